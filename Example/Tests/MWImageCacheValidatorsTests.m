@@ -0,0 +1,139 @@
+//
+//  MWImageCacheValidatorsTests.m
+//  MWWebImageTests
+//
+//  The validators stored with the cached images, and the conditional refresh of `MWWebImageRefreshCached`: an unchanged image costs a 304 without body, a changed one is downloaded again.
+//
+
+#import "MWWebImageTestCase.h"
+
+@interface MWImageCacheValidatorsTests : MWWebImageTestCase
+
+@property (nonatomic, strong) NSURL *imageURL;
+
+@end
+
+@implementation MWImageCacheValidatorsTests
+
+- (void)setUp
+{
+    [super setUp];
+    self.imageURL = [self URLForPath:@"/validated.png"];
+    [self setImageWithSize:CGSizeMake(64, 64)];
+}
+
+- (void)setImageWithSize:(CGSize)size
+{
+    UIImage *image = [MWWebImageTestCase sampleImageWithSize:size];
+    [self.localLoader setData:[[MWImageIOCoder sharedCoder] encodedDataWithImage:image format:MWImageFormatPNG options:nil] forPath:self.imageURL.path];
+}
+
+- (MWImageCacheValidators *)storedValidators
+{
+    __block MWImageCacheValidators *storedValidators;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Query the validators"];
+    [self.imageCache queryValidatorsForKey:[self.manager cacheKeyForURL:self.imageURL] completion:^(MWImageCacheValidators *validators) {
+        storedValidators = validators;
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:kMWTestLoadTimeout handler:nil];
+    return storedValidators;
+}
+
+// Refresh the cached image, and return the final status code of the download and the images delivered
+- (NSInteger)refreshDeliveringImages:(NSMutableArray<UIImage *> *)images
+{
+    NSURL *url = self.imageURL;
+    __block NSInteger statusCode = 0;
+    [self expectationForNotification:MWWebImageDownloadStopNotification object:nil handler:^BOOL(NSNotification *notification) {
+        MWWebImageDownloaderOperation *operation = notification.object;
+        if (![operation.request.URL isEqual:url]) {
+            return NO;
+        }
+        statusCode = ((NSHTTPURLResponse *)operation.response).statusCode;
+        return YES;
+    }];
+    [self.manager loadImageWithURL:url options:MWWebImageRefreshCached progress:nil completed:^(UIImage *image, NSData *data, NSError *error, MWImageCacheType cacheType, BOOL finished, NSURL *imageURL) {
+        XCTAssertNil(error);
+        if (image) {
+            [images addObject:image];
+        }
+    }];
+    [self waitForExpectationsWithTimeout:kMWTestLoadTimeout handler:nil];
+    // The completion blocks of the download are called after its notification
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Main queue drained"];
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [expectation fulfill];
+    });
+    [self waitForExpectationsWithTimeout:kMWTestLoadTimeout handler:nil];
+    return statusCode;
+}
+
+- (void)testValidatorsAreStoredWithTheImage
+{
+    [self loadImageWithURL:self.imageURL options:0 context:nil completion:^(UIImage *image, NSError *error, MWImageCacheType cacheType) {
+        XCTAssertNotNil(image);
+    }];
+    MWImageCacheValidators *validators = [self storedValidators];
+    XCTAssertNotNil(validators.entityTag);
+    // `Cache-Control: no-cache`, always revalidated
+    XCTAssertEqual(validators.maxAge, 0);
+    XCTAssertFalse(validators.isFresh);
+}
+
+- (void)testUnchangedImageIsRevalidatedWithNotModified
+{
+    [self loadImageWithURL:self.imageURL options:0 context:nil completion:^(UIImage *image, NSError *error, MWImageCacheType cacheType) {
+        XCTAssertNotNil(image);
+    }];
+    MWImageCacheValidators *downloadedValidators = [self storedValidators];
+    NSMutableArray<UIImage *> *images = [NSMutableArray array];
+    NSInteger statusCode = [self refreshDeliveringImages:images];
+    XCTAssertEqual(statusCode, 304);
+    XCTAssertEqual(self.localLoader.requestCount, 2);
+    // Only the cached image, the 304 does not call the completion again
+    XCTAssertEqual(images.count, 1);
+    MWImageCacheValidators *revalidatedValidators = [self storedValidators];
+    XCTAssertEqualObjects(revalidatedValidators.entityTag, downloadedValidators.entityTag);
+    XCTAssertGreaterThan(revalidatedValidators.validatedDate.timeIntervalSinceReferenceDate, downloadedValidators.validatedDate.timeIntervalSinceReferenceDate);
+}
+
+- (void)testChangedImageIsDownloadedAgain
+{
+    [self loadImageWithURL:self.imageURL options:0 context:nil completion:^(UIImage *image, NSError *error, MWImageCacheType cacheType) {
+        XCTAssertNotNil(image);
+    }];
+    MWImageCacheValidators *downloadedValidators = [self storedValidators];
+    [self setImageWithSize:CGSizeMake(32, 32)];
+    NSMutableArray<UIImage *> *images = [NSMutableArray array];
+    NSInteger statusCode = [self refreshDeliveringImages:images];
+    XCTAssertEqual(statusCode, 200);
+    // The cached image, then the changed one
+    XCTAssertEqual(images.count, 2);
+    XCTAssertEqual(images.lastObject.size.width, 32);
+    XCTAssertNotEqualObjects([self storedValidators].entityTag, downloadedValidators.entityTag);
+}
+
+- (void)testCancelAfterTheCachedImageDoesNotCompleteAgain
+{
+    [self loadImageWithURL:self.imageURL options:0 context:nil completion:^(UIImage *image, NSError *error, MWImageCacheType cacheType) {
+        XCTAssertNotNil(image);
+    }];
+    __block NSUInteger completionCount = 0;
+    MWWebImageCombinedOperation *operation = [self.manager loadImageWithURL:self.imageURL options:MWWebImageRefreshCached progress:nil completed:^(UIImage *image, NSData *data, NSError *error, MWImageCacheType cacheType, BOOL finished, NSURL *imageURL) {
+        XCTAssertNotNil(image);
+        XCTAssertNil(error);
+        XCTAssertTrue(finished);
+        completionCount++;
+    }];
+    // The memory hit is delivered at once, the validators are still being queried
+    XCTAssertEqual(completionCount, 1);
+    [operation cancel];
+    // Queried after the validators of the load, on the same queues
+    [self storedValidators];
+    XCTAssertEqual(completionCount, 1);
+    XCTAssertFalse(self.manager.isRunning);
+    XCTAssertEqual(self.localLoader.requestCount, 1);
+}
+
+@end
@@ -0,0 +1,154 @@
+//
+//  MWImageCoderTests.m
+//  MWWebImageTests
+//
+//  The coders backed by the optional codec libraries (see the subspecs of the podspec), compared with Image/IO on the same data.
+//  A coder whose library is not linked can't decode, its tests are skipped.
+//
+
+@import XCTest;
+#import <MWWebImage/MWWebImage.h>
+#import "MWWebImageTestCase.h"
+
+static const NSUInteger kMWDecodeIterations = 5;
+
+@interface MWImageCoderTests : XCTestCase
+
+@end
+
+@implementation MWImageCoderTests
+
+#pragma mark - Helpers
+
++ (NSDictionary<MWImageCoderOption, id> *)thumbnailOptionsWithPixelSize:(CGSize)pixelSize
+{
+    return @{MWImageCoderDecodeThumbnailPixelSize : [NSValue valueWithCGSize:pixelSize]};
+}
+
+// The average decode time, with the bitmap forced so that the lazy decode of Image/IO is counted too
+- (CFTimeInterval)decodeTimeOfData:(NSData *)data coder:(id<MWImageCoder>)coder options:(NSDictionary<MWImageCoderOption, id> *)options
+{
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger i = 0; i < kMWDecodeIterations; i++) {
+        @autoreleasepool {
+            UIImage *image = [coder decodedImageWithData:data options:options];
+            XCTAssertNotNil([MWImageCoderHelper decodedImageWithImage:image]);
+        }
+    }
+    return (CFAbsoluteTimeGetCurrent() - start) / kMWDecodeIterations;
+}
+
+// Decode with the coder and with Image/IO, check they agree on the pixel size, and report both decode times
+- (void)compareDecodingOfData:(NSData *)data withCoder:(id<MWImageCoder>)coder options:(NSDictionary<MWImageCoderOption, id> *)options
+{
+    UIImage *image = [coder decodedImageWithData:data options:options];
+    XCTAssertNotNil(image);
+    CFTimeInterval coderTime = [self decodeTimeOfData:data coder:coder options:options];
+    MWImageIOCoder *referenceCoder = [MWImageIOCoder sharedCoder];
+    if (![referenceCoder canDecodeFromData:data]) {
+        NSLog(@"%@ decoded %lu bytes in %.1fms, Image/IO can't decode them", NSStringFromClass([coder class]), (unsigned long)data.length, coderTime * 1000);
+        return;
+    }
+    UIImage *referenceImage = [referenceCoder decodedImageWithData:data options:options];
+    XCTAssertEqual(CGImageGetWidth(image.CGImage), CGImageGetWidth(referenceImage.CGImage));
+    XCTAssertEqual(CGImageGetHeight(image.CGImage), CGImageGetHeight(referenceImage.CGImage));
+    CFTimeInterval referenceTime = [self decodeTimeOfData:data coder:referenceCoder options:options];
+    NSLog(@"%@ decoded %lu bytes in %.1fms, Image/IO in %.1fms", NSStringFromClass([coder class]), (unsigned long)data.length, coderTime * 1000, referenceTime * 1000);
+}
+
+#pragma mark - WebP
+
+- (NSData *)sampleWebPData
+{
+    MWImageWebPCoder *coder = [MWImageWebPCoder sharedCoder];
+    if (![coder canEncodeToFormat:MWImageFormatWebP]) {
+        return nil;
+    }
+    UIImage *image = [MWWebImageTestCase sampleImageWithSize:CGSizeMake(2048, 1536)];
+    return [coder encodedDataWithImage:image format:MWImageFormatWebP options:@{MWImageCoderEncodeCompressionQuality : @0.8}];
+}
+
+- (void)testWebPDecodeComparedWithImageIO
+{
+    NSData *data = [self sampleWebPData];
+    XCTSkipUnless(data != nil, @"libwebp is not linked, add the WebP subspec");
+    XCTAssertTrue([[MWImageWebPCoder sharedCoder] canDecodeFromData:data]);
+    [self compareDecodingOfData:data withCoder:[MWImageWebPCoder sharedCoder] options:nil];
+}
+
+- (void)testWebPThumbnailDecodeComparedWithImageIO
+{
+    NSData *data = [self sampleWebPData];
+    XCTSkipUnless(data != nil, @"libwebp is not linked, add the WebP subspec");
+    NSDictionary<MWImageCoderOption, id> *options = [self.class thumbnailOptionsWithPixelSize:CGSizeMake(400, 300)];
+    UIImage *image = [[MWImageWebPCoder sharedCoder] decodedImageWithData:data options:options];
+    XCTAssertEqual(CGImageGetWidth(image.CGImage), 400);
+    XCTAssertEqual(CGImageGetHeight(image.CGImage), 300);
+    [self compareDecodingOfData:data withCoder:[MWImageWebPCoder sharedCoder] options:options];
+}
+
+#pragma mark - AVIF
+
+- (NSData *)sampleAVIFData
+{
+    MWImageAVIFCoder *coder = [MWImageAVIFCoder sharedCoder];
+    if (![coder canEncodeToFormat:MWImageFormatAVIF]) {
+        return nil;
+    }
+    UIImage *image = [MWWebImageTestCase sampleImageWithSize:CGSizeMake(1024, 768)];
+    return [coder encodedDataWithImage:image format:MWImageFormatAVIF options:@{MWImageCoderEncodeCompressionQuality : @0.6}];
+}
+
+- (void)testAVIFDecodeComparedWithImageIO
+{
+    NSData *data = [self sampleAVIFData];
+    XCTSkipUnless(data != nil, @"libavif is not linked, add the AVIF subspec");
+    XCTAssertEqual([NSData MW_imageFormatForImageData:data], MWImageFormatAVIF);
+    XCTAssertTrue([[MWImageAVIFCoder sharedCoder] canDecodeFromData:data]);
+    [self compareDecodingOfData:data withCoder:[MWImageAVIFCoder sharedCoder] options:nil];
+}
+
+#pragma mark - JPEG
+
+- (void)testJPEGThumbnailDecodeComparedWithImageIO
+{
+    UIImage *sampleImage = [MWWebImageTestCase sampleImageWithSize:CGSizeMake(4032, 3024)];
+    NSData *data = [[MWImageIOCoder sharedCoder] encodedDataWithImage:sampleImage format:MWImageFormatJPEG options:@{MWImageCoderEncodeCompressionQuality : @0.8}];
+    XCTAssertNotNil(data);
+    XCTSkipUnless([[MWImageJPEGCoder sharedCoder] canDecodeFromData:data], @"libjpeg-turbo is not linked, add the JPEGTurbo subspec");
+    // Scaled in the DCT domain to 1/8, then resampled to the thumbnail size
+    NSDictionary<MWImageCoderOption, id> *options = [self.class thumbnailOptionsWithPixelSize:CGSizeMake(400, 300)];
+    UIImage *image = [[MWImageJPEGCoder sharedCoder] decodedImageWithData:data options:options];
+    XCTAssertEqual(CGImageGetWidth(image.CGImage), 400);
+    XCTAssertEqual(CGImageGetHeight(image.CGImage), 300);
+    XCTAssertTrue(image.MW_iMWecoded);
+    [self compareDecodingOfData:data withCoder:[MWImageJPEGCoder sharedCoder] options:options];
+}
+
+#pragma mark - PNG
+
+- (void)testPNGDecodeComparedWithImageIO
+{
+    UIImage *sampleImage = [MWWebImageTestCase sampleImageWithSize:CGSizeMake(2048, 1536)];
+    NSData *data = [[MWImageIOCoder sharedCoder] encodedDataWithImage:sampleImage format:MWImageFormatPNG options:nil];
+    XCTAssertNotNil(data);
+    XCTSkipUnless([[MWImagePNGCoder sharedCoder] canDecodeFromData:data], @"libdeflate is not linked (add the PNG subspec), or the PNG is color managed");
+    UIImage *image = [[MWImagePNGCoder sharedCoder] decodedImageWithData:data options:nil];
+    XCTAssertTrue(image.MW_iMWecoded);
+    [self compareDecodingOfData:data withCoder:[MWImagePNGCoder sharedCoder] options:nil];
+}
+
+- (void)testPNGHeaderOverPixelLimitIsNotAllocated
+{
+    // A valid signature and IHDR claiming 100000x100000 RGBA, followed by a tiny IDAT
+    static const uint8_t bytes[] = {
+        0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n',
+        0x00, 0x00, 0x00, 0x0D, 'I', 'H', 'D', 'R', 0x00, 0x01, 0x86, 0xA0, 0x00, 0x01, 0x86, 0xA0, 0x08, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x02, 'I', 'D', 'A', 'T', 0x78, 0x9C, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 'I', 'E', 'N', 'D', 0xAE, 0x42, 0x60, 0x82,
+    };
+    NSData *data = [NSData dataWithBytes:bytes length:sizeof(bytes)];
+    XCTAssertNil([[MWImagePNGCoder sharedCoder] decodedImageWithData:data options:nil]);
+}
+
+@end
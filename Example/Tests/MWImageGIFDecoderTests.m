@@ -0,0 +1,395 @@
+//
+//  MWImageGIFDecoderTests.m
+//  MWWebImageTests
+//
+//  The native GIF decoder on hand-built files: the disposal methods and the keyframe replay compared with Image/IO, and the malformed input of an untrusted download.
+//
+
+#import "MWWebImageTestCase.h"
+#import <MWWebImage/MWImageGIFDecoder.h>
+
+// The 4 colors of the global color table: black, red, green, blue
+static const uint8_t kMWTestGIFColors[4][3] = {{0, 0, 0}, {255, 0, 0}, {0, 255, 0}, {0, 0, 255}};
+// The minimum code size of the 4 colors, the codes are 3 bits since the table is cleared every 2 literals
+static const uint8_t kMWTestGIFMinCodeSize = 2;
+static const uint32_t kMWTestGIFClearCode = 4;
+static const uint32_t kMWTestGIFEndCode = 5;
+
+typedef NS_ENUM(uint8_t, MWTestGIFDisposal) {
+    MWTestGIFDisposalNone = 0,
+    MWTestGIFDisposalKeep = 1,
+    MWTestGIFDisposalBackground = 2,
+    MWTestGIFDisposalPrevious = 3,
+};
+
+// The color index of a frame pixel, in frame coordinates
+typedef uint8_t(^MWTestGIFPixelBlock)(size_t x, size_t y);
+
+@interface MWImageGIFDecoderTests : XCTestCase
+
+@end
+
+@implementation MWImageGIFDecoderTests
+
+#pragma mark - Building
+
+- (NSMutableData *)GIFDataWithCanvasWidth:(uint16_t)width height:(uint16_t)height
+{
+    NSMutableData *data = [NSMutableData dataWithBytes:"GIF89a" length:6];
+    uint8_t screen[7] = {width & 0xFF, width >> 8, height & 0xFF, height >> 8, 0x81, 0, 0};
+    [data appendBytes:screen length:sizeof(screen)];
+    [data appendBytes:kMWTestGIFColors length:sizeof(kMWTestGIFColors)];
+    // Loops forever
+    uint8_t netscape[19] = {0x21, 0xFF, 11, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 3, 1, 0, 0, 0};
+    [data appendBytes:netscape length:sizeof(netscape)];
+    return data;
+}
+
+// The codes packed LSB first, in data sub-blocks with their terminator
+- (NSData *)subBlocksWithCodes:(NSArray<NSNumber *> *)codes
+{
+    NSMutableData *stream = [NSMutableData data];
+    uint32_t bitBuffer = 0;
+    uint32_t bitCount = 0;
+    for (NSNumber *code in codes) {
+        bitBuffer |= code.unsignedIntValue << bitCount;
+        bitCount += 3;
+        while (bitCount >= 8) {
+            uint8_t byte = bitBuffer & 0xFF;
+            [stream appendBytes:&byte length:1];
+            bitBuffer >>= 8;
+            bitCount -= 8;
+        }
+    }
+    if (bitCount > 0) {
+        uint8_t byte = bitBuffer & 0xFF;
+        [stream appendBytes:&byte length:1];
+    }
+    NSMutableData *blocks = [NSMutableData dataWithBytes:&kMWTestGIFMinCodeSize length:1];
+    for (NSUInteger offset = 0; offset < stream.length; offset += 255) {
+        uint8_t blockSize = MIN(255, stream.length - offset);
+        [blocks appendBytes:&blockSize length:1];
+        [blocks appendData:[stream subdataWithRange:NSMakeRange(offset, blockSize)]];
+    }
+    uint8_t terminator = 0;
+    [blocks appendBytes:&terminator length:1];
+    return blocks;
+}
+
+// Only literals, clearing the table before it would grow the code size
+- (NSArray<NSNumber *> *)codesWithColorIndexes:(NSData *)colorIndexes
+{
+    NSMutableArray<NSNumber *> *codes = [NSMutableArray array];
+    const uint8_t *bytes = colorIndexes.bytes;
+    for (NSUInteger i = 0; i < colorIndexes.length; i++) {
+        if (i % 2 == 0) {
+            [codes addObject:@(kMWTestGIFClearCode)];
+        }
+        [codes addObject:@(bytes[i])];
+    }
+    [codes addObject:@(kMWTestGIFEndCode)];
+    return codes;
+}
+
+- (void)appendControlToData:(NSMutableData *)data disposal:(MWTestGIFDisposal)disposal transparentIndex:(int)transparentIndex
+{
+    uint8_t flags = (uint8_t)(disposal << 2) | (transparentIndex >= 0 ? 1 : 0);
+    uint8_t control[8] = {0x21, 0xF9, 4, flags, 10, 0, transparentIndex >= 0 ? (uint8_t)transparentIndex : 0, 0};
+    [data appendBytes:control length:sizeof(control)];
+}
+
+- (void)appendDescriptorToData:(NSMutableData *)data left:(uint16_t)left top:(uint16_t)top width:(uint16_t)width height:(uint16_t)height interlaced:(BOOL)interlaced
+{
+    uint8_t descriptor[10] = {0x2C, left & 0xFF, left >> 8, top & 0xFF, top >> 8, width & 0xFF, width >> 8, height & 0xFF, height >> 8, interlaced ? 0x40 : 0};
+    [data appendBytes:descriptor length:sizeof(descriptor)];
+}
+
+- (void)appendFrameToData:(NSMutableData *)data left:(uint16_t)left top:(uint16_t)top width:(uint16_t)width height:(uint16_t)height disposal:(MWTestGIFDisposal)disposal transparentIndex:(int)transparentIndex interlaced:(BOOL)interlaced pixels:(MWTestGIFPixelBlock)pixels
+{
+    [self appendControlToData:data disposal:disposal transparentIndex:transparentIndex];
+    [self appendDescriptorToData:data left:left top:top width:width height:height interlaced:interlaced];
+    // The rows in their stored order
+    NSMutableArray<NSNumber *> *rows = [NSMutableArray array];
+    if (interlaced) {
+        const size_t starts[4] = {0, 4, 2, 1};
+        const size_t steps[4] = {8, 8, 4, 2};
+        for (size_t pass = 0; pass < 4; pass++) {
+            for (size_t row = starts[pass]; row < height; row += steps[pass]) {
+                [rows addObject:@(row)];
+            }
+        }
+    } else {
+        for (size_t row = 0; row < height; row++) {
+            [rows addObject:@(row)];
+        }
+    }
+    NSMutableData *colorIndexes = [NSMutableData dataWithCapacity:(size_t)width * height];
+    for (NSNumber *row in rows) {
+        for (size_t x = 0; x < width; x++) {
+            uint8_t colorIndex = pixels(x, row.unsignedIntegerValue);
+            [colorIndexes appendBytes:&colorIndex length:1];
+        }
+    }
+    [data appendData:[self subBlocksWithCodes:[self codesWithColorIndexes:colorIndexes]]];
+}
+
+- (void)appendFrameToData:(NSMutableData *)data left:(uint16_t)left top:(uint16_t)top width:(uint16_t)width height:(uint16_t)height disposal:(MWTestGIFDisposal)disposal transparentIndex:(int)transparentIndex pixels:(MWTestGIFPixelBlock)pixels
+{
+    [self appendFrameToData:data left:left top:top width:width height:height disposal:disposal transparentIndex:transparentIndex interlaced:NO pixels:pixels];
+}
+
+- (void)appendTrailerToData:(NSMutableData *)data
+{
+    uint8_t trailer = 0x3B;
+    [data appendBytes:&trailer length:1];
+}
+
+// 8x8, every disposal method, with keyframes at 0 and 4
+- (NSData *)disposalGIFData
+{
+    NSMutableData *data = [self GIFDataWithCanvasWidth:8 height:8];
+    [self appendFrameToData:data left:0 top:0 width:8 height:8 disposal:MWTestGIFDisposalKeep transparentIndex:-1 pixels:^uint8_t(size_t x, size_t y) {
+        return 1;
+    }];
+    [self appendFrameToData:data left:2 top:2 width:4 height:4 disposal:MWTestGIFDisposalBackground transparentIndex:-1 pixels:^uint8_t(size_t x, size_t y) {
+        return 2;
+    }];
+    [self appendFrameToData:data left:0 top:0 width:4 height:4 disposal:MWTestGIFDisposalPrevious transparentIndex:0 pixels:^uint8_t(size_t x, size_t y) {
+        return (x + y) % 2 == 0 ? 3 : 0;
+    }];
+    [self appendFrameToData:data left:4 top:0 width:4 height:8 disposal:MWTestGIFDisposalNone transparentIndex:-1 pixels:^uint8_t(size_t x, size_t y) {
+        return 2;
+    }];
+    [self appendFrameToData:data left:0 top:0 width:8 height:8 disposal:MWTestGIFDisposalKeep transparentIndex:-1 pixels:^uint8_t(size_t x, size_t y) {
+        return y % 2 == 0 ? 1 : 3;
+    }];
+    [self appendFrameToData:data left:1 top:1 width:2 height:2 disposal:MWTestGIFDisposalBackground transparentIndex:-1 pixels:^uint8_t(size_t x, size_t y) {
+        return 3;
+    }];
+    [self appendFrameToData:data left:0 top:4 width:8 height:4 disposal:MWTestGIFDisposalNone transparentIndex:0 pixels:^uint8_t(size_t x, size_t y) {
+        return x % 2 == 0 ? 2 : 0;
+    }];
+    [self appendTrailerToData:data];
+    return data;
+}
+
+#pragma mark - Pixels
+
+// Premultiplied RGBA bytes, top row first
+- (NSData *)pixelsOfImage:(CGImageRef)imageRef
+{
+    size_t width = CGImageGetWidth(imageRef);
+    size_t height = CGImageGetHeight(imageRef);
+    NSMutableData *pixels = [NSMutableData dataWithLength:width * height * 4];
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = CGBitmapContextCreate(pixels.mutableBytes, width, height, 8, width * 4, colorSpace, kCGBitmapByteOrderDefault | kCGImageAlphaPremultipliedLast);
+    CGColorSpaceRelease(colorSpace);
+    CGContextSetBlendMode(context, kCGBlendModeCopy);
+    CGContextDrawImage(context, CGRectMake(0, 0, width, height), imageRef);
+    CGContextRelease(context);
+    return pixels;
+}
+
+- (NSData *)pixelsOfDecoder:(MWImageGIFDecoder *)decoder atIndex:(NSUInteger)index
+{
+    CGImageRef imageRef = [decoder createFrameAtIndex:index];
+    if (!imageRef) {
+        return nil;
+    }
+    NSData *pixels = [self pixelsOfImage:imageRef];
+    CGImageRelease(imageRef);
+    return pixels;
+}
+
+// The RGBA of a pixel, as 0xRRGGBBAA
+- (uint32_t)pixelOfPixels:(NSData *)pixels width:(size_t)width x:(size_t)x y:(size_t)y
+{
+    const uint8_t *bytes = (const uint8_t *)pixels.bytes + (y * width + x) * 4;
+    return (uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16 | (uint32_t)bytes[2] << 8 | bytes[3];
+}
+
+// The color management of Image/IO may be a step off the palette
+- (void)assertPixels:(NSData *)pixels equalToPixels:(NSData *)expectedPixels message:(NSString *)message
+{
+    XCTAssertEqual(pixels.length, expectedPixels.length, @"%@", message);
+    const uint8_t *bytes = pixels.bytes;
+    const uint8_t *expectedBytes = expectedPixels.bytes;
+    for (NSUInteger i = 0; i < MIN(pixels.length, expectedPixels.length); i++) {
+        if (abs((int)bytes[i] - (int)expectedBytes[i]) > 2) {
+            XCTFail(@"%@: pixel %lu component %lu is %d instead of %d", message, (unsigned long)i / 4, (unsigned long)i % 4, bytes[i], expectedBytes[i]);
+            return;
+        }
+    }
+}
+
+#pragma mark - Disposal and keyframes
+
+- (void)testFramesMatchImageIO
+{
+    NSData *data = [self disposalGIFData];
+    MWImageGIFDecoder *decoder = [[MWImageGIFDecoder alloc] initWithData:data];
+    XCTAssertNotNil(decoder);
+    XCTAssertTrue(CGSizeEqualToSize(decoder.canvasSize, CGSizeMake(8, 8)));
+    XCTAssertEqual(decoder.loopCount, 0);
+    XCTAssertEqualWithAccuracy([decoder durationAtIndex:0], 0.1, 0.001);
+
+    CGImageSourceRef source = CGImageSourceCreateWithData((__bridge CFDataRef)data, NULL);
+    XCTAssertEqual(decoder.frameCount, CGImageSourceGetCount(source));
+    for (NSUInteger i = 0; i < decoder.frameCount; i++) {
+        CGImageRef imageRef = CGImageSourceCreateImageAtIndex(source, i, NULL);
+        NSData *expectedPixels = [self pixelsOfImage:imageRef];
+        CGImageRelease(imageRef);
+        [self assertPixels:[self pixelsOfDecoder:decoder atIndex:i] equalToPixels:expectedPixels message:[NSString stringWithFormat:@"Frame %lu", (unsigned long)i]];
+    }
+    CFRelease(source);
+}
+
+- (void)testDisposalMethods
+{
+    MWImageGIFDecoder *decoder = [[MWImageGIFDecoder alloc] initWithData:[self disposalGIFData]];
+    NSData *pixels = [self pixelsOfDecoder:decoder atIndex:2];
+    // Cleared to transparent by the background disposal of frame 1, under a transparent pixel of frame 2
+    XCTAssertEqual([self pixelOfPixels:pixels width:8 x:3 y:2], 0x00000000);
+    XCTAssertEqual([self pixelOfPixels:pixels width:8 x:2 y:2], 0x0000FFFF);
+    XCTAssertEqual([self pixelOfPixels:pixels width:8 x:1 y:0], 0xFF0000FF);
+
+    pixels = [self pixelsOfDecoder:decoder atIndex:3];
+    // Frame 2 restored the canvas under it
+    XCTAssertEqual([self pixelOfPixels:pixels width:8 x:2 y:2], 0x00000000);
+    XCTAssertEqual([self pixelOfPixels:pixels width:8 x:0 y:0], 0xFF0000FF);
+    XCTAssertEqual([self pixelOfPixels:pixels width:8 x:4 y:4], 0x00FF00FF);
+}
+
+- (void)testKeyframeIndexes
+{
+    MWImageGIFDecoder *decoder = [[MWImageGIFDecoder alloc] initWithData:[self disposalGIFData]];
+    NSMutableIndexSet *expectedIndexes = [NSMutableIndexSet indexSetWithIndex:0];
+    [expectedIndexes addIndex:4];
+    XCTAssertEqualObjects(decoder.keyframeIndexes, expectedIndexes);
+}
+
+- (void)testRandomAccessReplaysFromTheKeyframe
+{
+    NSData *data = [self disposalGIFData];
+    MWImageGIFDecoder *sequentialDecoder = [[MWImageGIFDecoder alloc] initWithData:data];
+    NSMutableArray<NSData *> *sequentialPixels = [NSMutableArray array];
+    for (NSUInteger i = 0; i < sequentialDecoder.frameCount; i++) {
+        [sequentialPixels addObject:[self pixelsOfDecoder:sequentialDecoder atIndex:i]];
+    }
+
+    // Backwards, across the keyframe, the same frame twice, and the frame after the current one
+    MWImageGIFDecoder *decoder = [[MWImageGIFDecoder alloc] initWithData:data];
+    for (NSNumber *index in @[@3, @6, @1, @5, @5, @0, @2, @3, @4, @6]) {
+        NSUInteger i = index.unsignedIntegerValue;
+        [self assertPixels:[self pixelsOfDecoder:decoder atIndex:i] equalToPixels:sequentialPixels[i] message:[NSString stringWithFormat:@"Frame %lu", (unsigned long)i]];
+    }
+    XCTAssertNil([self pixelsOfDecoder:decoder atIndex:decoder.frameCount]);
+}
+
+- (void)testFramesLargerThanTheCanvasAreClipped
+{
+    for (NSNumber *interlaced in @[@NO, @YES]) {
+        NSMutableData *data = [self GIFDataWithCanvasWidth:8 height:8];
+        [self appendFrameToData:data left:0 top:0 width:16 height:16 disposal:MWTestGIFDisposalNone transparentIndex:-1 interlaced:interlaced.boolValue pixels:^uint8_t(size_t x, size_t y) {
+            return x < 8 && y < 8 ? 2 : 1;
+        }];
+        [self appendTrailerToData:data];
+        MWImageGIFDecoder *decoder = [[MWImageGIFDecoder alloc] initWithData:data];
+        NSData *pixels = [self pixelsOfDecoder:decoder atIndex:0];
+        XCTAssertNotNil(pixels);
+        for (size_t y = 0; y < 8; y++) {
+            for (size_t x = 0; x < 8; x++) {
+                XCTAssertEqual([self pixelOfPixels:pixels width:8 x:x y:y], 0x00FF00FF, @"Interlaced %@", interlaced);
+            }
+        }
+    }
+}
+
+#pragma mark - Malformed input
+
+- (void)testFrameOverThePixelLimitIsRejected
+{
+    // A few bytes declaring a 65535x65535 frame, 4 GB of color indexes
+    NSMutableData *data = [self GIFDataWithCanvasWidth:10 height:10];
+    [self appendControlToData:data disposal:MWTestGIFDisposalNone transparentIndex:-1];
+    [self appendDescriptorToData:data left:0 top:0 width:65535 height:65535 interlaced:NO];
+    [data appendData:[self subBlocksWithCodes:@[@(kMWTestGIFClearCode), @1, @(kMWTestGIFEndCode)]]];
+    [self appendTrailerToData:data];
+    XCTAssertNil([[MWImageGIFDecoder alloc] initWithData:data]);
+}
+
+- (void)testFrameOutsideTheCanvasKeepsTheCanvas
+{
+    NSMutableData *data = [self GIFDataWithCanvasWidth:4 height:4];
+    [self appendFrameToData:data left:0 top:0 width:4 height:4 disposal:MWTestGIFDisposalKeep transparentIndex:-1 pixels:^uint8_t(size_t x, size_t y) {
+        return 1;
+    }];
+    [self appendFrameToData:data left:100 top:100 width:4 height:4 disposal:MWTestGIFDisposalNone transparentIndex:-1 pixels:^uint8_t(size_t x, size_t y) {
+        return 2;
+    }];
+    [self appendTrailerToData:data];
+    MWImageGIFDecoder *decoder = [[MWImageGIFDecoder alloc] initWithData:data];
+    XCTAssertEqual(decoder.frameCount, 2);
+    NSData *pixels = [self pixelsOfDecoder:decoder atIndex:1];
+    XCTAssertEqual([self pixelOfPixels:pixels width:4 x:3 y:3], 0xFF0000FF);
+}
+
+- (void)testTruncatedLZWDataIsPadded
+{
+    // 3 pixels of 16, without the end code
+    NSMutableData *data = [self GIFDataWithCanvasWidth:4 height:4];
+    [self appendControlToData:data disposal:MWTestGIFDisposalNone transparentIndex:-1];
+    [self appendDescriptorToData:data left:0 top:0 width:4 height:4 interlaced:NO];
+    [data appendData:[self subBlocksWithCodes:@[@(kMWTestGIFClearCode), @1, @2, @(kMWTestGIFClearCode), @3]]];
+    [self appendTrailerToData:data];
+    MWImageGIFDecoder *decoder = [[MWImageGIFDecoder alloc] initWithData:data];
+    NSData *pixels = [self pixelsOfDecoder:decoder atIndex:0];
+    XCTAssertNotNil(pixels);
+    XCTAssertEqual([self pixelOfPixels:pixels width:4 x:0 y:0], 0xFF0000FF);
+    XCTAssertEqual([self pixelOfPixels:pixels width:4 x:1 y:0], 0x00FF00FF);
+    XCTAssertEqual([self pixelOfPixels:pixels width:4 x:2 y:0], 0x0000FFFF);
+    // The first color, opaque without a transparent index
+    XCTAssertEqual([self pixelOfPixels:pixels width:4 x:3 y:3], 0x000000FF);
+}
+
+- (void)testTruncatedFrameIsDropped
+{
+    // The last frame stops in its data sub-blocks
+    NSMutableData *data = [self GIFDataWithCanvasWidth:4 height:4];
+    [self appendFrameToData:data left:0 top:0 width:4 height:4 disposal:MWTestGIFDisposalNone transparentIndex:-1 pixels:^uint8_t(size_t x, size_t y) {
+        return 1;
+    }];
+    [self appendControlToData:data disposal:MWTestGIFDisposalNone transparentIndex:-1];
+    [self appendDescriptorToData:data left:0 top:0 width:4 height:4 interlaced:NO];
+    uint8_t truncatedBlocks[3] = {kMWTestGIFMinCodeSize, 200, 0x0C};
+    [data appendBytes:truncatedBlocks length:sizeof(truncatedBlocks)];
+    MWImageGIFDecoder *decoder = [[MWImageGIFDecoder alloc] initWithData:data];
+    XCTAssertEqual(decoder.frameCount, 1);
+
+    // Nothing but the header
+    XCTAssertNil([[MWImageGIFDecoder alloc] initWithData:[data subdataWithRange:NSMakeRange(0, 13)]]);
+}
+
+- (void)testInvalidCodesFailTheFrame
+{
+    NSArray<NSArray<NSNumber *> *> *invalidCodes = @[
+        // The first code after a clear is not a literal
+        @[@(kMWTestGIFClearCode), @6],
+        // A code past the next one to be defined
+        @[@(kMWTestGIFClearCode), @1, @7],
+    ];
+    for (NSArray<NSNumber *> *codes in invalidCodes) {
+        NSMutableData *data = [self GIFDataWithCanvasWidth:4 height:4];
+        [self appendControlToData:data disposal:MWTestGIFDisposalNone transparentIndex:-1];
+        [self appendDescriptorToData:data left:0 top:0 width:4 height:4 interlaced:NO];
+        [data appendData:[self subBlocksWithCodes:codes]];
+        [self appendTrailerToData:data];
+        MWImageGIFDecoder *decoder = [[MWImageGIFDecoder alloc] initWithData:data];
+        XCTAssertEqual(decoder.frameCount, 1);
+        CGImageRef imageRef = [decoder createFrameAtIndex:0];
+        XCTAssertTrue(imageRef == NULL, @"Codes %@", codes);
+        CGImageRelease(imageRef);
+    }
+}
+
+@end
@@ -0,0 +1,129 @@
+//
+//  MWImageHeaderParserTests.m
+//  MWWebImageTests
+//
+//  The header parser on the first bytes of a download, cut at every offset, and the decode budget of the downloader which relies on it.
+//
+
+#import "MWWebImageTestCase.h"
+
+@interface MWImageHeaderParserTests : MWWebImageTestCase
+
+@end
+
+@implementation MWImageHeaderParserTests
+
+// Every prefix either needs more data or gives the right size, and the whole header succeeds
+- (void)assertParsingPrefixesOfData:(NSData *)data format:(MWImageFormat)expectedFormat pixelSize:(CGSize)expectedPixelSize
+{
+    NSUInteger successLength = 0;
+    for (NSUInteger length = 0; length <= data.length && successLength == 0; length++) {
+        MWImageFormat format = MWImageFormatUndefined;
+        CGSize pixelSize = CGSizeZero;
+        MWImageHeaderParseStatus status = [MWImageHeaderParser parseHeaderWithData:[data subdataWithRange:NSMakeRange(0, length)] format:&format pixelSize:&pixelSize];
+        if (status == MWImageHeaderParseStatusSuccess) {
+            XCTAssertEqual(format, expectedFormat);
+            XCTAssertTrue(CGSizeEqualToSize(pixelSize, expectedPixelSize), @"%@ instead of %@", NSStringFromCGSize(pixelSize), NSStringFromCGSize(expectedPixelSize));
+            successLength = length;
+        } else {
+            XCTAssertEqual(status, MWImageHeaderParseStatusNeedMoreData, @"Prefix of %lu bytes", (unsigned long)length);
+        }
+    }
+    XCTAssertGreaterThan(successLength, 0);
+    // The header is near the start, not the whole image
+    XCTAssertLessThan(successLength, data.length);
+}
+
+- (NSData *)sampleDataWithFormat:(MWImageFormat)format
+{
+    UIImage *image = [MWWebImageTestCase sampleImageWithSize:CGSizeMake(300, 200)];
+    return [[MWImageIOCoder sharedCoder] encodedDataWithImage:image format:format options:nil];
+}
+
+#pragma mark - Formats
+
+- (void)testJPEGHeader
+{
+    [self assertParsingPrefixesOfData:[self sampleDataWithFormat:MWImageFormatJPEG] format:MWImageFormatJPEG pixelSize:CGSizeMake(300, 200)];
+}
+
+- (void)testPNGHeader
+{
+    [self assertParsingPrefixesOfData:[self sampleDataWithFormat:MWImageFormatPNG] format:MWImageFormatPNG pixelSize:CGSizeMake(300, 200)];
+}
+
+- (void)testGIFHeader
+{
+    [self assertParsingPrefixesOfData:[self sampleDataWithFormat:MWImageFormatGIF] format:MWImageFormatGIF pixelSize:CGSizeMake(300, 200)];
+}
+
+- (void)testHEICHeader
+{
+    XCTSkipUnless([[MWImageIOCoder sharedCoder] canEncodeToFormat:MWImageFormatHEIC], @"This device can't encode HEIC");
+    [self assertParsingPrefixesOfData:[self sampleDataWithFormat:MWImageFormatHEIC] format:MWImageFormatHEIC pixelSize:CGSizeMake(300, 200)];
+}
+
+- (void)testWebPHeader
+{
+    MWImageWebPCoder *coder = [MWImageWebPCoder sharedCoder];
+    XCTSkipUnless([coder canEncodeToFormat:MWImageFormatWebP], @"libwebp is not linked, add the WebP subspec");
+    UIImage *image = [MWWebImageTestCase sampleImageWithSize:CGSizeMake(300, 200)];
+    NSData *data = [coder encodedDataWithImage:image format:MWImageFormatWebP options:nil];
+    [self assertParsingPrefixesOfData:data format:MWImageFormatWebP pixelSize:CGSizeMake(300, 200)];
+}
+
+- (void)testUnknownDataIsUnsupported
+{
+    NSData *data = [@"<html><body>Not found</body></html>" dataUsingEncoding:NSUTF8StringEncoding];
+    XCTAssertEqual([MWImageHeaderParser parseHeaderWithData:data format:NULL pixelSize:NULL], MWImageHeaderParseStatusUnsupported);
+}
+
+- (void)testTruncatedPNGNeedsMoreData
+{
+    NSData *data = [self sampleDataWithFormat:MWImageFormatPNG];
+    // The signature and the IHDR chunk header, without the size
+    XCTAssertEqual([MWImageHeaderParser parseHeaderWithData:[data subdataWithRange:NSMakeRange(0, 16)] format:NULL pixelSize:NULL], MWImageHeaderParseStatusNeedMoreData);
+}
+
+#pragma mark - Decode budget
+
+- (MWWebImageManager *)managerWithMaxImagePixelCount:(NSUInteger)maxImagePixelCount
+{
+    MWWebImageDownloaderConfig *config = [self.class localDownloaderConfig];
+    config.maxImagePixelCount = maxImagePixelCount;
+    MWWebImageDownloader *downloader = [[MWWebImageDownloader alloc] initWithConfig:config];
+    [self addTeardownBlock:^{
+        [downloader invalidateSessionAndCancel:YES];
+    }];
+    return [[MWWebImageManager alloc] initWithCache:self.imageCache loader:downloader];
+}
+
+- (void)loadImageWithManager:(MWWebImageManager *)manager url:(NSURL *)url context:(MWWebImageContext *)context completion:(void(^)(UIImage *image, NSError *error))completion
+{
+    XCTestExpectation *expectation = [self expectationWithDescription:url.absoluteString];
+    [manager loadImageWithURL:url options:MWWebImageFromLoaderOnly context:context progress:nil completed:^(UIImage *image, NSData *data, NSError *error, MWImageCacheType cacheType, BOOL finished, NSURL *imageURL) {
+        completion(image, error);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:kMWTestLoadTimeout handler:nil];
+}
+
+- (void)testImageOverBudgetIsCancelledButNotBlocked
+{
+    NSURL *url = [self URLForPath:@"/large.png"];
+    UIImage *image = [MWWebImageTestCase sampleImageWithSize:CGSizeMake(512, 512)];
+    [self.localLoader setData:[[MWImageIOCoder sharedCoder] encodedDataWithImage:image format:MWImageFormatPNG options:nil] forPath:url.path];
+    MWWebImageManager *manager = [self managerWithMaxImagePixelCount:100 * 100];
+    [self loadImageWithManager:manager url:url context:nil completion:^(UIImage *image, NSError *error) {
+        XCTAssertNil(image);
+        XCTAssertEqual(error.code, MWWebImageErrorImageTooLarge);
+    }];
+    // A thumbnail fits the budget, the URL was not blocked by the failure
+    [self loadImageWithManager:manager url:url context:@{MWWebImageContextImageThumbnailPixelSize : [NSValue valueWithCGSize:CGSizeMake(64, 64)]} completion:^(UIImage *image, NSError *error) {
+        XCTAssertNil(error);
+        XCTAssertEqual(CGImageGetWidth(image.CGImage), 64);
+    }];
+    XCTAssertEqual(self.localLoader.requestCount, 2);
+}
+
+@end
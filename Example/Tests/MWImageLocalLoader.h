@@ -0,0 +1,113 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import <MWWebImage/MWWebImageCompat.h>
+#import <MWWebImage/MWImageLoader.h>
+
+/// The default URL scheme served by `MWImageLocalLoader` (`mwlocal://host/path`)
+FOUNDATION_EXPORT NSString * _Nonnull const MWImageLocalLoaderScheme;
+
+/**
+ The delivery profile of a local load: how long it waits before the first byte, how fast the bytes arrive and whether it fails.
+ */
+@interface MWImageLocalLoaderProfile : NSObject <NSCopying>
+
+/// The delay before the first byte, in seconds. Defaults to 0
+@property (nonatomic, assign) NSTimeInterval latency;
+/// The delivery rate, in bytes per second. 0 delivers everything at once. Defaults to 0
+@property (nonatomic, assign) double bandwidth;
+/// The bytes delivered per progress step. Defaults to 16KB
+@property (nonatomic, assign) NSUInteger chunkSize;
+/// The probability of a failure, between 0 and 1. The draw comes from the seeded generator of the loader, so the same requests in the same order fail the same way. Defaults to 0
+@property (nonatomic, assign) double failureRate;
+/// The bytes delivered before a failure happens, 0 to fail before the first byte. Defaults to 0
+@property (nonatomic, assign) NSUInteger failureOffset;
+/// The error of a failure. Defaults to `NSURLErrorNetworkConnectionLost`
+@property (nonatomic, copy, nonnull) NSError *failureError;
+/// The HTTP status code of a failure, such as 503, used instead of `failureError` and `failureOffset`. The loader fails with `MWWebImageErrorInvalidDownloadStatusCode`, `MWImageLocalURLProtocol` responds with this status. 0 to fail with `failureError`. Defaults to 0
+@property (nonatomic, assign) NSInteger failureStatusCode;
+/// The header fields of the failure response served by `MWImageLocalURLProtocol`, such as `Retry-After`. Defaults to nil
+@property (nonatomic, copy, nullable) NSDictionary<NSString *, NSString *> *failureHeaderFields;
+
+/**
+ A profile without latency, bandwidth limit or failure.
+ */
++ (nonnull instancetype)immediateProfile;
+
+/**
+ A profile with the given latency and bandwidth, without failure.
+
+ @param latency The delay before the first byte, in seconds
+ @param bandwidth The delivery rate, in bytes per second. 0 for unlimited
+ */
++ (nonnull instancetype)profileWithLatency:(NSTimeInterval)latency bandwidth:(double)bandwidth;
+
+@end
+
+/**
+ An image loader serving images from a local corpus, with scripted latency, bandwidth and failures. It does not touch the network, so the whole `MWWebImageManager` pipeline (cache, decoding, transform) can be benchmarked reproducibly, including on build hosts without network.
+ Register it with `-[MWImageLoadersManager addLoader:]`, or pass it as `MWWebImageContextImageLoader`.
+ The URL path is resolved against `corpusURL`, or against the data added with `setData:forPath:` first. Each load takes the next profile of `profileScript`, so a script like fast, fast, slow, failing replays the same way on every run.
+ The images are decoded with `MWImageLoaderDecodeImageData`, and with `MWImageLoaderDecodeProgressiveImageData` when `MWWebImageProgressiveLoad` is set, like `MWWebImageDownloader`.
+ @note All methods are thread-safe.
+ */
+@interface MWImageLocalLoader : NSObject <MWImageLoader>
+
+/// The directory of the image files, nil to serve only the data added with `setData:forPath:`
+@property (nonatomic, copy, readonly, nullable) NSURL *corpusURL;
+/// The URL scheme served. Defaults to `MWImageLocalLoaderScheme`
+@property (atomic, copy, nonnull) NSString *scheme;
+/// The HTTP(S) hosts also served, for example to replace a CDN host in a benchmark. Defaults to nil
+@property (atomic, copy, nullable) NSSet<NSString *> *hosts;
+/// The profiles of the loads, used in turn. If empty, `defaultProfile` is used
+@property (atomic, copy, nullable) NSArray<MWImageLocalLoaderProfile *> *profileScript;
+/// The profile used without script. Defaults to `immediateProfile`
+@property (atomic, copy, nonnull) MWImageLocalLoaderProfile *defaultProfile;
+/// The seed of the failure generator. Setting it restarts the script and the generator. Defaults to 0
+@property (nonatomic, assign) uint64_t seed;
+/// The number of loads requested so far
+@property (nonatomic, assign, readonly) NSUInteger requestCount;
+
+/**
+ Create a loader.
+
+ @param corpusURL The directory of the image files, nil to serve only the data added with `setData:forPath:`
+ */
+- (nonnull instancetype)initWithCorpusURL:(nullable NSURL *)corpusURL NS_DESIGNATED_INITIALIZER;
+
+/**
+ Serve some data from memory, which avoids the file system in a benchmark.
+
+ @param data The image data, nil to remove
+ @param path The URL path, such as `@"/photos/1.jpg"`
+ */
+- (void)setData:(nullable NSData *)data forPath:(nonnull NSString *)path;
+
+/**
+ The image data of a URL, from memory or from the corpus. Used by `MWImageLocalURLProtocol` too.
+
+ @param url The image URL
+ @return The data, nil if there is no image at this path
+ */
+- (nullable NSData *)dataForURL:(nonnull NSURL *)url;
+
+/**
+ Take the profile of the next load: advance the script and draw whether it fails. Used by `MWImageLocalURLProtocol` too.
+
+ @param shouldFail Set to whether the load fails
+ @return The profile
+ */
+- (nonnull MWImageLocalLoaderProfile *)nextProfileShouldFail:(nonnull BOOL *)shouldFail;
+
+/**
+ Restart the script and the failure generator from `seed`.
+ */
+- (void)reset;
+
+@end
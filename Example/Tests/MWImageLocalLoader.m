@@ -0,0 +1,325 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "MWImageLocalLoader.h"
+#import <MWWebImage/MWWebImageError.h>
+#import <MWWebImage/MWInternalMacros.h>
+
+NSString * const MWImageLocalLoaderScheme = @"mwlocal";
+
+static const NSUInteger kMWImageLocalLoaderDefaultChunkSize = 16 * 1024;
+
+@implementation MWImageLocalLoaderProfile
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _chunkSize = kMWImageLocalLoaderDefaultChunkSize;
+        _failureError = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorNetworkConnectionLost userInfo:@{NSLocalizedDescriptionKey : @"Scripted failure of the local loader"}];
+    }
+    return self;
+}
+
++ (instancetype)immediateProfile {
+    return [self new];
+}
+
++ (instancetype)profileWithLatency:(NSTimeInterval)latency bandwidth:(double)bandwidth {
+    MWImageLocalLoaderProfile *profile = [self new];
+    profile.latency = latency;
+    profile.bandwidth = bandwidth;
+    return profile;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    MWImageLocalLoaderProfile *profile = [[[self class] allocWithZone:zone] init];
+    profile.latency = self.latency;
+    profile.bandwidth = self.bandwidth;
+    profile.chunkSize = self.chunkSize;
+    profile.failureRate = self.failureRate;
+    profile.failureOffset = self.failureOffset;
+    profile.failureError = self.failureError;
+    profile.failureStatusCode = self.failureStatusCode;
+    profile.failureHeaderFields = self.failureHeaderFields;
+    return profile;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p latency = %.3fs, bandwidth = %.0fB/s, failureRate = %.2f>", NSStringFromClass(self.class), self, self.latency, self.bandwidth, self.failureRate];
+}
+
+@end
+
+/// One scripted load, delivered on its own serial queue
+@interface MWImageLocalLoaderOperation : NSObject <MWWebImageOperation>
+
+@property (nonatomic, strong, nonnull) NSURL *url;
+@property (nonatomic, strong, nullable) NSData *data;
+@property (nonatomic, strong, nonnull) MWImageLocalLoaderProfile *profile;
+@property (nonatomic, assign) BOOL shouldFail;
+@property (nonatomic, assign) MWWebImageOptions options;
+@property (nonatomic, copy, nullable) MWWebImageContext *context;
+@property (nonatomic, copy, nullable) MWImageLoaderProgressBlock progressBlock;
+@property (nonatomic, copy, nullable) MWImageLoaderCompletedBlock completedBlock;
+@property (nonatomic, strong, nonnull) dispatch_queue_t deliveryQueue;
+@property (nonatomic, assign) NSUInteger deliveredLength;
+@property (assign, getter=isCancelled) BOOL cancelled;
+@property (assign, getter=isFinished) BOOL finished;
+
+@end
+
+@implementation MWImageLocalLoaderOperation
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _deliveryQueue = dispatch_queue_create("com.hackemist.MWImageLocalLoaderOperation.deliveryQueue", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+- (void)start {
+    [self deliverAfterDelay:self.profile.latency];
+}
+
+- (void)cancel {
+    dispatch_async(self.deliveryQueue, ^{
+        if (self.isFinished) {
+            return;
+        }
+        self.cancelled = YES;
+        [self finishWithImage:nil data:nil error:[NSError errorWithDomain:MWWebImageErrorDomain code:MWWebImageErrorCancelled userInfo:@{NSLocalizedDescriptionKey : @"Operation cancelled by user during the local load"}]];
+    });
+}
+
+- (void)deliverAfterDelay:(NSTimeInterval)delay {
+    // Keep the operation alive until it finishes, the caller may not retain it
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), self.deliveryQueue, ^{
+        [self deliverNextChunk];
+    });
+}
+
+- (void)deliverNextChunk {
+    if (self.isFinished) {
+        return;
+    }
+    NSUInteger totalLength = self.data.length;
+    if (!self.data) {
+        [self finishWithImage:nil data:nil error:[NSError errorWithDomain:MWWebImageErrorDomain code:MWWebImageErrorInvalidDownloadStatusCode userInfo:@{NSLocalizedDescriptionKey : @"No image at this path in the local corpus", MWWebImageErrorDownloadStatusCodeKey : @(404)}]];
+        return;
+    }
+    if (self.shouldFail && self.profile.failureStatusCode > 0) {
+        [self finishWithImage:nil data:nil error:[NSError errorWithDomain:MWWebImageErrorDomain code:MWWebImageErrorInvalidDownloadStatusCode userInfo:@{NSLocalizedDescriptionKey : [NSString stringWithFormat:@"Scripted failure of the local loader, status code: %ld", (long)self.profile.failureStatusCode], MWWebImageErrorDownloadStatusCodeKey : @(self.profile.failureStatusCode)}]];
+        return;
+    }
+    // Deliver up to the failure offset when failing
+    NSUInteger endLength = self.shouldFail ? MIN(self.profile.failureOffset, totalLength) : totalLength;
+    if (self.deliveredLength >= endLength) {
+        if (self.shouldFail) {
+            [self finishWithImage:nil data:nil error:self.profile.failureError];
+        } else {
+            [self finishWithData:self.data];
+        }
+        return;
+    }
+    NSUInteger chunkSize = self.profile.bandwidth > 0 ? MAX(self.profile.chunkSize, 1) : endLength;
+    NSUInteger length = MIN(chunkSize, endLength - self.deliveredLength);
+    self.deliveredLength += length;
+    if (self.progressBlock) {
+        self.progressBlock(self.deliveredLength, totalLength, self.url);
+    }
+    if (MW_OPTIONS_CONTAINS(self.options, MWWebImageProgressiveLoad) && self.deliveredLength < totalLength) {
+        NSData *partialData = [self.data subdataWithRange:NSMakeRange(0, self.deliveredLength)];
+        UIImage *image = MWImageLoaderDecodeProgressiveImageData(partialData, self.url, NO, self, self.options, self.context);
+        if (image && self.completedBlock) {
+            MWImageLoaderCompletedBlock completedBlock = self.completedBlock;
+            dispatch_main_async_safe(^{
+                completedBlock(image, nil, nil, NO);
+            });
+        }
+    }
+    NSTimeInterval delay = self.profile.bandwidth > 0 ? length / self.profile.bandwidth : 0;
+    [self deliverAfterDelay:delay];
+}
+
+- (void)finishWithData:(NSData *)data {
+    UIImage *image;
+    if (MW_OPTIONS_CONTAINS(self.options, MWWebImageProgressiveLoad)) {
+        image = MWImageLoaderDecodeProgressiveImageData(data, self.url, YES, self, self.options, self.context);
+    }
+    if (!image) {
+        image = MWImageLoaderDecodeImageData(data, self.url, self.options, self.context);
+    }
+    if (!image) {
+        [self finishWithImage:nil data:nil error:[NSError errorWithDomain:MWWebImageErrorDomain code:MWWebImageErrorBadImageData userInfo:@{NSLocalizedDescriptionKey : @"Downloaded image decode failed"}]];
+        return;
+    }
+    [self finishWithImage:image data:data error:nil];
+}
+
+- (void)finishWithImage:(UIImage *)image data:(NSData *)data error:(NSError *)error {
+    self.finished = YES;
+    MWImageLoaderCompletedBlock completedBlock = self.completedBlock;
+    self.progressBlock = nil;
+    self.completedBlock = nil;
+    if (completedBlock) {
+        dispatch_main_async_safe(^{
+            completedBlock(image, data, error, YES);
+        });
+    }
+}
+
+@end
+
+@interface MWImageLocalLoader ()
+
+@property (nonatomic, copy, readwrite, nullable) NSURL *corpusURL;
+@property (nonatomic, assign, readwrite) NSUInteger requestCount;
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSString *, NSData *> *dataPerPath;
+@property (nonatomic, assign) uint64_t randomState;
+@property (nonatomic, strong, nonnull) dispatch_semaphore_t lock;
+
+@end
+
+@implementation MWImageLocalLoader
+
+- (instancetype)init {
+    return [self initWithCorpusURL:nil];
+}
+
+- (instancetype)initWithCorpusURL:(NSURL *)corpusURL {
+    self = [super init];
+    if (self) {
+        _corpusURL = [corpusURL copy];
+        _scheme = MWImageLocalLoaderScheme;
+        _defaultProfile = [MWImageLocalLoaderProfile immediateProfile];
+        _dataPerPath = [NSMutableDictionary dictionary];
+        _lock = dispatch_semaphore_create(1);
+    }
+    return self;
+}
+
+- (void)setSeed:(uint64_t)seed {
+    MW_LOCK(self.lock);
+    _seed = seed;
+    MW_UNLOCK(self.lock);
+    [self reset];
+}
+
+- (void)reset {
+    MW_LOCK(self.lock);
+    self.requestCount = 0;
+    self.randomState = self.seed;
+    MW_UNLOCK(self.lock);
+}
+
+- (void)setData:(NSData *)data forPath:(NSString *)path {
+    MW_LOCK(self.lock);
+    self.dataPerPath[path] = data;
+    MW_UNLOCK(self.lock);
+}
+
+- (NSData *)dataForURL:(NSURL *)url {
+    NSString *path = url.path;
+    if (path.length == 0) {
+        return nil;
+    }
+    MW_LOCK(self.lock);
+    NSData *data = self.dataPerPath[path];
+    MW_UNLOCK(self.lock);
+    if (data || !self.corpusURL) {
+        return data;
+    }
+    // Stay inside the corpus, by path components so that a sibling like `corpus-private` does not match `corpus`
+    NSURL *fileURL = [self.corpusURL URLByAppendingPathComponent:path].URLByStandardizingPath;
+    NSArray<NSString *> *corpusComponents = self.corpusURL.URLByStandardizingPath.pathComponents;
+    NSArray<NSString *> *fileComponents = fileURL.pathComponents;
+    if (fileComponents.count <= corpusComponents.count || ![[fileComponents subarrayWithRange:NSMakeRange(0, corpusComponents.count)] isEqualToArray:corpusComponents]) {
+        return nil;
+    }
+    return [NSData dataWithContentsOfURL:fileURL options:NSDataReadingMappedIfSafe error:nil];
+}
+
+// splitmix64, the same seed gives the same draws on every platform
+- (double)nextRandomValue {
+    uint64_t z = (self.randomState += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+    return (z >> 11) * (1.0 / 9007199254740992.0);
+}
+
+- (MWImageLocalLoaderProfile *)nextProfileShouldFail:(BOOL *)shouldFail {
+    NSParameterAssert(shouldFail);
+    MW_LOCK(self.lock);
+    NSArray<MWImageLocalLoaderProfile *> *profileScript = self.profileScript;
+    MWImageLocalLoaderProfile *profile = profileScript.count > 0 ? profileScript[self.requestCount % profileScript.count] : self.defaultProfile;
+    self.requestCount++;
+    // Always draw, so the failures do not depend on the failure rates of the other profiles
+    double value = [self nextRandomValue];
+    MW_UNLOCK(self.lock);
+    *shouldFail = value < profile.failureRate;
+    return profile;
+}
+
+#pragma mark - MWImageLoader
+
+- (BOOL)canRequestImageForURL:(NSURL *)url {
+    if (!url) {
+        return NO;
+    }
+    NSString *scheme = url.scheme.lowercaseString;
+    if ([scheme isEqualToString:self.scheme.lowercaseString]) {
+        return YES;
+    }
+    if ([scheme isEqualToString:@"http"] || [scheme isEqualToString:@"https"]) {
+        return url.host && [self.hosts containsObject:url.host];
+    }
+    return NO;
+}
+
+- (id<MWWebImageOperation>)requestImageWithURL:(NSURL *)url options:(MWWebImageOptions)options context:(MWWebImageContext *)context progress:(MWImageLoaderProgressBlock)progressBlock completed:(MWImageLoaderCompletedBlock)completedBlock {
+    if (![self canRequestImageForURL:url]) {
+        if (completedBlock) {
+            NSError *error = [NSError errorWithDomain:MWWebImageErrorDomain code:MWWebImageErrorInvalidURL userInfo:@{NSLocalizedDescriptionKey : @"Image url is not served by the local loader"}];
+            dispatch_main_async_safe(^{
+                completedBlock(nil, nil, error, YES);
+            });
+        }
+        return nil;
+    }
+    BOOL shouldFail = NO;
+    MWImageLocalLoaderOperation *operation = [MWImageLocalLoaderOperation new];
+    operation.profile = [self nextProfileShouldFail:&shouldFail];
+    operation.shouldFail = shouldFail;
+    operation.url = url;
+    operation.options = options;
+    operation.context = context;
+    operation.progressBlock = progressBlock;
+    operation.completedBlock = completedBlock;
+    dispatch_async(operation.deliveryQueue, ^{
+        // Read the file off the caller queue, like a download
+        operation.data = [self dataForURL:url];
+    });
+    [operation start];
+    return operation;
+}
+
+- (BOOL)shouldBlockFailedURLWithURL:(NSURL *)url error:(NSError *)error {
+    // Same rules as `MWWebImageDownloader`, the scripted network errors are transient
+    if ([error.domain isEqualToString:MWWebImageErrorDomain]) {
+        return error.code == MWWebImageErrorInvalidURL || error.code == MWWebImageErrorBadImageData;
+    }
+    return NO;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p corpus = %@, scheme = %@, requests = %lu>", NSStringFromClass(self.class), self, self.corpusURL, self.scheme, (unsigned long)self.requestCount];
+}
+
+@end
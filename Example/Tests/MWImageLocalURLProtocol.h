@@ -0,0 +1,38 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import <MWWebImage/MWWebImageCompat.h>
+
+@class MWImageLocalLoader;
+
+/**
+ An HTTP stand-in serving the corpus and profiles of a `MWImageLocalLoader` inside `NSURLSession`. Unlike the loader itself, the loads go through `MWWebImageDownloader`, its operations and the real session delegate callbacks, so the downloader overhead is measured too.
+ The responses are `200` with `Content-Length`, `Content-Type`, `ETag` and `Accept-Ranges`, `206` with `Content-Range` for a `Range: bytes=<offset>-` request whose `If-Range` matches or is absent, `304` when `If-None-Match` matches, `404` for a missing path. The body is delivered in chunks at the profile bandwidth, and the scripted failures end the load with the profile error, or respond with the profile failure status code and header fields.
+ Add it to the protocol classes of the downloader session:
+ @code
+ [MWImageLocalURLProtocol registerLoader:loader];
+ MWWebImageDownloaderConfig *config = [MWWebImageDownloaderConfig new];
+ config.sessionConfiguration.protocolClasses = @[MWImageLocalURLProtocol.class];
+ MWWebImageDownloader *downloader = [[MWWebImageDownloader alloc] initWithConfig:config];
+ @endcode
+ @note The requests handled are the ones `canRequestImageForURL:` of a registered loader accepts, so set the loader `hosts` to serve HTTP(S) URLs.
+ */
+@interface MWImageLocalURLProtocol : NSURLProtocol
+
+/**
+ Serve the URLs of a loader. The loader is retained until it is unregistered.
+ */
++ (void)registerLoader:(nonnull MWImageLocalLoader *)loader;
+
+/**
+ Stop serving the URLs of a loader.
+ */
++ (void)unregisterLoader:(nonnull MWImageLocalLoader *)loader;
+
+@end
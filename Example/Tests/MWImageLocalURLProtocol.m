@@ -0,0 +1,245 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "MWImageLocalURLProtocol.h"
+#import "MWImageLocalLoader.h"
+#import <MWWebImage/NMWata+ImageContentType.h>
+#import <MWWebImage/MWInternalMacros.h>
+
+static NSMutableArray<MWImageLocalLoader *> *MWImageLocalURLProtocolLoaders;
+static dispatch_semaphore_t MWImageLocalURLProtocolLock;
+
+static NSString * MWImageLocalURLProtocolMIMEType(NSData *data) {
+    MWImageFormat format = [NSData MW_imageFormatForImageData:data];
+    switch (format) {
+        case MWImageFormatJPEG: return @"image/jpeg";
+        case MWImageFormatPNG: return @"image/png";
+        case MWImageFormatGIF: return @"image/gif";
+        case MWImageFormatTIFF: return @"image/tiff";
+        case MWImageFormatWebP: return @"image/webp";
+        case MWImageFormatHEIC: return @"image/heic";
+        case MWImageFormatHEIF: return @"image/heif";
+        case MWImageFormatPDF: return @"application/pdf";
+        case MWImageFormatSVG: return @"image/svg+xml";
+        case MWImageFormatAVIF: return @"image/avif";
+        default: return @"application/octet-stream";
+    }
+}
+
+// The offset of a `Range: bytes=<offset>-` request, NSNotFound for another range
+static NSUInteger MWImageLocalURLProtocolRangeOffset(NSString *range) {
+    NSScanner *scanner = [NSScanner scannerWithString:range];
+    unsigned long long offset = 0;
+    if (![scanner scanString:@"bytes=" intoString:nil] || ![scanner scanUnsignedLongLong:&offset] || ![scanner scanString:@"-" intoString:nil] || !scanner.isAtEnd) {
+        return NSNotFound;
+    }
+    return (NSUInteger)offset;
+}
+
+// FNV-1a of the body, stable across runs unlike `-[NSData hash]`
+static NSString * MWImageLocalURLProtocolEntityTag(NSData *data) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    const uint8_t *bytes = data.bytes;
+    for (NSUInteger i = 0; i < data.length; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return [NSString stringWithFormat:@"\"%016llx\"", hash];
+}
+
+@interface MWImageLocalURLProtocol ()
+
+@property (nonatomic, strong, nullable) MWImageLocalLoader *loader;
+@property (nonatomic, strong, nullable) MWImageLocalLoaderProfile *profile;
+@property (nonatomic, assign) BOOL shouldFail;
+@property (nonatomic, strong, nullable) NSData *data;
+@property (nonatomic, assign) NSUInteger rangeOffset;
+@property (nonatomic, assign) NSUInteger deliveredLength;
+@property (nonatomic, strong, nonnull) dispatch_queue_t deliveryQueue;
+@property (nonatomic, assign, nullable) CFRunLoopRef clientRunLoop;
+@property (nonatomic, copy, nonnull) NSString *clientRunLoopMode;
+@property (atomic, assign, getter=isStopped) BOOL stopped;
+
+@end
+
+@implementation MWImageLocalURLProtocol
+
++ (void)initialize {
+    if (self == [MWImageLocalURLProtocol class]) {
+        MWImageLocalURLProtocolLoaders = [NSMutableArray array];
+        MWImageLocalURLProtocolLock = dispatch_semaphore_create(1);
+    }
+}
+
++ (void)registerLoader:(MWImageLocalLoader *)loader {
+    MW_LOCK(MWImageLocalURLProtocolLock);
+    if (![MWImageLocalURLProtocolLoaders containsObject:loader]) {
+        [MWImageLocalURLProtocolLoaders addObject:loader];
+    }
+    MW_UNLOCK(MWImageLocalURLProtocolLock);
+}
+
++ (void)unregisterLoader:(MWImageLocalLoader *)loader {
+    MW_LOCK(MWImageLocalURLProtocolLock);
+    [MWImageLocalURLProtocolLoaders removeObject:loader];
+    MW_UNLOCK(MWImageLocalURLProtocolLock);
+}
+
++ (MWImageLocalLoader *)loaderForURL:(NSURL *)url {
+    MW_LOCK(MWImageLocalURLProtocolLock);
+    NSArray<MWImageLocalLoader *> *loaders = [MWImageLocalURLProtocolLoaders copy];
+    MW_UNLOCK(MWImageLocalURLProtocolLock);
+    // The later registered loader has the highest priority, like `MWImageLoadersManager`
+    for (MWImageLocalLoader *loader in loaders.reverseObjectEnumerator) {
+        if ([loader canRequestImageForURL:url]) {
+            return loader;
+        }
+    }
+    return nil;
+}
+
+#pragma mark - NSURLProtocol
+
++ (BOOL)canInitWithRequest:(NSURLRequest *)request {
+    return [self loaderForURL:request.URL] != nil;
+}
+
++ (NSURLRequest *)canonicalRequestForRequest:(NSURLRequest *)request {
+    return request;
+}
+
+- (void)startLoading {
+    // The client must be called back on the loading thread
+    self.clientRunLoop = CFRunLoopGetCurrent();
+    self.clientRunLoopMode = [NSRunLoop currentRunLoop].currentMode ?: NSDefaultRunLoopMode;
+    self.deliveryQueue = dispatch_queue_create("com.hackemist.MWImageLocalURLProtocol.deliveryQueue", DISPATCH_QUEUE_SERIAL);
+    self.loader = [[self class] loaderForURL:self.request.URL];
+    BOOL shouldFail = NO;
+    self.profile = [self.loader nextProfileShouldFail:&shouldFail];
+    self.shouldFail = shouldFail;
+    NSURLRequest *request = self.request;
+    dispatch_async(self.deliveryQueue, ^{
+        self.data = [self.loader dataForURL:request.URL];
+    });
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(self.profile.latency * NSEC_PER_SEC)), self.deliveryQueue, ^{
+        [self sendResponse];
+    });
+}
+
+- (void)stopLoading {
+    self.stopped = YES;
+}
+
+#pragma mark - Delivery
+
+- (void)performClientBlock:(dispatch_block_t)block {
+    CFRunLoopPerformBlock(self.clientRunLoop, (__bridge CFStringRef)self.clientRunLoopMode, ^{
+        if (!self.isStopped) {
+            block();
+        }
+    });
+    CFRunLoopWakeUp(self.clientRunLoop);
+}
+
+- (void)sendResponse {
+    if (self.isStopped) {
+        return;
+    }
+    NSURL *url = self.request.URL;
+    NSData *data = self.data;
+    if (self.shouldFail && self.profile.failureStatusCode > 0) {
+        NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:url statusCode:self.profile.failureStatusCode HTTPVersion:@"HTTP/1.1" headerFields:self.profile.failureHeaderFields];
+        [self performClientBlock:^{
+            [self.client URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+            [self.client URLProtocolDidFinishLoading:self];
+        }];
+        return;
+    }
+    if (self.shouldFail && self.profile.failureOffset == 0) {
+        NSError *error = self.profile.failureError;
+        [self performClientBlock:^{
+            [self.client URLProtocol:self didFailWithError:error];
+        }];
+        return;
+    }
+    NSInteger statusCode;
+    NSMutableDictionary<NSString *, NSString *> *headerFields = [NSMutableDictionary dictionary];
+    if (!data) {
+        statusCode = 404;
+        headerFields[@"Content-Length"] = @"0";
+    } else {
+        NSString *entityTag = MWImageLocalURLProtocolEntityTag(data);
+        headerFields[@"ETag"] = entityTag;
+        headerFields[@"Cache-Control"] = @"no-cache";
+        NSString *range = [self.request valueForHTTPHeaderField:@"Range"];
+        NSString *ifRange = [self.request valueForHTTPHeaderField:@"If-Range"];
+        NSUInteger rangeOffset = range ? MWImageLocalURLProtocolRangeOffset(range) : NSNotFound;
+        if ([[self.request valueForHTTPHeaderField:@"If-None-Match"] isEqualToString:entityTag]) {
+            statusCode = 304;
+        } else if (rangeOffset < data.length && (!ifRange || [ifRange isEqualToString:entityTag])) {
+            // The missing bytes of a resumed download
+            statusCode = 206;
+            self.rangeOffset = rangeOffset;
+            self.deliveredLength = rangeOffset;
+            headerFields[@"Content-Range"] = [NSString stringWithFormat:@"bytes %lu-%lu/%lu", (unsigned long)rangeOffset, (unsigned long)data.length - 1, (unsigned long)data.length];
+            headerFields[@"Content-Length"] = @(data.length - rangeOffset).stringValue;
+            headerFields[@"Content-Type"] = MWImageLocalURLProtocolMIMEType(data);
+        } else {
+            // The image changed since the partial data, or a plain request
+            statusCode = 200;
+            headerFields[@"Accept-Ranges"] = @"bytes";
+            headerFields[@"Content-Length"] = @(data.length).stringValue;
+            headerFields[@"Content-Type"] = MWImageLocalURLProtocolMIMEType(data);
+        }
+    }
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:url statusCode:statusCode HTTPVersion:@"HTTP/1.1" headerFields:headerFields];
+    [self performClientBlock:^{
+        [self.client URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+    }];
+    if (statusCode != 200 && statusCode != 206) {
+        [self performClientBlock:^{
+            [self.client URLProtocolDidFinishLoading:self];
+        }];
+        return;
+    }
+    [self sendNextChunk];
+}
+
+- (void)sendNextChunk {
+    if (self.isStopped) {
+        return;
+    }
+    NSData *data = self.data;
+    // The failure offset counts the bytes of this response
+    NSUInteger endLength = self.shouldFail ? MIN(self.rangeOffset + self.profile.failureOffset, data.length) : data.length;
+    if (self.deliveredLength >= endLength) {
+        if (self.shouldFail) {
+            NSError *error = self.profile.failureError;
+            [self performClientBlock:^{
+                [self.client URLProtocol:self didFailWithError:error];
+            }];
+        } else {
+            [self performClientBlock:^{
+                [self.client URLProtocolDidFinishLoading:self];
+            }];
+        }
+        return;
+    }
+    NSUInteger chunkSize = self.profile.bandwidth > 0 ? MAX(self.profile.chunkSize, 1) : endLength;
+    NSUInteger length = MIN(chunkSize, endLength - self.deliveredLength);
+    NSData *chunk = [data subdataWithRange:NSMakeRange(self.deliveredLength, length)];
+    self.deliveredLength += length;
+    [self performClientBlock:^{
+        [self.client URLProtocol:self didLoadData:chunk];
+    }];
+    NSTimeInterval delay = self.profile.bandwidth > 0 ? length / self.profile.bandwidth : 0;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), self.deliveryQueue, ^{
+        [self sendNextChunk];
+    });
+}
+
+@end
@@ -0,0 +1,99 @@
+//
+//  MWImageProgressiveCoderTests.m
+//  MWWebImageTests
+//
+//  The progressive decoding of a download: feeding only the new chunks with `appendIncrementalData:finished:`, compared with the whole data so far with `updateIncrementalData:finished:`.
+//
+
+#import "MWWebImageTestCase.h"
+
+static const NSUInteger kMWProgressiveChunkLength = 32 * 1024;
+
+@interface MWImageProgressiveCoderTests : XCTestCase
+
+@property (nonatomic, strong) NSData *imageData;
+
+@end
+
+@implementation MWImageProgressiveCoderTests
+
+- (void)setUp
+{
+    [super setUp];
+    UIImage *image = [MWWebImageTestCase sampleImageWithSize:CGSizeMake(2048, 1536)];
+    self.imageData = [[MWImageIOCoder sharedCoder] encodedDataWithImage:image format:MWImageFormatJPEG options:@{MWImageCoderEncodeCompressionQuality : @0.9}];
+}
+
+// Feed the image by chunks like a download, decoding every `decodeInterval` chunks (0 for the final image only)
+- (UIImage *)decodeProgressivelyByAppending:(BOOL)appending decodeInterval:(NSUInteger)decodeInterval partialImageCount:(NSUInteger *)partialImageCount
+{
+    NSData *data = self.imageData;
+    MWImageIOCoder *coder = [[MWImageIOCoder alloc] initIncrementalWithOptions:nil];
+    NSUInteger chunkCount = 0;
+    for (NSUInteger offset = 0; offset < data.length; offset += kMWProgressiveChunkLength) {
+        @autoreleasepool {
+            NSUInteger length = MIN(kMWProgressiveChunkLength, data.length - offset);
+            BOOL finished = offset + length == data.length;
+            if (appending) {
+                [coder appendIncrementalData:[data subdataWithRange:NSMakeRange(offset, length)] finished:finished];
+            } else {
+                // The downloader used to hand over a copy of all the bytes received so far
+                [coder updateIncrementalData:[data subdataWithRange:NSMakeRange(0, offset + length)] finished:finished];
+            }
+            chunkCount++;
+            if (!finished && decodeInterval > 0 && chunkCount % decodeInterval == 0) {
+                UIImage *partialImage = [coder incrementalDecodedImageWithOptions:nil];
+                if (partialImage && partialImageCount) {
+                    (*partialImageCount)++;
+                }
+            }
+        }
+    }
+    return [coder incrementalDecodedImageWithOptions:nil];
+}
+
+- (void)testAppendedAndUpdatedDataDecodeTheSameImage
+{
+    NSUInteger appendedPartialImageCount = 0;
+    NSUInteger updatedPartialImageCount = 0;
+    UIImage *appendedImage = [self decodeProgressivelyByAppending:YES decodeInterval:4 partialImageCount:&appendedPartialImageCount];
+    UIImage *updatedImage = [self decodeProgressivelyByAppending:NO decodeInterval:4 partialImageCount:&updatedPartialImageCount];
+    XCTAssertEqual(CGImageGetWidth(appendedImage.CGImage), 2048);
+    XCTAssertEqual(CGImageGetHeight(appendedImage.CGImage), 1536);
+    XCTAssertEqual(CGImageGetWidth(updatedImage.CGImage), 2048);
+    XCTAssertEqual(CGImageGetHeight(updatedImage.CGImage), 1536);
+    XCTAssertGreaterThan(appendedPartialImageCount, 0);
+    XCTAssertEqual(appendedPartialImageCount, updatedPartialImageCount);
+}
+
+#pragma mark - Benchmarks
+
+- (void)testUpdateFeedingPerformance
+{
+    [self measureBlock:^{
+        XCTAssertNotNil([self decodeProgressivelyByAppending:NO decodeInterval:0 partialImageCount:NULL]);
+    }];
+}
+
+- (void)testAppendFeedingPerformance
+{
+    [self measureBlock:^{
+        XCTAssertNotNil([self decodeProgressivelyByAppending:YES decodeInterval:0 partialImageCount:NULL]);
+    }];
+}
+
+- (void)testUpdateProgressiveDecodingPerformance
+{
+    [self measureBlock:^{
+        XCTAssertNotNil([self decodeProgressivelyByAppending:NO decodeInterval:4 partialImageCount:NULL]);
+    }];
+}
+
+- (void)testAppendProgressiveDecodingPerformance
+{
+    [self measureBlock:^{
+        XCTAssertNotNil([self decodeProgressivelyByAppending:YES decodeInterval:4 partialImageCount:NULL]);
+    }];
+}
+
+@end
@@ -0,0 +1,115 @@
+//
+//  MWMemoryCacheStatisticsTests.m
+//  MWWebImageTests
+//
+//  The hit ratios estimated from the stack distance of each lookup, at 0.5x, 1x, 2x and 4x the memory count budget.
+//
+
+#import "MWWebImageTestCase.h"
+
+@interface MWMemoryCacheStatisticsTests : XCTestCase
+
+@end
+
+@implementation MWMemoryCacheStatisticsTests
+
+- (MWMemoryCache *)cacheWithCountLimit:(NSUInteger)countLimit
+{
+    MWImageCacheConfig *config = [[MWImageCacheConfig alloc] init];
+    config.shouldUseWeakMemoryCache = NO;
+    config.shouldRecordMemoryCacheStatistics = YES;
+    config.maxMemoryCount = countLimit;
+    return [[MWMemoryCache alloc] initWithConfig:config];
+}
+
+// Store the keys, then look them up in a loop, each lookup has a stack distance of `keyCount`
+- (MWMemoryCacheStatistics *)statisticsOfLoopOverKeyCount:(NSUInteger)keyCount countLimit:(NSUInteger)countLimit rounds:(NSUInteger)rounds
+{
+    MWMemoryCache *cache = [self cacheWithCountLimit:countLimit];
+    for (NSUInteger i = 0; i < keyCount; i++) {
+        [cache setObject:@(i) forKey:@(i).stringValue];
+    }
+    for (NSUInteger round = 0; round < rounds; round++) {
+        for (NSUInteger i = 0; i < keyCount; i++) {
+            [cache objectForKey:@(i).stringValue];
+        }
+    }
+    return cache.statistics;
+}
+
+- (void)assertStatistics:(MWMemoryCacheStatistics *)statistics estimatedHitRatios:(NSArray<NSNumber *> *)ratios
+{
+    XCTAssertEqualWithAccuracy(statistics.estimatedHitRatioAtHalfBudget, ratios[0].doubleValue, 0.0001, @"%@", statistics);
+    XCTAssertEqualWithAccuracy(statistics.estimatedHitRatio, ratios[1].doubleValue, 0.0001, @"%@", statistics);
+    XCTAssertEqualWithAccuracy(statistics.estimatedHitRatioAtDoubleBudget, ratios[2].doubleValue, 0.0001, @"%@", statistics);
+    XCTAssertEqualWithAccuracy(statistics.estimatedHitRatioAtQuadrupleBudget, ratios[3].doubleValue, 0.0001, @"%@", statistics);
+}
+
+#pragma mark - Scales
+
+- (void)testLoopFittingHalfTheBudget
+{
+    [self assertStatistics:[self statisticsOfLoopOverKeyCount:2 countLimit:4 rounds:3] estimatedHitRatios:@[@1, @1, @1, @1]];
+}
+
+- (void)testLoopFittingTheBudget
+{
+    [self assertStatistics:[self statisticsOfLoopOverKeyCount:4 countLimit:4 rounds:3] estimatedHitRatios:@[@0, @1, @1, @1]];
+}
+
+- (void)testLoopFittingDoubleTheBudget
+{
+    [self assertStatistics:[self statisticsOfLoopOverKeyCount:8 countLimit:4 rounds:3] estimatedHitRatios:@[@0, @0, @1, @1]];
+}
+
+- (void)testLoopFittingQuadrupleTheBudget
+{
+    [self assertStatistics:[self statisticsOfLoopOverKeyCount:16 countLimit:4 rounds:3] estimatedHitRatios:@[@0, @0, @0, @1]];
+}
+
+- (void)testLoopLargerThanAllScales
+{
+    MWMemoryCacheStatistics *statistics = [self statisticsOfLoopOverKeyCount:17 countLimit:4 rounds:3];
+    [self assertStatistics:statistics estimatedHitRatios:@[@0, @0, @0, @0]];
+    XCTAssertEqual(statistics.hitCount + statistics.missCount, 17 * 3);
+}
+
+- (void)testMixedDistances
+{
+    MWMemoryCache *cache = [self cacheWithCountLimit:4];
+    for (NSUInteger i = 0; i < 8; i++) {
+        [cache setObject:@(i) forKey:@(i).stringValue];
+    }
+    // Distances of 1, 2, 5 and 9
+    [cache objectForKey:@"7"];
+    [cache objectForKey:@"6"];
+    [cache objectForKey:@"3"];
+    [cache objectForKey:@"9"];
+    [cache setObject:@(9) forKey:@"9"];
+    [cache objectForKey:@"0"];
+    // The unknown key is a cold miss at every scale
+    [self assertStatistics:cache.statistics estimatedHitRatios:@[@0.4, @0.4, @0.6, @0.8]];
+}
+
+#pragma mark - Compaction
+
+- (void)testResidentEntriesSurviveCompaction
+{
+    // More resident entries than the initial stamps can compact to
+    NSUInteger keyCount = 6000;
+    MWMemoryCache *cache = [self cacheWithCountLimit:keyCount];
+    for (NSUInteger i = 0; i < keyCount; i++) {
+        [cache setObject:@(i) forKey:@(i).stringValue];
+    }
+    // Each lookup is within the budget, the compaction happens during the first round
+    for (NSUInteger round = 0; round < 3; round++) {
+        for (NSUInteger i = 0; i < keyCount; i++) {
+            [cache objectForKey:@(i).stringValue];
+        }
+    }
+    MWMemoryCacheStatistics *statistics = cache.statistics;
+    XCTAssertEqual(statistics.hitCount + statistics.missCount, keyCount * 3);
+    XCTAssertEqualWithAccuracy(statistics.estimatedHitRatio, 1, 0.0001, @"%@", statistics);
+}
+
+@end
@@ -0,0 +1,228 @@
+//
+//  MWMemoryCacheTests.m
+//  MWWebImageTests
+//
+//  The GreedyDual-Size eviction of the memory cache: the order by rebuild cost per byte, the aging by the inflation value, the limit changes, and the purges of `NSCache` itself. Then the images sharing an identical bitmap.
+//
+
+#import "MWWebImageTestCase.h"
+
+@interface MWMemoryCacheTests : XCTestCase
+
+@end
+
+@implementation MWMemoryCacheTests
+
+#pragma mark - GreedyDual-Size
+
+- (MWMemoryCache *)greedyDualSizeCacheWithCountLimit:(NSUInteger)countLimit
+{
+    MWImageCacheConfig *config = [[MWImageCacheConfig alloc] init];
+    config.memoryCacheEvictionType = MWImageCacheConfigMemoryEvictionTypeGreedyDualSize;
+    // The evicted images are still held by the tests
+    config.shouldUseWeakMemoryCache = NO;
+    config.maxMemoryCount = countLimit;
+    return [[MWMemoryCache alloc] initWithConfig:config];
+}
+
+- (UIImage *)imageWithRebuildCost:(NSTimeInterval)rebuildCost
+{
+    UIImage *image = [MWWebImageTestCase sampleImageWithSize:CGSizeMake(4, 4)];
+    image.MW_rebuildCost = rebuildCost;
+    return image;
+}
+
+// The priority `H` of an entry is the inflation `L` when stored or hit, plus its rebuild cost per byte
+- (void)storeImageWithRebuildCost:(NSTimeInterval)rebuildCost cost:(NSUInteger)cost inCache:(MWMemoryCache *)cache forKey:(NSString *)key
+{
+    [cache setObject:[self imageWithRebuildCost:rebuildCost] forKey:key cost:cost];
+}
+
+- (void)testLowestRebuildCostPerByteIsEvictedFirst
+{
+    MWMemoryCache *cache = [self greedyDualSizeCacheWithCountLimit:2];
+    // The slowest to rebuild, but 4 times larger: H = 1
+    [self storeImageWithRebuildCost:4 cost:4 inCache:cache forKey:@"a"];
+    // H = 2, then 3
+    [self storeImageWithRebuildCost:2 cost:1 inCache:cache forKey:@"b"];
+    [self storeImageWithRebuildCost:3 cost:1 inCache:cache forKey:@"c"];
+    XCTAssertNil([cache objectForKey:@"a"]);
+    XCTAssertNotNil([cache objectForKey:@"b"]);
+    XCTAssertNotNil([cache objectForKey:@"c"]);
+}
+
+- (void)testInflationAgesTheEntries
+{
+    MWMemoryCache *cache = [self greedyDualSizeCacheWithCountLimit:2];
+    [self storeImageWithRebuildCost:3 cost:1 inCache:cache forKey:@"a"];
+    [self storeImageWithRebuildCost:1 cost:1 inCache:cache forKey:@"b"];
+    // H = 2.5, evicts b, L = 1
+    [self storeImageWithRebuildCost:2.5 cost:1 inCache:cache forKey:@"c"];
+    // H = 3.5, evicts c, L = 2.5
+    [self storeImageWithRebuildCost:2.5 cost:1 inCache:cache forKey:@"d"];
+    // H = 3.5, the cheapest entry so far but stored last, evicts a which was never hit since
+    [self storeImageWithRebuildCost:1 cost:1 inCache:cache forKey:@"e"];
+    XCTAssertNil([cache objectForKey:@"a"]);
+    XCTAssertNil([cache objectForKey:@"b"]);
+    XCTAssertNil([cache objectForKey:@"c"]);
+    XCTAssertNotNil([cache objectForKey:@"d"]);
+    XCTAssertNotNil([cache objectForKey:@"e"]);
+}
+
+- (void)testHitRenewsThePriority
+{
+    MWMemoryCache *cache = [self greedyDualSizeCacheWithCountLimit:2];
+    [self storeImageWithRebuildCost:1 cost:1 inCache:cache forKey:@"a"];
+    [self storeImageWithRebuildCost:2 cost:1 inCache:cache forKey:@"b"];
+    // H = 2.8, evicts a, L = 1
+    [self storeImageWithRebuildCost:2.8 cost:1 inCache:cache forKey:@"c"];
+    // H = 3 instead of 2
+    XCTAssertNotNil([cache objectForKey:@"b"]);
+    // H = 3.5, evicts c
+    [self storeImageWithRebuildCost:2.5 cost:1 inCache:cache forKey:@"d"];
+    XCTAssertNil([cache objectForKey:@"c"]);
+    XCTAssertNotNil([cache objectForKey:@"b"]);
+    XCTAssertNotNil([cache objectForKey:@"d"]);
+}
+
+- (void)testLowerLimitsEvictByPriority
+{
+    MWMemoryCache *cache = [self greedyDualSizeCacheWithCountLimit:0];
+    [self storeImageWithRebuildCost:3 cost:10 inCache:cache forKey:@"a"];
+    [self storeImageWithRebuildCost:1 cost:10 inCache:cache forKey:@"b"];
+    [self storeImageWithRebuildCost:2 cost:10 inCache:cache forKey:@"c"];
+    [self storeImageWithRebuildCost:4 cost:10 inCache:cache forKey:@"d"];
+
+    // H = 0.3, 0.1, 0.2 and 0.4
+    cache.config.maxMemoryCount = 3;
+    XCTAssertNil([cache objectForKey:@"b"]);
+
+    cache.config.maxMemoryCost = 20;
+    XCTAssertNil([cache objectForKey:@"c"]);
+    XCTAssertNotNil([cache objectForKey:@"a"]);
+    XCTAssertNotNil([cache objectForKey:@"d"]);
+}
+
+- (void)testPurgedObjectLeavesTheBookkeeping
+{
+    MWMemoryCache *cache = [self greedyDualSizeCacheWithCountLimit:2];
+    UIImage *image = [self imageWithRebuildCost:5];
+    [cache setObject:image forKey:@"a" cost:1];
+    [self storeImageWithRebuildCost:1 cost:1 inCache:cache forKey:@"b"];
+    // What `NSCache` does when it purges an object under system memory pressure
+    XCTAssertEqual(cache.delegate, (id<NSCacheDelegate>)cache);
+    [cache.delegate cache:cache willEvictObject:image];
+    // Only b and c are counted, b is not evicted for an entry which is gone
+    [self storeImageWithRebuildCost:3 cost:1 inCache:cache forKey:@"c"];
+    XCTAssertNotNil([cache objectForKey:@"b"]);
+    XCTAssertNotNil([cache objectForKey:@"c"]);
+}
+
+- (void)testRemovedObjectIsNotAnEviction
+{
+    MWImageCacheConfig *config = [[MWImageCacheConfig alloc] init];
+    config.memoryCacheEvictionType = MWImageCacheConfigMemoryEvictionTypeGreedyDualSize;
+    config.shouldUseWeakMemoryCache = NO;
+    config.shouldRecordMemoryCacheStatistics = YES;
+    config.maxMemoryCount = 1;
+    MWMemoryCache *cache = [[MWMemoryCache alloc] initWithConfig:config];
+    [self storeImageWithRebuildCost:1 cost:1 inCache:cache forKey:@"a"];
+    [cache removeObjectForKey:@"a"];
+    [self storeImageWithRebuildCost:1 cost:1 inCache:cache forKey:@"b"];
+    [self storeImageWithRebuildCost:1 cost:1 inCache:cache forKey:@"b"];
+    XCTAssertEqual(cache.statistics.evictionCount, 0);
+    [self storeImageWithRebuildCost:2 cost:1 inCache:cache forKey:@"c"];
+    XCTAssertEqual(cache.statistics.evictionCount, 1);
+}
+
+#pragma mark - Deduplication
+
+- (MWMemoryCache *)deduplicatingCache
+{
+    MWImageCacheConfig *config = [[MWImageCacheConfig alloc] init];
+    config.shouldDeduplicateImagesInMemory = YES;
+    return [[MWMemoryCache alloc] initWithConfig:config];
+}
+
+// A decoded copy of the image in its own bitmap, with the pixel at column 5 of a row changed, or none if the row is negative
+- (UIImage *)decodedImageWithImage:(UIImage *)image changingPixelAtRow:(NSInteger)row
+{
+    size_t width = CGImageGetWidth(image.CGImage);
+    size_t height = CGImageGetHeight(image.CGImage);
+    CGContextRef context = CGBitmapContextCreate(NULL, width, height, 8, 0, [MWImageCoderHelper colorSpaceGetDeviceRGB], kCGBitmapByteOrder32Host | kCGImageAlphaPremultipliedFirst);
+    CGContextDrawImage(context, CGRectMake(0, 0, width, height), image.CGImage);
+    if (row >= 0) {
+        CGContextSetRGBFillColor(context, 1, 0, 1, 1);
+        CGContextFillRect(context, CGRectMake(5, height - 1 - row, 1, 1));
+    }
+    CGImageRef imageRef = CGBitmapContextCreateImage(context);
+    CGContextRelease(context);
+    UIImage *decodedImage = [[UIImage alloc] initWithCGImage:imageRef scale:1 orientation:UIImageOrientationUp];
+    CGImageRelease(imageRef);
+    decodedImage.MW_iMWecoded = YES;
+    return decodedImage;
+}
+
+- (void)testIdenticalBitmapIsSharedWithTheMetadataKept
+{
+    MWMemoryCache *cache = [self deduplicatingCache];
+    UIImage *sourceImage = [MWWebImageTestCase sampleImageWithSize:CGSizeMake(64, 64)];
+    UIImage *image = [self decodedImageWithImage:sourceImage changingPixelAtRow:-1];
+    XCTAssertEqual([cache deduplicatedImageWithImage:image], image);
+
+    UIImage *identicalImage = [self decodedImageWithImage:sourceImage changingPixelAtRow:-1];
+    identicalImage = [[UIImage alloc] initWithCGImage:identicalImage.CGImage scale:2 orientation:UIImageOrientationRight];
+    identicalImage.MW_iMWecoded = YES;
+    identicalImage.MW_imageFormat = MWImageFormatPNG;
+    identicalImage.MW_extendedObject = @"extended";
+    XCTAssertNotEqual(identicalImage.CGImage, image.CGImage);
+    UIImage *deduplicatedImage = [cache deduplicatedImageWithImage:identicalImage];
+    XCTAssertEqual(deduplicatedImage.CGImage, image.CGImage);
+    XCTAssertEqual(deduplicatedImage.scale, 2);
+    XCTAssertEqual(deduplicatedImage.imageOrientation, UIImageOrientationRight);
+    XCTAssertEqual(deduplicatedImage.MW_imageFormat, MWImageFormatPNG);
+    XCTAssertEqualObjects(deduplicatedImage.MW_extendedObject, @"extended");
+    XCTAssertTrue(deduplicatedImage.MW_iMWecoded);
+    XCTAssertEqual(cache.deduplicatedCount, 1);
+    XCTAssertEqual(cache.deduplicatedBytes, identicalImage.MW_memoryCost);
+}
+
+- (void)testDifferentBitmapIsNotShared
+{
+    UIImage *sourceImage = [MWWebImageTestCase sampleImageWithSize:CGSizeMake(64, 64)];
+    // Row 0 is in the fingerprint, row 2 is not and only the comparison of the whole bitmaps tells them apart
+    for (NSNumber *row in @[@0, @2]) {
+        MWMemoryCache *cache = [self deduplicatingCache];
+        UIImage *image = [self decodedImageWithImage:sourceImage changingPixelAtRow:-1];
+        [cache deduplicatedImageWithImage:image];
+        UIImage *otherImage = [self decodedImageWithImage:sourceImage changingPixelAtRow:row.integerValue];
+        XCTAssertEqual([cache deduplicatedImageWithImage:otherImage], otherImage, @"Row %@", row);
+        XCTAssertEqual(cache.deduplicatedCount, 0, @"Row %@", row);
+    }
+}
+
+- (void)testDisabledDeduplicationKeepsTheImage
+{
+    MWMemoryCache *cache = [[MWMemoryCache alloc] initWithConfig:[[MWImageCacheConfig alloc] init]];
+    UIImage *sourceImage = [MWWebImageTestCase sampleImageWithSize:CGSizeMake(64, 64)];
+    UIImage *image = [self decodedImageWithImage:sourceImage changingPixelAtRow:-1];
+    UIImage *identicalImage = [self decodedImageWithImage:sourceImage changingPixelAtRow:-1];
+    [cache deduplicatedImageWithImage:image];
+    XCTAssertEqual([cache deduplicatedImageWithImage:identicalImage], identicalImage);
+    XCTAssertEqual(cache.deduplicatedCount, 0);
+}
+
+- (void)testFingerprintsOfReleasedImagesArePruned
+{
+    MWMemoryCache *cache = [self deduplicatingCache];
+    for (NSUInteger i = 0; i < 200; i++) {
+        @autoreleasepool {
+            UIImage *image = [self decodedImageWithImage:[MWWebImageTestCase sampleImageWithSize:CGSizeMake(8 + i, 8)] changingPixelAtRow:-1];
+            [cache deduplicatedImageWithImage:image];
+        }
+    }
+    NSMapTable *sharedBitmaps = [cache valueForKey:@"sharedBitmaps"];
+    XCTAssertLessThanOrEqual(sharedBitmaps.count, 64);
+}
+
+@end
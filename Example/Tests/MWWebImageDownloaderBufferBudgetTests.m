@@ -0,0 +1,148 @@
+//
+//  MWWebImageDownloaderBufferBudgetTests.m
+//  MWWebImageTests
+//
+//  The hysteresis of the buffer budget, which pauses the downloads over the limit and resumes them once drained to 3/4 of it.
+//
+
+#import "MWWebImageTestCase.h"
+
+@interface MWWebImageDownloaderBufferBudgetTests : XCTestCase
+
+@property (nonatomic, strong) MWWebImageDownloaderBufferBudget *budget;
+@property (nonatomic, strong) NSMutableArray<NSNumber *> *pressureChanges;
+@property (atomic, strong) XCTestExpectation *pressureExpectation; // fulfilled on the pressure queue
+
+@end
+
+@implementation MWWebImageDownloaderBufferBudgetTests
+
+- (void)setUp
+{
+    [super setUp];
+    self.budget = [[MWWebImageDownloaderBufferBudget alloc] initWithLimit:1000];
+    self.pressureChanges = [NSMutableArray array];
+    __weak typeof(self) weakSelf = self;
+    self.budget.pressureChangedBlock = ^(BOOL overBudget) {
+        @synchronized (weakSelf.pressureChanges) {
+            [weakSelf.pressureChanges addObject:@(overBudget)];
+        }
+        [weakSelf.pressureExpectation fulfill];
+    };
+}
+
+// Run the block, then wait for the pressure change it causes
+- (void)expectPressureChange:(BOOL)overBudget afterBlock:(void(^)(void))block
+{
+    self.pressureExpectation = [self expectationWithDescription:overBudget ? @"Over budget" : @"Under budget"];
+    block();
+    XCTAssertEqual(self.budget.isOverBudget, overBudget);
+    [self waitForExpectationsWithTimeout:kMWTestLoadTimeout handler:nil];
+    self.pressureExpectation = nil;
+    @synchronized (self.pressureChanges) {
+        XCTAssertEqualObjects(self.pressureChanges.lastObject, @(overBudget));
+    }
+}
+
+// Let the pressure queue run, a change would have been delivered by then
+- (void)assertPressureChangeCount:(NSUInteger)count
+{
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Pressure queue drained"];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.1 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [expectation fulfill];
+    });
+    [self waitForExpectationsWithTimeout:kMWTestLoadTimeout handler:nil];
+    @synchronized (self.pressureChanges) {
+        XCTAssertEqual(self.pressureChanges.count, count, @"%@", self.pressureChanges);
+    }
+}
+
+#pragma mark - Hysteresis
+
+- (void)testOverTheLimitPausesAndDrainedToThreeQuartersResumes
+{
+    [self.budget chargeBytes:600];
+    [self.budget chargeBytes:400];
+    // At the limit is not over it
+    XCTAssertFalse(self.budget.isOverBudget);
+    [self expectPressureChange:YES afterBlock:^{
+        [self.budget chargeBytes:1];
+    }];
+    // Between 3/4 and the limit, still over budget
+    [self.budget releaseBytes:200];
+    XCTAssertTrue(self.budget.isOverBudget);
+    [self.budget releaseBytes:50];
+    XCTAssertEqual(self.budget.bufferedBytes, 751);
+    XCTAssertTrue(self.budget.isOverBudget);
+    [self expectPressureChange:NO afterBlock:^{
+        [self.budget releaseBytes:1];
+    }];
+    // Back up to the limit, still under budget
+    [self.budget chargeBytes:250];
+    XCTAssertFalse(self.budget.isOverBudget);
+    [self assertPressureChangeCount:2];
+}
+
+- (void)testChunksAroundTheLimitDoNotFlap
+{
+    [self expectPressureChange:YES afterBlock:^{
+        [self.budget chargeBytes:1100];
+    }];
+    // A download keeps receiving and decoding chunks of 100 bytes around the limit
+    for (NSUInteger i = 0; i < 10; i++) {
+        [self.budget releaseBytes:100];
+        [self.budget chargeBytes:100];
+    }
+    XCTAssertTrue(self.budget.isOverBudget);
+    [self assertPressureChangeCount:1];
+}
+
+- (void)testReleasingMoreThanBufferedIsClamped
+{
+    [self expectPressureChange:YES afterBlock:^{
+        [self.budget chargeBytes:2000];
+    }];
+    [self expectPressureChange:NO afterBlock:^{
+        [self.budget releaseBytes:5000];
+    }];
+    XCTAssertEqual(self.budget.bufferedBytes, 0);
+}
+
+#pragma mark - Limit
+
+- (void)testNoLimitCountsButNeverPauses
+{
+    self.budget.limit = 0;
+    [self.budget chargeBytes:NSUIntegerMax / 2];
+    XCTAssertFalse(self.budget.isOverBudget);
+    XCTAssertEqual(self.budget.bufferedBytes, NSUIntegerMax / 2);
+    [self assertPressureChangeCount:0];
+}
+
+- (void)testRemovingTheLimitResumesAtTheNextChange
+{
+    [self expectPressureChange:YES afterBlock:^{
+        [self.budget chargeBytes:2000];
+    }];
+    self.budget.limit = 0;
+    [self expectPressureChange:NO afterBlock:^{
+        [self.budget releaseBytes:1];
+    }];
+}
+
+#pragma mark - High water mark
+
+- (void)testHighWaterMark
+{
+    [self.budget chargeBytes:300];
+    [self.budget chargeBytes:200];
+    [self.budget releaseBytes:400];
+    XCTAssertEqual(self.budget.bufferedBytes, 100);
+    XCTAssertEqual(self.budget.highWaterMark, 500);
+    [self.budget resetHighWaterMark];
+    XCTAssertEqual(self.budget.highWaterMark, 100);
+    [self.budget chargeBytes:50];
+    XCTAssertEqual(self.budget.highWaterMark, 150);
+}
+
+@end
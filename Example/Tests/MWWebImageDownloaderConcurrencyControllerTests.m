@@ -0,0 +1,231 @@
+//
+//  MWWebImageDownloaderConcurrencyControllerTests.m
+//  MWWebImageTests
+//
+//  The additive increase, multiplicative decrease of the adaptive download concurrency, driven by reported downloads.
+//
+
+#import "MWWebImageTestCase.h"
+
+static NSString * const kMWTestHost = @"images.example.com";
+
+@interface MWWebImageDownloaderConcurrencyControllerTests : XCTestCase
+
+@end
+
+@implementation MWWebImageDownloaderConcurrencyControllerTests
+
+- (MWWebImageDownloaderConcurrencyDecision *)report:(MWWebImageDownloaderConcurrencyController *)controller timeToFirstByte:(NSTimeInterval)timeToFirstByte pending:(BOOL)pending
+{
+    return [controller decisionForDownloadWithHost:kMWTestHost timeToFirstByte:timeToFirstByte bytes:1000 error:nil hasPendingDownloads:pending];
+}
+
+- (MWWebImageDownloaderConcurrencyDecision *)report:(MWWebImageDownloaderConcurrencyController *)controller error:(NSError *)error
+{
+    return [controller decisionForDownloadWithHost:kMWTestHost timeToFirstByte:0.1 bytes:0 error:error hasPendingDownloads:YES];
+}
+
+// Finish one round of `limit` downloads with downloads still waiting. The queue drained for a moment at the start of the round, so its goodput is not compared and only the additive increase is exercised
+- (MWWebImageDownloaderConcurrencyDecision *)finishRoundOfController:(MWWebImageDownloaderConcurrencyController *)controller
+{
+    NSUInteger count = controller.limit;
+    for (NSUInteger i = 1; i < count; i++) {
+        XCTAssertNil([self report:controller timeToFirstByte:0.1 pending:i > 1], @"The round is not finished after %lu of %lu downloads", (unsigned long)i, (unsigned long)count);
+    }
+    return [self report:controller timeToFirstByte:0.1 pending:YES];
+}
+
+- (void)raiseLimitOfController:(MWWebImageDownloaderConcurrencyController *)controller to:(NSUInteger)limit
+{
+    while (controller.limit < limit) {
+        XCTAssertNotNil([self finishRoundOfController:controller]);
+    }
+    XCTAssertEqual(controller.limit, limit);
+}
+
+#pragma mark - Additive increase
+
+- (void)testRoundWithPendingDownloadsRaisesTheLimitByOne
+{
+    MWWebImageDownloaderConcurrencyController *controller = [[MWWebImageDownloaderConcurrencyController alloc] initWithMinimumLimit:1 maximumLimit:8];
+    XCTAssertEqual(controller.limit, 1);
+    for (NSUInteger limit = 1; limit < 5; limit++) {
+        MWWebImageDownloaderConcurrencyDecision *decision = [self finishRoundOfController:controller];
+        XCTAssertEqual(decision.reason, MWWebImageDownloaderConcurrencyChangeReasonAdditiveIncrease);
+        XCTAssertEqual(decision.previousLimit, limit);
+        XCTAssertEqual(decision.limit, limit + 1);
+        XCTAssertEqual(controller.limit, limit + 1);
+    }
+}
+
+- (void)testRoundWithoutPendingDownloadsKeepsTheLimit
+{
+    MWWebImageDownloaderConcurrencyController *controller = [[MWWebImageDownloaderConcurrencyController alloc] initWithMinimumLimit:1 maximumLimit:8];
+    [self raiseLimitOfController:controller to:3];
+    // Several rounds, the queue never needed more slots
+    for (NSUInteger i = 0; i < 9; i++) {
+        XCTAssertNil([self report:controller timeToFirstByte:0.1 pending:NO]);
+    }
+    XCTAssertEqual(controller.limit, 3);
+    // The next round counts from zero, a round needs `limit` downloads again
+    XCTAssertNil([self report:controller timeToFirstByte:0.1 pending:NO]);
+    XCTAssertNil([self report:controller timeToFirstByte:0.1 pending:YES]);
+    XCTAssertEqual([self report:controller timeToFirstByte:0.1 pending:YES].limit, 4);
+}
+
+#pragma mark - Slow first byte
+
+- (void)testSlowFirstByteHalvesTheLimit
+{
+    MWWebImageDownloaderConcurrencyController *controller = [[MWWebImageDownloaderConcurrencyController alloc] initWithMinimumLimit:1 maximumLimit:8];
+    [self raiseLimitOfController:controller to:6];
+    // The baseline is 0.1s, congested above 0.1 * 2 + 0.05
+    XCTAssertNil([self report:controller timeToFirstByte:0.24 pending:YES]);
+    MWWebImageDownloaderConcurrencyDecision *decision = [self report:controller timeToFirstByte:0.5 pending:YES];
+    XCTAssertEqual(decision.reason, MWWebImageDownloaderConcurrencyChangeReasonSlowFirstByte);
+    XCTAssertEqual(decision.previousLimit, 6);
+    XCTAssertEqual(decision.limit, 3);
+    XCTAssertEqualWithAccuracy(decision.timeToFirstByte, 0.5, 0.0001);
+    XCTAssertEqualWithAccuracy(decision.baselineTimeToFirstByte, 0.1, 0.0001);
+    XCTAssertEqual(controller.limit, 3);
+}
+
+- (void)testFirstByteIsOnlyComparedWithTheSameHost
+{
+    MWWebImageDownloaderConcurrencyController *controller = [[MWWebImageDownloaderConcurrencyController alloc] initWithMinimumLimit:1 maximumLimit:8];
+    [self raiseLimitOfController:controller to:6];
+    // A slow CDN, not a congested link
+    XCTAssertNil([controller decisionForDownloadWithHost:@"slow.example.com" timeToFirstByte:2 bytes:1000 error:nil hasPendingDownloads:YES]);
+    XCTAssertNil([controller decisionForDownloadWithHost:@"slow.example.com" timeToFirstByte:2 bytes:1000 error:nil hasPendingDownloads:YES]);
+    // An unknown first byte time is not a sample
+    XCTAssertNil([self report:controller timeToFirstByte:-1 pending:YES]);
+    XCTAssertEqual(controller.limit, 6);
+    // Hosts are case insensitive
+    MWWebImageDownloaderConcurrencyDecision *decision = [controller decisionForDownloadWithHost:kMWTestHost.uppercaseString timeToFirstByte:0.5 bytes:1000 error:nil hasPendingDownloads:YES];
+    XCTAssertEqual(decision.reason, MWWebImageDownloaderConcurrencyChangeReasonSlowFirstByte);
+    XCTAssertEqualWithAccuracy(decision.baselineTimeToFirstByte, 0.1, 0.0001);
+}
+
+#pragma mark - Goodput
+
+- (void)testGoodputDropOfSaturatedRoundHalvesTheLimit
+{
+    MWWebImageDownloaderConcurrencyController *controller = [[MWWebImageDownloaderConcurrencyController alloc] initWithMinimumLimit:1 maximumLimit:2];
+    // A saturated round of 100MB in well under a second, then a saturated round of 2 bytes
+    MWWebImageDownloaderConcurrencyDecision *decision = [controller decisionForDownloadWithHost:kMWTestHost timeToFirstByte:0.1 bytes:100 * 1024 * 1024 error:nil hasPendingDownloads:YES];
+    XCTAssertEqual(decision.reason, MWWebImageDownloaderConcurrencyChangeReasonAdditiveIncrease);
+    XCTAssertEqual(controller.limit, 2);
+    XCTAssertNil([controller decisionForDownloadWithHost:kMWTestHost timeToFirstByte:0.1 bytes:1 error:nil hasPendingDownloads:YES]);
+    decision = [controller decisionForDownloadWithHost:kMWTestHost timeToFirstByte:0.1 bytes:1 error:nil hasPendingDownloads:YES];
+    XCTAssertEqual(decision.reason, MWWebImageDownloaderConcurrencyChangeReasonGoodputDrop);
+    XCTAssertEqual(decision.previousLimit, 2);
+    XCTAssertEqual(decision.limit, 1);
+    XCTAssertGreaterThan(decision.goodput, 0);
+}
+
+- (void)testGoodputOfIdleRoundIsNotCompared
+{
+    MWWebImageDownloaderConcurrencyController *controller = [[MWWebImageDownloaderConcurrencyController alloc] initWithMinimumLimit:1 maximumLimit:2];
+    XCTAssertNotNil([controller decisionForDownloadWithHost:kMWTestHost timeToFirstByte:0.1 bytes:100 * 1024 * 1024 error:nil hasPendingDownloads:YES]);
+    // The queue drained during the round, the low goodput is not the network
+    XCTAssertNil([controller decisionForDownloadWithHost:kMWTestHost timeToFirstByte:0.1 bytes:1 error:nil hasPendingDownloads:NO]);
+    XCTAssertNil([controller decisionForDownloadWithHost:kMWTestHost timeToFirstByte:0.1 bytes:1 error:nil hasPendingDownloads:YES]);
+    XCTAssertEqual(controller.limit, 2);
+}
+
+#pragma mark - Errors
+
+- (void)testNetworkErrorsHalveTheLimit
+{
+    NSArray<NSNumber *> *codes = @[@(NSURLErrorTimedOut), @(NSURLErrorNetworkConnectionLost), @(NSURLErrorCannotConnectToHost)];
+    for (NSNumber *code in codes) {
+        MWWebImageDownloaderConcurrencyController *controller = [[MWWebImageDownloaderConcurrencyController alloc] initWithMinimumLimit:1 maximumLimit:8];
+        [self raiseLimitOfController:controller to:4];
+        MWWebImageDownloaderConcurrencyDecision *decision = [self report:controller error:[NSError errorWithDomain:NSURLErrorDomain code:code.integerValue userInfo:nil]];
+        XCTAssertEqual(decision.reason, MWWebImageDownloaderConcurrencyChangeReasonNetworkError, @"%@", code);
+        XCTAssertEqual(decision.limit, 2, @"%@", code);
+    }
+}
+
+- (void)testOtherErrorsAreNotCongestionNorFinishTheRound
+{
+    MWWebImageDownloaderConcurrencyController *controller = [[MWWebImageDownloaderConcurrencyController alloc] initWithMinimumLimit:1 maximumLimit:8];
+    [self raiseLimitOfController:controller to:2];
+    NSArray<NSError *> *errors = @[[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil],
+                                   [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorBadServerResponse userInfo:nil],
+                                   [NSError errorWithDomain:MWWebImageErrorDomain code:MWWebImageErrorInvalidDownloadStatusCode userInfo:nil]];
+    for (NSError *error in errors) {
+        XCTAssertNil([self report:controller error:error], @"%@", error);
+    }
+    XCTAssertEqual(controller.limit, 2);
+    // The round still needs two successful downloads
+    XCTAssertNil([self report:controller timeToFirstByte:0.1 pending:NO]);
+    XCTAssertEqual([self report:controller timeToFirstByte:0.1 pending:YES].limit, 3);
+}
+
+#pragma mark - Stale samples
+
+- (void)testDownloadsInFlightDuringDecreaseAreNotCountedAgain
+{
+    MWWebImageDownloaderConcurrencyController *controller = [[MWWebImageDownloaderConcurrencyController alloc] initWithMinimumLimit:1 maximumLimit:8];
+    [self raiseLimitOfController:controller to:4];
+    NSError *timeout = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorTimedOut userInfo:nil];
+    XCTAssertEqual([self report:controller error:timeout].limit, 2);
+    // The 4 downloads started with the old limit see the same congestion
+    XCTAssertNil([self report:controller error:timeout]);
+    XCTAssertNil([self report:controller timeToFirstByte:0.5 pending:NO]);
+    XCTAssertNil([self report:controller error:timeout]);
+    XCTAssertNil([self report:controller timeToFirstByte:0.5 pending:NO]);
+    XCTAssertEqual(controller.limit, 2);
+    // A download started after the decrease is fresh again
+    MWWebImageDownloaderConcurrencyDecision *decision = [self report:controller timeToFirstByte:0.5 pending:NO];
+    XCTAssertEqual(decision.reason, MWWebImageDownloaderConcurrencyChangeReasonSlowFirstByte);
+    XCTAssertEqual(decision.limit, 1);
+}
+
+#pragma mark - Floor and ceiling
+
+- (void)testLimitStaysAtTheCeiling
+{
+    MWWebImageDownloaderConcurrencyController *controller = [[MWWebImageDownloaderConcurrencyController alloc] initWithMinimumLimit:2 maximumLimit:3];
+    XCTAssertEqual(controller.limit, 2);
+    [self raiseLimitOfController:controller to:3];
+    XCTAssertNil([self finishRoundOfController:controller]);
+    XCTAssertNil([self finishRoundOfController:controller]);
+    XCTAssertEqual(controller.limit, 3);
+}
+
+- (void)testLimitStaysAtTheFloor
+{
+    MWWebImageDownloaderConcurrencyController *controller = [[MWWebImageDownloaderConcurrencyController alloc] initWithMinimumLimit:2 maximumLimit:8];
+    [self raiseLimitOfController:controller to:3];
+    // 3 / 2 would be 1, below the floor
+    XCTAssertEqual([self report:controller timeToFirstByte:0.5 pending:YES].limit, 2);
+    [self report:controller timeToFirstByte:0.1 pending:NO];
+    [self report:controller timeToFirstByte:0.1 pending:NO];
+    [self report:controller timeToFirstByte:0.1 pending:NO];
+    // Already at the floor, no decision
+    XCTAssertNil([self report:controller error:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorTimedOut userInfo:nil]]);
+    XCTAssertEqual(controller.limit, 2);
+}
+
+- (void)testLimitsAreClamped
+{
+    MWWebImageDownloaderConcurrencyController *controller = [[MWWebImageDownloaderConcurrencyController alloc] initWithMinimumLimit:0 maximumLimit:0];
+    XCTAssertEqual(controller.minimumLimit, 1);
+    XCTAssertEqual(controller.maximumLimit, 1);
+    XCTAssertEqual(controller.limit, 1);
+
+    controller = [[MWWebImageDownloaderConcurrencyController alloc] initWithMinimumLimit:1 maximumLimit:8];
+    [self raiseLimitOfController:controller to:5];
+    controller.maximumLimit = 3;
+    XCTAssertEqual(controller.limit, 3);
+    controller.minimumLimit = 4;
+    XCTAssertEqual(controller.maximumLimit, 4);
+    XCTAssertEqual(controller.limit, 4);
+    controller.maximumLimit = 2;
+    XCTAssertEqual(controller.maximumLimit, 4);
+    XCTAssertEqual(controller.limit, 4);
+}
+
+@end
@@ -0,0 +1,127 @@
+//
+//  MWWebImageDownloaderDecryptorTests.m
+//  MWWebImageTests
+//
+//  The streaming base64 decryptor, whose groups of 4 characters are split at any offset by the received chunks.
+//
+
+#import "MWWebImageTestCase.h"
+
+@interface MWWebImageDownloaderDecryptorTests : MWWebImageTestCase
+
+@end
+
+@implementation MWWebImageDownloaderDecryptorTests
+
++ (NSData *)payloadWithLength:(NSUInteger)length
+{
+    NSMutableData *payload = [NSMutableData dataWithLength:length];
+    uint8_t *bytes = payload.mutableBytes;
+    uint32_t seed = (uint32_t)length;
+    for (NSUInteger i = 0; i < length; i++) {
+        seed = seed * 1664525 + 1013904223;
+        bytes[i] = seed >> 24;
+    }
+    return payload;
+}
+
+// Feed the encoded data in chunks of the given lengths, the last chunk takes the rest
++ (NSData *)decryptData:(NSData *)encodedData chunkLengths:(NSArray<NSNumber *> *)chunkLengths
+{
+    id<MWWebImageDownloaderDecryptorStream> stream = [(id<MWWebImageDownloaderStreamingDecryptor>)MWWebImageDownloaderDecryptor.base64Decryptor decryptorStreamWithResponse:nil];
+    NSMutableData *decryptedData = [NSMutableData data];
+    NSUInteger offset = 0;
+    for (NSNumber *chunkLength in chunkLengths) {
+        NSUInteger length = MIN(chunkLength.unsignedIntegerValue, encodedData.length - offset);
+        NSData *data = [stream decryptedDataWithData:[encodedData subdataWithRange:NSMakeRange(offset, length)]];
+        if (!data) {
+            return nil;
+        }
+        [decryptedData appendData:data];
+        offset += length;
+    }
+    NSData *data = [stream decryptedDataWithData:[encodedData subdataWithRange:NSMakeRange(offset, encodedData.length - offset)]];
+    NSData *remainingData = [stream finishDecrypting];
+    if (!data || !remainingData) {
+        return nil;
+    }
+    [decryptedData appendData:data];
+    [decryptedData appendData:remainingData];
+    return decryptedData;
+}
+
+- (void)testBase64DecryptorIsStreaming
+{
+    XCTAssertTrue([MWWebImageDownloaderDecryptor.base64Decryptor conformsToProtocol:@protocol(MWWebImageDownloaderStreamingDecryptor)]);
+}
+
+- (void)testBase64StreamSplitAtEveryOffset
+{
+    // No padding, one `=` and two `=`
+    for (NSUInteger length = 300; length < 303; length++) {
+        NSData *payload = [self.class payloadWithLength:length];
+        NSData *encodedData = [payload base64EncodedDataWithOptions:0];
+        for (NSUInteger offset = 0; offset <= encodedData.length; offset++) {
+            XCTAssertEqualObjects([self.class decryptData:encodedData chunkLengths:@[@(offset)]], payload, @"Split at %lu", (unsigned long)offset);
+        }
+    }
+}
+
+- (void)testBase64StreamWithSmallChunks
+{
+    NSData *payload = [self.class payloadWithLength:1000];
+    NSData *encodedData = [payload base64EncodedDataWithOptions:0];
+    for (NSUInteger chunkLength = 1; chunkLength <= 9; chunkLength++) {
+        NSMutableArray<NSNumber *> *chunkLengths = [NSMutableArray array];
+        for (NSUInteger offset = 0; offset < encodedData.length; offset += chunkLength) {
+            [chunkLengths addObject:@(chunkLength)];
+        }
+        XCTAssertEqualObjects([self.class decryptData:encodedData chunkLengths:chunkLengths], payload, @"Chunks of %lu", (unsigned long)chunkLength);
+    }
+}
+
+- (void)testBase64StreamSkipsLineBreaks
+{
+    NSData *payload = [self.class payloadWithLength:1000];
+    NSData *encodedData = [payload base64EncodedDataWithOptions:NSDataBase64Encoding76CharacterLineLength | NSDataBase64EncodingEndLineWithCarriageReturn | NSDataBase64EncodingEndLineWithLineFeed];
+    // Split inside the line breaks too
+    for (NSUInteger offset = 70; offset <= 84; offset++) {
+        XCTAssertEqualObjects([self.class decryptData:encodedData chunkLengths:@[@(offset)]], payload, @"Split at %lu", (unsigned long)offset);
+    }
+}
+
+- (void)testBase64StreamWithoutPadding
+{
+    NSData *payload = [self.class payloadWithLength:301];
+    NSString *encodedString = [[payload base64EncodedStringWithOptions:0] stringByTrimmingCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@"="]];
+    NSData *encodedData = [encodedString dataUsingEncoding:NSASCIIStringEncoding];
+    XCTAssertEqualObjects([self.class decryptData:encodedData chunkLengths:@[@(encodedData.length - 1)]], payload);
+}
+
+- (void)testBase64StreamRejectsTruncatedGroup
+{
+    NSData *payload = [self.class payloadWithLength:300];
+    NSMutableData *encodedData = [[payload base64EncodedDataWithOptions:0] mutableCopy];
+    // A single character can't encode a byte
+    [encodedData appendBytes:"Q" length:1];
+    XCTAssertNil([self.class decryptData:encodedData chunkLengths:@[@(encodedData.length / 2)]]);
+}
+
+- (void)testBase64DownloadWithOddChunks
+{
+    UIImage *image = [MWWebImageTestCase sampleImageWithSize:CGSizeMake(128, 96)];
+    NSData *imageData = [[MWImageIOCoder sharedCoder] encodedDataWithImage:image format:MWImageFormatPNG options:nil];
+    NSURL *url = [self URLForPath:@"/image.b64"];
+    [self.localLoader setData:[imageData base64EncodedDataWithOptions:NSDataBase64Encoding64CharacterLineLength] forPath:url.path];
+    // Chunks which split both the groups and the line breaks
+    MWImageLocalLoaderProfile *profile = [MWImageLocalLoaderProfile profileWithLatency:0 bandwidth:50 * 1024 * 1024];
+    profile.chunkSize = 333;
+    self.localLoader.defaultProfile = profile;
+    [self loadImageWithURL:url options:MWWebImageFromLoaderOnly context:@{MWWebImageContextDownloadDecryptor : MWWebImageDownloaderDecryptor.base64Decryptor} completion:^(UIImage *image, NSError *error, MWImageCacheType cacheType) {
+        XCTAssertNil(error);
+        XCTAssertEqual(CGImageGetWidth(image.CGImage), 128);
+        XCTAssertEqual(CGImageGetHeight(image.CGImage), 96);
+    }];
+}
+
+@end
@@ -0,0 +1,229 @@
+//
+//  MWWebImageDownloaderHostSchedulerTests.m
+//  MWWebImageTests
+//
+//  The per-host limits and the smooth weighted round-robin of the host scheduler, with operations which are never started.
+//
+
+#import "MWWebImageTestCase.h"
+
+@interface MWWebImageDownloaderHostSchedulerTests : XCTestCase
+
+@property (nonatomic, strong) MWWebImageDownloaderConfig *config;
+@property (nonatomic, strong) MWWebImageDownloaderHostScheduler *scheduler;
+@property (nonatomic, strong) NSMapTable<NSOperation *, NSString *> *hosts;
+
+@end
+
+@implementation MWWebImageDownloaderHostSchedulerTests
+
+- (void)setUp
+{
+    [super setUp];
+    self.config = [MWWebImageDownloaderConfig new];
+    self.scheduler = [[MWWebImageDownloaderHostScheduler alloc] initWithConfig:self.config];
+    self.hosts = [NSMapTable strongToStrongObjectsMapTable];
+}
+
+- (NSArray<NSOperation *> *)enqueueOperationsWithCount:(NSUInteger)count forHost:(NSString *)host
+{
+    NSMutableArray<NSOperation *> *operations = [NSMutableArray array];
+    for (NSUInteger i = 0; i < count; i++) {
+        NSOperation *operation = [NSBlockOperation blockOperationWithBlock:^{}];
+        [self.hosts setObject:host forKey:operation];
+        [self.scheduler enqueueOperation:operation forHost:host];
+        [operations addObject:operation];
+    }
+    return [operations copy];
+}
+
+- (NSArray<NSString *> *)hostsOfOperations:(NSArray<NSOperation *> *)operations
+{
+    NSMutableArray<NSString *> *hosts = [NSMutableArray array];
+    for (NSOperation *operation in operations) {
+        [hosts addObject:[self.hosts objectForKey:operation]];
+    }
+    return [hosts copy];
+}
+
+- (NSUInteger)countOfHost:(NSString *)host inHosts:(NSArray<NSString *> *)hosts
+{
+    return [hosts indexesOfObjectsPassingTest:^BOOL(NSString *obj, NSUInteger idx, BOOL *stop) {
+        return [obj isEqualToString:host];
+    }].count;
+}
+
+#pragma mark - Limits
+
+- (void)testGlobalLimit
+{
+    [self enqueueOperationsWithCount:5 forHost:@"a.com"];
+    XCTAssertEqual([self.scheduler dequeueOperationsWithLimit:3].count, 3);
+    // The admitted downloads still hold their slots
+    XCTAssertEqual([self.scheduler dequeueOperationsWithLimit:3].count, 0);
+    XCTAssertEqual(self.scheduler.pendingCount, 2);
+}
+
+- (void)testPerHostLimit
+{
+    self.config.maxConcurrentDownloadsPerHost = 2;
+    NSArray<NSOperation *> *operations = [self enqueueOperationsWithCount:5 forHost:@"a.com"];
+    [self enqueueOperationsWithCount:5 forHost:@"b.com"];
+    NSArray<NSString *> *hosts = [self hostsOfOperations:[self.scheduler dequeueOperationsWithLimit:10]];
+    XCTAssertEqual(hosts.count, 4);
+    XCTAssertEqual([self countOfHost:@"a.com" inHosts:hosts], 2);
+    XCTAssertEqual([self countOfHost:@"b.com" inHosts:hosts], 2);
+    XCTAssertEqual(self.scheduler.statistics[@"a.com"].runningCount, 2);
+    XCTAssertEqual(self.scheduler.statistics[@"a.com"].pendingCount, 3);
+
+    // A finished download frees a slot of its own host only
+    [self.scheduler finishOperation:operations[0]];
+    XCTAssertEqualObjects([self hostsOfOperations:[self.scheduler dequeueOperationsWithLimit:10]], @[@"a.com"]);
+    XCTAssertEqual(self.scheduler.statistics[@"a.com"].finishedCount, 1);
+
+    // The limit is read at each scheduling
+    self.config.maxConcurrentDownloadsPerHost = 3;
+    hosts = [self hostsOfOperations:[self.scheduler dequeueOperationsWithLimit:10]];
+    XCTAssertEqual([self countOfHost:@"a.com" inHosts:hosts], 1);
+    XCTAssertEqual([self countOfHost:@"b.com" inHosts:hosts], 1);
+}
+
+#pragma mark - Round-robin
+
+- (void)testHostsAreInterleaved
+{
+    [self enqueueOperationsWithCount:6 forHost:@"a.com"];
+    [self enqueueOperationsWithCount:6 forHost:@"b.com"];
+    [self enqueueOperationsWithCount:2 forHost:@"c.com"];
+    NSArray<NSString *> *hosts = [self hostsOfOperations:[self.scheduler dequeueOperationsWithLimit:6]];
+    // One download of each host per turn, a busy host does not starve the others
+    XCTAssertEqual([self countOfHost:@"a.com" inHosts:hosts], 2);
+    XCTAssertEqual([self countOfHost:@"b.com" inHosts:hosts], 2);
+    XCTAssertEqual([self countOfHost:@"c.com" inHosts:hosts], 2);
+    for (NSUInteger i = 1; i < hosts.count; i++) {
+        XCTAssertNotEqualObjects(hosts[i], hosts[i - 1], @"%@", hosts);
+    }
+    // Then the remaining hosts alternate
+    hosts = [self hostsOfOperations:[self.scheduler dequeueOperationsWithLimit:10]];
+    XCTAssertEqual([self countOfHost:@"a.com" inHosts:hosts], 2);
+    XCTAssertEqual([self countOfHost:@"b.com" inHosts:hosts], 2);
+    for (NSUInteger i = 1; i < hosts.count; i++) {
+        XCTAssertNotEqualObjects(hosts[i], hosts[i - 1], @"%@", hosts);
+    }
+}
+
+- (void)testHostWeights
+{
+    self.config.downloadWeightsPerHost = @{@"a.com" : @2};
+    [self enqueueOperationsWithCount:10 forHost:@"a.com"];
+    [self enqueueOperationsWithCount:10 forHost:@"b.com"];
+    NSArray<NSString *> *hosts = [self hostsOfOperations:[self.scheduler dequeueOperationsWithLimit:9]];
+    // Each turn of 3 slots gives 2 to the heavier host, spread out rather than in a burst
+    for (NSUInteger turn = 0; turn < 3; turn++) {
+        NSArray<NSString *> *turnHosts = [hosts subarrayWithRange:NSMakeRange(turn * 3, 3)];
+        XCTAssertEqual([self countOfHost:@"a.com" inHosts:turnHosts], 2, @"%@", hosts);
+        XCTAssertEqual([self countOfHost:@"b.com" inHosts:turnHosts], 1, @"%@", hosts);
+    }
+    for (NSUInteger i = 1; i < hosts.count; i++) {
+        XCTAssertFalse([hosts[i] isEqualToString:@"b.com"] && [hosts[i - 1] isEqualToString:@"b.com"], @"%@", hosts);
+    }
+}
+
+- (void)testPriorityThenExecutionOrderInsideHost
+{
+    NSArray<NSOperation *> *operations = [self enqueueOperationsWithCount:4 forHost:@"a.com"];
+    operations[2].queuePriority = NSOperationQueuePriorityHigh;
+    NSArray<NSOperation *> *admittedOperations = [self.scheduler dequeueOperationsWithLimit:4];
+    XCTAssertEqualObjects(admittedOperations, (@[operations[2], operations[0], operations[1], operations[3]]));
+
+    self.config.executionOrder = MWWebImageDownloaderLIFOExecutionOrder;
+    operations = [self enqueueOperationsWithCount:4 forHost:@"b.com"];
+    operations[1].queuePriority = NSOperationQueuePriorityHigh;
+    admittedOperations = [self.scheduler dequeueOperationsWithLimit:8];
+    XCTAssertEqualObjects(admittedOperations, (@[operations[1], operations[3], operations[2], operations[0]]));
+}
+
+#pragma mark - Cancellation
+
+- (void)testCancelledOperationDoesNotWait
+{
+    NSMutableArray<NSOperation *> *cancelledOperations = [NSMutableArray array];
+    self.scheduler.cancelledBlock = ^(NSOperation *operation) {
+        [cancelledOperations addObject:operation];
+    };
+    [self enqueueOperationsWithCount:1 forHost:@"a.com"];
+    XCTAssertEqual([self.scheduler dequeueOperationsWithLimit:1].count, 1);
+    // The global limit is reached, the cancelled one is handed out anyway
+    NSArray<NSOperation *> *operations = [self enqueueOperationsWithCount:2 forHost:@"a.com"];
+    [operations[1] cancel];
+    XCTAssertEqualObjects(cancelledOperations, @[operations[1]]);
+    XCTAssertEqualObjects(self.scheduler.pendingOperations, @[operations[0]]);
+    XCTAssertEqual(self.scheduler.statistics[@"a.com"].runningCount, 2);
+
+    // Cancelled before it was enqueued
+    NSOperation *operation = [NSBlockOperation blockOperationWithBlock:^{}];
+    [operation cancel];
+    [self.scheduler enqueueOperation:operation forHost:@"b.com"];
+    XCTAssertEqualObjects(cancelledOperations, (@[operations[1], operation]));
+    XCTAssertEqual(self.scheduler.statistics[@"b.com"].pendingCount, 0);
+
+    // An admitted download is not observed anymore
+    [operations[1] cancel];
+    [self.scheduler finishOperation:operations[1]];
+    XCTAssertEqual(cancelledOperations.count, 2);
+    XCTAssertEqual(self.scheduler.statistics[@"a.com"].runningCount, 1);
+}
+
+#pragma mark - Idle hosts
+
+- (NSArray<NSOperation *> *)enqueueOperationsForHostsInRange:(NSRange)range
+{
+    NSMutableArray<NSOperation *> *operations = [NSMutableArray array];
+    for (NSUInteger i = range.location; i < NSMaxRange(range); i++) {
+        [operations addObjectsFromArray:[self enqueueOperationsWithCount:1 forHost:[NSString stringWithFormat:@"%lu.com", (unsigned long)i]]];
+    }
+    return [operations copy];
+}
+
+- (void)testActiveHostsAreNotPruned
+{
+    NSArray<NSOperation *> *operations = [self enqueueOperationsForHostsInRange:NSMakeRange(0, 40)];
+    XCTAssertEqual([self.scheduler dequeueOperationsWithLimit:40].count, 40);
+    // Past the host count, but only one host is idle
+    [self.scheduler finishOperation:operations[0]];
+    NSDictionary<NSString *, MWWebImageDownloaderHostStatistics *> *statistics = self.scheduler.statistics;
+    XCTAssertEqual(statistics.count, 39);
+    XCTAssertNil(statistics[@"0.com"]);
+    XCTAssertEqual(statistics[@"1.com"].runningCount, 1);
+}
+
+- (void)testLeastRecentlyActiveIdleHostsArePruned
+{
+    NSArray<NSOperation *> *operations = [self enqueueOperationsForHostsInRange:NSMakeRange(0, 32)];
+    XCTAssertEqual([self.scheduler dequeueOperationsWithLimit:32].count, 32);
+    for (NSUInteger i = 0; i < 3; i++) {
+        [self.scheduler finishOperation:operations[i]];
+    }
+    [NSThread sleepForTimeInterval:0.01];
+    for (NSUInteger i = 3; i < 32; i++) {
+        [self.scheduler finishOperation:operations[i]];
+    }
+    // Idle hosts are kept for the statistics up to the host count
+    XCTAssertEqual(self.scheduler.statistics.count, 32);
+
+    [self enqueueOperationsForHostsInRange:NSMakeRange(32, 3)];
+    NSArray<NSOperation *> *admittedOperations = [self.scheduler dequeueOperationsWithLimit:1];
+    XCTAssertEqual(admittedOperations.count, 1);
+    [self.scheduler finishOperation:admittedOperations[0]];
+    NSDictionary<NSString *, MWWebImageDownloaderHostStatistics *> *statistics = self.scheduler.statistics;
+    XCTAssertEqual(statistics.count, 32);
+    XCTAssertNil(statistics[@"0.com"]);
+    XCTAssertNil(statistics[@"1.com"]);
+    XCTAssertNil(statistics[@"2.com"]);
+    XCTAssertEqual(statistics[@"3.com"].finishedCount, 1);
+    XCTAssertNotNil(statistics[@"32.com"]);
+    XCTAssertNotNil(statistics[@"33.com"]);
+    XCTAssertNotNil(statistics[@"34.com"]);
+}
+
+@end
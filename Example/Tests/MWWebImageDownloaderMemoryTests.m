@@ -0,0 +1,163 @@
+//
+//  MWWebImageDownloaderMemoryTests.m
+//  MWWebImageTests
+//
+//  The peak memory of a download: the received chunks are copied into one buffer of the expected size, which the completion maps without a second copy.
+//
+
+#import "MWWebImageTestCase.h"
+#import <mach/mach.h>
+
+// A payload large enough to stand out of the allocator noise
+static const NSUInteger kMWLargeChunkLength = 32 * 1024 * 1024;
+
+// The memory footprint of the process, the one the system limits
+static uint64_t MWPhysicalFootprint(void) {
+    task_vm_info_data_t info;
+    mach_msg_type_number_t count = TASK_VM_INFO_COUNT;
+    if (task_info(mach_task_self(), TASK_VM_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) {
+        return 0;
+    }
+    return info.phys_footprint;
+}
+
+static uint32_t MWCRC32(const uint8_t *bytes, size_t length, uint32_t crc) {
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= bytes[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+@interface MWWebImageDownloaderMemoryTests : MWWebImageTestCase
+
+@property (nonatomic, strong) NSData *imageData;
+@property (nonatomic, strong) NSURL *imageURL;
+
+@end
+
+@implementation MWWebImageDownloaderMemoryTests
+
+- (void)setUp
+{
+    [super setUp];
+    self.imageURL = [self URLForPath:@"/large.png"];
+    self.imageData = [self.class largePNGData];
+    [self.localLoader setData:self.imageData forPath:self.imageURL.path];
+    // Like a fast network, a chunk at a time
+    MWImageLocalLoaderProfile *profile = [MWImageLocalLoaderProfile profileWithLatency:0 bandwidth:1024 * 1024 * 1024];
+    profile.chunkSize = 256 * 1024;
+    self.localLoader.defaultProfile = profile;
+}
+
+// A small PNG made large by a private ancillary chunk, which the decoders skip: the bytes are downloaded, the bitmap stays small
++ (NSData *)largePNGData
+{
+    UIImage *image = [MWWebImageTestCase sampleImageWithSize:CGSizeMake(64, 64)];
+    NSData *pngData = [[MWImageIOCoder sharedCoder] encodedDataWithImage:image format:MWImageFormatPNG options:nil];
+    // After the signature (8 bytes) and the IHDR chunk (25 bytes)
+    NSUInteger insertOffset = 8 + 25;
+    NSMutableData *data = [NSMutableData dataWithCapacity:pngData.length + kMWLargeChunkLength + 12];
+    [data appendData:[pngData subdataWithRange:NSMakeRange(0, insertOffset)]];
+    uint32_t length = CFSwapInt32HostToBig((uint32_t)kMWLargeChunkLength);
+    [data appendBytes:&length length:4];
+    NSUInteger typeOffset = data.length;
+    [data appendBytes:"mwPd" length:4];
+    [data increaseLengthBy:kMWLargeChunkLength];
+    uint8_t *chunkBytes = (uint8_t *)data.mutableBytes + typeOffset + 4;
+    for (NSUInteger i = 0; i < kMWLargeChunkLength; i++) {
+        chunkBytes[i] = (uint8_t)(i * 31);
+    }
+    uint32_t crc = CFSwapInt32HostToBig(MWCRC32((uint8_t *)data.mutableBytes + typeOffset, 4 + kMWLargeChunkLength, 0));
+    [data appendBytes:&crc length:4];
+    [data appendData:[pngData subdataWithRange:NSMakeRange(insertOffset, pngData.length - insertOffset)]];
+    return [data copy];
+}
+
+// Download the image and return the peak footprint growth sampled at each progress and at completion
+- (uint64_t)downloadMeasuringPeakFootprint
+{
+    __block uint64_t peakFootprint = 0;
+    dispatch_semaphore_t lock = dispatch_semaphore_create(1);
+    void (^sample)(void) = ^{
+        uint64_t footprint = MWPhysicalFootprint();
+        dispatch_semaphore_wait(lock, DISPATCH_TIME_FOREVER);
+        peakFootprint = MAX(peakFootprint, footprint);
+        dispatch_semaphore_signal(lock);
+    };
+    uint64_t baseFootprint = MWPhysicalFootprint();
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Large download"];
+    [self.downloader downloadImageWithURL:self.imageURL options:0 progress:^(NSInteger receivedSize, NSInteger expectedSize, NSURL *targetURL) {
+        sample();
+    } completed:^(UIImage *image, NSData *data, NSError *error, BOOL finished) {
+        sample();
+        XCTAssertNil(error);
+        XCTAssertNotNil(image);
+        XCTAssertEqual(data.length, self.imageData.length);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:kMWTestLoadTimeout handler:nil];
+    return peakFootprint > baseFootprint ? peakFootprint - baseFootprint : 0;
+}
+
+- (void)testPeakFootprintIsTheImageSize
+{
+    uint64_t peakGrowth = [self downloadMeasuringPeakFootprint];
+    NSLog(@"Downloaded %lu bytes, peak footprint growth %llu bytes", (unsigned long)self.imageData.length, peakGrowth);
+    // Flattening the received chunks while they are still referenced would double it
+    XCTAssertLessThan(peakGrowth, (uint64_t)(self.imageData.length * 1.5));
+}
+
+- (void)testBodyPastTheCappedReceiveBufferIsKept
+{
+    // A 4 MB receive buffer at most, the rest of the body goes to the rope
+    MWWebImageDownloaderConfig *config = [self.class localDownloaderConfig];
+    config.maxImagePixelCount = 1024 * 1024;
+    MWWebImageDownloader *downloader = [[MWWebImageDownloader alloc] initWithConfig:config];
+    [self addTeardownBlock:^{
+        [downloader invalidateSessionAndCancel:YES];
+    }];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Large download"];
+    [downloader downloadImageWithURL:self.imageURL options:0 progress:nil completed:^(UIImage *image, NSData *data, NSError *error, BOOL finished) {
+        XCTAssertNil(error);
+        XCTAssertNotNil(image);
+        XCTAssertEqualObjects(data, self.imageData);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:kMWTestLoadTimeout handler:nil];
+}
+
+- (void)testDownloadToFileMapsTheFile
+{
+    __block uint64_t peakFootprint = 0;
+    uint64_t baseFootprint = MWPhysicalFootprint();
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Large download to file"];
+    [self.manager loadImageWithURL:self.imageURL options:MWWebImageDownloadToFile | MWWebImageFromLoaderOnly progress:^(NSInteger receivedSize, NSInteger expectedSize, NSURL *targetURL) {
+        peakFootprint = MAX(peakFootprint, MWPhysicalFootprint());
+    } completed:^(UIImage *image, NSData *data, NSError *error, MWImageCacheType cacheType, BOOL finished, NSURL *imageURL) {
+        peakFootprint = MAX(peakFootprint, MWPhysicalFootprint());
+        XCTAssertNil(error);
+        XCTAssertNotNil(image);
+        XCTAssertEqualObjects(data, self.imageData);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:kMWTestLoadTimeout handler:nil];
+    uint64_t peakGrowth = peakFootprint > baseFootprint ? peakFootprint - baseFootprint : 0;
+    NSLog(@"Downloaded %lu bytes to a file, peak footprint growth %llu bytes", (unsigned long)self.imageData.length, peakGrowth);
+    // The pages of the mapped file are not dirty, they are not part of the footprint
+    XCTAssertLessThan(peakGrowth, (uint64_t)(self.imageData.length / 2));
+}
+
+- (void)testDownloadMemoryPerformance
+{
+    if (@available(iOS 13.0, *)) {
+        [self measureWithMetrics:@[[XCTMemoryMetric new]] block:^{
+            [self downloadMeasuringPeakFootprint];
+        }];
+    }
+}
+
+@end
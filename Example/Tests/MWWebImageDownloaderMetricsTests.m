@@ -0,0 +1,122 @@
+//
+//  MWWebImageDownloaderMetricsTests.m
+//  MWWebImageTests
+//
+//  The percentiles of the log-linear histograms of the download metrics, within the bucket precision.
+//
+
+#import "MWWebImageTestCase.h"
+
+// Private, recorded by the collector from the task metrics
+@interface MWWebImageDownloaderHistogram (Tests)
+
+- (void)recordValue:(uint64_t)value;
+
+@end
+
+@interface MWWebImageDownloaderMetricsTests : XCTestCase
+
+@end
+
+@implementation MWWebImageDownloaderMetricsTests
+
+- (MWWebImageDownloaderHistogram *)histogramWithValuesFrom:(uint64_t)first to:(uint64_t)last
+{
+    MWWebImageDownloaderHistogram *histogram = [MWWebImageDownloaderHistogram new];
+    for (uint64_t value = first; value <= last; value++) {
+        [histogram recordValue:value];
+    }
+    return histogram;
+}
+
+#pragma mark - Percentiles
+
+- (void)testEmptyHistogram
+{
+    MWWebImageDownloaderHistogram *histogram = [MWWebImageDownloaderHistogram new];
+    XCTAssertEqual(histogram.count, 0);
+    XCTAssertEqual(histogram.minValue, 0);
+    XCTAssertEqual(histogram.maxValue, 0);
+    XCTAssertEqual(histogram.mean, 0);
+    XCTAssertEqual([histogram valueAtPercentile:50], 0);
+}
+
+- (void)testSmallValuesAreExact
+{
+    MWWebImageDownloaderHistogram *histogram = [self histogramWithValuesFrom:1 to:10];
+    XCTAssertEqual([histogram valueAtPercentile:0], 1);
+    XCTAssertEqual([histogram valueAtPercentile:10], 1);
+    XCTAssertEqual([histogram valueAtPercentile:50], 5);
+    XCTAssertEqual([histogram valueAtPercentile:51], 6);
+    XCTAssertEqual([histogram valueAtPercentile:90], 9);
+    XCTAssertEqual([histogram valueAtPercentile:100], 10);
+    // Out of range percentiles are clamped
+    XCTAssertEqual([histogram valueAtPercentile:-1], 1);
+    XCTAssertEqual([histogram valueAtPercentile:200], 10);
+    XCTAssertEqualWithAccuracy(histogram.mean, 5.5, 0.0001);
+}
+
+- (void)testLargeValuesAreWithinTheBucketPrecision
+{
+    MWWebImageDownloaderHistogram *histogram = [self histogramWithValuesFrom:1 to:100000];
+    XCTAssertEqual(histogram.count, 100000);
+    XCTAssertEqual(histogram.minValue, 1);
+    XCTAssertEqual(histogram.maxValue, 100000);
+    XCTAssertEqualWithAccuracy(histogram.mean, 50000.5, 0.0001);
+    for (NSNumber *percentile in @[@1, @25, @50, @75, @90, @99, @99.9]) {
+        double expectedValue = percentile.doubleValue * 1000;
+        XCTAssertEqualWithAccuracy((double)[histogram valueAtPercentile:percentile.doubleValue], expectedValue, expectedValue / 16 + 1, @"p%@", percentile);
+    }
+}
+
+- (void)testPercentilesAreWithinTheRecordedRange
+{
+    MWWebImageDownloaderHistogram *histogram = [MWWebImageDownloaderHistogram new];
+    [histogram recordValue:1234567];
+    XCTAssertEqual([histogram valueAtPercentile:0], 1234567);
+    XCTAssertEqual([histogram valueAtPercentile:50], 1234567);
+    XCTAssertEqual([histogram valueAtPercentile:100], 1234567);
+}
+
+- (void)testTailIsNotHiddenByTheMedian
+{
+    MWWebImageDownloaderHistogram *histogram = [MWWebImageDownloaderHistogram new];
+    for (NSUInteger i = 0; i < 99; i++) {
+        [histogram recordValue:100];
+    }
+    [histogram recordValue:100000];
+    XCTAssertEqual([histogram valueAtPercentile:50], 100);
+    XCTAssertEqual([histogram valueAtPercentile:99], 100);
+    XCTAssertEqual([histogram valueAtPercentile:99.5], 100000);
+    XCTAssertEqualWithAccuracy(histogram.mean, (99 * 100 + 100000) / 100.0, 0.0001);
+}
+
+#pragma mark - Representation
+
+- (void)testCopyAndDictionaryRepresentation
+{
+    MWWebImageDownloaderHistogram *histogram = [self histogramWithValuesFrom:1 to:1000];
+    MWWebImageDownloaderHistogram *copiedHistogram = [histogram copy];
+    [histogram recordValue:5000];
+    XCTAssertEqual(copiedHistogram.count, 1000);
+    XCTAssertEqual(copiedHistogram.maxValue, 1000);
+
+    NSDictionary<NSString *, id> *dictionary = [copiedHistogram dictionaryRepresentation];
+    XCTAssertEqualObjects(dictionary[@"count"], @1000);
+    XCTAssertEqualObjects(dictionary[@"min"], @1);
+    XCTAssertEqualObjects(dictionary[@"max"], @1000);
+    XCTAssertEqualObjects(dictionary[@"p50"], @([copiedHistogram valueAtPercentile:50]));
+    XCTAssertEqualObjects(dictionary[@"p90"], @([copiedHistogram valueAtPercentile:90]));
+    XCTAssertEqualObjects(dictionary[@"p99"], @([copiedHistogram valueAtPercentile:99]));
+    uint64_t bucketCount = 0;
+    uint64_t previousLowestValue = 0;
+    for (NSArray<NSNumber *> *bucket in dictionary[@"buckets"]) {
+        XCTAssertTrue(bucketCount == 0 || bucket[0].unsignedLongLongValue > previousLowestValue);
+        previousLowestValue = bucket[0].unsignedLongLongValue;
+        bucketCount += bucket[1].unsignedLongLongValue;
+    }
+    XCTAssertEqual(bucketCount, 1000);
+    XCTAssertTrue([NSJSONSerialization isValidJSONObject:dictionary]);
+}
+
+@end
@@ -0,0 +1,69 @@
+//
+//  MWWebImageDownloaderOperationTests.m
+//  MWWebImageTests
+//
+//  The life cycle of a download operation around its decodes in the shared `MWImageDecodeExecutor`.
+//
+
+#import "MWWebImageTestCase.h"
+
+@interface MWWebImageDownloaderOperationTests : MWWebImageTestCase
+
+@end
+
+@implementation MWWebImageDownloaderOperationTests
+
+- (void)setUp
+{
+    [super setUp];
+    UIImage *image = [MWWebImageTestCase sampleImageWithSize:CGSizeMake(64, 64)];
+    [self.localLoader setData:[[MWImageIOCoder sharedCoder] encodedDataWithImage:image format:MWImageFormatPNG options:nil] forPath:@"/image.png"];
+}
+
+// Keep the executor busy, so that the next decodes wait. Signal the semaphore to release it
+- (dispatch_semaphore_t)occupyDecodeExecutor
+{
+    MWImageDecodeExecutor *executor = [MWImageDecodeExecutor sharedExecutor];
+    NSUInteger maxConcurrentDecodeCount = executor.maxConcurrentDecodeCount;
+    executor.maxConcurrentDecodeCount = 1;
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    [executor addDecodeBlock:^{
+        dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    } priority:MWWebImageOperationPriorityHigh cost:0 dependency:nil];
+    [self addTeardownBlock:^{
+        dispatch_semaphore_signal(semaphore);
+        executor.maxConcurrentDecodeCount = maxConcurrentDecodeCount;
+    }];
+    return semaphore;
+}
+
+- (void)testCancelWhileWaitingForTheFinalDecodeFinishesTheOperation
+{
+    dispatch_semaphore_t semaphore = [self occupyDecodeExecutor];
+    NSURL *url = [self URLForPath:@"/image.png"];
+    __block MWWebImageDownloaderOperation *operation;
+    XCTestExpectation *stopped = [self expectationForNotification:MWWebImageDownloadStopNotification object:nil handler:^BOOL(NSNotification *notification) {
+        operation = notification.object;
+        return [operation.request.URL isEqual:url];
+    }];
+    XCTestExpectation *completion = [self expectationWithDescription:@"Cancelled download"];
+    MWWebImageDownloadToken *token = [self.downloader downloadImageWithURL:url completed:^(UIImage *image, NSData *data, NSError *error, BOOL finished) {
+        XCTAssertNil(image);
+        XCTAssertEqual(error.code, MWWebImageErrorCancelled);
+        [completion fulfill];
+    }];
+    [self waitForExpectations:@[stopped] timeout:kMWTestLoadTimeout];
+    // The data task completed, the final decode waits for the busy executor
+    XCTNSPredicateExpectation *pending = [[XCTNSPredicateExpectation alloc] initWithPredicate:[NSPredicate predicateWithFormat:@"pendingCount > 0"] object:[MWImageDecodeExecutor sharedExecutor]];
+    [self waitForExpectations:@[pending] timeout:kMWTestLoadTimeout];
+    XCTestExpectation *finished = [self keyValueObservingExpectationForObject:operation keyPath:@"isFinished" expectedValue:@YES];
+    [token cancel];
+    // Not held by a decode which will never run
+    [self waitForExpectations:@[completion, finished] timeout:kMWTestLoadTimeout];
+    XCTAssertFalse(operation.isExecuting);
+    XCTNSPredicateExpectation *released = [[XCTNSPredicateExpectation alloc] initWithPredicate:[NSPredicate predicateWithFormat:@"currentDownloadCount == 0"] object:self.downloader];
+    [self waitForExpectations:@[released] timeout:kMWTestLoadTimeout];
+    dispatch_semaphore_signal(semaphore);
+}
+
+@end
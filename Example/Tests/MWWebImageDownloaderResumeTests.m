@@ -0,0 +1,120 @@
+//
+//  MWWebImageDownloaderResumeTests.m
+//  MWWebImageTests
+//
+//  The resumed downloads of `MWWebImageDownloaderConfig.shouldResumeDownloads`: an interrupted download saves its bytes, and the next one only asks for the missing bytes with `Range` / `If-Range`.
+//
+
+#import "MWWebImageTestCase.h"
+
+@interface MWWebImageDownloaderResumeTests : MWWebImageTestCase
+
+@property (nonatomic, strong) MWWebImageDownloader *resumingDownloader;
+@property (nonatomic, strong) NSData *imageData;
+@property (nonatomic, strong) NSURL *imageURL;
+
+@end
+
+@implementation MWWebImageDownloaderResumeTests
+
+- (void)setUp
+{
+    [super setUp];
+    MWWebImageDownloaderConfig *config = [self.class localDownloaderConfig];
+    config.shouldResumeDownloads = YES;
+    self.resumingDownloader = [[MWWebImageDownloader alloc] initWithConfig:config];
+    UIImage *image = [MWWebImageTestCase sampleImageWithSize:CGSizeMake(512, 512)];
+    self.imageData = [[MWImageIOCoder sharedCoder] encodedDataWithImage:image format:MWImageFormatPNG options:nil];
+    // The resume data is kept on disk by URL, each test has its own
+    self.imageURL = [self URLForPath:[NSString stringWithFormat:@"/resume-%@.png", [NSUUID UUID].UUIDString]];
+    [self.localLoader setData:self.imageData forPath:self.imageURL.path];
+}
+
+- (void)tearDown
+{
+    [self.resumingDownloader invalidateSessionAndCancel:YES];
+    [super tearDown];
+}
+
+// A download lost after the given bytes
++ (MWImageLocalLoaderProfile *)lostProfileWithOffset:(NSUInteger)offset
+{
+    MWImageLocalLoaderProfile *profile = [MWImageLocalLoaderProfile immediateProfile];
+    profile.failureRate = 1;
+    profile.failureOffset = offset;
+    return profile;
+}
+
+- (void)interruptDownloadAfterLength:(NSUInteger)length
+{
+    self.localLoader.profileScript = @[[self.class lostProfileWithOffset:length], [MWImageLocalLoaderProfile immediateProfile]];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Interrupted download"];
+    [self.resumingDownloader downloadImageWithURL:self.imageURL completed:^(UIImage *image, NSData *data, NSError *error, BOOL finished) {
+        XCTAssertEqualObjects(error.domain, NSURLErrorDomain);
+        XCTAssertEqual(error.code, NSURLErrorNetworkConnectionLost);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:kMWTestLoadTimeout handler:nil];
+}
+
+// Download again, and return the response and the bytes resumed from the interrupted download
+- (NSHTTPURLResponse *)downloadExpectingData:(NSData *)expectedData resumedSize:(NSUInteger *)resumedSize
+{
+    NSURL *url = self.imageURL;
+    __block NSHTTPURLResponse *response;
+    [self expectationForNotification:MWWebImageDownloadReceiveResponseNotification object:nil handler:^BOOL(NSNotification *notification) {
+        MWWebImageDownloaderOperation *operation = notification.object;
+        if (![operation.request.URL isEqual:url]) {
+            return NO;
+        }
+        response = (NSHTTPURLResponse *)operation.response;
+        *resumedSize = operation.resumedSize;
+        return YES;
+    }];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Resumed download"];
+    [self.resumingDownloader downloadImageWithURL:url completed:^(UIImage *image, NSData *data, NSError *error, BOOL finished) {
+        XCTAssertNil(error);
+        XCTAssertNotNil(image);
+        XCTAssertEqualObjects(data, expectedData);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:kMWTestLoadTimeout handler:nil];
+    return response;
+}
+
+- (void)testInterruptedDownloadResumesWithTheMissingBytes
+{
+    NSUInteger interruptedLength = self.imageData.length / 2;
+    [self interruptDownloadAfterLength:interruptedLength];
+    NSUInteger resumedSize = 0;
+    NSHTTPURLResponse *response = [self downloadExpectingData:self.imageData resumedSize:&resumedSize];
+    XCTAssertEqual(response.statusCode, 206);
+    XCTAssertEqual(resumedSize, interruptedLength);
+    // Only the missing bytes were sent
+    XCTAssertEqual(response.expectedContentLength, (long long)(self.imageData.length - interruptedLength));
+    XCTAssertEqual(self.localLoader.requestCount, 2);
+}
+
+- (void)testChangedImageIsDownloadedAgain
+{
+    [self interruptDownloadAfterLength:self.imageData.length / 2];
+    // The `If-Range` validator does not match anymore
+    UIImage *image = [MWWebImageTestCase sampleImageWithSize:CGSizeMake(256, 256)];
+    NSData *changedData = [[MWImageIOCoder sharedCoder] encodedDataWithImage:image format:MWImageFormatPNG options:nil];
+    [self.localLoader setData:changedData forPath:self.imageURL.path];
+    NSUInteger resumedSize = 0;
+    NSHTTPURLResponse *response = [self downloadExpectingData:changedData resumedSize:&resumedSize];
+    XCTAssertEqual(response.statusCode, 200);
+    XCTAssertEqual(resumedSize, 0);
+}
+
+- (void)testPartialDataUnderMinimumIsNotResumed
+{
+    [self interruptDownloadAfterLength:1024];
+    NSUInteger resumedSize = 0;
+    NSHTTPURLResponse *response = [self downloadExpectingData:self.imageData resumedSize:&resumedSize];
+    XCTAssertEqual(response.statusCode, 200);
+    XCTAssertEqual(resumedSize, 0);
+}
+
+@end
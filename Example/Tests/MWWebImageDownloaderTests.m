@@ -0,0 +1,141 @@
+//
+//  MWWebImageDownloaderTests.m
+//  MWWebImageTests
+//
+//  The downloads of the same URL, shared by one operation while they can use the same response, at the priority of their most urgent caller.
+//
+
+#import "MWWebImageTestCase.h"
+
+@interface MWWebImageDownloaderTests : MWWebImageTestCase
+
+@end
+
+@implementation MWWebImageDownloaderTests
+
+- (void)setUp
+{
+    [super setUp];
+    UIImage *image = [MWWebImageTestCase sampleImageWithSize:CGSizeMake(64, 64)];
+    [self.localLoader setData:[[MWImageIOCoder sharedCoder] encodedDataWithImage:image format:MWImageFormatPNG options:nil] forPath:@"/image.png"];
+}
+
+- (void)downloadImageWithURL:(NSURL *)url context:(MWWebImageContext *)context
+{
+    XCTestExpectation *expectation = [self expectationWithDescription:[NSString stringWithFormat:@"%@ %@", url, context]];
+    [self.downloader downloadImageWithURL:url options:0 context:context progress:nil completed:^(UIImage *image, NSData *data, NSError *error, BOOL finished) {
+        XCTAssertNotNil(image);
+        [expectation fulfill];
+    }];
+}
+
+- (void)testDownloadsOfTheSameURLShareTheOperation
+{
+    NSURL *url = [self URLForPath:@"/image.png"];
+    [self downloadImageWithURL:url context:nil];
+    [self downloadImageWithURL:url context:nil];
+    [self waitForExpectationsWithTimeout:kMWTestLoadTimeout handler:nil];
+    XCTAssertEqual(self.localLoader.requestCount, 1);
+}
+
+- (void)testDownloadsOfAnotherVariantAreNotShared
+{
+    NSURL *url = [self URLForPath:@"/image.png"];
+    [self downloadImageWithURL:url context:@{MWWebImageContextImageVariant : @"small"}];
+    [self downloadImageWithURL:url context:@{MWWebImageContextImageVariant : @"small"}];
+    // Cached under another key, it may not be the same response
+    [self downloadImageWithURL:url context:@{MWWebImageContextImageVariant : @"large"}];
+    [self downloadImageWithURL:url context:nil];
+    [self waitForExpectationsWithTimeout:kMWTestLoadTimeout handler:nil];
+    XCTAssertEqual(self.localLoader.requestCount, 3);
+}
+
+#pragma mark - Priority inheritance
+
+- (MWWebImageDownloadToken *)downloadImageWithOptions:(MWWebImageDownloaderOptions)options cancelled:(BOOL)cancelled
+{
+    XCTestExpectation *expectation = [self expectationWithDescription:cancelled ? @"Cancelled download" : @"Download"];
+    return [self.downloader downloadImageWithURL:[self URLForPath:@"/image.png"] options:options progress:nil completed:^(UIImage *image, NSData *data, NSError *error, BOOL finished) {
+        if (cancelled) {
+            XCTAssertEqual(error.code, MWWebImageErrorCancelled);
+        } else {
+            XCTAssertNotNil(image);
+        }
+        [expectation fulfill];
+    }];
+}
+
+// Private, the token only exposes the priority of its caller
+- (MWWebImageDownloaderOperation *)downloadOperationOfToken:(MWWebImageDownloadToken *)token
+{
+    return [token valueForKey:@"downloadOperation"];
+}
+
+- (void)testJoiningCallerRaisesTheQueuedOperation
+{
+    self.downloader.suspended = YES;
+    MWWebImageDownloadToken *prefetchToken = [self downloadImageWithOptions:MWWebImageDownloaderLowPriority cancelled:NO];
+    MWWebImageDownloaderOperation *operation = [self downloadOperationOfToken:prefetchToken];
+    XCTAssertEqual(operation.queuePriority, NSOperationQueuePriorityLow);
+
+    // A visible view joins the prefetch
+    MWWebImageDownloadToken *visibleToken = [self downloadImageWithOptions:MWWebImageDownloaderHighPriority cancelled:YES];
+    XCTAssertEqual([self downloadOperationOfToken:visibleToken], operation);
+    XCTAssertEqualWithAccuracy(operation.priority, MWWebImageOperationPriorityHigh, 0.001);
+    XCTAssertEqual(operation.queuePriority, NSOperationQueuePriorityHigh);
+    // Each token keeps the priority of its own caller
+    XCTAssertEqualWithAccuracy(prefetchToken.priority, MWWebImageOperationPriorityLow, 0.001);
+
+    // The view went away, back to the prefetch priority
+    [visibleToken cancel];
+    XCTAssertEqualWithAccuracy(operation.priority, MWWebImageOperationPriorityLow, 0.001);
+    XCTAssertEqual(operation.queuePriority, NSOperationQueuePriorityLow);
+
+    // The remaining token raises the operation by itself
+    prefetchToken.priority = 1;
+    XCTAssertEqual(operation.queuePriority, NSOperationQueuePriorityVeryHigh);
+
+    self.downloader.suspended = NO;
+    [self waitForExpectationsWithTimeout:kMWTestLoadTimeout handler:nil];
+    XCTAssertEqual(self.localLoader.requestCount, 1);
+}
+
+- (void)testJoiningCallerRaisesTheRunningOperation
+{
+    self.localLoader.defaultProfile = [MWImageLocalLoaderProfile profileWithLatency:1 bandwidth:0];
+    NSURL *url = [self URLForPath:@"/image.png"];
+    // Posted on the main queue once the data task is resumed at the operation priority
+    XCTestExpectation *started = [self expectationForNotification:MWWebImageDownloadStartNotification object:nil handler:^BOOL(NSNotification *notification) {
+        return [((MWWebImageDownloaderOperation *)notification.object).request.URL isEqual:url];
+    }];
+    MWWebImageDownloadToken *prefetchToken = [self downloadImageWithOptions:MWWebImageDownloaderLowPriority cancelled:NO];
+    MWWebImageDownloaderOperation *operation = [self downloadOperationOfToken:prefetchToken];
+    [self waitForExpectations:@[started] timeout:kMWTestLoadTimeout];
+    XCTAssertEqualWithAccuracy(operation.dataTask.priority, MWWebImageOperationPriorityLow, 0.001);
+
+    MWWebImageDownloadToken *visibleToken = [self downloadImageWithOptions:MWWebImageDownloaderHighPriority cancelled:YES];
+    XCTAssertEqual([self downloadOperationOfToken:visibleToken], operation);
+    XCTAssertEqualWithAccuracy(operation.dataTask.priority, MWWebImageOperationPriorityHigh, 0.001);
+    [visibleToken cancel];
+    XCTAssertEqualWithAccuracy(operation.dataTask.priority, MWWebImageOperationPriorityLow, 0.001);
+    [self waitForExpectationsWithTimeout:kMWTestLoadTimeout handler:nil];
+}
+
+- (void)testHighestRemainingCallerWins
+{
+    self.downloader.suspended = YES;
+    MWWebImageDownloadToken *lowToken = [self downloadImageWithOptions:MWWebImageDownloaderLowPriority cancelled:NO];
+    MWWebImageDownloadToken *highToken = [self downloadImageWithOptions:MWWebImageDownloaderHighPriority cancelled:YES];
+    MWWebImageDownloadToken *defaultToken = [self downloadImageWithOptions:0 cancelled:YES];
+    MWWebImageDownloaderOperation *operation = [self downloadOperationOfToken:lowToken];
+    // Joining at a lower priority does not lower the operation
+    XCTAssertEqualWithAccuracy(operation.priority, MWWebImageOperationPriorityHigh, 0.001);
+    [highToken cancel];
+    XCTAssertEqualWithAccuracy(operation.priority, MWWebImageOperationPriorityDefault, 0.001);
+    [defaultToken cancel];
+    XCTAssertEqualWithAccuracy(operation.priority, MWWebImageOperationPriorityLow, 0.001);
+    self.downloader.suspended = NO;
+    [self waitForExpectationsWithTimeout:kMWTestLoadTimeout handler:nil];
+}
+
+@end
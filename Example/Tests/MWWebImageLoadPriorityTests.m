@@ -0,0 +1,130 @@
+//
+//  MWWebImageLoadPriorityTests.m
+//  MWWebImageTests
+//
+//  The priority of a load changed while its download is queued or running, from the download token and from the combined operation of the manager.
+//
+
+#import "MWWebImageTestCase.h"
+
+@interface MWWebImageLoadPriorityTests : MWWebImageTestCase
+
+@end
+
+@implementation MWWebImageLoadPriorityTests
+
+- (void)setUp
+{
+    [super setUp];
+    UIImage *image = [MWWebImageTestCase sampleImageWithSize:CGSizeMake(64, 64)];
+    [self.localLoader setData:[[MWImageIOCoder sharedCoder] encodedDataWithImage:image format:MWImageFormatPNG options:nil] forPath:@"/image.png"];
+}
+
+- (MWWebImageDownloadToken *)downloadWithOptions:(MWWebImageDownloaderOptions)options
+{
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Download"];
+    return [self.downloader downloadImageWithURL:[self URLForPath:@"/image.png"] options:options progress:nil completed:^(UIImage *image, NSData *data, NSError *error, BOOL finished) {
+        XCTAssertNotNil(image);
+        [expectation fulfill];
+    }];
+}
+
+// Private, the token only exposes the priority of its caller
+- (MWWebImageDownloaderOperation *)downloadOperationOfToken:(MWWebImageDownloadToken *)token
+{
+    return [token valueForKey:@"downloadOperation"];
+}
+
+// Posted on the main queue once the data task is resumed at the operation priority
+- (XCTestExpectation *)expectationForStartOfDownload
+{
+    NSURL *url = [self URLForPath:@"/image.png"];
+    return [self expectationForNotification:MWWebImageDownloadStartNotification object:nil handler:^BOOL(NSNotification *notification) {
+        return [((MWWebImageDownloaderOperation *)notification.object).request.URL isEqual:url];
+    }];
+}
+
+#pragma mark - Download token
+
+- (void)testQueuedDownloadIsReordered
+{
+    self.downloader.suspended = YES;
+    MWWebImageDownloadToken *token = [self downloadWithOptions:MWWebImageDownloaderLowPriority];
+    MWWebImageDownloaderOperation *operation = [self downloadOperationOfToken:token];
+    XCTAssertEqualWithAccuracy(token.priority, MWWebImageOperationPriorityLow, 0.001);
+    XCTAssertEqual(operation.queuePriority, NSOperationQueuePriorityLow);
+
+    token.priority = MWWebImageOperationPriorityHigh;
+    XCTAssertEqualWithAccuracy(operation.priority, MWWebImageOperationPriorityHigh, 0.001);
+    XCTAssertEqual(operation.queuePriority, NSOperationQueuePriorityHigh);
+    token.priority = 1;
+    XCTAssertEqual(operation.queuePriority, NSOperationQueuePriorityVeryHigh);
+    // Clamped to the priority scale
+    token.priority = -1;
+    XCTAssertEqualWithAccuracy(operation.priority, 0, 0.001);
+    XCTAssertEqual(operation.queuePriority, NSOperationQueuePriorityVeryLow);
+
+    self.downloader.suspended = NO;
+    [self waitForExpectationsWithTimeout:kMWTestLoadTimeout handler:nil];
+}
+
+- (void)testRunningDownloadFollowsThePriority
+{
+    self.localLoader.defaultProfile = [MWImageLocalLoaderProfile profileWithLatency:1 bandwidth:0];
+    XCTestExpectation *started = [self expectationForStartOfDownload];
+    MWWebImageDownloadToken *token = [self downloadWithOptions:MWWebImageDownloaderLowPriority];
+    MWWebImageDownloaderOperation *operation = [self downloadOperationOfToken:token];
+    [self waitForExpectations:@[started] timeout:kMWTestLoadTimeout];
+    XCTAssertEqualWithAccuracy(operation.dataTask.priority, MWWebImageOperationPriorityLow, 0.001);
+
+    token.priority = MWWebImageOperationPriorityHigh;
+    XCTAssertEqualWithAccuracy(operation.dataTask.priority, MWWebImageOperationPriorityHigh, 0.001);
+    // Already out of the queue, its queue priority does not matter anymore
+    XCTAssertEqual(operation.queuePriority, NSOperationQueuePriorityLow);
+    token.priority = MWWebImageOperationPriorityDefault;
+    XCTAssertEqualWithAccuracy(operation.dataTask.priority, MWWebImageOperationPriorityDefault, 0.001);
+    [self waitForExpectationsWithTimeout:kMWTestLoadTimeout handler:nil];
+}
+
+- (void)testCancelledTokenIgnoresThePriority
+{
+    self.downloader.suspended = YES;
+    MWWebImageDownloadToken *token = [self.downloader downloadImageWithURL:[self URLForPath:@"/image.png"] options:MWWebImageDownloaderLowPriority progress:nil completed:nil];
+    MWWebImageDownloaderOperation *operation = [self downloadOperationOfToken:token];
+    [token cancel];
+    token.priority = MWWebImageOperationPriorityHigh;
+    XCTAssertEqualWithAccuracy(token.priority, MWWebImageOperationPriorityLow, 0.001);
+    XCTAssertNotEqual(operation.queuePriority, NSOperationQueuePriorityHigh);
+    self.downloader.suspended = NO;
+}
+
+#pragma mark - Combined operation
+
+- (void)testCombinedOperationForwardsThePriorityToTheDownload
+{
+    self.localLoader.defaultProfile = [MWImageLocalLoaderProfile profileWithLatency:1 bandwidth:0];
+    XCTestExpectation *started = [self expectationForStartOfDownload];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Load"];
+    MWWebImageCombinedOperation *operation = [self.manager loadImageWithURL:[self URLForPath:@"/image.png"] options:MWWebImageLowPriority context:nil progress:nil completed:^(UIImage *image, NSData *data, NSError *error, MWImageCacheType cacheType, BOOL finished, NSURL *imageURL) {
+        XCTAssertNotNil(image);
+        [expectation fulfill];
+    }];
+    XCTAssertEqualWithAccuracy(operation.priority, MWWebImageOperationPriorityLow, 0.001);
+    // Raised while the cache is queried, before the download exists
+    operation.priority = MWWebImageOperationPriorityHigh;
+    // Applied once the loader operation is created, on the thread of the cache query
+    XCTNSPredicateExpectation *loading = [[XCTNSPredicateExpectation alloc] initWithPredicate:[NSPredicate predicateWithFormat:@"loaderOperation.priority >= 0.75"] object:operation];
+    [self waitForExpectations:@[loading] timeout:kMWTestLoadTimeout];
+    MWWebImageDownloadToken *token = (MWWebImageDownloadToken *)operation.loaderOperation;
+    MWWebImageDownloaderOperation *downloadOperation = [self downloadOperationOfToken:token];
+    XCTAssertEqualWithAccuracy(token.priority, MWWebImageOperationPriorityHigh, 0.001);
+    XCTAssertEqualWithAccuracy(downloadOperation.priority, MWWebImageOperationPriorityHigh, 0.001);
+
+    // Lowered while running, for example when the view scrolls off screen
+    [self waitForExpectations:@[started] timeout:kMWTestLoadTimeout];
+    operation.priority = MWWebImageOperationPriorityLow;
+    XCTAssertEqualWithAccuracy(downloadOperation.dataTask.priority, MWWebImageOperationPriorityLow, 0.001);
+    [self waitForExpectations:@[expectation] timeout:kMWTestLoadTimeout];
+}
+
+@end
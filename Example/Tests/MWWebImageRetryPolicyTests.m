@@ -0,0 +1,199 @@
+//
+//  MWWebImageRetryPolicyTests.m
+//  MWWebImageTests
+//
+//  The backoff of `MWWebImageRetryPolicy`, the retries of the manager with `Retry-After` and the retry budget, and the expiration of the failed URLs.
+//
+
+#import "MWWebImageTestCase.h"
+
+@interface MWWebImageRetryPolicyTests : MWWebImageTestCase
+
+@end
+
+@implementation MWWebImageRetryPolicyTests
+
+- (void)setUp
+{
+    [super setUp];
+    UIImage *image = [MWWebImageTestCase sampleImageWithSize:CGSizeMake(64, 64)];
+    [self.localLoader setData:[[MWImageIOCoder sharedCoder] encodedDataWithImage:image format:MWImageFormatPNG options:nil] forPath:@"/image.png"];
+    MWWebImageRetryPolicy *retryPolicy = [MWWebImageRetryPolicy new];
+    retryPolicy.baseDelay = 0.01;
+    self.manager.retryPolicy = retryPolicy;
+}
+
+// A 503 failure, with the given `Retry-After`
++ (MWImageLocalLoaderProfile *)unavailableProfileWithRetryAfter:(NSString *)retryAfter
+{
+    MWImageLocalLoaderProfile *profile = [MWImageLocalLoaderProfile immediateProfile];
+    profile.failureRate = 1;
+    profile.failureStatusCode = 503;
+    if (retryAfter) {
+        profile.failureHeaderFields = @{@"Retry-After" : retryAfter};
+    }
+    return profile;
+}
+
++ (NSString *)HTTPDateWithTimeIntervalSinceNow:(NSTimeInterval)interval
+{
+    NSDateFormatter *dateFormatter = [NSDateFormatter new];
+    dateFormatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+    dateFormatter.timeZone = [NSTimeZone timeZoneForSecondsFromGMT:0];
+    dateFormatter.dateFormat = @"EEE',' dd MMM yyyy HH':'mm':'ss 'GMT'";
+    return [dateFormatter stringFromDate:[NSDate dateWithTimeIntervalSinceNow:interval]];
+}
+
+#pragma mark - Backoff
+
+- (void)testDelayForRetryCountIsAJitteredExponentialBackoff
+{
+    MWWebImageRetryPolicy *retryPolicy = [MWWebImageRetryPolicy new];
+    retryPolicy.baseDelay = 0.5;
+    retryPolicy.maxDelay = 4;
+    for (NSUInteger retryCount = 0; retryCount < 8; retryCount++) {
+        NSTimeInterval backoff = MIN(retryPolicy.maxDelay, retryPolicy.baseDelay * pow(2, retryCount));
+        NSTimeInterval maxObservedDelay = 0;
+        for (NSUInteger i = 0; i < 200; i++) {
+            NSTimeInterval delay = [retryPolicy delayForRetryCount:retryCount];
+            XCTAssertGreaterThanOrEqual(delay, 0);
+            XCTAssertLessThanOrEqual(delay, backoff);
+            maxObservedDelay = MAX(maxObservedDelay, delay);
+        }
+        // Full jitter spreads over the whole backoff, not only its start
+        XCTAssertGreaterThan(maxObservedDelay, backoff / 2);
+    }
+}
+
+- (void)testRetryableErrors
+{
+    MWWebImageRetryPolicy *retryPolicy = [MWWebImageRetryPolicy new];
+    XCTAssertTrue([retryPolicy isRetryableError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorTimedOut userInfo:nil]]);
+    XCTAssertFalse([retryPolicy isRetryableError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorNotConnectedToInternet userInfo:nil]]);
+    XCTAssertTrue([retryPolicy isRetryableError:[NSError errorWithDomain:MWWebImageErrorDomain code:MWWebImageErrorInvalidDownloadStatusCode userInfo:@{MWWebImageErrorDownloadStatusCodeKey : @503}]]);
+    XCTAssertFalse([retryPolicy isRetryableError:[NSError errorWithDomain:MWWebImageErrorDomain code:MWWebImageErrorInvalidDownloadStatusCode userInfo:@{MWWebImageErrorDownloadStatusCodeKey : @404}]]);
+    XCTAssertFalse([retryPolicy isRetryableError:[NSError errorWithDomain:MWWebImageErrorDomain code:MWWebImageErrorBadImageData userInfo:nil]]);
+}
+
+#pragma mark - Retries
+
+- (void)testUnavailableResponseIsRetried
+{
+    self.localLoader.profileScript = @[[self.class unavailableProfileWithRetryAfter:nil], [MWImageLocalLoaderProfile immediateProfile]];
+    [self loadImageWithURL:[self URLForPath:@"/image.png"] options:MWWebImageFromLoaderOnly context:nil completion:^(UIImage *image, NSError *error, MWImageCacheType cacheType) {
+        XCTAssertNotNil(image);
+        XCTAssertNil(error);
+    }];
+    XCTAssertEqual(self.localLoader.requestCount, 2);
+}
+
+- (void)testLostConnectionIsRetried
+{
+    MWImageLocalLoaderProfile *lostProfile = [MWImageLocalLoaderProfile immediateProfile];
+    lostProfile.failureRate = 1;
+    lostProfile.failureOffset = 100;
+    self.localLoader.profileScript = @[lostProfile, [MWImageLocalLoaderProfile immediateProfile]];
+    [self loadImageWithURL:[self URLForPath:@"/image.png"] options:MWWebImageFromLoaderOnly context:nil completion:^(UIImage *image, NSError *error, MWImageCacheType cacheType) {
+        XCTAssertNotNil(image);
+        XCTAssertNil(error);
+    }];
+    XCTAssertEqual(self.localLoader.requestCount, 2);
+}
+
+- (void)testRetryAfterWithinMaxDelayIsWaited
+{
+    self.localLoader.profileScript = @[[self.class unavailableProfileWithRetryAfter:@"1"], [MWImageLocalLoaderProfile immediateProfile]];
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    [self loadImageWithURL:[self URLForPath:@"/image.png"] options:MWWebImageFromLoaderOnly context:nil completion:^(UIImage *image, NSError *error, MWImageCacheType cacheType) {
+        XCTAssertNotNil(image);
+    }];
+    XCTAssertGreaterThanOrEqual(CFAbsoluteTimeGetCurrent() - start, 1);
+    XCTAssertEqual(self.localLoader.requestCount, 2);
+}
+
+- (void)testRetryAfterOverMaxDelayFailsWithoutRetry
+{
+    self.manager.retryPolicy.maxDelay = 30;
+    self.localLoader.profileScript = @[[self.class unavailableProfileWithRetryAfter:@"120"], [MWImageLocalLoaderProfile immediateProfile]];
+    [self loadImageWithURL:[self URLForPath:@"/image.png"] options:MWWebImageFromLoaderOnly context:nil completion:^(UIImage *image, NSError *error, MWImageCacheType cacheType) {
+        XCTAssertNil(image);
+        XCTAssertEqual(error.code, MWWebImageErrorInvalidDownloadStatusCode);
+        XCTAssertEqualObjects(error.userInfo[MWWebImageErrorDownloadStatusCodeKey], @503);
+    }];
+    XCTAssertEqual(self.localLoader.requestCount, 1);
+}
+
+- (void)testRetryAfterHTTPDateOverMaxDelayFailsWithoutRetry
+{
+    // Not parsed, the date would be ignored and the load retried
+    NSString *retryAfter = [self.class HTTPDateWithTimeIntervalSinceNow:3600];
+    self.localLoader.profileScript = @[[self.class unavailableProfileWithRetryAfter:retryAfter], [MWImageLocalLoaderProfile immediateProfile]];
+    [self loadImageWithURL:[self URLForPath:@"/image.png"] options:MWWebImageFromLoaderOnly context:nil completion:^(UIImage *image, NSError *error, MWImageCacheType cacheType) {
+        XCTAssertNil(image);
+        XCTAssertEqual(error.code, MWWebImageErrorInvalidDownloadStatusCode);
+    }];
+    XCTAssertEqual(self.localLoader.requestCount, 1);
+}
+
+- (void)testRetryAfterHTTPDateInThePastIsRetriedNow
+{
+    NSString *retryAfter = [self.class HTTPDateWithTimeIntervalSinceNow:-3600];
+    self.localLoader.profileScript = @[[self.class unavailableProfileWithRetryAfter:retryAfter], [MWImageLocalLoaderProfile immediateProfile]];
+    [self loadImageWithURL:[self URLForPath:@"/image.png"] options:MWWebImageFromLoaderOnly context:nil completion:^(UIImage *image, NSError *error, MWImageCacheType cacheType) {
+        XCTAssertNotNil(image);
+    }];
+    XCTAssertEqual(self.localLoader.requestCount, 2);
+}
+
+- (void)testRetryCountIsLimited
+{
+    self.manager.retryPolicy.maxRetryCount = 2;
+    self.localLoader.defaultProfile = [self.class unavailableProfileWithRetryAfter:nil];
+    [self loadImageWithURL:[self URLForPath:@"/image.png"] options:MWWebImageFromLoaderOnly context:nil completion:^(UIImage *image, NSError *error, MWImageCacheType cacheType) {
+        XCTAssertNil(image);
+        XCTAssertEqual(error.code, MWWebImageErrorInvalidDownloadStatusCode);
+    }];
+    XCTAssertEqual(self.localLoader.requestCount, 3);
+}
+
+- (void)testRetryBudgetIsShared
+{
+    // One retry to spend, and none earned by the loads
+    self.manager.retryPolicy.maxRetryBudget = 1;
+    self.manager.retryPolicy.retryBudgetRatio = 0;
+    self.localLoader.defaultProfile = [self.class unavailableProfileWithRetryAfter:nil];
+    [self loadImageWithURL:[self URLForPath:@"/image.png"] options:MWWebImageFromLoaderOnly context:nil completion:^(UIImage *image, NSError *error, MWImageCacheType cacheType) {
+        XCTAssertNotNil(error);
+    }];
+    XCTAssertEqual(self.localLoader.requestCount, 2);
+    [self loadImageWithURL:[self URLForPath:@"/image.png"] options:MWWebImageFromLoaderOnly context:nil completion:^(UIImage *image, NSError *error, MWImageCacheType cacheType) {
+        XCTAssertNotNil(error);
+    }];
+    XCTAssertEqual(self.localLoader.requestCount, 3);
+}
+
+#pragma mark - Failed URLs
+
+- (void)testFailedURLExpires
+{
+    self.manager.failedURLExpirationInterval = 0.5;
+    NSURL *url = [self URLForPath:@"/corrupted.png"];
+    [self.localLoader setData:[@"Not an image" dataUsingEncoding:NSUTF8StringEncoding] forPath:url.path];
+    [self loadImageWithURL:url options:MWWebImageFromLoaderOnly context:nil completion:^(UIImage *image, NSError *error, MWImageCacheType cacheType) {
+        XCTAssertEqual(error.code, MWWebImageErrorBadImageData);
+    }];
+    XCTAssertEqual(self.localLoader.requestCount, 1);
+    // Blocked, and never retried
+    [self loadImageWithURL:url options:MWWebImageFromLoaderOnly context:nil completion:^(UIImage *image, NSError *error, MWImageCacheType cacheType) {
+        XCTAssertEqual(error.code, MWWebImageErrorBlackListed);
+    }];
+    XCTAssertEqual(self.localLoader.requestCount, 1);
+    // Loaded again once expired
+    [NSThread sleepForTimeInterval:0.6];
+    [self loadImageWithURL:url options:MWWebImageFromLoaderOnly context:nil completion:^(UIImage *image, NSError *error, MWImageCacheType cacheType) {
+        XCTAssertEqual(error.code, MWWebImageErrorBadImageData);
+    }];
+    XCTAssertEqual(self.localLoader.requestCount, 2);
+}
+
+@end
@@ -0,0 +1,39 @@
+//
+//  MWWebImageTestCase.h
+//  MWWebImageTests
+//
+//  The base of the tests loading through the whole pipeline: a manager with its own cache, and a downloader whose session is served by `MWImageLocalURLProtocol`, so no test touches the network.
+//
+
+@import XCTest;
+#import <MWWebImage/MWWebImage.h>
+#import "MWImageLocalLoader.h"
+#import "MWImageLocalURLProtocol.h"
+
+/// The timeout of a load in the tests, in seconds
+FOUNDATION_EXPORT const NSTimeInterval kMWTestLoadTimeout;
+
+@interface MWWebImageTestCase : XCTestCase
+
+/// The corpus and profiles of the loads, serving `https://mwlocal.test/`
+@property (nonatomic, strong, readonly) MWImageLocalLoader *localLoader;
+/// A downloader whose session is served by `localLoader`
+@property (nonatomic, strong, readonly) MWWebImageDownloader *downloader;
+/// A cache in its own namespace, cleared after each test
+@property (nonatomic, strong, readonly) MWImageCache *imageCache;
+/// A manager using `imageCache` and `downloader`
+@property (nonatomic, strong, readonly) MWWebImageManager *manager;
+
+/// A photo-like image, a gradient with noise, so that the encoders do not collapse it
++ (UIImage *)sampleImageWithSize:(CGSize)size;
+
+/// A downloader config whose session is served by the registered local loaders, for the tests which need another downloader
++ (MWWebImageDownloaderConfig *)localDownloaderConfig;
+
+/// The HTTPS URL of a path served by `localLoader`
+- (NSURL *)URLForPath:(NSString *)path;
+
+/// Load with `manager` and wait for the final completion
+- (void)loadImageWithURL:(NSURL *)url options:(MWWebImageOptions)options context:(MWWebImageContext *)context completion:(void(^)(UIImage *image, NSError *error, MWImageCacheType cacheType))completion;
+
+@end
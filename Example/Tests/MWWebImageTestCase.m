@@ -0,0 +1,99 @@
+//
+//  MWWebImageTestCase.m
+//  MWWebImageTests
+//
+
+#import "MWWebImageTestCase.h"
+
+const NSTimeInterval kMWTestLoadTimeout = 10;
+
+static NSString * const kMWTestHost = @"mwlocal.test";
+
+@interface MWWebImageTestCase ()
+
+@property (nonatomic, strong, readwrite) MWImageLocalLoader *localLoader;
+@property (nonatomic, strong, readwrite) MWWebImageDownloader *downloader;
+@property (nonatomic, strong, readwrite) MWImageCache *imageCache;
+@property (nonatomic, strong, readwrite) MWWebImageManager *manager;
+
+@end
+
+@implementation MWWebImageTestCase
+
+- (void)setUp
+{
+    [super setUp];
+    self.localLoader = [MWImageLocalLoader new];
+    self.localLoader.hosts = [NSSet setWithObject:kMWTestHost];
+    [MWImageLocalURLProtocol registerLoader:self.localLoader];
+    self.downloader = [[MWWebImageDownloader alloc] initWithConfig:[self.class localDownloaderConfig]];
+    self.imageCache = [[MWImageCache alloc] initWithNamespace:NSStringFromClass(self.class)];
+    self.manager = [[MWWebImageManager alloc] initWithCache:self.imageCache loader:self.downloader];
+}
+
+- (void)tearDown
+{
+    [self.manager cancelAll];
+    [self.downloader invalidateSessionAndCancel:YES];
+    [MWImageLocalURLProtocol unregisterLoader:self.localLoader];
+    [self.imageCache clearMemory];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Clear the disk cache"];
+    [self.imageCache clearDiskOnCompletion:^{
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:kMWTestLoadTimeout handler:nil];
+    [super tearDown];
+}
+
++ (MWWebImageDownloaderConfig *)localDownloaderConfig
+{
+    MWWebImageDownloaderConfig *config = [MWWebImageDownloaderConfig new];
+    config.sessionConfiguration = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+    config.sessionConfiguration.protocolClasses = @[MWImageLocalURLProtocol.class];
+    return config;
+}
+
++ (UIImage *)sampleImageWithSize:(CGSize)size
+{
+    size_t width = size.width, height = size.height;
+    CGContextRef context = CGBitmapContextCreate(NULL, width, height, 8, 0, [MWImageCoderHelper colorSpaceGetDeviceRGB], kCGBitmapByteOrder32Host | kCGImageAlphaNoneSkipFirst);
+    uint8_t *bytes = CGBitmapContextGetData(context);
+    size_t rowBytes = CGBitmapContextGetBytesPerRow(context);
+    uint32_t seed = 1;
+    for (size_t y = 0; y < height; y++) {
+        uint8_t *row = bytes + y * rowBytes;
+        for (size_t x = 0; x < width; x++) {
+            seed = seed * 1664525 + 1013904223;
+            uint8_t noise = seed >> 28;
+            row[x * 4] = (uint8_t)(x * 239 / width) + noise;
+            row[x * 4 + 1] = (uint8_t)(y * 239 / height) + noise;
+            row[x * 4 + 2] = (uint8_t)((x + y) * 119 / (width + height)) + noise;
+            row[x * 4 + 3] = 255;
+        }
+    }
+    CGImageRef imageRef = CGBitmapContextCreateImage(context);
+    CGContextRelease(context);
+    UIImage *image = [[UIImage alloc] initWithCGImage:imageRef];
+    CGImageRelease(imageRef);
+    return image;
+}
+
+- (NSURL *)URLForPath:(NSString *)path
+{
+    return [NSURL URLWithString:[NSString stringWithFormat:@"https://%@%@", kMWTestHost, path]];
+}
+
+- (void)loadImageWithURL:(NSURL *)url options:(MWWebImageOptions)options context:(MWWebImageContext *)context completion:(void(^)(UIImage *image, NSError *error, MWImageCacheType cacheType))completion
+{
+    XCTestExpectation *expectation = [self expectationWithDescription:url.absoluteString];
+    [self.manager loadImageWithURL:url options:options context:context progress:nil completed:^(UIImage *image, NSData *data, NSError *error, MWImageCacheType cacheType, BOOL finished, NSURL *imageURL) {
+        if (!finished) {
+            return;
+        }
+        completion(image, error, cacheType);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:kMWTestLoadTimeout handler:nil];
+}
+
+@end
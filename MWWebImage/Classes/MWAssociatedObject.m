@@ -24,4 +24,6 @@ void MWImageCopyAssociatedObject(UIImage * _Nullable source, UIImage * _Nullable
     target.MW_iMWecoded = source.MW_iMWecoded;
     // Extended Cache Data
     target.MW_extendedObject = source.MW_extendedObject;
+    // Memory Cache Cost
+    target.MW_rebuildCost = source.MW_rebuildCost;
 }
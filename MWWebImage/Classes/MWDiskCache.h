@@ -117,6 +117,25 @@
  */
 - (NSUInteger)totalSize;
 
+@optional
+
+/**
+ Returns the HTTP validators data associated with a given key, see `MWImageCacheValidators`.
+ This method may blocks the calling thread until file read finished.
+ 
+ @param key A string identifying the data. If nil, just return nil.
+ @return The validators data associated with key, or nil if no value is associated with key.
+ */
+- (nullable NSData *)validatorsDataForKey:(nonnull NSString *)key;
+
+/**
+ Set the HTTP validators data with a given key. Like the extended data, it's kept beside the exist disk file data, and removed when the data is overridden.
+ 
+ @param validatorsData The validators data (pass nil to remove).
+ @param key The key with which to associate the value. If nil, this method has no effect.
+ */
+- (void)setValidatorsData:(nullable NSData *)validatorsData forKey:(nonnull NSString *)key;
+
 @end
 
 /**
@@ -12,6 +12,7 @@
 #import <CommonCrypto/CommonDigest.h>
 
 static NSString * const MWDiskCacheExtendedAttributeName = @"com.hackemist.MWDiskCache";
+static NSString * const MWDiskCacheValidatorsAttributeName = @"com.hackemist.MWDiskCache.validators";
 
 @interface MWDiskCache ()
 
@@ -123,6 +124,25 @@ static NSString * const MWDiskCacheExtendedAttributeName = @"com.hackemist.MWDis
     }
 }
 
+- (NSData *)validatorsDataForKey:(NSString *)key {
+    NSParameterAssert(key);
+    
+    NSString *cachePathForKey = [self cachePathForKey:key];
+    
+    return [MWFileAttributeHelper extendedAttribute:MWDiskCacheValidatorsAttributeName atPath:cachePathForKey traverseLink:NO error:nil];
+}
+
+- (void)setValidatorsData:(NSData *)validatorsData forKey:(NSString *)key {
+    NSParameterAssert(key);
+    NSString *cachePathForKey = [self cachePathForKey:key];
+    
+    if (!validatorsData) {
+        [MWFileAttributeHelper removeExtendedAttribute:MWDiskCacheValidatorsAttributeName atPath:cachePathForKey traverseLink:NO error:nil];
+    } else {
+        [MWFileAttributeHelper setExtendedAttribute:MWDiskCacheValidatorsAttributeName value:validatorsData atPath:cachePathForKey traverseLink:NO overwrite:YES error:nil];
+    }
+}
+
 - (void)removeDataForKey:(NSString *)key {
     NSParameterAssert(key);
     NSString *filePath = [self cachePathForKey:key];
@@ -0,0 +1,31 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "MWImageCoder.h"
+
+// Whether libavif is linked. The AV1 decoding is done by the codec libavif is built with, dav1d preferably
+#if __has_include(<avif/avif.h>)
+#define MW_AVIF 1
+#elif __has_include(<libavif/avif.h>)
+#define MW_AVIF 1
+#else
+#define MW_AVIF 0
+#endif
+
+/**
+ This coder is used for AVIF and AVIF image sequence (AVIS) image format, with libavif, because Image/IO does not decode AVIF on the supported firmwares.
+ It decodes with as many threads as the active processors, and for `MWImageCoderDecodeThumbnailPixelSize`, scales the YUV planes before the RGB conversion instead of converting the full image (with libavif 1.0 built with libyuv, otherwise the RGB image is scaled). The sequence frames are decoded on demand with `MWAnimatedImageCoder`.
+ It encodes to AVIF as well, `MWImageCoderEncodeMaxFileSize` is not supported.
+ @note This coder is only functional when libavif is linked (`MW_AVIF` is 1), it's then registered in `MWImageCodersManager` by default. Otherwise, it can't decode nor encode anything.
+ */
+@interface MWImageAVIFCoder : NSObject <MWImageCoder, MWAnimatedImageCoder>
+
+@property (nonatomic, class, readonly, nonnull) MWImageAVIFCoder *sharedCoder;
+
+@end
@@ -0,0 +1,517 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "MWImageAVIFCoder.h"
+#import "NMWata+ImageContentType.h"
+#import "UIImage+Metadata.h"
+#import "UIImage+ForceDecode.h"
+#import "NSImage+Compatibility.h"
+#import "MWImageCoderHelper.h"
+#import "MWImageFrame.h"
+#import "MWInternalMacros.h"
+#import <Accelerate/Accelerate.h>
+
+#if MW_AVIF
+#if __has_include(<avif/avif.h>)
+#import <avif/avif.h>
+#else
+#import <libavif/avif.h>
+#endif
+#endif
+
+#if MW_AVIF
+
+// AV1 decoding and the YUV conversion scale with the cores
+static int MWAVIFMaxThreads(void) {
+    return (int)MAX(NSProcessInfo.processInfo.activeProcessorCount, 1);
+}
+
+// The thumbnail pixel size limits the image pixel size like `MWImageIOAnimatedCoder`
+static CGSize MWAVIFScaledPixelSize(CGSize pixelSize, CGSize thumbnailSize, BOOL preserveAspectRatio) {
+    if (thumbnailSize.width <= 0 || thumbnailSize.height <= 0 || (pixelSize.width <= thumbnailSize.width && pixelSize.height <= thumbnailSize.height)) {
+        return pixelSize;
+    }
+    if (!preserveAspectRatio) {
+        return thumbnailSize;
+    }
+    CGFloat ratio = MIN(thumbnailSize.width / pixelSize.width, thumbnailSize.height / pixelSize.height);
+    return CGSizeMake(MAX(round(pixelSize.width * ratio), 1), MAX(round(pixelSize.height * ratio), 1));
+}
+
+static void MWAVIFReleaseBitmapData(void *info, const void *data, size_t size) {
+    free((void *)data);
+}
+
+// Convert the decoded YUV planes to a premultiplied RGBA image, which owns the buffer
+static CGImageRef MWAVIFCreateCGImage(avifImage *image) CF_RETURNS_RETAINED {
+    avifRGBImage rgb;
+    avifRGBImageSetDefaults(&rgb, image);
+    rgb.format = AVIF_RGB_FORMAT_RGBA;
+    rgb.depth = 8;
+    rgb.alphaPremultiplied = AVIF_TRUE;
+#if AVIF_VERSION_MAJOR >= 1
+    rgb.maxThreads = MWAVIFMaxThreads();
+#endif
+    rgb.rowBytes = rgb.width * 4;
+    size_t length = (size_t)rgb.rowBytes * rgb.height;
+    rgb.pixels = malloc(length);
+    if (!rgb.pixels) {
+        return NULL;
+    }
+    if (avifImageYUVToRGB(image, &rgb) != AVIF_RESULT_OK) {
+        free(rgb.pixels);
+        return NULL;
+    }
+    CGDataProviderRef provider = CGDataProviderCreateWithData(NULL, rgb.pixels, length, MWAVIFReleaseBitmapData);
+    if (!provider) {
+        free(rgb.pixels);
+        return NULL;
+    }
+    BOOL hasAlpha = image->alphaPlane != NULL;
+    CGBitmapInfo bitmapInfo = kCGBitmapByteOrder32Big | (hasAlpha ? kCGImageAlphaPremultipliedLast : kCGImageAlphaNoneSkipLast);
+    CGImageRef imageRef = CGImageCreate(rgb.width, rgb.height, 8, 32, rgb.rowBytes, [MWImageCoderHelper colorSpaceGetDeviceRGB], bitmapInfo, provider, NULL, NO, kCGRenderingIntentDefault);
+    CGDataProviderRelease(provider);
+    return imageRef;
+}
+
+static CGImageRef MWAVIFCreateScaledCGImage(avifImage *image, CGSize scaledSize) CF_RETURNS_RETAINED {
+    CGImageRef imageRef = MWAVIFCreateCGImage(image);
+    if (!imageRef || (scaledSize.width == image->width && scaledSize.height == image->height)) {
+        return imageRef;
+    }
+    CGImageRef scaledImageRef = [MWImageCoderHelper CGImageCreateScaled:imageRef size:scaledSize];
+    CGImageRelease(imageRef);
+    return scaledImageRef;
+}
+
+static avifDecoder *MWAVIFCreateDecoder(NSData *data) {
+    avifDecoder *decoder = avifDecoderCreate();
+    if (!decoder) {
+        return NULL;
+    }
+    decoder->maxThreads = MWAVIFMaxThreads();
+    decoder->ignoreExif = AVIF_TRUE;
+    decoder->ignoreXMP = AVIF_TRUE;
+    // The decoder reads the data in place, the caller keeps it alive
+    if (avifDecoderSetIOMemory(decoder, data.bytes, data.length) != AVIF_RESULT_OK || avifDecoderParse(decoder) != AVIF_RESULT_OK) {
+        avifDecoderDestroy(decoder);
+        return NULL;
+    }
+    return decoder;
+}
+
+static NSUInteger MWAVIFLoopCount(avifDecoder *decoder) {
+#if AVIF_VERSION_MAJOR >= 1
+    // The repetitions after the first play, negative for infinite or unknown
+    if (decoder->repetitionCount >= 0) {
+        return (NSUInteger)decoder->repetitionCount + 1;
+    }
+#endif
+    return 0;
+}
+
+static UIImage *MWAVIFImageWithCGImage(CGImageRef imageRef, CGFloat scale) {
+#if MW_UIKIT || MW_WATCH
+    return [[UIImage alloc] initWithCGImage:imageRef scale:scale orientation:UIImageOrientationUp];
+#else
+    return [[UIImage alloc] initWithCGImage:imageRef scale:scale orientation:kCGImagePropertyOrientationUp];
+#endif
+}
+
+#endif
+
+@implementation MWImageAVIFCoder {
+#if MW_AVIF
+    NSData *_imageData;
+    avifDecoder *_decoder;
+    NSArray<NSNumber *> *_frameDurations;
+    NSUInteger _loopCount;
+    CGFloat _scale;
+    CGSize _thumbnailSize;
+    BOOL _preserveAspectRatio;
+    dispatch_semaphore_t _lock;
+#endif
+}
+
+- (void)dealloc {
+#if MW_AVIF
+    if (_decoder) {
+        avifDecoderDestroy(_decoder);
+        _decoder = NULL;
+    }
+#endif
+}
+
++ (instancetype)sharedCoder {
+    static MWImageAVIFCoder *coder;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        coder = [[MWImageAVIFCoder alloc] init];
+    });
+    return coder;
+}
+
+#pragma mark - Decode
+
+- (BOOL)canDecodeFromData:(nullable NSData *)data {
+#if MW_AVIF
+    return [NSData MW_imageFormatForImageData:data] == MWImageFormatAVIF;
+#else
+    return NO;
+#endif
+}
+
+- (UIImage *)decodedImageWithData:(NSData *)data options:(nullable MWImageCoderOptions *)options {
+#if MW_AVIF
+    if (!data) {
+        return nil;
+    }
+    CGFloat scale = 1;
+    NSNumber *scaleFactor = options[MWImageCoderDecodeScaleFactor];
+    if (scaleFactor != nil) {
+        scale = MAX([scaleFactor doubleValue], 1);
+    }
+    CGSize thumbnailSize = CGSizeZero;
+    NSValue *thumbnailSizeValue = options[MWImageCoderDecodeThumbnailPixelSize];
+    if (thumbnailSizeValue != nil) {
+#if MW_MAC
+        thumbnailSize = thumbnailSizeValue.sizeValue;
+#else
+        thumbnailSize = thumbnailSizeValue.CGSizeValue;
+#endif
+    }
+    BOOL preserveAspectRatio = YES;
+    NSNumber *preserveAspectRatioValue = options[MWImageCoderDecodePreserveAspectRatio];
+    if (preserveAspectRatioValue != nil) {
+        preserveAspectRatio = preserveAspectRatioValue.boolValue;
+    }
+
+    avifDecoder *decoder = MWAVIFCreateDecoder(data);
+    if (!decoder) {
+        return nil;
+    }
+    @onExit {
+        avifDecoderDestroy(decoder);
+    };
+    BOOL decodeFirstFrame = [options[MWImageCoderDecodeFirstFrameOnly] boolValue];
+    UIImage *image;
+    if (decoder->imageCount <= 1 || decodeFirstFrame) {
+        if (avifDecoderNextImage(decoder) != AVIF_RESULT_OK) {
+            return nil;
+        }
+        avifImage *avifImage = decoder->image;
+        CGSize scaledSize = MWAVIFScaledPixelSize(CGSizeMake(avifImage->width, avifImage->height), thumbnailSize, preserveAspectRatio);
+#if AVIF_VERSION_MAJOR >= 1
+        if (scaledSize.width != avifImage->width || scaledSize.height != avifImage->height) {
+            // Scale the planes first, the full size RGB buffer is never allocated. This needs libavif built with libyuv, or it scales after the conversion
+            avifDiagnostics diagnostics;
+            avifImageScale(avifImage, (uint32_t)scaledSize.width, (uint32_t)scaledSize.height, &diagnostics);
+        }
+#endif
+        CGImageRef imageRef = MWAVIFCreateScaledCGImage(avifImage, scaledSize);
+        if (!imageRef) {
+            return nil;
+        }
+        image = MWAVIFImageWithCGImage(imageRef, scale);
+        CGImageRelease(imageRef);
+    } else {
+        NSMutableArray<MWImageFrame *> *frames = [NSMutableArray arrayWithCapacity:decoder->imageCount];
+        while (avifDecoderNextImage(decoder) == AVIF_RESULT_OK) {
+            avifImage *avifImage = decoder->image;
+            CGSize scaledSize = MWAVIFScaledPixelSize(CGSizeMake(avifImage->width, avifImage->height), thumbnailSize, preserveAspectRatio);
+            CGImageRef imageRef = MWAVIFCreateScaledCGImage(avifImage, scaledSize);
+            if (!imageRef) {
+                break;
+            }
+            UIImage *frameImage = MWAVIFImageWithCGImage(imageRef, scale);
+            CGImageRelease(imageRef);
+            [frames addObject:[MWImageFrame frameWithImage:frameImage duration:decoder->imageTiming.duration]];
+        }
+        image = [MWImageCoderHelper animatedImageWithFrames:frames];
+        image.MW_imageLoopCount = MWAVIFLoopCount(decoder);
+    }
+    image.MW_imageFormat = MWImageFormatAVIF;
+    return image;
+#else
+    return nil;
+#endif
+}
+
+#pragma mark - Encode
+
+- (BOOL)canEncodeToFormat:(MWImageFormat)format {
+#if MW_AVIF
+    return format == MWImageFormatAVIF;
+#else
+    return NO;
+#endif
+}
+
+- (NSData *)encodedDataWithImage:(UIImage *)image format:(MWImageFormat)format options:(nullable MWImageCoderOptions *)options {
+#if MW_AVIF
+    if (!image || format != MWImageFormatAVIF) {
+        return nil;
+    }
+    CGImageRef imageRef = image.CGImage;
+    if (!imageRef) {
+        return nil;
+    }
+    double compressionQuality = 1;
+    if (options[MWImageCoderEncodeCompressionQuality]) {
+        compressionQuality = [options[MWImageCoderEncodeCompressionQuality] doubleValue];
+    }
+    compressionQuality = MIN(MAX(compressionQuality, 0), 1);
+    CGSize maxPixelSize = CGSizeZero;
+    NSValue *maxPixelSizeValue = options[MWImageCoderEncodeMaxPixelSize];
+    if (maxPixelSizeValue != nil) {
+#if MW_MAC
+        maxPixelSize = maxPixelSizeValue.sizeValue;
+#else
+        maxPixelSize = maxPixelSizeValue.CGSizeValue;
+#endif
+    }
+    CGSize pixelSize = CGSizeMake(CGImageGetWidth(imageRef), CGImageGetHeight(imageRef));
+    CGSize encodedSize = MWAVIFScaledPixelSize(pixelSize, maxPixelSize, YES);
+
+    avifEncoder *encoder = avifEncoderCreate();
+    if (!encoder) {
+        return nil;
+    }
+    @onExit {
+        avifEncoderDestroy(encoder);
+    };
+    encoder->maxThreads = MWAVIFMaxThreads();
+    encoder->speed = AVIF_SPEED_DEFAULT;
+#if AVIF_VERSION_MAJOR >= 1
+    encoder->quality = (int)round(compressionQuality * AVIF_QUALITY_BEST);
+    encoder->qualityAlpha = encoder->quality;
+#else
+    int quantizer = (int)round((1 - compressionQuality) * AVIF_QUANTIZER_WORST_QUALITY);
+    encoder->minQuantizer = quantizer;
+    encoder->maxQuantizer = quantizer;
+    encoder->minQuantizerAlpha = quantizer;
+    encoder->maxQuantizerAlpha = quantizer;
+#endif
+
+    avifRWData output = AVIF_DATA_EMPTY;
+    NSArray<MWImageFrame *> *frames = [MWImageCoderHelper framesFromAnimatedImage:image];
+    BOOL encodeFirstFrame = [options[MWImageCoderEncodeFirstFrameOnly] boolValue];
+    if (encodeFirstFrame || frames.count == 0) {
+        avifImage *avifImage = [self.class createAVIFImageWithCGImage:imageRef size:encodedSize];
+        if (!avifImage) {
+            return nil;
+        }
+        avifResult result = avifEncoderWrite(encoder, avifImage, &output);
+        avifImageDestroy(avifImage);
+        if (result != AVIF_RESULT_OK) {
+            avifRWDataFree(&output);
+            return nil;
+        }
+    } else {
+        // The durations are in milliseconds
+        encoder->timescale = 1000;
+#if AVIF_VERSION_MAJOR >= 1
+        NSUInteger loopCount = image.MW_imageLoopCount;
+        encoder->repetitionCount = loopCount == 0 ? AVIF_REPETITION_COUNT_INFINITE : (int)loopCount - 1;
+#endif
+        for (MWImageFrame *frame in frames) {
+            CGImageRef frameImageRef = frame.image.CGImage;
+            avifImage *avifImage = frameImageRef ? [self.class createAVIFImageWithCGImage:frameImageRef size:encodedSize] : NULL;
+            if (!avifImage) {
+                return nil;
+            }
+            uint64_t duration = MAX((uint64_t)round(frame.duration * 1000), 1);
+            avifResult result = avifEncoderAddImage(encoder, avifImage, duration, AVIF_ADD_IMAGE_FLAG_NONE);
+            avifImageDestroy(avifImage);
+            if (result != AVIF_RESULT_OK) {
+                return nil;
+            }
+        }
+        if (avifEncoderFinish(encoder, &output) != AVIF_RESULT_OK) {
+            avifRWDataFree(&output);
+            return nil;
+        }
+    }
+    NSData *data = [NSData dataWithBytes:output.data length:output.size];
+    avifRWDataFree(&output);
+    return data;
+#else
+    return nil;
+#endif
+}
+
+#if MW_AVIF
+
+// The YUV 4:2:0 image of a CGImage at the encoded size, from straight (not premultiplied) RGBA
++ (avifImage *)createAVIFImageWithCGImage:(CGImageRef)imageRef size:(CGSize)size {
+    CGImageRef scaledImageRef = [MWImageCoderHelper CGImageCreateScaled:imageRef size:size];
+    if (!scaledImageRef) {
+        return NULL;
+    }
+    BOOL hasAlpha = [MWImageCoderHelper CGImageContainsAlpha:scaledImageRef];
+    vImage_CGImageFormat format = (vImage_CGImageFormat) {
+        .bitsPerComponent = 8,
+        .bitsPerPixel = 32,
+        .colorSpace = NULL,
+        .bitmapInfo = kCGBitmapByteOrder32Big | kCGImageAlphaLast,
+        .version = 0,
+        .decode = NULL,
+        .renderingIntent = kCGRenderingIntentDefault,
+    };
+    vImage_Buffer buffer = {};
+    vImage_Error error = vImageBuffer_InitWithCGImage(&buffer, &format, NULL, scaledImageRef, kvImageNoFlags);
+    CGImageRelease(scaledImageRef);
+    if (error != kvImageNoError) {
+        return NULL;
+    }
+    avifImage *avifImage = avifImageCreate((uint32_t)buffer.width, (uint32_t)buffer.height, 8, AVIF_PIXEL_FORMAT_YUV420);
+    if (!avifImage) {
+        free(buffer.data);
+        return NULL;
+    }
+    avifRGBImage rgb;
+    avifRGBImageSetDefaults(&rgb, avifImage);
+    rgb.format = AVIF_RGB_FORMAT_RGBA;
+    rgb.depth = 8;
+    rgb.pixels = buffer.data;
+    rgb.rowBytes = (uint32_t)buffer.rowBytes;
+    // An opaque image gets no alpha plane
+    rgb.ignoreAlpha = hasAlpha ? AVIF_FALSE : AVIF_TRUE;
+#if AVIF_VERSION_MAJOR >= 1
+    rgb.maxThreads = MWAVIFMaxThreads();
+#endif
+    avifResult result = avifImageRGBToYUV(avifImage, &rgb);
+    free(buffer.data);
+    if (result != AVIF_RESULT_OK) {
+        avifImageDestroy(avifImage);
+        return NULL;
+    }
+    return avifImage;
+}
+
+#endif
+
+#pragma mark - MWAnimatedImageCoder
+
+- (nullable instancetype)initWithAnimatedImageData:(nullable NSData *)data options:(nullable MWImageCoderOptions *)options {
+#if MW_AVIF
+    if (!data) {
+        return nil;
+    }
+    self = [super init];
+    if (self) {
+        _decoder = MWAVIFCreateDecoder(data);
+        if (!_decoder || _decoder->imageCount <= 1) {
+            // Still images use `decodedImageWithData:options:`
+            return nil;
+        }
+        _imageData = data;
+        // The durations come from the sample table, without decoding
+        NSMutableArray<NSNumber *> *frameDurations = [NSMutableArray arrayWithCapacity:_decoder->imageCount];
+        for (int i = 0; i < _decoder->imageCount; i++) {
+            avifImageTiming timing;
+            if (avifDecoderNthImageTiming(_decoder, i, &timing) != AVIF_RESULT_OK) {
+                return nil;
+            }
+            [frameDurations addObject:@(timing.duration)];
+        }
+        _frameDurations = [frameDurations copy];
+        _loopCount = MWAVIFLoopCount(_decoder);
+        CGFloat scale = 1;
+        NSNumber *scaleFactor = options[MWImageCoderDecodeScaleFactor];
+        if (scaleFactor != nil) {
+            scale = MAX([scaleFactor doubleValue], 1);
+        }
+        _scale = scale;
+        CGSize thumbnailSize = CGSizeZero;
+        NSValue *thumbnailSizeValue = options[MWImageCoderDecodeThumbnailPixelSize];
+        if (thumbnailSizeValue != nil) {
+#if MW_MAC
+            thumbnailSize = thumbnailSizeValue.sizeValue;
+#else
+            thumbnailSize = thumbnailSizeValue.CGSizeValue;
+#endif
+        }
+        _thumbnailSize = thumbnailSize;
+        BOOL preserveAspectRatio = YES;
+        NSNumber *preserveAspectRatioValue = options[MWImageCoderDecodePreserveAspectRatio];
+        if (preserveAspectRatioValue != nil) {
+            preserveAspectRatio = preserveAspectRatioValue.boolValue;
+        }
+        _preserveAspectRatio = preserveAspectRatio;
+        _lock = dispatch_semaphore_create(1);
+    }
+    return self;
+#else
+    return nil;
+#endif
+}
+
+- (NSData *)animatedImageData {
+#if MW_AVIF
+    return _imageData;
+#else
+    return nil;
+#endif
+}
+
+- (NSUInteger)animatedImageLoopCount {
+#if MW_AVIF
+    return _loopCount;
+#else
+    return 0;
+#endif
+}
+
+- (NSUInteger)animatedImageFrameCount {
+#if MW_AVIF
+    return _frameDurations.count;
+#else
+    return 0;
+#endif
+}
+
+- (NSTimeInterval)animatedImageDurationAtIndex:(NSUInteger)index {
+#if MW_AVIF
+    if (index >= _frameDurations.count) {
+        return 0;
+    }
+    return _frameDurations[index].doubleValue;
+#else
+    return 0;
+#endif
+}
+
+- (UIImage *)animatedImageFrameAtIndex:(NSUInteger)index {
+#if MW_AVIF
+    if (index >= _frameDurations.count) {
+        return nil;
+    }
+    MW_LOCK(_lock);
+    // The decoder seeks from the nearest keyframe, or continues when the index is the next frame
+    CGImageRef imageRef = NULL;
+    if (avifDecoderNthImage(_decoder, (uint32_t)index) == AVIF_RESULT_OK) {
+        avifImage *avifImage = _decoder->image;
+        CGSize scaledSize = MWAVIFScaledPixelSize(CGSizeMake(avifImage->width, avifImage->height), _thumbnailSize, _preserveAspectRatio);
+        imageRef = MWAVIFCreateScaledCGImage(avifImage, scaledSize);
+    }
+    MW_UNLOCK(_lock);
+    if (!imageRef) {
+        return nil;
+    }
+    UIImage *image = MWAVIFImageWithCGImage(imageRef, _scale);
+    CGImageRelease(imageRef);
+    image.MW_imageFormat = MWImageFormatAVIF;
+    image.MW_iMWecoded = YES;
+    return image;
+#else
+    return nil;
+#endif
+}
+
+@end
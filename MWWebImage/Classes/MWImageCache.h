@@ -13,6 +13,7 @@
 #import "MWImageCacheDefine.h"
 #import "MWMemoryCache.h"
 #import "MWDiskCache.h"
+#import "MWImageCacheValidators.h"
 
 /// Image Cache Options
 typedef NS_OPTIONS(NSUInteger, MWImageCacheOptions) {
@@ -206,6 +207,14 @@ typedef NS_OPTIONS(NSUInteger, MWImageCacheOptions) {
 - (void)storeImageToMemory:(nullable UIImage*)image
                     forKey:(nullable NSString *)key;
 
+/**
+ * Synchronously returns an image which shares the bitmap of an identical image already loaded, when `config.shouldDeduplicateImagesInMemory` is enabled and the memory cache is a `MWMemoryCache`. Else returns the image itself.
+ *
+ * @param image  The decoded image to store and deliver
+ * @note This hashes a few rows of the bitmap, and compares the whole bitmaps on a match, do not call it on the main thread.
+ */
+- (nonnull UIImage *)deduplicatedImageWithImage:(nonnull UIImage *)image;
+
 /**
  * Synchronously store image data into disk cache at the given key.
  *
@@ -215,6 +224,16 @@ typedef NS_OPTIONS(NSUInteger, MWImageCacheOptions) {
 - (void)storeImageDataToDisk:(nullable NSData *)imageData
                       forKey:(nullable NSString *)key;
 
+/**
+ * Synchronously move a file written beside the disk cache to a cache file, replacing it atomically. It runs on the IO queue, in order with the other disk operations.
+ * This is how the downloader commits the data received with `MWWebImageContextLoaderDownloadFileURL`.
+ *
+ * @param fileURL       The file to move, on the same volume as the cache
+ * @param cacheFileURL  The cache file, usually the `cachePathForKey:` of the key
+ * @return Whether the file was moved. If not, it's removed
+ */
+- (BOOL)moveFileAtURL:(nonnull NSURL *)fileURL toCacheFileURL:(nonnull NSURL *)cacheFileURL;
+
 
 #pragma mark - Contains and Check Ops
 
@@ -234,6 +253,25 @@ typedef NS_OPTIONS(NSUInteger, MWImageCacheOptions) {
  */
 - (BOOL)diskImageDataExistsWithKey:(nullable NSString *)key;
 
+#pragma mark - Validators Ops
+
+/**
+ * Asynchronously query the HTTP validators stored with the image data in disk cache.
+ *
+ *  @param key             the key describing the url
+ *  @param completionBlock the block to be executed when the query is done, with nil if the disk cache does not have validators for the key
+ *  @note the completion block will be always executed on the main queue
+ */
+- (void)queryValidatorsForKey:(nullable NSString *)key completion:(nullable MWImageCacheValidatorsCompletionBlock)completionBlock;
+
+/**
+ * Asynchronously store the HTTP validators with the image data in disk cache. The disk operations are serial, so the validators are stored after the image data stored before this call.
+ *
+ *  @param validators The validators, pass nil to remove
+ *  @param key        The unique image cache key, usually it's image absolute URL
+ */
+- (void)storeValidators:(nullable MWImageCacheValidators *)validators forKey:(nullable NSString *)key;
+
 #pragma mark - Query and Retrieve Ops
 
 /**
@@ -412,6 +450,12 @@ typedef NS_OPTIONS(NSUInteger, MWImageCacheOptions) {
  */
 - (void)calculateSizeWithCompletionBlock:(nullable MWImageCacheCalculateSizeBlock)completionBlock;
 
+/**
+ * Get a snapshot of the memory cache hit, miss and eviction count, with the estimated hit ratio at 0.5x, 2x and 4x the current budget.
+ * @note This is nil unless `MWImageCacheConfig.shouldRecordMemoryCacheStatistics` is enabled and the memory cache is `MWMemoryCache` or its subclass.
+ */
+- (nullable MWMemoryCacheStatistics *)memoryCacheStatistics;
+
 @end
 
 /**
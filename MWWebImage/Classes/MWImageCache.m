@@ -270,6 +270,13 @@ static NSString * _defaultDiskCacheDirectory;
     [self.memoryCache setObject:image forKey:key cost:cost];
 }
 
+- (UIImage *)deduplicatedImageWithImage:(UIImage *)image {
+    if (!image || !self.config.shouldDeduplicateImagesInMemory || ![self.memoryCache isKindOfClass:[MWMemoryCache class]]) {
+        return image;
+    }
+    return [(MWMemoryCache *)self.memoryCache deduplicatedImageWithImage:image];
+}
+
 - (void)storeImageDataToDisk:(nullable NSData *)imageData
                       forKey:(nullable NSString *)key {
     if (!imageData || !key) {
@@ -281,6 +288,18 @@ static NSString * _defaultDiskCacheDirectory;
     });
 }
 
+- (BOOL)moveFileAtURL:(NSURL *)fileURL toCacheFileURL:(NSURL *)cacheFileURL {
+    __block BOOL moved = NO;
+    dispatch_sync(self.ioQueue, ^{
+        // `rename` replaces the previous cache file atomically, a reader sees either the old data or the new one
+        moved = rename(fileURL.fileSystemRepresentation, cacheFileURL.fileSystemRepresentation) == 0;
+        if (!moved) {
+            unlink(fileURL.fileSystemRepresentation);
+        }
+    });
+    return moved;
+}
+
 // Make sure to call from io queue by caller
 - (void)_storeImageDataToDisk:(nullable NSData *)imageData forKey:(nullable NSString *)key {
     if (!imageData || !key) {
@@ -290,6 +309,38 @@ static NSString * _defaultDiskCacheDirectory;
     [self.diskCache setData:imageData forKey:key];
 }
 
+#pragma mark - Validators Ops
+
+- (void)queryValidatorsForKey:(NSString *)key completion:(MWImageCacheValidatorsCompletionBlock)completionBlock {
+    if (!key || ![self.diskCache respondsToSelector:@selector(validatorsDataForKey:)]) {
+        if (completionBlock) {
+            completionBlock(nil);
+        }
+        return;
+    }
+    dispatch_async(self.ioQueue, ^{
+        MWImageCacheValidators *validators = [MWImageCacheValidators validatorsWithData:[self.diskCache validatorsDataForKey:key]];
+        if (completionBlock) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                completionBlock(validators);
+            });
+        }
+    });
+}
+
+- (void)storeValidators:(MWImageCacheValidators *)validators forKey:(NSString *)key {
+    if (!key || ![self.diskCache respondsToSelector:@selector(setValidatorsData:forKey:)]) {
+        return;
+    }
+    dispatch_async(self.ioQueue, ^{
+        // The image data may have been removed or failed to be written
+        if (![self.diskCache contaiNSDataForKey:key]) {
+            return;
+        }
+        [self.diskCache setValidatorsData:validators.data forKey:key];
+    });
+}
+
 #pragma mark - Query and Retrieve Ops
 
 - (void)diskImageExistsWithKey:(nullable NSString *)key completion:(nullable MWImageCacheCheckCompletionBlock)completionBlock {
@@ -539,6 +590,10 @@ static NSString * _defaultDiskCacheDirectory;
                 }
                 // decode image data only if in-memory cache missed
                 diskImage = [self diskImageForKey:key data:diskData options:options context:context];
+                if (diskImage && !shouldQueryDiskSync) {
+                    // On the io queue, the shared image is both cached and delivered
+                    diskImage = [self deduplicatedImageWithImage:diskImage];
+                }
                 if (shouldCacheToMomery && diskImage && self.config.shouldCacheImagesInMemory) {
                     NSUInteger cost = diskImage.MW_memoryCost;
                     [self.memoryCache setObject:diskImage forKey:key cost:cost];
@@ -720,6 +775,13 @@ static NSString * _defaultDiskCacheDirectory;
     });
 }
 
+- (nullable MWMemoryCacheStatistics *)memoryCacheStatistics {
+    if (![self.memoryCache isKindOfClass:[MWMemoryCache class]]) {
+        return nil;
+    }
+    return ((MWMemoryCache *)self.memoryCache).statistics;
+}
+
 #pragma mark - Helper
 + (MWWebImageOptions)imageOptionsFromCacheOptions:(MWImageCacheOptions)cacheOptions {
     MWWebImageOptions options = 0;
@@ -29,6 +29,18 @@ typedef NS_ENUM(NSUInteger, MWImageCacheConfigExpireType) {
     MWImageCacheConfigExpireTypeChangeDate,
 };
 
+/// Image Memory Cache Eviction Type
+typedef NS_ENUM(NSUInteger, MWImageCacheConfigMemoryEvictionType) {
+    /**
+     * Let `NSCache` decide which entry to evict when the memory cache is over `maxMemoryCost` or `maxMemoryCount`. Two entries of the same bytes size are equally evictable (Default)
+     */
+    MWImageCacheConfigMemoryEvictionTypeDefault,
+    /**
+     * GreedyDual-Size eviction. Each entry records the time it took to be decoded and transformed when stored (see `UIImage.MW_rebuildCost`), and the entry with the lowest rebuild cost per byte, aged by recency, is evicted first. Expensive transformed images survive longer than cheap originals of the same size
+     */
+    MWImageCacheConfigMemoryEvictionTypeGreedyDualSize,
+};
+
 /**
  The class contains all the config for image cache
  @note This class conform to NSCopying, make sure to add the property in `copyWithZone:` as well.
@@ -61,6 +73,22 @@ typedef NS_ENUM(NSUInteger, MWImageCacheConfigExpireType) {
  */
 @property (assign, nonatomic) BOOL shouldUseWeakMemoryCache;
 
+/**
+ * Whether or not to share one backing bitmap between memory cache entries whose decoded pixels are identical. The same avatar often reaches the cache under several URLs, or under thumbnail and transformer keys which resolve to the same pixels.
+ * When enabled, the image cache fingerprints a few rows of the decoded pixel buffer of each static image it loads from disk or network, off the main thread and before the image is stored. If an identical bitmap is still alive, which is checked by comparing the whole pixel buffers, the loaded image reuses it instead of holding another copy, and that image is the one delivered to the completion block. See `MWMemoryCache.deduplicatedBytes` for the bytes saved.
+ * @note Only decoded static images take part, animated images and images loaded with `MWWebImageAvoidDecodeImage` are stored as is.
+ * Defaults to NO. You can change this option dynamically.
+ */
+@property (assign, nonatomic) BOOL shouldDeduplicateImagesInMemory;
+
+/**
+ * Whether or not the memory cache records the hit, miss and eviction count, and keeps ghost entries (key and cost only) of recently evicted images to estimate the hit ratio at other budgets. See `MWImageCache.memoryCacheStatistics`.
+ * This helps to choose `maxMemoryCost` and `maxMemoryCount` per device class from real usage.
+ * @note This value does not support dynamic changes. Which means further modification on this value after cache initialized has no effect.
+ * Defaults to NO.
+ */
+@property (assign, nonatomic) BOOL shouldRecordMemoryCacheStatistics;
+
 /**
  * Whether or not to remove the expired disk data when application entering the background. (Not works for macOS)
  * Defaults to YES.
@@ -106,6 +134,13 @@ typedef NS_ENUM(NSUInteger, MWImageCacheConfigExpireType) {
  */
 @property (assign, nonatomic) NSUInteger maxMemoryCount;
 
+/**
+ * The policy used by the built-in `MWMemoryCache` to choose which image to evict when over `maxMemoryCost` or `maxMemoryCount`.
+ * @note This value does not support dynamic changes. Which means further modification on this value after cache initialized has no effect.
+ * Defaults to `MWImageCacheConfigMemoryEvictionTypeDefault`.
+ */
+@property (assign, nonatomic) MWImageCacheConfigMemoryEvictionType memoryCacheEvictionType;
+
 /*
  * The attribute which the clear cache will be checked against when clearing the disk cache
  * Default is Modified Date
@@ -28,12 +28,15 @@ static const NSInteger kDefaultCacheMaxDiskAge = 60 * 60 * 24 * 7; // 1 week
         _shouldDisableiCloud = YES;
         _shouldCacheImagesInMemory = YES;
         _shouldUseWeakMemoryCache = YES;
+        _shouldDeduplicateImagesInMemory = NO;
         _shouldRemoveExpiredDataWhenEnterBackground = YES;
         _diskCacheReadingOptions = 0;
         _diskCacheWritingOptions = NSDataWritingAtomic;
         _maxDiskAge = kDefaultCacheMaxDiskAge;
         _maxDiskSize = 0;
         _diskCacheExpireType = MWImageCacheConfigExpireTypeModificationDate;
+        _memoryCacheEvictionType = MWImageCacheConfigMemoryEvictionTypeDefault;
+        _shouldRecordMemoryCacheStatistics = NO;
         _memoryCacheClass = [MWMemoryCache class];
         _diskCacheClass = [MWDiskCache class];
     }
@@ -45,6 +48,7 @@ static const NSInteger kDefaultCacheMaxDiskAge = 60 * 60 * 24 * 7; // 1 week
     config.shouldDisableiCloud = self.shouldDisableiCloud;
     config.shouldCacheImagesInMemory = self.shouldCacheImagesInMemory;
     config.shouldUseWeakMemoryCache = self.shouldUseWeakMemoryCache;
+    config.shouldDeduplicateImagesInMemory = self.shouldDeduplicateImagesInMemory;
     config.shouldRemoveExpiredDataWhenEnterBackground = self.shouldRemoveExpiredDataWhenEnterBackground;
     config.diskCacheReadingOptions = self.diskCacheReadingOptions;
     config.diskCacheWritingOptions = self.diskCacheWritingOptions;
@@ -53,6 +57,8 @@ static const NSInteger kDefaultCacheMaxDiskAge = 60 * 60 * 24 * 7; // 1 week
     config.maxMemoryCost = self.maxMemoryCost;
     config.maxMemoryCount = self.maxMemoryCount;
     config.diskCacheExpireType = self.diskCacheExpireType;
+    config.memoryCacheEvictionType = self.memoryCacheEvictionType;
+    config.shouldRecordMemoryCacheStatistics = self.shouldRecordMemoryCacheStatistics;
     config.fileManager = self.fileManager; // NSFileManager does not conform to NSCopying, just pass the reference
     config.memoryCacheClass = self.memoryCacheClass;
     config.diskCacheClass = self.diskCacheClass;
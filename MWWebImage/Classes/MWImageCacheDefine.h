@@ -11,6 +11,8 @@
 #import "MWWebImageOperation.h"
 #import "MWWebImageDefine.h"
 
+@class MWImageCacheValidators;
+
 /// Image Cache Type
 typedef NS_ENUM(NSInteger, MWImageCacheType) {
     /**
@@ -41,6 +43,7 @@ typedef void(^MWImageCacheCalculateSizeBlock)(NSUInteger fileCount, NSUInteger t
 typedef NSString * _Nullable (^MWImageCacheAdditionalCachePathBlock)(NSString * _Nonnull key);
 typedef void(^MWImageCacheQueryCompletionBlock)(UIImage * _Nullable image, NSData * _Nullable data, MWImageCacheType cacheType);
 typedef void(^MWImageCacheContainsCompletionBlock)(MWImageCacheType containsCacheType);
+typedef void(^MWImageCacheValidatorsCompletionBlock)(MWImageCacheValidators * _Nullable validators);
 
 /**
  This is the built-in decoding process for image query from cache.
@@ -140,4 +143,24 @@ FOUNDATION_EXPORT UIImage * _Nullable MWImageCacheDecodeImageData(NSData * _Nonn
 - (void)clearWithCacheType:(MWImageCacheType)cacheType
                 completion:(nullable MWWebImageNoParamsBlock)completionBlock;
 
+@optional
+
+/**
+ Query the HTTP validators stored with the cached image, used by `MWWebImageManager` to send a conditional request when refreshing the image with `MWWebImageRefreshCached` or `MWWebImageStaleWhileRevalidate`. Without this method, the refresh relies on `NSURLCache` instead.
+
+ @param key The image cache key
+ @param completionBlock A block executed after the operation is finished, with nil if there are no validators
+ */
+- (void)queryValidatorsForKey:(nullable NSString *)key
+                   completion:(nullable MWImageCacheValidatorsCompletionBlock)completionBlock;
+
+/**
+ Store the HTTP validators of the cached image. Called after `storeImage:imageData:forKey:cacheType:completion:` with the same key, they should be kept with the image data and removed with it.
+
+ @param validators The validators, pass nil to remove
+ @param key The image cache key
+ */
+- (void)storeValidators:(nullable MWImageCacheValidators *)validators
+                 forKey:(nullable NSString *)key;
+
 @end
@@ -11,9 +11,11 @@
 #import "MWImageCoderHelper.h"
 #import "MWAnimatedImage.h"
 #import "UIImage+Metadata.h"
+#import "UIImage+MemoryCacheCost.h"
 #import "MWInternalMacros.h"
 
 UIImage * _Nullable MWImageCacheDecodeImageData(NSData * _Nonnull imageData, NSString * _Nonnull cacheKey, MWWebImageOptions options, MWWebImageContext * _Nullable context) {
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
     UIImage *image;
     BOOL decodeFirstFrame = MW_OPTIONS_CONTAINS(options, MWWebImageDecodeFirstFrameOnly);
     NSNumber *scaleValue = context[MWWebImageContextImageScaleFactor];
@@ -81,5 +83,9 @@ UIImage * _Nullable MWImageCacheDecodeImageData(NSData * _Nonnull imageData, NSS
         }
     }
     
+    if (image) {
+        image.MW_rebuildCost = CFAbsoluteTimeGetCurrent() - startTime;
+    }
+    
     return image;
 }
@@ -0,0 +1,60 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "MWWebImageCompat.h"
+
+/**
+ The HTTP validators of a cached image, stored with its disk data by `MWImageCache`.
+ They are sent as a conditional request (`If-None-Match` / `If-Modified-Since`) when refreshing the cached image with `MWWebImageRefreshCached` or `MWWebImageStaleWhileRevalidate`, so an unchanged image costs a `304 Not Modified` response instead of the full body.
+ */
+@interface MWImageCacheValidators : NSObject
+
+/// The `ETag` of the response
+@property (nonatomic, copy, readonly, nullable) NSString *entityTag;
+/// The `Last-Modified` of the response
+@property (nonatomic, copy, readonly, nullable) NSString *lastModified;
+/// The date the image was downloaded or last revalidated
+@property (nonatomic, strong, readonly, nonnull) NSDate *validatedDate;
+/// The `Cache-Control: max-age` of the response in seconds, 0 if absent or `no-cache`
+@property (nonatomic, assign, readonly) NSTimeInterval maxAge;
+/// Whether the image is still fresh, younger than `maxAge`. A fresh image does not need to be revalidated by `MWWebImageStaleWhileRevalidate`
+@property (nonatomic, assign, readonly, getter=isFresh) BOOL fresh;
+
+- (nonnull instancetype)init NS_UNAVAILABLE;
++ (nonnull instancetype)new NS_UNAVAILABLE;
+
+/**
+ Read the validators of a response.
+
+ @param response The image response
+ @return The validators, nil if the response is not HTTP or has neither validator nor `max-age`
+ */
++ (nullable instancetype)validatorsWithResponse:(nullable NSURLResponse *)response;
+
+/**
+ The validators after a `304 Not Modified` response: the date is reset, and the headers sent again by the server replace the current ones.
+ */
+- (nonnull instancetype)validatorsByRevalidatingWithResponse:(nullable NSURLResponse *)response;
+
+/**
+ Read the validators from the data stored in the disk cache, see `data`.
+ */
++ (nullable instancetype)validatorsWithData:(nullable NSData *)data;
+
+/**
+ The data to store in the disk cache.
+ */
+- (nullable NSData *)data;
+
+/**
+ Add the conditional headers to the request.
+ */
+- (void)applyToRequest:(nonnull NSMutableURLRequest *)request;
+
+@end
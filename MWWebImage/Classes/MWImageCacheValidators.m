@@ -0,0 +1,147 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "MWImageCacheValidators.h"
+
+static NSString *const kMWValidatorsEntityTagKey = @"etag";
+static NSString *const kMWValidatorsLastModifiedKey = @"lastModified";
+static NSString *const kMWValidatorsValidatedDateKey = @"validatedDate";
+static NSString *const kMWValidatorsMaxAgeKey = @"maxAge";
+
+@interface MWImageCacheValidators ()
+
+@property (nonatomic, copy, readwrite, nullable) NSString *entityTag;
+@property (nonatomic, copy, readwrite, nullable) NSString *lastModified;
+@property (nonatomic, strong, readwrite, nonnull) NSDate *validatedDate;
+@property (nonatomic, assign, readwrite) NSTimeInterval maxAge;
+
+@end
+
+@implementation MWImageCacheValidators
+
+- (instancetype)initWithEntityTag:(NSString *)entityTag lastModified:(NSString *)lastModified validatedDate:(NSDate *)validatedDate maxAge:(NSTimeInterval)maxAge {
+    self = [super init];
+    if (self) {
+        _entityTag = [entityTag copy];
+        _lastModified = [lastModified copy];
+        _validatedDate = validatedDate;
+        _maxAge = MAX(maxAge, 0);
+    }
+    return self;
+}
+
+// `allHeaderFields` keys are not canonicalized the same way on all OS versions
++ (NSString *)valueForHeaderField:(NSString *)field inResponse:(NSHTTPURLResponse *)response {
+    for (NSString *key in response.allHeaderFields) {
+        if ([key caseInsensitiveCompare:field] == NSOrderedSame) {
+            return response.allHeaderFields[key];
+        }
+    }
+    return nil;
+}
+
+// -1 if there is no `Cache-Control`
++ (NSTimeInterval)maxAgeWithCacheControl:(NSString *)cacheControl {
+    if (!cacheControl) {
+        return -1;
+    }
+    NSTimeInterval maxAge = 0;
+    for (NSString *component in [cacheControl componentsSeparatedByString:@","]) {
+        NSString *directive = [[component stringByTrimmingCharactersInSet:NSCharacterSet.whitespaceCharacterSet] lowercaseString];
+        if ([directive isEqualToString:@"no-cache"] || [directive isEqualToString:@"no-store"]) {
+            return 0;
+        } else if ([directive hasPrefix:@"max-age="]) {
+            maxAge = [directive substringFromIndex:@"max-age=".length].doubleValue;
+        }
+    }
+    return maxAge;
+}
+
++ (instancetype)validatorsWithResponse:(NSURLResponse *)response {
+    if (![response isKindOfClass:NSHTTPURLResponse.class]) {
+        return nil;
+    }
+    NSHTTPURLResponse *HTTPResponse = (NSHTTPURLResponse *)response;
+    NSString *entityTag = [self valueForHeaderField:@"ETag" inResponse:HTTPResponse];
+    NSString *lastModified = [self valueForHeaderField:@"Last-Modified" inResponse:HTTPResponse];
+    NSTimeInterval maxAge = [self maxAgeWithCacheControl:[self valueForHeaderField:@"Cache-Control" inResponse:HTTPResponse]];
+    if (entityTag.length == 0 && lastModified.length == 0 && maxAge <= 0) {
+        return nil;
+    }
+    return [[self alloc] initWithEntityTag:entityTag lastModified:lastModified validatedDate:[NSDate date] maxAge:maxAge];
+}
+
+- (instancetype)validatorsByRevalidatingWithResponse:(NSURLResponse *)response {
+    NSString *entityTag = self.entityTag;
+    NSString *lastModified = self.lastModified;
+    NSTimeInterval maxAge = self.maxAge;
+    if ([response isKindOfClass:NSHTTPURLResponse.class]) {
+        // A 304 response should send the same headers as the 200 one, but may omit some
+        NSHTTPURLResponse *HTTPResponse = (NSHTTPURLResponse *)response;
+        entityTag = [self.class valueForHeaderField:@"ETag" inResponse:HTTPResponse] ?: entityTag;
+        lastModified = [self.class valueForHeaderField:@"Last-Modified" inResponse:HTTPResponse] ?: lastModified;
+        NSTimeInterval responseMaxAge = [self.class maxAgeWithCacheControl:[self.class valueForHeaderField:@"Cache-Control" inResponse:HTTPResponse]];
+        if (responseMaxAge >= 0) {
+            maxAge = responseMaxAge;
+        }
+    }
+    return [[self.class alloc] initWithEntityTag:entityTag lastModified:lastModified validatedDate:[NSDate date] maxAge:maxAge];
+}
+
+- (BOOL)isFresh {
+    return self.maxAge > 0 && -[self.validatedDate timeIntervalSinceNow] < self.maxAge;
+}
+
+#pragma mark - Serialization
+
++ (instancetype)validatorsWithData:(NSData *)data {
+    if (!data) {
+        return nil;
+    }
+    NSDictionary *dictionary = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+    if (![dictionary isKindOfClass:NSDictionary.class]) {
+        return nil;
+    }
+    NSString *entityTag = dictionary[kMWValidatorsEntityTagKey];
+    NSString *lastModified = dictionary[kMWValidatorsLastModifiedKey];
+    NSNumber *validatedTime = dictionary[kMWValidatorsValidatedDateKey];
+    NSNumber *maxAge = dictionary[kMWValidatorsMaxAgeKey];
+    if (![validatedTime isKindOfClass:NSNumber.class]) {
+        return nil;
+    }
+    return [[self alloc] initWithEntityTag:([entityTag isKindOfClass:NSString.class] ? entityTag : nil)
+                              lastModified:([lastModified isKindOfClass:NSString.class] ? lastModified : nil)
+                             validatedDate:[NSDate dateWithTimeIntervalSince1970:validatedTime.doubleValue]
+                                    maxAge:([maxAge isKindOfClass:NSNumber.class] ? maxAge.doubleValue : 0)];
+}
+
+- (NSData *)data {
+    NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
+    dictionary[kMWValidatorsEntityTagKey] = self.entityTag;
+    dictionary[kMWValidatorsLastModifiedKey] = self.lastModified;
+    dictionary[kMWValidatorsValidatedDateKey] = @(self.validatedDate.timeIntervalSince1970);
+    dictionary[kMWValidatorsMaxAgeKey] = @(self.maxAge);
+    return [NSJSONSerialization dataWithJSONObject:dictionary options:0 error:nil];
+}
+
+#pragma mark - Request
+
+- (void)applyToRequest:(NSMutableURLRequest *)request {
+    if (self.entityTag.length > 0) {
+        [request setValue:self.entityTag forHTTPHeaderField:@"If-None-Match"];
+    }
+    if (self.lastModified.length > 0) {
+        [request setValue:self.lastModified forHTTPHeaderField:@"If-Modified-Since"];
+    }
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p etag = %@, last modified = %@, validated = %@, max age = %.0fs>", NSStringFromClass(self.class), self, self.entityTag, self.lastModified, self.validatedDate, self.maxAge];
+}
+
+@end
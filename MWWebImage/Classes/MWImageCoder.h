@@ -187,6 +187,17 @@ FOUNDATION_EXPORT MWImageCoderOption _Nonnull const MWImageCoderWebImageContext
  */
 - (void)updateIncrementalData:(nullable NSData *)data finished:(BOOL)finished;
 
+@optional
+/**
+ Feed only the new image data received since the last call. The coder keeps the data and the parser state between calls, so the whole download is handed over once instead of on every update.
+ When implemented, this is used instead of `updateIncrementalData:finished:` by the built-in progressive decoding process.
+
+ @param data The image data received since the last call
+ @param finished Whether the download has finished
+ */
+- (void)appendIncrementalData:(nonnull NSData *)data finished:(BOOL)finished;
+
+@required
 /**
  Incremental decode the current image data to image.
  @note Due to the performance issue for progressive decoding and the integration for image view. This method may only return the first frame image even if the image data is animated image. If you want progressive animated image decoding, conform to `MWAnimatedImageCoder` protocol as well and use `animatedImageFrameAtIndex:` instead.
@@ -11,6 +11,10 @@
 #import "MWImageGIFCoder.h"
 #import "MWImageAPNGCoder.h"
 #import "MWImageHEICCoder.h"
+#import "MWImageWebPCoder.h"
+#import "MWImageAVIFCoder.h"
+#import "MWImageJPEGCoder.h"
+#import "MWImagePNGCoder.h"
 #import "MWInternalMacros.h"
 
 @interface MWImageCodersManager ()
@@ -37,6 +41,19 @@
     if (self = [super init]) {
         // initialize with default coders
         _imageCoders = [NSMutableArray arrayWithArray:@[[MWImageIOCoder sharedCoder], [MWImageGIFCoder sharedCoder], [MWImageAPNGCoder sharedCoder]]];
+#if MW_WEBP
+        // Before Image/IO, which only decodes WebP on recent firmwares
+        [_imageCoders addObject:[MWImageWebPCoder sharedCoder]];
+#endif
+#if MW_AVIF
+        [_imageCoders addObject:[MWImageAVIFCoder sharedCoder]];
+#endif
+#if MW_JPEG_TURBO
+        [_imageCoders addObject:[MWImageJPEGCoder sharedCoder]];
+#endif
+#if MW_LIBDEFLATE
+        [_imageCoders addObject:[MWImagePNGCoder sharedCoder]];
+#endif
         _codersLock = dispatch_semaphore_create(1);
     }
     return self;
@@ -0,0 +1,91 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "MWWebImageCompat.h"
+#import "MWWebImageOperation.h"
+
+/// The lane of a decode, the lanes are served in order
+typedef NS_ENUM(NSUInteger, MWImageDecodeLane) {
+    /// Images on screen, priority above 0.375
+    MWImageDecodeLaneVisible = 0,
+    /// Prefetched images, priority above 0.125
+    MWImageDecodeLanePrefetch,
+    /// The rest, priority up to 0.125
+    MWImageDecodeLaneBackground,
+};
+
+/// The lane of a decode with the given load priority
+FOUNDATION_EXPORT MWImageDecodeLane MWImageDecodeLaneForPriority(MWWebImageOperationPriority priority);
+
+/**
+ A decode submitted to `MWImageDecodeExecutor`. Changing its priority moves it to another lane while it waits.
+ */
+@interface MWImageDecodeTask : NSObject <MWWebImageOperation>
+
+/// The priority of the decode
+@property (assign, nonatomic) MWWebImageOperationPriority priority;
+/// The estimated memory of the decode, in bytes
+@property (assign, nonatomic, readonly) NSUInteger cost;
+/// Whether the decode was cancelled before it started
+@property (assign, nonatomic, readonly, getter=isCancelled) BOOL cancelled;
+/// Whether the decode finished running
+@property (assign, nonatomic, readonly, getter=isFinished) BOOL finished;
+
+@end
+
+/**
+ The shared executor of the image decodes of `MWWebImageDownloaderOperation`. It runs a bounded number of decodes at a time, instead of one serial queue per download, so the decodes of many downloads do not compete with the main thread.
+ The waiting decodes are admitted from the visible lane first, then the prefetch and background lanes, in submission order inside a lane. A decode is admitted only if the estimated memory of the decodes in flight stays under `maxInFlightBytes`, except when nothing else is in flight.
+ @note All methods are thread-safe.
+ */
+@interface MWImageDecodeExecutor : NSObject
+
+/// The global shared executor
+@property (nonatomic, class, readonly, nonnull) MWImageDecodeExecutor *sharedExecutor;
+
+/// The maximum number of decodes running at the same time. Defaults to the active processor count minus one for the main thread, at least 1
+@property (assign, atomic) NSUInteger maxConcurrentDecodeCount;
+/// The maximum estimated memory of the decodes in flight, in bytes. 0 means no limit. Defaults to 1/16 of the physical memory
+@property (assign, atomic) NSUInteger maxInFlightBytes;
+/// The decodes running now
+@property (assign, atomic, readonly) NSUInteger runningCount;
+/// The estimated memory of the decodes running now, in bytes
+@property (assign, atomic, readonly) NSUInteger inFlightBytes;
+/// The decodes waiting for admission
+@property (assign, atomic, readonly) NSUInteger pendingCount;
+
+/**
+ Submit a decode.
+
+ @param block The decoding work, run on a global queue with the quality of service of its lane
+ @param priority The load priority, which selects the lane
+ @param cost The estimated memory of the decode, in bytes. See `MWImageDecodeEstimatedCost`
+ @param dependency A decode which must finish, or be cancelled, before this one starts. This keeps the decodes of one download in order
+ @return The task, which can be cancelled before it starts
+ */
+- (nonnull MWImageDecodeTask *)addDecodeBlock:(nonnull dispatch_block_t)block
+                                     priority:(MWWebImageOperationPriority)priority
+                                         cost:(NSUInteger)cost
+                                   dependency:(nullable MWImageDecodeTask *)dependency;
+
+@end
+
+/**
+ The estimated memory to decode an image data: its pixel count from the image header (see `MWImageHeaderParser`), limited by the thumbnail pixel size, times 4 bytes.
+
+ @param data The image data, which can be partial
+ @param thumbnailPixelSize The thumbnail pixel size of the decode, `CGSizeZero` for none
+ @return The estimated bytes, or the data length times 4 if the header can't be read
+ */
+FOUNDATION_EXPORT NSUInteger MWImageDecodeEstimatedCost(NSData * _Nonnull data, CGSize thumbnailPixelSize);
+
+/**
+ The estimated memory to decode an image of a known pixel size, limited by the thumbnail pixel size, times 4 bytes.
+ */
+FOUNDATION_EXPORT NSUInteger MWImageDecodeEstimatedCostForPixelSize(CGSize pixelSize, CGSize thumbnailPixelSize);
@@ -0,0 +1,294 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "MWImageDecodeExecutor.h"
+#import "MWDeviceHelper.h"
+#import "MWImageHeaderParser.h"
+#import "MWInternalMacros.h"
+#import <ImageIO/ImageIO.h>
+
+static const NSUInteger kMWImageDecodeLaneCount = 3;
+
+MWImageDecodeLane MWImageDecodeLaneForPriority(MWWebImageOperationPriority priority) {
+    if (priority > 0.375) {
+        return MWImageDecodeLaneVisible;
+    } else if (priority > 0.125) {
+        return MWImageDecodeLanePrefetch;
+    } else {
+        return MWImageDecodeLaneBackground;
+    }
+}
+
+static qos_class_t MWImageDecodeQualityOfServiceForLane(MWImageDecodeLane lane) {
+    switch (lane) {
+        case MWImageDecodeLaneVisible: return QOS_CLASS_USER_INITIATED;
+        case MWImageDecodeLanePrefetch: return QOS_CLASS_UTILITY;
+        default: return QOS_CLASS_BACKGROUND;
+    }
+}
+
+NSUInteger MWImageDecodeEstimatedCost(NSData * _Nonnull data, CGSize thumbnailPixelSize) {
+    CGSize pixelSize = CGSizeZero;
+    if ([MWImageHeaderParser parseHeaderWithData:data format:NULL pixelSize:&pixelSize] == MWImageHeaderParseStatusSuccess) {
+        return MWImageDecodeEstimatedCostForPixelSize(pixelSize, thumbnailPixelSize);
+    }
+    NSUInteger cost = data.length * 4;
+    // Other formats, such as TIFF
+    CGImageSourceRef source = CGImageSourceCreateWithData((__bridge CFDataRef)data, NULL);
+    if (!source) {
+        return cost;
+    }
+    // Only the header is parsed, the image is not decoded
+    CFDictionaryRef properties = CGImageSourceCopyPropertiesAtIndex(source, 0, NULL);
+    CFRelease(source);
+    if (!properties) {
+        return cost;
+    }
+    NSUInteger width = [((__bridge NSDictionary *)properties)[(__bridge NSString *)kCGImagePropertyPixelWidth] unsignedIntegerValue];
+    NSUInteger height = [((__bridge NSDictionary *)properties)[(__bridge NSString *)kCGImagePropertyPixelHeight] unsignedIntegerValue];
+    CFRelease(properties);
+    if (width == 0 || height == 0) {
+        return cost;
+    }
+    return MWImageDecodeEstimatedCostForPixelSize(CGSizeMake(width, height), thumbnailPixelSize);
+}
+
+NSUInteger MWImageDecodeEstimatedCostForPixelSize(CGSize pixelSize, CGSize thumbnailPixelSize) {
+    double pixelCount = (double)pixelSize.width * pixelSize.height;
+    if (thumbnailPixelSize.width > 0 && thumbnailPixelSize.height > 0) {
+        pixelCount = MIN(pixelCount, thumbnailPixelSize.width * thumbnailPixelSize.height);
+    }
+    return (NSUInteger)MIN(pixelCount * 4, (double)NSUIntegerMax);
+}
+
+@interface MWImageDecodeExecutor ()
+
+@property (nonatomic, strong, nonnull) NSArray<NSMutableArray<MWImageDecodeTask *> *> *lanes;
+@property (assign, atomic, readwrite) NSUInteger runningCount;
+@property (assign, atomic, readwrite) NSUInteger inFlightBytes;
+@property (nonatomic, strong, nonnull) dispatch_semaphore_t lock;
+
+- (void)updateLaneOfTask:(nonnull MWImageDecodeTask *)task;
+- (void)cancelTask:(nonnull MWImageDecodeTask *)task;
+
+@end
+
+@interface MWImageDecodeTask ()
+
+@property (nonatomic, weak, nullable) MWImageDecodeExecutor *executor;
+@property (nonatomic, copy, nullable) dispatch_block_t block;
+@property (nonatomic, strong, nullable) MWImageDecodeTask *dependency;
+@property (nonatomic, assign) MWImageDecodeLane lane;
+@property (assign, nonatomic, readwrite) NSUInteger cost;
+@property (assign, atomic, readwrite, getter=isCancelled) BOOL cancelled;
+@property (assign, atomic, readwrite, getter=isFinished) BOOL finished;
+@property (assign, atomic, getter=isStarted) BOOL started;
+
+@end
+
+@implementation MWImageDecodeTask
+
+@synthesize priority = _priority;
+
+- (MWWebImageOperationPriority)priority {
+    @synchronized (self) {
+        return _priority;
+    }
+}
+
+- (void)setPriority:(MWWebImageOperationPriority)priority {
+    @synchronized (self) {
+        _priority = priority;
+    }
+    [self.executor updateLaneOfTask:self];
+}
+
+- (void)cancel {
+    [self.executor cancelTask:self];
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p lane = %lu, cost = %lu, started = %d, finished = %d>", NSStringFromClass(self.class), self, (unsigned long)self.lane, (unsigned long)self.cost, self.isStarted, self.isFinished];
+}
+
+@end
+
+@implementation MWImageDecodeExecutor
+
++ (MWImageDecodeExecutor *)sharedExecutor {
+    static dispatch_once_t onceToken;
+    static MWImageDecodeExecutor *executor;
+    dispatch_once(&onceToken, ^{
+        executor = [[MWImageDecodeExecutor alloc] init];
+    });
+    return executor;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        NSMutableArray<NSMutableArray<MWImageDecodeTask *> *> *lanes = [NSMutableArray arrayWithCapacity:kMWImageDecodeLaneCount];
+        for (NSUInteger i = 0; i < kMWImageDecodeLaneCount; i++) {
+            [lanes addObject:[NSMutableArray array]];
+        }
+        _lanes = [lanes copy];
+        // Leave a core to the main thread
+        NSUInteger processorCount = NSProcessInfo.processInfo.activeProcessorCount;
+        _maxConcurrentDecodeCount = processorCount > 1 ? processorCount - 1 : 1;
+        _maxInFlightBytes = [MWDeviceHelper totalMemory] / 16;
+        _lock = dispatch_semaphore_create(1);
+    }
+    return self;
+}
+
+- (NSUInteger)pendingCount {
+    NSUInteger count = 0;
+    MW_LOCK(self.lock);
+    for (NSMutableArray<MWImageDecodeTask *> *lane in self.lanes) {
+        count += lane.count;
+    }
+    MW_UNLOCK(self.lock);
+    return count;
+}
+
+- (void)setMaxConcurrentDecodeCount:(NSUInteger)maxConcurrentDecodeCount {
+    @synchronized (self) {
+        _maxConcurrentDecodeCount = MAX(maxConcurrentDecodeCount, 1);
+    }
+    [self schedule];
+}
+
+- (NSUInteger)maxConcurrentDecodeCount {
+    @synchronized (self) {
+        return _maxConcurrentDecodeCount;
+    }
+}
+
+- (void)setMaxInFlightBytes:(NSUInteger)maxInFlightBytes {
+    @synchronized (self) {
+        _maxInFlightBytes = maxInFlightBytes;
+    }
+    [self schedule];
+}
+
+- (NSUInteger)maxInFlightBytes {
+    @synchronized (self) {
+        return _maxInFlightBytes;
+    }
+}
+
+- (MWImageDecodeTask *)addDecodeBlock:(dispatch_block_t)block priority:(MWWebImageOperationPriority)priority cost:(NSUInteger)cost dependency:(MWImageDecodeTask *)dependency {
+    NSParameterAssert(block);
+    MWImageDecodeTask *task = [MWImageDecodeTask new];
+    task.priority = priority;
+    task.executor = self;
+    task.block = block;
+    task.cost = cost;
+    task.dependency = dependency;
+    MW_LOCK(self.lock);
+    task.lane = MWImageDecodeLaneForPriority(priority);
+    [self.lanes[task.lane] addObject:task];
+    MW_UNLOCK(self.lock);
+    [self schedule];
+    return task;
+}
+
+- (void)updateLaneOfTask:(MWImageDecodeTask *)task {
+    MW_LOCK(self.lock);
+    MWImageDecodeLane lane = MWImageDecodeLaneForPriority(task.priority);
+    NSMutableArray<MWImageDecodeTask *> *currentLane = self.lanes[task.lane];
+    if (lane != task.lane && [currentLane containsObject:task]) {
+        [currentLane removeObject:task];
+        [self.lanes[lane] addObject:task];
+    }
+    task.lane = lane;
+    MW_UNLOCK(self.lock);
+    [self schedule];
+}
+
+- (void)cancelTask:(MWImageDecodeTask *)task {
+    MW_LOCK(self.lock);
+    BOOL pending = [self.lanes[task.lane] containsObject:task];
+    if (pending) {
+        [self.lanes[task.lane] removeObject:task];
+        task.block = nil;
+        task.dependency = nil;
+        task.cancelled = YES;
+    }
+    MW_UNLOCK(self.lock);
+    if (pending) {
+        // The decodes depending on it can start
+        [self schedule];
+    }
+}
+
+#pragma mark - Scheduling
+
+// The first admissible task, from the highest lane. Must be called inside the lock
+- (MWImageDecodeTask *)nextTask {
+    NSUInteger maxInFlightBytes = self.maxInFlightBytes;
+    for (NSMutableArray<MWImageDecodeTask *> *lane in self.lanes) {
+        for (MWImageDecodeTask *task in lane) {
+            MWImageDecodeTask *dependency = task.dependency;
+            if (dependency && !dependency.isFinished && !dependency.isCancelled) {
+                continue;
+            }
+            // A decode larger than the limit still runs alone
+            BOOL fits = maxInFlightBytes == 0 || self.runningCount == 0 || self.inFlightBytes + task.cost <= maxInFlightBytes;
+            if (!fits) {
+                // Keep the memory for this one, the smaller decodes behind it should not starve it
+                return nil;
+            }
+            return task;
+        }
+    }
+    return nil;
+}
+
+- (void)schedule {
+    NSMutableArray<MWImageDecodeTask *> *admittedTasks = [NSMutableArray array];
+    MW_LOCK(self.lock);
+    NSUInteger maxConcurrentDecodeCount = self.maxConcurrentDecodeCount;
+    while (self.runningCount < maxConcurrentDecodeCount) {
+        MWImageDecodeTask *task = [self nextTask];
+        if (!task) {
+            break;
+        }
+        [self.lanes[task.lane] removeObject:task];
+        task.dependency = nil;
+        task.started = YES;
+        self.runningCount++;
+        self.inFlightBytes += task.cost;
+        [admittedTasks addObject:task];
+    }
+    MW_UNLOCK(self.lock);
+    for (MWImageDecodeTask *task in admittedTasks) {
+        dispatch_async(dispatch_get_global_queue(MWImageDecodeQualityOfServiceForLane(task.lane), 0), ^{
+            @autoreleasepool {
+                task.block();
+            }
+            [self finishTask:task];
+        });
+    }
+}
+
+- (void)finishTask:(MWImageDecodeTask *)task {
+    MW_LOCK(self.lock);
+    task.block = nil;
+    task.finished = YES;
+    self.runningCount--;
+    self.inFlightBytes -= task.cost;
+    MW_UNLOCK(self.lock);
+    [self schedule];
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p running = %lu, pending = %lu, inFlightBytes = %lu>", NSStringFromClass(self.class), self, (unsigned long)self.runningCount, (unsigned long)self.pendingCount, (unsigned long)self.inFlightBytes];
+}
+
+@end
@@ -14,6 +14,7 @@
  @note `MWImageIOCoder` supports GIF but only as static (will use the 1st frame).
  @note Use `MWImageGIFCoder` for fully animated GIFs. For `UIImageView`, it will produce animated `UIImage`(`NSImage` on macOS) for rendering. For `MWAnimatedImageView`, it will use `MWAnimatedImage` for rendering.
  @note The recommended approach for animated GIFs is using `MWAnimatedImage` with `MWAnimatedImageView`. It's more performant than `UIImageView` for GIF displaying(especially on memory usage)
+ @note For `MWAnimatedImage`, the frames are decoded by a native decoder which keeps the composited canvas, so the next frame only costs its own pixels, and a dropped frame is replayed from the nearest keyframe. Image/IO is used when the GIF can't be scanned.
  */
 @interface MWImageGIFCoder : MWImageIOAnimatedCoder <MWProgressiveImageCoder, MWAnimatedImageCoder>
 
@@ -7,13 +7,25 @@
  */
 
 #import "MWImageGIFCoder.h"
+#import "MWImageGIFDecoder.h"
+#import "MWImageCoderHelper.h"
+#import "UIImage+Metadata.h"
+#import "UIImage+ForceDecode.h"
+#import "NSImage+Compatibility.h"
 #if MW_MAC
 #import <CoreServices/CoreServices.h>
 #else
 #import <MobileCoreServices/MobileCoreServices.h>
 #endif
 
-@implementation MWImageGIFCoder
+@implementation MWImageGIFCoder {
+    // The native decoder of the animation frames, nil for the Image/IO frames
+    MWImageGIFDecoder *_frameDecoder;
+    NSData *_frameData;
+    CGFloat _frameScale;
+    CGSize _frameThumbnailSize;
+    BOOL _framePreserveAspectRatio;
+}
 
 + (instancetype)sharedCoder {
     static MWImageGIFCoder *coder;
@@ -24,6 +36,109 @@
     return coder;
 }
 
+#pragma mark - MWAnimatedImageCoder
+
+- (nullable instancetype)initWithAnimatedImageData:(nullable NSData *)data options:(nullable MWImageCoderOptions *)options {
+    if (!data) {
+        return nil;
+    }
+    MWImageGIFDecoder *frameDecoder = [[MWImageGIFDecoder alloc] initWithData:data];
+    if (!frameDecoder) {
+        return [super initWithAnimatedImageData:data options:options];
+    }
+    self = [super init];
+    if (self) {
+        _frameDecoder = frameDecoder;
+        CGFloat scale = 1;
+        NSNumber *scaleFactor = options[MWImageCoderDecodeScaleFactor];
+        if (scaleFactor != nil) {
+            scale = MAX([scaleFactor doubleValue], 1);
+        }
+        _frameScale = scale;
+        CGSize thumbnailSize = CGSizeZero;
+        NSValue *thumbnailSizeValue = options[MWImageCoderDecodeThumbnailPixelSize];
+        if (thumbnailSizeValue != nil) {
+#if MW_MAC
+            thumbnailSize = thumbnailSizeValue.sizeValue;
+#else
+            thumbnailSize = thumbnailSizeValue.CGSizeValue;
+#endif
+        }
+        _frameThumbnailSize = thumbnailSize;
+        BOOL preserveAspectRatio = YES;
+        NSNumber *preserveAspectRatioValue = options[MWImageCoderDecodePreserveAspectRatio];
+        if (preserveAspectRatioValue != nil) {
+            preserveAspectRatio = preserveAspectRatioValue.boolValue;
+        }
+        _framePreserveAspectRatio = preserveAspectRatio;
+        _frameData = data;
+    }
+    return self;
+}
+
+- (NSData *)animatedImageData {
+    if (!_frameDecoder) {
+        return [super animatedImageData];
+    }
+    return _frameData;
+}
+
+- (NSUInteger)animatedImageLoopCount {
+    if (!_frameDecoder) {
+        return [super animatedImageLoopCount];
+    }
+    return _frameDecoder.loopCount;
+}
+
+- (NSUInteger)animatedImageFrameCount {
+    if (!_frameDecoder) {
+        return [super animatedImageFrameCount];
+    }
+    return _frameDecoder.frameCount;
+}
+
+- (NSTimeInterval)animatedImageDurationAtIndex:(NSUInteger)index {
+    if (!_frameDecoder) {
+        return [super animatedImageDurationAtIndex:index];
+    }
+    return [_frameDecoder durationAtIndex:index];
+}
+
+- (UIImage *)animatedImageFrameAtIndex:(NSUInteger)index {
+    if (!_frameDecoder) {
+        return [super animatedImageFrameAtIndex:index];
+    }
+    CGImageRef imageRef = [_frameDecoder createFrameAtIndex:index];
+    if (!imageRef) {
+        return nil;
+    }
+    // Same thumbnail size as `MWImageIOAnimatedCoder`
+    CGSize canvasSize = _frameDecoder.canvasSize;
+    CGSize thumbnailSize = _frameThumbnailSize;
+    if (thumbnailSize.width > 0 && thumbnailSize.height > 0 && (canvasSize.width > thumbnailSize.width || canvasSize.height > thumbnailSize.height)) {
+        CGSize scaledSize = thumbnailSize;
+        if (_framePreserveAspectRatio) {
+            CGFloat ratio = MIN(thumbnailSize.width / canvasSize.width, thumbnailSize.height / canvasSize.height);
+            scaledSize = CGSizeMake(MAX(round(canvasSize.width * ratio), 1), MAX(round(canvasSize.height * ratio), 1));
+        }
+        CGImageRef scaledImageRef = [MWImageCoderHelper CGImageCreateScaled:imageRef size:scaledSize];
+        CGImageRelease(imageRef);
+        imageRef = scaledImageRef;
+        if (!imageRef) {
+            return nil;
+        }
+    }
+#if MW_UIKIT || MW_WATCH
+    UIImage *image = [[UIImage alloc] initWithCGImage:imageRef scale:_frameScale orientation:UIImageOrientationUp];
+#else
+    UIImage *image = [[UIImage alloc] initWithCGImage:imageRef scale:_frameScale orientation:kCGImagePropertyOrientationUp];
+#endif
+    CGImageRelease(imageRef);
+    image.MW_imageFormat = MWImageFormatGIF;
+    image.MW_iMWecoded = YES;
+    return image;
+}
+
 #pragma mark - Subclass Override
 
 + (MWImageFormat)imageFormat {
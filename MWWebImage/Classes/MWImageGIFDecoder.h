@@ -0,0 +1,49 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "MWWebImageCompat.h"
+
+/**
+ A native GIF decoder for the animation playback of `MWImageGIFCoder`, without Image/IO.
+ It keeps the composited canvas of the last frame, so the next frame only decodes its own LZW data and applies the disposal method of the previous frame. The frames which do not depend on the previous ones (a full canvas opaque frame, or a frame after a full canvas cleared by its disposal) are indexed as keyframes when the data is scanned, a random access replays from the nearest keyframe before it.
+ @note All methods are thread-safe, the frames are decoded one at a time.
+ */
+@interface MWImageGIFDecoder : NSObject
+
+/// The canvas pixel size, from the logical screen descriptor
+@property (nonatomic, assign, readonly) CGSize canvasSize;
+/// The frame count
+@property (nonatomic, assign, readonly) NSUInteger frameCount;
+/// The loop count of the Netscape application extension, 0 means infinite. 1 if there is none, like Image/IO
+@property (nonatomic, assign, readonly) NSUInteger loopCount;
+/// The indexes of the frames which decode without the previous frames
+@property (nonatomic, copy, readonly, nonnull) NSIndexSet *keyframeIndexes;
+
+/**
+ Scan the frames of the GIF data, without decoding them.
+
+ @param data The complete GIF data, kept by the decoder
+ @return The decoder, or nil if the data is not a GIF, is corrupted or has no frame
+ */
+- (nullable instancetype)initWithData:(nonnull NSData *)data NS_DESIGNATED_INITIALIZER;
+- (nonnull instancetype)init NS_UNAVAILABLE;
+
+/// The duration of a frame in seconds, clamped like Image/IO
+- (NSTimeInterval)durationAtIndex:(NSUInteger)index;
+
+/**
+ Create the composited canvas at a frame, in the premultiplied BGRA layout of `CGImageCreateDecoded`.
+ The frame after the last one decoded costs its own pixels only, any other frame is replayed from the nearest keyframe.
+
+ @param index The frame index
+ @return The image of the canvas size, or nil if the index is out of bounds or the frame data is corrupted
+ */
+- (nullable CGImageRef)createFrameAtIndex:(NSUInteger)index CF_RETURNS_RETAINED;
+
+@end
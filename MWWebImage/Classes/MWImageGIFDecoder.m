@@ -0,0 +1,522 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "MWImageGIFDecoder.h"
+#import "MWImageCoderHelper.h"
+#import "MWInternalMacros.h"
+
+// Larger canvases are left to Image/IO
+static const NSUInteger kMWGIFMaxCanvasPixels = 1 << 26;
+#define kMWGIFMaxLZWCodes 4096
+
+typedef NS_ENUM(uint8_t, MWGIFDisposal) {
+    MWGIFDisposalNone = 0,
+    MWGIFDisposalKeep = 1,
+    MWGIFDisposalBackground = 2,
+    MWGIFDisposalPrevious = 3,
+};
+
+typedef struct {
+    uint16_t left, top, width, height;
+    BOOL interlaced;
+    size_t colorTableOffset; // 0 for none
+    uint16_t colorCount;
+    int16_t transparentIndex; // -1 for none
+    MWGIFDisposal disposal;
+    uint16_t delay; // 1/100 second
+    uint8_t minCodeSize;
+    size_t dataOffset; // the first data sub-block
+} MWGIFFrameInfo;
+
+static inline uint16_t MWGIFReadLE16(const uint8_t *bytes) {
+    return (uint16_t)bytes[0] | (uint16_t)bytes[1] << 8;
+}
+
+// Skip the data sub-blocks from `offset`, returns the offset after the block terminator, or 0 if truncated
+static size_t MWGIFSkipSubBlocks(const uint8_t *bytes, size_t length, size_t offset) {
+    while (offset < length) {
+        uint8_t blockSize = bytes[offset];
+        offset += 1 + blockSize;
+        if (blockSize == 0) {
+            return offset;
+        }
+    }
+    return 0;
+}
+
+static BOOL MWGIFFrameCoversCanvas(const MWGIFFrameInfo *frame, size_t canvasWidth, size_t canvasHeight) {
+    return frame->left == 0 && frame->top == 0 && frame->width >= canvasWidth && frame->height >= canvasHeight;
+}
+
+static void MWGIFReleaseBitmapData(void *info, const void *data, size_t size) {
+    free((void *)data);
+}
+
+@interface MWImageGIFDecoder ()
+
+@property (nonatomic, assign, readwrite) CGSize canvasSize;
+@property (nonatomic, assign, readwrite) NSUInteger frameCount;
+@property (nonatomic, assign, readwrite) NSUInteger loopCount;
+@property (nonatomic, copy, readwrite, nonnull) NSIndexSet *keyframeIndexes;
+
+@end
+
+@implementation MWImageGIFDecoder {
+    NSData *_data;
+    MWGIFFrameInfo *_frames;
+    size_t _canvasWidth;
+    size_t _canvasHeight;
+    // The composited canvas of `_currentIndex`, premultiplied ARGB host words
+    uint32_t *_canvas;
+    NSUInteger _currentIndex;
+    // The canvas under the current frame, when its disposal restores the previous canvas
+    uint32_t *_previousRegion;
+    // The decoding buffers, reused by all the frames
+    uint8_t *_colorIndexes;
+    size_t _colorIndexesCapacity;
+    uint16_t _prefix[kMWGIFMaxLZWCodes];
+    uint8_t _suffix[kMWGIFMaxLZWCodes];
+    uint8_t _stack[kMWGIFMaxLZWCodes + 1];
+    dispatch_semaphore_t _lock;
+}
+
+- (void)dealloc {
+    free(_frames);
+    free(_canvas);
+    free(_previousRegion);
+    free(_colorIndexes);
+}
+
+- (instancetype)initWithData:(NSData *)data {
+    self = [super init];
+    if (self) {
+        _data = [data copy];
+        if (![self scanFrames]) {
+            return nil;
+        }
+        _currentIndex = NSNotFound;
+        _lock = dispatch_semaphore_create(1);
+    }
+    return self;
+}
+
+#pragma mark - Scanning
+
+- (BOOL)scanFrames {
+    const uint8_t *bytes = _data.bytes;
+    size_t length = _data.length;
+    if (length < 13 || (memcmp(bytes, "GIF87a", 6) != 0 && memcmp(bytes, "GIF89a", 6) != 0)) {
+        return NO;
+    }
+    _canvasWidth = MWGIFReadLE16(bytes + 6);
+    _canvasHeight = MWGIFReadLE16(bytes + 8);
+    if (_canvasWidth == 0 || _canvasHeight == 0 || _canvasWidth * _canvasHeight > kMWGIFMaxCanvasPixels) {
+        return NO;
+    }
+    uint8_t screenFlags = bytes[10];
+    size_t offset = 13;
+    size_t globalColorTableOffset = 0;
+    uint16_t globalColorCount = 0;
+    if (screenFlags & 0x80) {
+        globalColorCount = 1 << ((screenFlags & 0x07) + 1);
+        globalColorTableOffset = offset;
+        offset += globalColorCount * 3;
+    }
+
+    NSUInteger loopCount = 1;
+    NSMutableData *frames = [NSMutableData data];
+    // The graphic control extension applies to the next image
+    MWGIFFrameInfo control = {.transparentIndex = -1};
+    while (offset < length) {
+        uint8_t introducer = bytes[offset];
+        if (introducer == 0x3B) {
+            // Trailer
+            break;
+        } else if (introducer == 0x21) {
+            if (offset + 2 > length) {
+                break;
+            }
+            uint8_t label = bytes[offset + 1];
+            size_t blockOffset = offset + 2;
+            if (label == 0xF9 && blockOffset + 6 <= length && bytes[blockOffset] == 4) {
+                uint8_t flags = bytes[blockOffset + 1];
+                control.disposal = (flags >> 2) & 0x07;
+                control.delay = MWGIFReadLE16(bytes + blockOffset + 2);
+                control.transparentIndex = (flags & 0x01) ? bytes[blockOffset + 4] : -1;
+            } else if (label == 0xFF && blockOffset + 16 <= length && bytes[blockOffset] == 11 && memcmp(bytes + blockOffset + 1, "NETSCAPE2.0", 11) == 0 && bytes[blockOffset + 12] == 3 && bytes[blockOffset + 13] == 1) {
+                loopCount = MWGIFReadLE16(bytes + blockOffset + 14);
+            }
+            offset = MWGIFSkipSubBlocks(bytes, length, blockOffset);
+            if (offset == 0) {
+                break;
+            }
+        } else if (introducer == 0x2C) {
+            if (offset + 10 > length) {
+                break;
+            }
+            MWGIFFrameInfo frame = control;
+            frame.left = MWGIFReadLE16(bytes + offset + 1);
+            frame.top = MWGIFReadLE16(bytes + offset + 3);
+            frame.width = MWGIFReadLE16(bytes + offset + 5);
+            frame.height = MWGIFReadLE16(bytes + offset + 7);
+            uint8_t imageFlags = bytes[offset + 9];
+            frame.interlaced = (imageFlags & 0x40) != 0;
+            offset += 10;
+            if (imageFlags & 0x80) {
+                frame.colorCount = 1 << ((imageFlags & 0x07) + 1);
+                frame.colorTableOffset = offset;
+                offset += frame.colorCount * 3;
+            } else {
+                frame.colorCount = globalColorCount;
+                frame.colorTableOffset = globalColorTableOffset;
+            }
+            if (offset + 1 > length) {
+                break;
+            }
+            frame.minCodeSize = bytes[offset];
+            frame.dataOffset = offset + 1;
+            offset = MWGIFSkipSubBlocks(bytes, length, frame.dataOffset);
+            if (offset == 0) {
+                // A truncated last frame
+                break;
+            }
+            if ((size_t)frame.width * frame.height > kMWGIFMaxCanvasPixels) {
+                // The color indexes of a frame are decoded before they are clipped to the canvas, left to Image/IO like a large canvas
+                return NO;
+            }
+            if (frame.minCodeSize >= 2 && frame.minCodeSize <= 8 && frame.width > 0 && frame.height > 0 && frame.colorTableOffset != 0) {
+                [frames appendBytes:&frame length:sizeof(frame)];
+            }
+            control = (MWGIFFrameInfo){.transparentIndex = -1};
+        } else {
+            // Corrupted, keep the frames so far
+            break;
+        }
+    }
+
+    NSUInteger frameCount = frames.length / sizeof(MWGIFFrameInfo);
+    if (frameCount == 0) {
+        return NO;
+    }
+    _frames = malloc(frames.length);
+    if (!_frames) {
+        return NO;
+    }
+    memcpy(_frames, frames.bytes, frames.length);
+
+    NSMutableIndexSet *keyframeIndexes = [NSMutableIndexSet indexSet];
+    for (NSUInteger i = 0; i < frameCount; i++) {
+        if ([self isKeyframeAtIndex:i]) {
+            [keyframeIndexes addIndex:i];
+        }
+    }
+    self.canvasSize = CGSizeMake(_canvasWidth, _canvasHeight);
+    self.frameCount = frameCount;
+    self.loopCount = loopCount;
+    self.keyframeIndexes = keyframeIndexes;
+    return YES;
+}
+
+- (BOOL)isKeyframeAtIndex:(NSUInteger)index {
+    if (index == 0) {
+        return YES;
+    }
+    const MWGIFFrameInfo *frame = &_frames[index];
+    if (MWGIFFrameCoversCanvas(frame, _canvasWidth, _canvasHeight) && frame->transparentIndex < 0 && frame->disposal != MWGIFDisposalPrevious) {
+        // Draws every pixel, and is not undone to the canvas under it
+        return YES;
+    }
+    const MWGIFFrameInfo *previousFrame = &_frames[index - 1];
+    if (previousFrame->disposal == MWGIFDisposalBackground && MWGIFFrameCoversCanvas(previousFrame, _canvasWidth, _canvasHeight)) {
+        // Starts from a cleared canvas
+        return YES;
+    }
+    return NO;
+}
+
+- (NSTimeInterval)durationAtIndex:(NSUInteger)index {
+    if (index >= self.frameCount) {
+        return 0;
+    }
+    NSTimeInterval duration = _frames[index].delay / 100.0;
+    // Same as `MWImageIOAnimatedCoder`, after Firefox
+    if (duration < 0.011) {
+        duration = 0.1;
+    }
+    return duration;
+}
+
+#pragma mark - Decoding
+
+- (CGImageRef)createFrameAtIndex:(NSUInteger)index {
+    if (index >= self.frameCount) {
+        return NULL;
+    }
+    MW_LOCK(_lock);
+    CGImageRef imageRef = NULL;
+    if ([self compositeFrameAtIndex:index]) {
+        imageRef = [self createImageFromCanvas];
+    }
+    MW_UNLOCK(_lock);
+    return imageRef;
+}
+
+// Brings the canvas to the frame. Must be called inside the lock
+- (BOOL)compositeFrameAtIndex:(NSUInteger)index {
+    if (index == _currentIndex) {
+        return YES;
+    }
+    size_t canvasLength = _canvasWidth * _canvasHeight * 4;
+    if (!_canvas) {
+        _canvas = malloc(canvasLength);
+        _previousRegion = malloc(canvasLength);
+        if (!_canvas || !_previousRegion) {
+            return NO;
+        }
+    }
+    NSUInteger keyframeIndex = [self.keyframeIndexes indexLessThanOrEqualToIndex:index];
+    NSUInteger nextIndex;
+    if (_currentIndex != NSNotFound && _currentIndex < index && _currentIndex >= keyframeIndex) {
+        // Only the frames after the current one, usually just the next
+        [self disposeFrameAtIndex:_currentIndex];
+        nextIndex = _currentIndex + 1;
+    } else {
+        memset(_canvas, 0, canvasLength);
+        nextIndex = keyframeIndex;
+    }
+    for (NSUInteger i = nextIndex; i <= index; i++) {
+        if (i > nextIndex) {
+            [self disposeFrameAtIndex:i - 1];
+        }
+        if (![self drawFrameAtIndex:i]) {
+            _currentIndex = NSNotFound;
+            return NO;
+        }
+        _currentIndex = i;
+    }
+    return YES;
+}
+
+// The canvas rect of a frame, clipped
+- (void)getRectOfFrame:(const MWGIFFrameInfo *)frame x:(size_t *)x y:(size_t *)y width:(size_t *)width height:(size_t *)height {
+    *x = MIN(frame->left, _canvasWidth);
+    *y = MIN(frame->top, _canvasHeight);
+    *width = MIN((size_t)frame->width, _canvasWidth - *x);
+    *height = MIN((size_t)frame->height, _canvasHeight - *y);
+}
+
+- (void)disposeFrameAtIndex:(NSUInteger)index {
+    const MWGIFFrameInfo *frame = &_frames[index];
+    size_t x, y, width, height;
+    [self getRectOfFrame:frame x:&x y:&y width:&width height:&height];
+    if (frame->disposal == MWGIFDisposalBackground) {
+        // Cleared to transparent, like the browsers, not to the background color
+        for (size_t row = 0; row < height; row++) {
+            memset(_canvas + (y + row) * _canvasWidth + x, 0, width * 4);
+        }
+    } else if (frame->disposal == MWGIFDisposalPrevious) {
+        for (size_t row = 0; row < height; row++) {
+            memcpy(_canvas + (y + row) * _canvasWidth + x, _previousRegion + row * width, width * 4);
+        }
+    }
+}
+
+- (BOOL)drawFrameAtIndex:(NSUInteger)index {
+    const MWGIFFrameInfo *frame = &_frames[index];
+    size_t x, y, width, height;
+    [self getRectOfFrame:frame x:&x y:&y width:&width height:&height];
+    // The rows below the canvas are not decoded, unless interlaced where they are mixed with the visible ones
+    size_t pixelCount = (size_t)frame->width * (frame->interlaced ? frame->height : height);
+    if (pixelCount == 0) {
+        return YES;
+    }
+    if (_colorIndexesCapacity < pixelCount) {
+        free(_colorIndexes);
+        _colorIndexes = malloc(pixelCount);
+        _colorIndexesCapacity = _colorIndexes ? pixelCount : 0;
+        if (!_colorIndexes) {
+            return NO;
+        }
+    }
+    if (![self decodeColorIndexesOfFrame:frame pixelCount:pixelCount]) {
+        return NO;
+    }
+
+    if (frame->disposal == MWGIFDisposalPrevious) {
+        for (size_t row = 0; row < height; row++) {
+            memcpy(_previousRegion + row * width, _canvas + (y + row) * _canvasWidth + x, width * 4);
+        }
+    }
+
+    // The premultiplied colors, the missing entries are opaque black
+    uint32_t colors[256];
+    const uint8_t *colorTable = (const uint8_t *)_data.bytes + frame->colorTableOffset;
+    for (size_t i = 0; i < 256; i++) {
+        colors[i] = i < frame->colorCount ? (0xFF000000 | (uint32_t)colorTable[i * 3] << 16 | (uint32_t)colorTable[i * 3 + 1] << 8 | colorTable[i * 3 + 2]) : 0xFF000000;
+    }
+    int transparentIndex = frame->transparentIndex;
+    // The interlaced rows are stored every 8th from 0, every 8th from 4, every 4th from 2, then every 2nd from 1
+    static const size_t interlaceStarts[4] = {0, 4, 2, 1};
+    static const size_t interlaceSteps[4] = {8, 8, 4, 2};
+    size_t passCount = frame->interlaced ? 4 : 1;
+    size_t sourceRow = 0;
+    for (size_t pass = 0; pass < passCount; pass++) {
+        size_t start = frame->interlaced ? interlaceStarts[pass] : 0;
+        size_t step = frame->interlaced ? interlaceSteps[pass] : 1;
+        for (size_t row = start; row < frame->height; row += step, sourceRow++) {
+            if (row >= height) {
+                continue;
+            }
+            const uint8_t *colorIndexes = _colorIndexes + sourceRow * frame->width;
+            uint32_t *pixels = _canvas + (y + row) * _canvasWidth + x;
+            if (transparentIndex < 0) {
+                for (size_t column = 0; column < width; column++) {
+                    pixels[column] = colors[colorIndexes[column]];
+                }
+            } else {
+                for (size_t column = 0; column < width; column++) {
+                    uint8_t colorIndex = colorIndexes[column];
+                    if (colorIndex != transparentIndex) {
+                        pixels[column] = colors[colorIndex];
+                    }
+                }
+            }
+        }
+    }
+    return YES;
+}
+
+// LZW with variable code sizes from `minCodeSize + 1` to 12 bits, packed LSB first into the data sub-blocks. A frame with less data than its pixels is padded with the transparent or first color index
+- (BOOL)decodeColorIndexesOfFrame:(const MWGIFFrameInfo *)frame pixelCount:(size_t)pixelCount {
+    const uint8_t *bytes = _data.bytes;
+    size_t length = _data.length;
+    size_t offset = frame->dataOffset;
+    size_t blockEnd = offset;
+
+    uint32_t clearCode = 1 << frame->minCodeSize;
+    uint32_t endCode = clearCode + 1;
+    uint32_t codeSize = frame->minCodeSize + 1;
+    uint32_t nextCode = clearCode + 2;
+    int32_t previousCode = -1;
+    uint8_t firstByte = 0;
+    for (uint32_t i = 0; i < clearCode; i++) {
+        _prefix[i] = 0;
+        _suffix[i] = (uint8_t)i;
+    }
+
+    uint32_t bitBuffer = 0;
+    uint32_t bitCount = 0;
+    size_t written = 0;
+    BOOL ended = NO;
+    while (written < pixelCount && !ended) {
+        // Fill the bits of the next code
+        while (bitCount < codeSize) {
+            if (offset == blockEnd) {
+                if (offset >= length || bytes[offset] == 0) {
+                    ended = YES;
+                    break;
+                }
+                blockEnd = offset + 1 + bytes[offset];
+                offset++;
+                if (blockEnd > length) {
+                    blockEnd = length;
+                }
+                continue;
+            }
+            bitBuffer |= (uint32_t)bytes[offset++] << bitCount;
+            bitCount += 8;
+        }
+        if (ended) {
+            break;
+        }
+        uint32_t code = bitBuffer & ((1 << codeSize) - 1);
+        bitBuffer >>= codeSize;
+        bitCount -= codeSize;
+
+        if (code == clearCode) {
+            codeSize = frame->minCodeSize + 1;
+            nextCode = clearCode + 2;
+            previousCode = -1;
+            continue;
+        }
+        if (code == endCode) {
+            break;
+        }
+        if (previousCode < 0) {
+            if (code >= clearCode) {
+                return NO;
+            }
+            _colorIndexes[written++] = (uint8_t)code;
+            previousCode = code;
+            firstByte = (uint8_t)code;
+            continue;
+        }
+
+        uint32_t inputCode = code;
+        size_t stackSize = 0;
+        if (code >= nextCode) {
+            if (code > nextCode) {
+                return NO;
+            }
+            // The code being defined, the previous string and its first byte
+            _stack[stackSize++] = firstByte;
+            code = previousCode;
+        }
+        while (code >= clearCode) {
+            _stack[stackSize++] = _suffix[code];
+            code = _prefix[code];
+        }
+        firstByte = _suffix[code];
+        _stack[stackSize++] = firstByte;
+
+        if (nextCode < kMWGIFMaxLZWCodes) {
+            _prefix[nextCode] = (uint16_t)previousCode;
+            _suffix[nextCode] = firstByte;
+            nextCode++;
+            if (nextCode == (1u << codeSize) && codeSize < 12) {
+                codeSize++;
+            }
+        }
+        previousCode = inputCode;
+
+        while (stackSize > 0 && written < pixelCount) {
+            _colorIndexes[written++] = _stack[--stackSize];
+        }
+    }
+    if (written < pixelCount) {
+        uint8_t padding = frame->transparentIndex >= 0 ? (uint8_t)frame->transparentIndex : 0;
+        memset(_colorIndexes + written, padding, pixelCount - written);
+    }
+    return YES;
+}
+
+// A copy of the canvas, which keeps changing
+- (CGImageRef)createImageFromCanvas CF_RETURNS_RETAINED {
+    size_t bytesPerRow = _canvasWidth * 4;
+    size_t length = bytesPerRow * _canvasHeight;
+    void *buffer = malloc(length);
+    if (!buffer) {
+        return NULL;
+    }
+    memcpy(buffer, _canvas, length);
+    CGDataProviderRef provider = CGDataProviderCreateWithData(NULL, buffer, length, MWGIFReleaseBitmapData);
+    if (!provider) {
+        free(buffer);
+        return NULL;
+    }
+    CGBitmapInfo bitmapInfo = kCGBitmapByteOrder32Host | kCGImageAlphaPremultipliedFirst;
+    CGImageRef imageRef = CGImageCreate(_canvasWidth, _canvasHeight, 8, 32, bytesPerRow, [MWImageCoderHelper colorSpaceGetDeviceRGB], bitmapInfo, provider, NULL, NO, kCGRenderingIntentDefault);
+    CGDataProviderRelease(provider);
+    return imageRef;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p canvasSize = %lux%lu, frameCount = %lu, keyframeCount = %lu>", NSStringFromClass(self.class), self, (unsigned long)_canvasWidth, (unsigned long)_canvasHeight, (unsigned long)self.frameCount, (unsigned long)self.keyframeIndexes.count];
+}
+
+@end
@@ -0,0 +1,42 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "MWWebImageCompat.h"
+#import "NMWata+ImageContentType.h"
+
+/// The result of parsing the first bytes of an image
+typedef NS_ENUM(NSInteger, MWImageHeaderParseStatus) {
+    /// The header is incomplete, parse again with more bytes
+    MWImageHeaderParseStatusNeedMoreData = 0,
+    /// The format and the pixel size are known
+    MWImageHeaderParseStatusSuccess,
+    /// The format is not supported, the data is corrupted, or the size is not near the start (such as a HEIF with the `meta` box after the `mdat` box)
+    MWImageHeaderParseStatusUnsupported,
+};
+
+/// The bytes after which the parser gives up, since a header is not expected past this. 256KB
+FOUNDATION_EXPORT const NSUInteger MWImageHeaderParserMaxHeaderLength;
+
+/**
+ A lightweight parser of the image headers, which reads the format and the pixel size from the first bytes of a JPEG, PNG, GIF, WebP, HEIF or AVIF image, without decoding and without ImageIO.
+ The downloader uses it on the first chunks of a download, see `MWWebImageDownloaderConfig.maxImagePixelCount`.
+ */
+@interface MWImageHeaderParser : NSObject
+
+/**
+ Parse the header of an image.
+
+ @param data The first bytes of the image, or the whole image
+ @param format Set to the image format on success
+ @param pixelSize Set to the pixel size on success. This is the stored size, before the EXIF orientation. For HEIF and AVIF, the largest image spatial extent
+ @return The parse status
+ */
++ (MWImageHeaderParseStatus)parseHeaderWithData:(nonnull NSData *)data format:(nullable MWImageFormat *)format pixelSize:(nullable CGSize *)pixelSize;
+
+@end
@@ -0,0 +1,302 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "MWImageHeaderParser.h"
+
+const NSUInteger MWImageHeaderParserMaxHeaderLength = 256 * 1024;
+
+static inline uint32_t MWReadBE16(const uint8_t *p) { return ((uint32_t)p[0] << 8) | p[1]; }
+static inline uint32_t MWReadBE32(const uint8_t *p) { return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]; }
+static inline uint64_t MWReadBE64(const uint8_t *p) { return ((uint64_t)MWReadBE32(p) << 32) | MWReadBE32(p + 4); }
+static inline uint32_t MWReadLE16(const uint8_t *p) { return p[0] | ((uint32_t)p[1] << 8); }
+static inline uint32_t MWReadLE24(const uint8_t *p) { return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16); }
+static inline uint32_t MWReadLE32(const uint8_t *p) { return MWReadLE24(p) | ((uint32_t)p[3] << 24); }
+
+// Whether the bytes start with the signature. `prefix` is set if the bytes are a prefix of the signature
+static BOOL MWHasSignature(const uint8_t *bytes, size_t length, const char *signature, size_t signatureLength, BOOL *prefix) {
+    size_t compared = MIN(length, signatureLength);
+    if (memcmp(bytes, signature, compared) != 0) {
+        return NO;
+    }
+    if (compared < signatureLength) {
+        *prefix = YES;
+        return NO;
+    }
+    return YES;
+}
+
+#pragma mark - Formats
+
+static MWImageHeaderParseStatus MWParsePNG(const uint8_t *bytes, size_t length, uint32_t *width, uint32_t *height) {
+    // Signature, then the IHDR chunk which must come first
+    if (length < 24) {
+        return MWImageHeaderParseStatusNeedMoreData;
+    }
+    if (memcmp(bytes + 12, "IHDR", 4) != 0) {
+        return MWImageHeaderParseStatusUnsupported;
+    }
+    *width = MWReadBE32(bytes + 16);
+    *height = MWReadBE32(bytes + 20);
+    return MWImageHeaderParseStatusSuccess;
+}
+
+static MWImageHeaderParseStatus MWParseGIF(const uint8_t *bytes, size_t length, uint32_t *width, uint32_t *height) {
+    // The logical screen descriptor follows the signature
+    if (length < 10) {
+        return MWImageHeaderParseStatusNeedMoreData;
+    }
+    *width = MWReadLE16(bytes + 6);
+    *height = MWReadLE16(bytes + 8);
+    return MWImageHeaderParseStatusSuccess;
+}
+
+static MWImageHeaderParseStatus MWParseJPEG(const uint8_t *bytes, size_t length, uint32_t *width, uint32_t *height) {
+    size_t offset = 2;
+    while (YES) {
+        if (offset >= length) {
+            return MWImageHeaderParseStatusNeedMoreData;
+        }
+        if (bytes[offset] != 0xFF) {
+            return MWImageHeaderParseStatusUnsupported;
+        }
+        // Markers can be padded with any number of 0xFF
+        while (offset < length && bytes[offset] == 0xFF) {
+            offset++;
+        }
+        if (offset >= length) {
+            return MWImageHeaderParseStatusNeedMoreData;
+        }
+        uint8_t marker = bytes[offset++];
+        if (marker == 0x01 || marker == 0xD8 || (marker >= 0xD0 && marker <= 0xD7)) {
+            // Standalone markers
+            continue;
+        }
+        if (marker == 0xD9 || marker == 0xDA) {
+            // End of image or start of scan before any frame header
+            return MWImageHeaderParseStatusUnsupported;
+        }
+        if (offset + 2 > length) {
+            return MWImageHeaderParseStatusNeedMoreData;
+        }
+        uint32_t segmentLength = MWReadBE16(bytes + offset);
+        if (segmentLength < 2) {
+            return MWImageHeaderParseStatusUnsupported;
+        }
+        // SOF0-SOF15, except DHT (C4), JPG (C8) and DAC (CC)
+        BOOL isFrameHeader = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+        if (isFrameHeader) {
+            // Length, precision, height, width
+            if (offset + 7 > length) {
+                return MWImageHeaderParseStatusNeedMoreData;
+            }
+            *height = MWReadBE16(bytes + offset + 3);
+            *width = MWReadBE16(bytes + offset + 5);
+            return MWImageHeaderParseStatusSuccess;
+        }
+        offset += segmentLength;
+    }
+}
+
+static MWImageHeaderParseStatus MWParseWebP(const uint8_t *bytes, size_t length, uint32_t *width, uint32_t *height) {
+    if (length < 30) {
+        return MWImageHeaderParseStatusNeedMoreData;
+    }
+    const uint8_t *chunk = bytes + 12;
+    if (memcmp(chunk, "VP8 ", 4) == 0) {
+        // Lossy: frame tag, start code, then 14 bits dimensions
+        if (bytes[23] != 0x9D || bytes[24] != 0x01 || bytes[25] != 0x2A) {
+            return MWImageHeaderParseStatusUnsupported;
+        }
+        *width = MWReadLE16(bytes + 26) & 0x3FFF;
+        *height = MWReadLE16(bytes + 28) & 0x3FFF;
+    } else if (memcmp(chunk, "VP8L", 4) == 0) {
+        // Lossless: signature, then 14 bits dimensions minus one
+        if (bytes[20] != 0x2F) {
+            return MWImageHeaderParseStatusUnsupported;
+        }
+        uint32_t bits = MWReadLE32(bytes + 21);
+        *width = (bits & 0x3FFF) + 1;
+        *height = ((bits >> 14) & 0x3FFF) + 1;
+    } else if (memcmp(chunk, "VP8X", 4) == 0) {
+        // Extended: flags, then 24 bits canvas dimensions minus one
+        *width = MWReadLE24(bytes + 24) + 1;
+        *height = MWReadLE24(bytes + 27) + 1;
+    } else {
+        return MWImageHeaderParseStatusUnsupported;
+    }
+    return MWImageHeaderParseStatusSuccess;
+}
+
+// Find a box in [start, end). Returns NeedMoreData if the box list is cut before finding it or before its end
+static MWImageHeaderParseStatus MWFindBox(const uint8_t *bytes, size_t length, size_t start, size_t end, const char *type, size_t *contentStart, size_t *boxEnd) {
+    size_t offset = start;
+    while (offset < end) {
+        if (offset + 8 > length) {
+            return MWImageHeaderParseStatusNeedMoreData;
+        }
+        uint64_t size = MWReadBE32(bytes + offset);
+        size_t headerSize = 8;
+        if (size == 1) {
+            if (offset + 16 > length) {
+                return MWImageHeaderParseStatusNeedMoreData;
+            }
+            size = MWReadBE64(bytes + offset + 8);
+            headerSize = 16;
+        } else if (size == 0) {
+            // Up to the end of the parent
+            size = end - offset;
+        }
+        if (size < headerSize || size > end - offset) {
+            return MWImageHeaderParseStatusUnsupported;
+        }
+        if (memcmp(bytes + offset + 4, type, 4) == 0) {
+            if (offset + size > length) {
+                return MWImageHeaderParseStatusNeedMoreData;
+            }
+            *contentStart = offset + headerSize;
+            *boxEnd = offset + (size_t)size;
+            return MWImageHeaderParseStatusSuccess;
+        }
+        if (memcmp(bytes + offset + 4, "mdat", 4) == 0) {
+            // The media data is large, the header is not near the start
+            return MWImageHeaderParseStatusUnsupported;
+        }
+        offset += (size_t)size;
+    }
+    return MWImageHeaderParseStatusUnsupported;
+}
+
+static MWImageFormat MWHEIFFormatForBrand(const uint8_t *brand) {
+    static const char *heicBrands[] = {"heic", "heix", "hevc", "hevx", "heim", "heis"};
+    for (size_t i = 0; i < sizeof(heicBrands) / sizeof(heicBrands[0]); i++) {
+        if (memcmp(brand, heicBrands[i], 4) == 0) {
+            return MWImageFormatHEIC;
+        }
+    }
+    if (memcmp(brand, "avif", 4) == 0 || memcmp(brand, "avis", 4) == 0) {
+        return MWImageFormatAVIF;
+    }
+    if (memcmp(brand, "mif1", 4) == 0 || memcmp(brand, "msf1", 4) == 0) {
+        return MWImageFormatHEIF;
+    }
+    return MWImageFormatUndefined;
+}
+
+static MWImageHeaderParseStatus MWParseHEIF(const uint8_t *bytes, size_t length, MWImageFormat *format, uint32_t *width, uint32_t *height) {
+    if (length < 12) {
+        return MWImageHeaderParseStatusNeedMoreData;
+    }
+    size_t ftypSize = MWReadBE32(bytes);
+    if (ftypSize < 16 || ftypSize > MWImageHeaderParserMaxHeaderLength) {
+        return MWImageHeaderParseStatusUnsupported;
+    }
+    if (length < ftypSize) {
+        return MWImageHeaderParseStatusNeedMoreData;
+    }
+    // The major brand, then the compatible brands. `heic` and `avif` win over the generic `mif1`
+    MWImageFormat heifFormat = MWHEIFFormatForBrand(bytes + 8);
+    for (size_t offset = 16; offset + 4 <= ftypSize && heifFormat != MWImageFormatHEIC && heifFormat != MWImageFormatAVIF; offset += 4) {
+        MWImageFormat brandFormat = MWHEIFFormatForBrand(bytes + offset);
+        if (brandFormat != MWImageFormatUndefined) {
+            heifFormat = brandFormat;
+        }
+    }
+    if (heifFormat == MWImageFormatUndefined) {
+        return MWImageHeaderParseStatusUnsupported;
+    }
+    // meta (full box) > iprp > ipco > ispe
+    size_t end = SIZE_MAX;
+    size_t contentStart = 0, boxEnd = 0;
+    MWImageHeaderParseStatus status = MWFindBox(bytes, length, ftypSize, end, "meta", &contentStart, &boxEnd);
+    if (status != MWImageHeaderParseStatusSuccess) {
+        return status;
+    }
+    status = MWFindBox(bytes, length, contentStart + 4, boxEnd, "iprp", &contentStart, &boxEnd);
+    if (status != MWImageHeaderParseStatusSuccess) {
+        return status;
+    }
+    status = MWFindBox(bytes, length, contentStart, boxEnd, "ipco", &contentStart, &boxEnd);
+    if (status != MWImageHeaderParseStatusSuccess) {
+        return status;
+    }
+    // The properties are shared by the items, a grid image has one for the canvas and one for the tiles
+    uint64_t largestArea = 0;
+    size_t offset = contentStart;
+    while (offset < boxEnd) {
+        size_t propertyStart = 0, propertyEnd = 0;
+        if (MWFindBox(bytes, length, offset, boxEnd, "ispe", &propertyStart, &propertyEnd) != MWImageHeaderParseStatusSuccess) {
+            break;
+        }
+        if (propertyEnd - propertyStart >= 12) {
+            uint32_t propertyWidth = MWReadBE32(bytes + propertyStart + 4);
+            uint32_t propertyHeight = MWReadBE32(bytes + propertyStart + 8);
+            if ((uint64_t)propertyWidth * propertyHeight > largestArea) {
+                largestArea = (uint64_t)propertyWidth * propertyHeight;
+                *width = propertyWidth;
+                *height = propertyHeight;
+            }
+        }
+        offset = propertyEnd;
+    }
+    if (largestArea == 0) {
+        return MWImageHeaderParseStatusUnsupported;
+    }
+    *format = heifFormat;
+    return MWImageHeaderParseStatusSuccess;
+}
+
+@implementation MWImageHeaderParser
+
++ (MWImageHeaderParseStatus)parseHeaderWithData:(NSData *)data format:(MWImageFormat *)format pixelSize:(CGSize *)pixelSize {
+    const uint8_t *bytes = data.bytes;
+    size_t length = data.length;
+    if (length == 0) {
+        return MWImageHeaderParseStatusNeedMoreData;
+    }
+    MWImageFormat imageFormat = MWImageFormatUndefined;
+    uint32_t width = 0, height = 0;
+    MWImageHeaderParseStatus status;
+    BOOL prefix = NO;
+    if (MWHasSignature(bytes, length, "\x89PNG\r\n\x1A\n", 8, &prefix)) {
+        imageFormat = MWImageFormatPNG;
+        status = MWParsePNG(bytes, length, &width, &height);
+    } else if (MWHasSignature(bytes, length, "GIF87a", 6, &prefix) || MWHasSignature(bytes, length, "GIF89a", 6, &prefix)) {
+        imageFormat = MWImageFormatGIF;
+        status = MWParseGIF(bytes, length, &width, &height);
+    } else if (MWHasSignature(bytes, length, "\xFF\xD8\xFF", 3, &prefix)) {
+        imageFormat = MWImageFormatJPEG;
+        status = MWParseJPEG(bytes, length, &width, &height);
+    } else if (length >= 12 && memcmp(bytes, "RIFF", 4) == 0 && memcmp(bytes + 8, "WEBP", 4) == 0) {
+        imageFormat = MWImageFormatWebP;
+        status = MWParseWebP(bytes, length, &width, &height);
+    } else if (length >= 8 && memcmp(bytes + 4, "ftyp", 4) == 0) {
+        status = MWParseHEIF(bytes, length, &imageFormat, &width, &height);
+    } else if (prefix || length < 12) {
+        // Too short to know the format
+        status = MWImageHeaderParseStatusNeedMoreData;
+    } else {
+        status = MWImageHeaderParseStatusUnsupported;
+    }
+    if (status == MWImageHeaderParseStatusNeedMoreData && length >= MWImageHeaderParserMaxHeaderLength) {
+        status = MWImageHeaderParseStatusUnsupported;
+    }
+    if (status == MWImageHeaderParseStatusSuccess && (width == 0 || height == 0)) {
+        status = MWImageHeaderParseStatusUnsupported;
+    }
+    if (status == MWImageHeaderParseStatusSuccess) {
+        if (format) {
+            *format = imageFormat;
+        }
+        if (pixelSize) {
+            *pixelSize = CGSizeMake(width, height);
+        }
+    }
+    return status;
+}
+
+@end
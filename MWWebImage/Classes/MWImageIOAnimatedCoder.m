@@ -19,6 +19,25 @@ static NSString * kMWCGImageSourceRasterizationDPI = @"kCGImageSourceRasterizati
 // Specify File Size for lossy format encoding, like JPEG
 static NSString * kMWCGImageDestinationRequestedFileSize = @"kCGImageDestinationRequestedFileSize";
 
+static size_t MWImageIOIncrementalDataGetBytesAtPosition(void *info, void *buffer, off_t position, size_t count) {
+    dispatch_data_t data = (__bridge dispatch_data_t)info;
+    size_t size = dispatch_data_get_size(data);
+    if (position < 0 || (size_t)position >= size) {
+        return 0;
+    }
+    count = MIN(count, size - (size_t)position);
+    dispatch_data_t subrange = dispatch_data_create_subrange(data, (size_t)position, count);
+    dispatch_data_apply(subrange, ^bool(dispatch_data_t region, size_t offset, const void *bytes, size_t size) {
+        memcpy((uint8_t *)buffer + offset, bytes, size);
+        return true;
+    });
+    return count;
+}
+
+static void MWImageIOIncrementalDataReleaseInfo(void *info) {
+    CFRelease(info);
+}
+
 @interface MWImageIOCoderFrame : NSObject
 
 @property (nonatomic, assign) NSUInteger index; // Frame index (zero based)
@@ -33,6 +52,7 @@ static NSString * kMWCGImageDestinationRequestedFileSize = @"kCGImageDestination
     size_t _width, _height;
     CGImageSourceRef _imageSource;
     NSData *_imageData;
+    dispatch_data_t _incrementalData; // accumulated by `appendIncrementalData:finished:`, the chunks are never copied nor moved
     CGFloat _scale;
     NSUInteger _loopCount;
     NSUInteger _frameCount;
@@ -108,6 +128,29 @@ static NSString * kMWCGImageDestinationRequestedFileSize = @"kCGImageDestination
 
 #pragma mark - Utils
 
++ (dispatch_data_t)incrementalData:(dispatch_data_t)incrementalData byAppendingData:(NSData *)data {
+    __block dispatch_data_t result = incrementalData ?: dispatch_data_empty;
+    // Wrap the bytes without copy, the regions keep the data alive
+    [data enumerateByteRangesUsingBlock:^(const void * _Nonnull bytes, NSRange byteRange, BOOL * _Nonnull stop) {
+        dispatch_data_t region = dispatch_data_create(bytes, byteRange.length, NULL, ^{
+            [data self];
+        });
+        result = dispatch_data_create_concat(result, region);
+    }];
+    return result;
+}
+
++ (CGDataProviderRef)createDataProviderWithIncrementalData:(dispatch_data_t)incrementalData {
+    CGDataProviderDirectCallbacks callbacks = {
+        .version = 0,
+        .getBytePointer = NULL,
+        .releaseBytePointer = NULL,
+        .getBytesAtPosition = MWImageIOIncrementalDataGetBytesAtPosition,
+        .releaseInfo = MWImageIOIncrementalDataReleaseInfo,
+    };
+    return CGDataProviderCreateDirect((__bridge_retained void *)incrementalData, dispatch_data_get_size(incrementalData), &callbacks);
+}
+
 + (BOOL)canDecodeFromFormat:(MWImageFormat)format {
     static dispatch_once_t onceToken;
     static NSSet *imageUTTypeSet;
@@ -408,6 +451,29 @@ static NSString * kMWCGImageDestinationRequestedFileSize = @"kCGImageDestination
     // Update the data source, we must pass ALL the data, not just the new bytes
     CGImageSourceUpdateData(_imageSource, (__bridge CFDataRef)data, finished);
     
+    [self scanIncrementalImageSource];
+}
+
+- (void)appendIncrementalData:(NSData *)data finished:(BOOL)finished {
+    if (_finished) {
+        return;
+    }
+    _finished = finished;
+    
+    // The image source still needs ALL the data, it reads the chunks through a data provider instead of a flattened copy
+    // Each update gets a new provider over an immutable snapshot, so the image source never reads bytes which an append moved
+    _incrementalData = [MWImageIOAnimatedCoder incrementalData:_incrementalData byAppendingData:data];
+    _imageData = (NSData *)_incrementalData;
+    CGDataProviderRef provider = [MWImageIOAnimatedCoder createDataProviderWithIncrementalData:_incrementalData];
+    if (provider) {
+        CGImageSourceUpdateDataProvider(_imageSource, provider, finished);
+        CGDataProviderRelease(provider);
+    }
+    
+    [self scanIncrementalImageSource];
+}
+
+- (void)scanIncrementalImageSource {
     if (_width + _height == 0) {
         NSDictionary *options = @{
             (__bridge NSString *)kCGImageSourceShouldCacheImmediately : @(YES),
@@ -16,6 +16,8 @@
 #define kMWUTTypeHEICS ((__bridge CFStringRef)@"public.heics")
 // kUTTypeWebP seems not defined in public UTI framework, Apple use the hardcode string, we define them :)
 #define kMWUTTypeWebP ((__bridge CFStringRef)@"org.webmproject.webp")
+// AVIF, same as WebP
+#define kMWUTTypeAVIF ((__bridge CFStringRef)@"public.avif")
 
 @interface MWImageIOAnimatedCoder ()
 
@@ -24,5 +26,7 @@
 + (nullable UIImage *)createFrameAtIndex:(NSUInteger)index source:(nonnull CGImageSourceRef)source scale:(CGFloat)scale preserveAspectRatio:(BOOL)preserveAspectRatio thumbnailSize:(CGSize)thumbnailSize options:(nullable NSDictionary *)options;
 + (BOOL)canEncodeToFormat:(MWImageFormat)format;
 + (BOOL)canDecodeFromFormat:(MWImageFormat)format;
++ (nonnull dispatch_data_t)incrementalData:(nullable dispatch_data_t)incrementalData byAppendingData:(nonnull NSData *)data;
++ (nullable CGDataProviderRef)createDataProviderWithIncrementalData:(nonnull dispatch_data_t)incrementalData CF_RETURNS_RETAINED;
 
 @end
@@ -22,6 +22,7 @@ static NSString * kMWCGImageDestinationRequestedFileSize = @"kCGImageDestination
     CGImageSourceRef _imageSource;
     CGFloat _scale;
     BOOL _finished;
+    dispatch_data_t _incrementalData; // accumulated by `appendIncrementalData:finished:`, the chunks are never copied nor moved
     BOOL _preserveAspectRatio;
     CGSize _thumbnailSize;
 }
@@ -149,6 +150,28 @@ static NSString * kMWCGImageDestinationRequestedFileSize = @"kCGImageDestination
     // Update the data source, we must pass ALL the data, not just the new bytes
     CGImageSourceUpdateData(_imageSource, (__bridge CFDataRef)data, finished);
     
+    [self scanIncrementalImageSource];
+}
+
+- (void)appendIncrementalData:(NSData *)data finished:(BOOL)finished {
+    if (_finished) {
+        return;
+    }
+    _finished = finished;
+    
+    // The image source still needs ALL the data, it reads the chunks through a data provider instead of a flattened copy
+    // Each update gets a new provider over an immutable snapshot, so the image source never reads bytes which an append moved
+    _incrementalData = [MWImageIOAnimatedCoder incrementalData:_incrementalData byAppendingData:data];
+    CGDataProviderRef provider = [MWImageIOAnimatedCoder createDataProviderWithIncrementalData:_incrementalData];
+    if (provider) {
+        CGImageSourceUpdateDataProvider(_imageSource, provider, finished);
+        CGDataProviderRelease(provider);
+    }
+    
+    [self scanIncrementalImageSource];
+}
+
+- (void)scanIncrementalImageSource {
     if (_width + _height == 0) {
         CFDictionaryRef properties = CGImageSourceCopyPropertiesAtIndex(_imageSource, 0, NULL);
         if (properties) {
@@ -0,0 +1,28 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "MWImageCoder.h"
+
+// Whether libjpeg-turbo is linked, with its TurboJPEG API
+#if __has_include(<turbojpeg.h>)
+#define MW_JPEG_TURBO 1
+#else
+#define MW_JPEG_TURBO 0
+#endif
+
+/**
+ This coder decodes JPEG thumbnails with libjpeg-turbo. When `MWImageCoderDecodeThumbnailPixelSize` is set (including by `MWWebImageScaleDownLargeImages`), it decodes in the DCT domain at the smallest scale of 1/2, 1/4 or 1/8 still larger than the thumbnail, then resamples to the thumbnail size with vImage. The full size image is never decoded nor allocated.
+ The decodes without a smaller thumbnail, the CMYK images and the images with a color profile other than sRGB are decoded by `MWImageIOCoder`. Encoding is done by `MWImageIOCoder`.
+ @note This coder is only functional when libjpeg-turbo is linked (`MW_JPEG_TURBO` is 1), it's then registered in `MWImageCodersManager` by default.
+ */
+@interface MWImageJPEGCoder : NSObject <MWImageCoder>
+
+@property (nonatomic, class, readonly, nonnull) MWImageJPEGCoder *sharedCoder;
+
+@end
@@ -0,0 +1,225 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "MWImageJPEGCoder.h"
+#import "MWImageIOCoder.h"
+#import "NMWata+ImageContentType.h"
+#import "UIImage+Metadata.h"
+#import "UIImage+ForceDecode.h"
+#import "NSImage+Compatibility.h"
+#import "MWImageCoderHelper.h"
+#import "MWInternalMacros.h"
+#import <ImageIO/ImageIO.h>
+#import <Accelerate/Accelerate.h>
+
+#if MW_JPEG_TURBO
+#import <turbojpeg.h>
+
+static inline size_t MWByteAlign(size_t size, size_t alignment) {
+    return ((size + (alignment - 1)) / alignment) * alignment;
+}
+
+static void MWJPEGReleaseBitmapData(void *info, const void *data, size_t size) {
+    free((void *)data);
+}
+
+// The smallest DCT scaling factor whose output still covers the target size
+static tjscalingfactor MWJPEGScalingFactorForSize(int width, int height, CGSize targetSize) {
+    tjscalingfactor bestFactor = {1, 1};
+    int factorCount = 0;
+    tjscalingfactor *factors = tjGetScalingFactors(&factorCount);
+    for (int i = 0; i < factorCount; i++) {
+        tjscalingfactor factor = factors[i];
+        if (factor.num * bestFactor.denom >= bestFactor.num * factor.denom) {
+            continue;
+        }
+        if (TJSCALED(width, factor) >= targetSize.width && TJSCALED(height, factor) >= targetSize.height) {
+            bestFactor = factor;
+        }
+    }
+    return bestFactor;
+}
+
+#endif
+
+@implementation MWImageJPEGCoder
+
++ (instancetype)sharedCoder {
+    static MWImageJPEGCoder *coder;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        coder = [[MWImageJPEGCoder alloc] init];
+    });
+    return coder;
+}
+
+#pragma mark - Decode
+
+- (BOOL)canDecodeFromData:(nullable NSData *)data {
+#if MW_JPEG_TURBO
+    return [NSData MW_imageFormatForImageData:data] == MWImageFormatJPEG;
+#else
+    return NO;
+#endif
+}
+
+- (UIImage *)decodedImageWithData:(NSData *)data options:(nullable MWImageCoderOptions *)options {
+#if MW_JPEG_TURBO
+    if (!data) {
+        return nil;
+    }
+    UIImage *image = [self.class createThumbnailWithData:data options:options];
+    if (!image) {
+        return [[MWImageIOCoder sharedCoder] decodedImageWithData:data options:options];
+    }
+    image.MW_imageFormat = MWImageFormatJPEG;
+    return image;
+#else
+    return [[MWImageIOCoder sharedCoder] decodedImageWithData:data options:options];
+#endif
+}
+
+#if MW_JPEG_TURBO
+
+// Returns nil when the decode is better done by Image/IO
++ (UIImage *)createThumbnailWithData:(NSData *)data options:(MWImageCoderOptions *)options {
+    CGSize thumbnailSize = CGSizeZero;
+    NSValue *thumbnailSizeValue = options[MWImageCoderDecodeThumbnailPixelSize];
+    if (thumbnailSizeValue != nil) {
+#if MW_MAC
+        thumbnailSize = thumbnailSizeValue.sizeValue;
+#else
+        thumbnailSize = thumbnailSizeValue.CGSizeValue;
+#endif
+    }
+    if (thumbnailSize.width <= 0 || thumbnailSize.height <= 0) {
+        return nil;
+    }
+    CGFloat scale = 1;
+    NSNumber *scaleFactor = options[MWImageCoderDecodeScaleFactor];
+    if (scaleFactor != nil) {
+        scale = MAX([scaleFactor doubleValue], 1);
+    }
+    BOOL preserveAspectRatio = YES;
+    NSNumber *preserveAspectRatioValue = options[MWImageCoderDecodePreserveAspectRatio];
+    if (preserveAspectRatioValue != nil) {
+        preserveAspectRatio = preserveAspectRatioValue.boolValue;
+    }
+
+    // The orientation and the color profile, only the header is parsed
+    CGImageSourceRef source = CGImageSourceCreateWithData((__bridge CFDataRef)data, NULL);
+    if (!source) {
+        return nil;
+    }
+    NSDictionary *properties = (__bridge_transfer NSDictionary *)CGImageSourceCopyPropertiesAtIndex(source, 0, NULL);
+    CFRelease(source);
+    NSString *profileName = properties[(__bridge NSString *)kCGImagePropertyProfileName];
+    if (profileName && [profileName rangeOfString:@"sRGB"].location == NSNotFound) {
+        // Such as Display P3, Image/IO keeps the wide gamut
+        return nil;
+    }
+    CGImagePropertyOrientation exifOrientation = (CGImagePropertyOrientation)[properties[(__bridge NSString *)kCGImagePropertyOrientation] unsignedIntegerValue];
+    if (!exifOrientation) {
+        exifOrientation = kCGImagePropertyOrientationUp;
+    }
+
+    tjhandle handle = tjInitDecompress();
+    if (!handle) {
+        return nil;
+    }
+    @onExit {
+        tjDestroy(handle);
+    };
+    int width = 0, height = 0, subsampling = 0, colorspace = 0;
+    if (tjDecompressHeader3(handle, data.bytes, data.length, &width, &height, &subsampling, &colorspace) != 0 || width <= 0 || height <= 0) {
+        return nil;
+    }
+    if (colorspace == TJCS_CMYK || colorspace == TJCS_YCCK) {
+        return nil;
+    }
+    if (width <= thumbnailSize.width && height <= thumbnailSize.height) {
+        // Not a thumbnail, a full decode
+        return nil;
+    }
+
+    // Like `MWImageIOAnimatedCoder`, the aspect ratio is kept in the displayed orientation, else the stored pixels are stretched to the thumbnail size
+    CGSize targetSize = thumbnailSize;
+    if (preserveAspectRatio) {
+        BOOL swapsDimensions = exifOrientation == kCGImagePropertyOrientationLeftMirrored || exifOrientation == kCGImagePropertyOrientationRight || exifOrientation == kCGImagePropertyOrientationRightMirrored || exifOrientation == kCGImagePropertyOrientationLeft;
+        CGSize limitSize = swapsDimensions ? CGSizeMake(thumbnailSize.height, thumbnailSize.width) : thumbnailSize;
+        CGFloat ratio = MIN(limitSize.width / width, limitSize.height / height);
+        targetSize = CGSizeMake(MAX(round(width * ratio), 1), MAX(round(height * ratio), 1));
+    }
+
+    // Decode at 1/2, 1/4 or 1/8 in the DCT domain, in the iOS display pixel format (BGRX8888)
+    tjscalingfactor factor = MWJPEGScalingFactorForSize(width, height, targetSize);
+    vImage_Buffer decodedBuffer = {
+        .width = TJSCALED(width, factor),
+        .height = TJSCALED(height, factor),
+    };
+    decodedBuffer.rowBytes = MWByteAlign(decodedBuffer.width * 4, 64);
+    decodedBuffer.data = malloc(decodedBuffer.rowBytes * decodedBuffer.height);
+    if (!decodedBuffer.data) {
+        return nil;
+    }
+    if (tjDecompress2(handle, data.bytes, data.length, decodedBuffer.data, (int)decodedBuffer.width, (int)decodedBuffer.rowBytes, (int)decodedBuffer.height, TJPF_BGRX, 0) != 0) {
+        free(decodedBuffer.data);
+        return nil;
+    }
+
+    // The remaining resample is done with SIMD
+    vImage_Buffer outputBuffer = decodedBuffer;
+    if (decodedBuffer.width != targetSize.width || decodedBuffer.height != targetSize.height) {
+        outputBuffer.width = targetSize.width;
+        outputBuffer.height = targetSize.height;
+        outputBuffer.rowBytes = MWByteAlign(outputBuffer.width * 4, 64);
+        outputBuffer.data = malloc(outputBuffer.rowBytes * outputBuffer.height);
+        vImage_Error error = outputBuffer.data ? vImageScale_ARGB8888(&decodedBuffer, &outputBuffer, NULL, kvImageHighQualityResampling) : kvImageMemoryAllocationError;
+        free(decodedBuffer.data);
+        if (error != kvImageNoError) {
+            free(outputBuffer.data);
+            return nil;
+        }
+    }
+
+    CGDataProviderRef provider = CGDataProviderCreateWithData(NULL, outputBuffer.data, outputBuffer.rowBytes * outputBuffer.height, MWJPEGReleaseBitmapData);
+    if (!provider) {
+        free(outputBuffer.data);
+        return nil;
+    }
+    CGBitmapInfo bitmapInfo = kCGBitmapByteOrder32Host | kCGImageAlphaNoneSkipFirst;
+    CGImageRef imageRef = CGImageCreate(outputBuffer.width, outputBuffer.height, 8, 32, outputBuffer.rowBytes, [MWImageCoderHelper colorSpaceGetDeviceRGB], bitmapInfo, provider, NULL, NO, kCGRenderingIntentDefault);
+    CGDataProviderRelease(provider);
+    if (!imageRef) {
+        return nil;
+    }
+#if MW_UIKIT || MW_WATCH
+    UIImageOrientation imageOrientation = [MWImageCoderHelper imageOrientationFromEXIFOrientation:exifOrientation];
+    UIImage *image = [[UIImage alloc] initWithCGImage:imageRef scale:scale orientation:imageOrientation];
+#else
+    UIImage *image = [[UIImage alloc] initWithCGImage:imageRef scale:scale orientation:exifOrientation];
+#endif
+    CGImageRelease(imageRef);
+    // Already a bitmap in the display format, force decoding would only copy it
+    image.MW_iMWecoded = YES;
+    return image;
+}
+
+#endif
+
+#pragma mark - Encode
+
+- (BOOL)canEncodeToFormat:(MWImageFormat)format {
+    return NO;
+}
+
+- (NSData *)encodedDataWithImage:(UIImage *)image format:(MWImageFormat)format options:(nullable MWImageCoderOptions *)options {
+    return nil;
+}
+
+@end
@@ -22,6 +22,20 @@ typedef void(^MWImageLoaderCompletedBlock)(UIImage * _Nullable image, NSData * _
  */
 FOUNDATION_EXPORT MWWebImageContextOption _Nonnull const MWWebImageContextLoaderCachedImage;
 
+/**
+ The HTTP validators of the cached image, provided with `MWWebImageContextLoaderCachedImage` when the image cache stores them. (MWImageCacheValidators)
+ The loader can send them as a conditional request (`If-None-Match` / `If-Modified-Since`), and call the completion with `MWWebImageErrorCacheNotModified` error on `304 Not Modified`.
+ @note If you don't implement `MWWebImageRefreshCached` support, you do not need to care about this context option.
+ */
+FOUNDATION_EXPORT MWWebImageContextOption _Nonnull const MWWebImageContextLoaderCachedValidators;
+
+/**
+ The file URL in the disk cache where the image data is stored, provided by `MWWebImageManager` when you specify `MWWebImageDownloadToFile`. (NSURL)
+ The loader can write the received bytes into a temporary file beside it instead of keeping them in memory, move it to this URL atomically once the image decoded (with `-[MWImageCache moveFileAtURL:toCacheFileURL:]` of the `MWWebImageContextImageCache` of the context), and complete with the data read from the file. The manager then only stores the image into the memory cache.
+ @note If you don't implement `MWWebImageDownloadToFile` support, you do not need to care about this context option.
+ */
+FOUNDATION_EXPORT MWWebImageContextOption _Nonnull const MWWebImageContextLoaderDownloadFileURL;
+
 #pragma mark - Helper method
 
 /**
@@ -50,6 +64,15 @@ FOUNDATION_EXPORT UIImage * _Nullable MWImageLoaderDecodeImageData(NSData * _Non
  */
 FOUNDATION_EXPORT UIImage * _Nullable MWImageLoaderDecodeProgressiveImageData(NSData * _Nonnull imageData, NSURL * _Nonnull imageURL, BOOL finished,  id<MWWebImageOperation> _Nonnull operation, MWWebImageOptions options, MWWebImageContext * _Nullable context);
 
+/**
+ The total bytes handed to the progressive coder by `MWImageLoaderDecodeProgressiveImageData` for the operation so far. This can be used to benchmark the progressive decoding cost of a download.
+ With a coder implementing `appendIncrementalData:finished:`, this stays equal to the downloaded size. Otherwise the whole data is handed over on each update, and this grows quadratically with the downloaded size.
+
+ @param operation The loader operation associated with current progressive download
+ @return The total bytes handed to the progressive coder, 0 if there is no progressive decoding yet
+ */
+FOUNDATION_EXPORT NSUInteger MWImageLoaderProgressiveFedBytes(id<MWWebImageOperation> _Nonnull operation);
+
 #pragma mark - MWImageLoader
 
 /**
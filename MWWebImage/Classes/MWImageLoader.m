@@ -12,15 +12,24 @@
 #import "MWImageCoderHelper.h"
 #import "MWAnimatedImage.h"
 #import "UIImage+Metadata.h"
+#import "UIImage+MemoryCacheCost.h"
 #import "MWInternalMacros.h"
 #import "objc/runtime.h"
 
 static void * MWImageLoaderProgressiveCoderKey = &MWImageLoaderProgressiveCoderKey;
+static void * MWImageLoaderProgressiveFedLengthKey = &MWImageLoaderProgressiveFedLengthKey;
+static void * MWImageLoaderProgressiveFedBytesKey = &MWImageLoaderProgressiveFedBytesKey;
+
+NSUInteger MWImageLoaderProgressiveFedBytes(id<MWWebImageOperation> _Nonnull operation) {
+    NSNumber *fedBytes = objc_getAssociatedObject(operation, MWImageLoaderProgressiveFedBytesKey);
+    return fedBytes.unsignedIntegerValue;
+}
 
 UIImage * _Nullable MWImageLoaderDecodeImageData(NSData * _Nonnull imageData, NSURL * _Nonnull imageURL, MWWebImageOptions options, MWWebImageContext * _Nullable context) {
     NSCParameterAssert(imageData);
     NSCParameterAssert(imageURL);
     
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
     UIImage *image;
     id<MWWebImageCacheKeyFilter> cacheKeyFilter = context[MWWebImageContextCacheKeyFilter];
     NSString *cacheKey;
@@ -96,6 +105,10 @@ UIImage * _Nullable MWImageLoaderDecodeImageData(NSData * _Nonnull imageData, NS
         }
     }
     
+    if (image) {
+        image.MW_rebuildCost = CFAbsoluteTimeGetCurrent() - startTime;
+    }
+    
     return image;
 }
 
@@ -135,6 +148,12 @@ UIImage * _Nullable MWImageLoaderDecodeProgressiveImageData(NSData * _Nonnull im
     mutableCoderOptions[MWImageCoderWebImageContext] = context;
     MWImageCoderOptions *coderOptions = [mutableCoderOptions copy];
     
+    NSUInteger fedLength = [objc_getAssociatedObject(operation, MWImageLoaderProgressiveFedLengthKey) unsignedIntegerValue];
+    if (imageData.length < fedLength) {
+        // The data restarted, the coder holds the bytes of the previous response
+        objc_setAssociatedObject(operation, MWImageLoaderProgressiveCoderKey, nil, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+        fedLength = 0;
+    }
     // Grab the progressive image coder
     id<MWProgressiveImageCoder> progressiveCoder = objc_getAssociatedObject(operation, MWImageLoaderProgressiveCoderKey);
     if (!progressiveCoder) {
@@ -159,7 +178,18 @@ UIImage * _Nullable MWImageLoaderDecodeProgressiveImageData(NSData * _Nonnull im
         return nil;
     }
     
-    [progressiveCoder updateIncrementalData:imageData finished:finished];
+    NSUInteger fedBytes = MWImageLoaderProgressiveFedBytes(operation);
+    if ([progressiveCoder respondsToSelector:@selector(appendIncrementalData:finished:)]) {
+        // Only hand over the bytes the coder has not seen yet
+        NSData *newData = [imageData subdataWithRange:NSMakeRange(fedLength, imageData.length - fedLength)];
+        [progressiveCoder appendIncrementalData:newData finished:finished];
+        fedBytes += newData.length;
+    } else {
+        [progressiveCoder updateIncrementalData:imageData finished:finished];
+        fedBytes += imageData.length;
+    }
+    objc_setAssociatedObject(operation, MWImageLoaderProgressiveFedLengthKey, @(imageData.length), OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    objc_setAssociatedObject(operation, MWImageLoaderProgressiveFedBytesKey, @(fedBytes), OBJC_ASSOCIATION_RETAIN_NONATOMIC);
     if (!decodeFirstFrame) {
         // check whether we should use `MWAnimatedImage`
         Class animatedImageClass = context[MWWebImageContextAnimatedImageClass];
@@ -198,3 +228,5 @@ UIImage * _Nullable MWImageLoaderDecodeProgressiveImageData(NSData * _Nonnull im
 }
 
 MWWebImageContextOption const MWWebImageContextLoaderCachedImage = @"loaderCachedImage";
+MWWebImageContextOption const MWWebImageContextLoaderCachedValidators = @"loaderCachedValidators";
+MWWebImageContextOption const MWWebImageContextLoaderDownloadFileURL = @"loaderDownloadFileURL";
@@ -0,0 +1,28 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "MWImageCoder.h"
+
+// Whether libdeflate is linked
+#if __has_include(<libdeflate.h>)
+#define MW_LIBDEFLATE 1
+#else
+#define MW_LIBDEFLATE 0
+#endif
+
+/**
+ This coder decodes static PNG images without Image/IO: the image data is inflated at once with libdeflate, the rows are unfiltered with SIMD, and the pixels are written straight in the premultiplied BGRA layout of `CGImageCreateDecoded`, so the image needs no force decoding.
+ It supports the 8 and 16 bits grayscale, RGB and alpha images, and the palette images. The animated PNG are left to `MWImageAPNGCoder`. The interlaced images, the images with a color profile and the other bit depths are decoded by `MWImageIOCoder`, as well as encoding.
+ @note This coder is only functional when libdeflate is linked (`MW_LIBDEFLATE` is 1), it's then registered in `MWImageCodersManager` by default.
+ */
+@interface MWImagePNGCoder : NSObject <MWImageCoder>
+
+@property (nonatomic, class, readonly, nonnull) MWImagePNGCoder *sharedCoder;
+
+@end
@@ -0,0 +1,512 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "MWImagePNGCoder.h"
+#import "MWImageIOCoder.h"
+#import "NMWata+ImageContentType.h"
+#import "UIImage+Metadata.h"
+#import "UIImage+ForceDecode.h"
+#import "NSImage+Compatibility.h"
+#import "MWImageCoderHelper.h"
+#import "MWInternalMacros.h"
+#import <Accelerate/Accelerate.h>
+
+#if MW_LIBDEFLATE
+#import <libdeflate.h>
+#import <simd/simd.h>
+
+static const uint8_t kMWPNGSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+// Like the GIF decoder, larger images are left to Image/IO instead of allocating their rows from the header values
+static const uint64_t kMWPNGMaxPixels = 1 << 26;
+
+typedef NS_ENUM(uint8_t, MWPNGColorType) {
+    MWPNGColorTypeGray = 0,
+    MWPNGColorTypeRGB = 2,
+    MWPNGColorTypePalette = 3,
+    MWPNGColorTypeGrayAlpha = 4,
+    MWPNGColorTypeRGBA = 6,
+};
+
+static inline size_t MWByteAlign(size_t size, size_t alignment) {
+    return ((size + (alignment - 1)) / alignment) * alignment;
+}
+
+static inline uint32_t MWPNGReadBE32(const uint8_t *bytes) {
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3];
+}
+
+static void MWPNGReleaseBitmapData(void *info, const void *data, size_t size) {
+    free((void *)data);
+}
+
+#pragma mark - Unfiltering
+
+// A pixel of 3 or 4 bytes, in 16 bits lanes so that the sums and the Paeth distances do not overflow
+static inline __attribute__((always_inline)) simd_short4 MWPNGLoadPixel(const uint8_t *bytes, size_t bpp) {
+    if (bpp == 4) {
+        simd_uchar4 pixel;
+        memcpy(&pixel, bytes, 4);
+        return simd_short(pixel);
+    }
+    return (simd_short4){bytes[0], bytes[1], bytes[2], 0};
+}
+
+// Stores the low byte of the lanes, which is the modulo 256 of the PNG filters
+static inline __attribute__((always_inline)) simd_short4 MWPNGStorePixel(uint8_t *bytes, simd_short4 pixel, size_t bpp) {
+    simd_uchar4 stored = simd_uchar(pixel);
+    memcpy(bytes, &stored, bpp);
+    return simd_short(stored);
+}
+
+static inline uint8_t MWPNGPaethPredictor(int a, int b, int c) {
+    int pa = abs(b - c);
+    int pb = abs(a - c);
+    int pc = abs(a + b - 2 * c);
+    if (pa <= pb && pa <= pc) {
+        return a;
+    }
+    return pb <= pc ? b : c;
+}
+
+// One pixel at a time, all the channels at once. The RGB and RGBA images, which are most of the PNG pixels
+static inline __attribute__((always_inline)) void MWPNGUnfilterRowPixels(uint8_t filter, uint8_t *row, const uint8_t *previousRow, size_t length, size_t bpp) {
+    simd_short4 a = 0, c = 0;
+    for (size_t i = 0; i + bpp <= length; i += bpp) {
+        simd_short4 x = MWPNGLoadPixel(row + i, bpp);
+        if (filter == 1) {
+            a = MWPNGStorePixel(row + i, x + a, bpp);
+        } else if (filter == 3) {
+            simd_short4 b = MWPNGLoadPixel(previousRow + i, bpp);
+            a = MWPNGStorePixel(row + i, x + ((a + b) >> 1), bpp);
+        } else {
+            simd_short4 b = MWPNGLoadPixel(previousRow + i, bpp);
+            simd_short4 pa = simd_abs(b - c);
+            simd_short4 pb = simd_abs(a - c);
+            simd_short4 pc = simd_abs(a + b - 2 * c);
+            simd_short4 predictor = simd_select(c, b, pb <= pc);
+            predictor = simd_select(predictor, a, (pa <= pb) & (pa <= pc));
+            a = MWPNGStorePixel(row + i, x + predictor, bpp);
+            c = b;
+        }
+    }
+}
+
+// The other pixel sizes: the palette and grayscale images, and the 16 bits images
+static void MWPNGUnfilterRowBytes(uint8_t filter, uint8_t *row, const uint8_t *previousRow, size_t length, size_t bpp) {
+    for (size_t i = 0; i < length; i++) {
+        int a = i >= bpp ? row[i - bpp] : 0;
+        int b = previousRow[i];
+        int c = i >= bpp ? previousRow[i - bpp] : 0;
+        if (filter == 1) {
+            row[i] += a;
+        } else if (filter == 3) {
+            row[i] += (a + b) >> 1;
+        } else {
+            row[i] += MWPNGPaethPredictor(a, b, c);
+        }
+    }
+}
+
+static BOOL MWPNGUnfilterRow(uint8_t filter, uint8_t *row, const uint8_t *previousRow, size_t length, size_t bpp) {
+    switch (filter) {
+        case 0:
+            return YES;
+        case 2: {
+            // No dependency between the bytes, 16 at a time
+            size_t i = 0;
+            for (; i + 16 <= length; i += 16) {
+                simd_uchar16 x, b;
+                memcpy(&x, row + i, 16);
+                memcpy(&b, previousRow + i, 16);
+                x += b;
+                memcpy(row + i, &x, 16);
+            }
+            for (; i < length; i++) {
+                row[i] += previousRow[i];
+            }
+            return YES;
+        }
+        case 1:
+        case 3:
+        case 4:
+            if (bpp == 4) {
+                MWPNGUnfilterRowPixels(filter, row, previousRow, length, 4);
+            } else if (bpp == 3) {
+                MWPNGUnfilterRowPixels(filter, row, previousRow, length, 3);
+            } else {
+                MWPNGUnfilterRowBytes(filter, row, previousRow, length, bpp);
+            }
+            return YES;
+        default:
+            return NO;
+    }
+}
+
+#endif
+
+@implementation MWImagePNGCoder
+
++ (instancetype)sharedCoder {
+    static MWImagePNGCoder *coder;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        coder = [[MWImagePNGCoder alloc] init];
+    });
+    return coder;
+}
+
+#pragma mark - Decode
+
+- (BOOL)canDecodeFromData:(nullable NSData *)data {
+#if MW_LIBDEFLATE
+    if ([NSData MW_imageFormatForImageData:data] != MWImageFormatPNG) {
+        return NO;
+    }
+    // The animation control chunk is before the first image data chunk
+    const uint8_t *bytes = data.bytes;
+    size_t length = data.length;
+    size_t offset = sizeof(kMWPNGSignature);
+    while (offset + 8 <= length) {
+        uint32_t chunkLength = MWPNGReadBE32(bytes + offset);
+        const uint8_t *chunkType = bytes + offset + 4;
+        if (memcmp(chunkType, "acTL", 4) == 0) {
+            return NO;
+        }
+        if (memcmp(chunkType, "IDAT", 4) == 0) {
+            break;
+        }
+        if (chunkLength > length - offset - 8) {
+            break;
+        }
+        offset += 12 + (size_t)chunkLength;
+    }
+    return YES;
+#else
+    return NO;
+#endif
+}
+
+- (UIImage *)decodedImageWithData:(NSData *)data options:(nullable MWImageCoderOptions *)options {
+#if MW_LIBDEFLATE
+    if (!data) {
+        return nil;
+    }
+    UIImage *image = [self.class createImageWithData:data options:options];
+    if (!image) {
+        return [[MWImageIOCoder sharedCoder] decodedImageWithData:data options:options];
+    }
+    image.MW_imageFormat = MWImageFormatPNG;
+    return image;
+#else
+    return [[MWImageIOCoder sharedCoder] decodedImageWithData:data options:options];
+#endif
+}
+
+#if MW_LIBDEFLATE
+
+// Returns nil when the decode is better done by Image/IO
++ (UIImage *)createImageWithData:(NSData *)data options:(MWImageCoderOptions *)options {
+    const uint8_t *bytes = data.bytes;
+    size_t length = data.length;
+    if (length < sizeof(kMWPNGSignature) || memcmp(bytes, kMWPNGSignature, sizeof(kMWPNGSignature)) != 0) {
+        return nil;
+    }
+
+    // The chunks
+    uint32_t width = 0, height = 0;
+    uint8_t bitDepth = 0, colorType = 0;
+    BOOL hasHeader = NO;
+    uint32_t palette[256];
+    size_t paletteCount = 0;
+    const uint8_t *transparency = NULL;
+    size_t transparencyCount = 0;
+    NSMutableData *compressedData = [NSMutableData data];
+    size_t offset = sizeof(kMWPNGSignature);
+    BOOL hasEnd = NO;
+    while (offset + 12 <= length && !hasEnd) {
+        uint32_t chunkLength = MWPNGReadBE32(bytes + offset);
+        if (chunkLength > length - offset - 12) {
+            // Truncated
+            return nil;
+        }
+        const uint8_t *chunkType = bytes + offset + 4;
+        const uint8_t *chunkData = bytes + offset + 8;
+        if (memcmp(chunkType, "IHDR", 4) == 0) {
+            if (chunkLength != 13) {
+                return nil;
+            }
+            width = MWPNGReadBE32(chunkData);
+            height = MWPNGReadBE32(chunkData + 4);
+            if ((uint64_t)width * height > kMWPNGMaxPixels) {
+                return nil;
+            }
+            bitDepth = chunkData[8];
+            colorType = chunkData[9];
+            uint8_t interlace = chunkData[12];
+            if (interlace != 0) {
+                // Adam7
+                return nil;
+            }
+            hasHeader = YES;
+        } else if (!hasHeader) {
+            return nil;
+        } else if (memcmp(chunkType, "PLTE", 4) == 0) {
+            paletteCount = MIN(chunkLength / 3, 256);
+            for (size_t i = 0; i < paletteCount; i++) {
+                palette[i] = (uint32_t)chunkData[i * 3] << 16 | (uint32_t)chunkData[i * 3 + 1] << 8 | chunkData[i * 3 + 2];
+            }
+        } else if (memcmp(chunkType, "tRNS", 4) == 0) {
+            transparency = chunkData;
+            transparencyCount = chunkLength;
+        } else if (memcmp(chunkType, "iCCP", 4) == 0 || memcmp(chunkType, "acTL", 4) == 0) {
+            // Color managed and animated images
+            return nil;
+        } else if (memcmp(chunkType, "IDAT", 4) == 0) {
+            [compressedData appendBytes:chunkData length:chunkLength];
+        } else if (memcmp(chunkType, "IEND", 4) == 0) {
+            hasEnd = YES;
+        }
+        offset += 12 + (size_t)chunkLength;
+    }
+    if (!hasHeader || width == 0 || height == 0 || compressedData.length == 0) {
+        return nil;
+    }
+
+    // The supported layouts
+    size_t channels;
+    switch (colorType) {
+        case MWPNGColorTypeGray: channels = 1; break;
+        case MWPNGColorTypeRGB: channels = 3; break;
+        case MWPNGColorTypePalette: channels = 1; break;
+        case MWPNGColorTypeGrayAlpha: channels = 2; break;
+        case MWPNGColorTypeRGBA: channels = 4; break;
+        default: return nil;
+    }
+    if (colorType == MWPNGColorTypePalette) {
+        if ((bitDepth != 1 && bitDepth != 2 && bitDepth != 4 && bitDepth != 8) || paletteCount == 0) {
+            return nil;
+        }
+    } else if (bitDepth != 8 && bitDepth != 16) {
+        return nil;
+    } else if (transparency) {
+        // The transparent color key of the grayscale and RGB images
+        return nil;
+    }
+    uint64_t bitsPerPixel = channels * bitDepth;
+    uint64_t stride = ((uint64_t)width * bitsPerPixel + 7) / 8;
+    uint64_t outputRowBytes = MWByteAlign((uint64_t)width * 4, 64);
+    if ((stride + 1) * height > SIZE_MAX / 2 || outputRowBytes * height > SIZE_MAX / 2) {
+        return nil;
+    }
+    // The bytes between a byte and the same byte of the previous pixel
+    size_t bpp = (size_t)MAX(bitsPerPixel / 8, 1);
+
+    // Inflate all the rows at once
+    size_t filteredLength = (size_t)(stride + 1) * height;
+    uint8_t *filtered = malloc(filteredLength);
+    if (!filtered) {
+        return nil;
+    }
+    @onExit {
+        free(filtered);
+    };
+    struct libdeflate_decompressor *decompressor = libdeflate_alloc_decompressor();
+    if (!decompressor) {
+        return nil;
+    }
+    size_t inflatedLength = 0;
+    enum libdeflate_result result = libdeflate_zlib_decompress(decompressor, compressedData.bytes, compressedData.length, filtered, filteredLength, &inflatedLength);
+    libdeflate_free_decompressor(decompressor);
+    if (result != LIBDEFLATE_SUCCESS || inflatedLength != filteredLength) {
+        return nil;
+    }
+
+    // Unfilter in place, the first row is filtered against zeros
+    uint8_t *zeroRow = calloc(1, (size_t)stride);
+    if (!zeroRow) {
+        return nil;
+    }
+    const uint8_t *previousRow = zeroRow;
+    BOOL unfiltered = YES;
+    for (uint32_t y = 0; y < height && unfiltered; y++) {
+        uint8_t *row = filtered + y * (stride + 1);
+        unfiltered = MWPNGUnfilterRow(row[0], row + 1, previousRow, (size_t)stride, bpp);
+        previousRow = row + 1;
+    }
+    free(zeroRow);
+    if (!unfiltered) {
+        return nil;
+    }
+    if (bitDepth == 16) {
+        // Keep the high byte of the big endian samples, in place
+        size_t samples = (size_t)width * channels;
+        for (uint32_t y = 0; y < height; y++) {
+            uint8_t *row = filtered + y * (stride + 1) + 1;
+            for (size_t i = 0; i < samples; i++) {
+                row[i] = row[i * 2];
+            }
+        }
+    }
+
+    // Straight to the premultiplied BGRA of the display, as the 32 bits host words ARGB
+    BOOL hasAlpha = colorType == MWPNGColorTypeGrayAlpha || colorType == MWPNGColorTypeRGBA || (colorType == MWPNGColorTypePalette && transparency);
+    vImage_Buffer source = {
+        .data = filtered + 1,
+        .height = height,
+        .width = width,
+        .rowBytes = (size_t)stride + 1,
+    };
+    vImage_Buffer output = {
+        .height = height,
+        .width = width,
+        .rowBytes = (size_t)outputRowBytes,
+    };
+    output.data = malloc(output.rowBytes * output.height);
+    if (!output.data) {
+        return nil;
+    }
+    vImage_Error error = kvImageNoError;
+    switch (colorType) {
+        case MWPNGColorTypeRGBA: {
+            const uint8_t permuteMap[4] = {2, 1, 0, 3};
+            error = vImagePermuteChannels_ARGB8888(&source, &output, permuteMap, kvImageNoFlags);
+            if (error == kvImageNoError) {
+                error = vImagePremultiplyData_BGRA8888(&output, &output, kvImageNoFlags);
+            }
+            break;
+        }
+        case MWPNGColorTypeRGB:
+            error = vImageConvert_RGB888toBGRA8888(&source, NULL, 0xFF, &output, false, kvImageNoFlags);
+            break;
+        case MWPNGColorTypeGray:
+            for (uint32_t y = 0; y < height; y++) {
+                const uint8_t *row = (const uint8_t *)source.data + y * source.rowBytes;
+                uint32_t *pixels = (uint32_t *)((uint8_t *)output.data + y * output.rowBytes);
+                for (uint32_t x = 0; x < width; x++) {
+                    uint32_t v = row[x];
+                    pixels[x] = 0xFF000000 | v << 16 | v << 8 | v;
+                }
+            }
+            break;
+        case MWPNGColorTypeGrayAlpha:
+            for (uint32_t y = 0; y < height; y++) {
+                const uint8_t *row = (const uint8_t *)source.data + y * source.rowBytes;
+                uint32_t *pixels = (uint32_t *)((uint8_t *)output.data + y * output.rowBytes);
+                for (uint32_t x = 0; x < width; x++) {
+                    uint32_t alpha = row[x * 2 + 1];
+                    uint32_t v = (row[x * 2] * alpha + 127) / 255;
+                    pixels[x] = alpha << 24 | v << 16 | v << 8 | v;
+                }
+            }
+            break;
+        case MWPNGColorTypePalette: {
+            // The premultiplied colors, the missing entries are opaque black
+            uint32_t colors[256];
+            for (size_t i = 0; i < 256; i++) {
+                uint32_t rgb = i < paletteCount ? palette[i] : 0;
+                uint32_t alpha = i < transparencyCount ? transparency[i] : 0xFF;
+                uint32_t r = (((rgb >> 16) & 0xFF) * alpha + 127) / 255;
+                uint32_t g = (((rgb >> 8) & 0xFF) * alpha + 127) / 255;
+                uint32_t b = ((rgb & 0xFF) * alpha + 127) / 255;
+                colors[i] = alpha << 24 | r << 16 | g << 8 | b;
+            }
+            uint32_t pixelsPerByte = 8 / bitDepth;
+            uint8_t mask = (uint8_t)((1 << bitDepth) - 1);
+            for (uint32_t y = 0; y < height; y++) {
+                const uint8_t *row = (const uint8_t *)source.data + y * source.rowBytes;
+                uint32_t *pixels = (uint32_t *)((uint8_t *)output.data + y * output.rowBytes);
+                for (uint32_t x = 0; x < width; x++) {
+                    // The first pixel is in the high bits
+                    uint32_t shift = (pixelsPerByte - 1 - x % pixelsPerByte) * bitDepth;
+                    pixels[x] = colors[(row[x / pixelsPerByte] >> shift) & mask];
+                }
+            }
+            break;
+        }
+    }
+    if (error != kvImageNoError) {
+        free(output.data);
+        return nil;
+    }
+
+    // PNG has no reduced resolution decoding, the thumbnail is resampled from the decoded pixels
+    CGSize thumbnailSize = CGSizeZero;
+    NSValue *thumbnailSizeValue = options[MWImageCoderDecodeThumbnailPixelSize];
+    if (thumbnailSizeValue != nil) {
+#if MW_MAC
+        thumbnailSize = thumbnailSizeValue.sizeValue;
+#else
+        thumbnailSize = thumbnailSizeValue.CGSizeValue;
+#endif
+    }
+    if (thumbnailSize.width > 0 && thumbnailSize.height > 0 && (width > thumbnailSize.width || height > thumbnailSize.height)) {
+        BOOL preserveAspectRatio = YES;
+        NSNumber *preserveAspectRatioValue = options[MWImageCoderDecodePreserveAspectRatio];
+        if (preserveAspectRatioValue != nil) {
+            preserveAspectRatio = preserveAspectRatioValue.boolValue;
+        }
+        CGSize targetSize = thumbnailSize;
+        if (preserveAspectRatio) {
+            CGFloat ratio = MIN(thumbnailSize.width / width, thumbnailSize.height / height);
+            targetSize = CGSizeMake(MAX(round(width * ratio), 1), MAX(round(height * ratio), 1));
+        }
+        vImage_Buffer scaledOutput = {
+            .height = targetSize.height,
+            .width = targetSize.width,
+            .rowBytes = MWByteAlign((size_t)targetSize.width * 4, 64),
+        };
+        scaledOutput.data = malloc(scaledOutput.rowBytes * scaledOutput.height);
+        error = scaledOutput.data ? vImageScale_ARGB8888(&output, &scaledOutput, NULL, kvImageHighQualityResampling) : kvImageMemoryAllocationError;
+        free(output.data);
+        if (error != kvImageNoError) {
+            free(scaledOutput.data);
+            return nil;
+        }
+        output = scaledOutput;
+    }
+
+    CGDataProviderRef provider = CGDataProviderCreateWithData(NULL, output.data, output.rowBytes * output.height, MWPNGReleaseBitmapData);
+    if (!provider) {
+        free(output.data);
+        return nil;
+    }
+    CGBitmapInfo bitmapInfo = kCGBitmapByteOrder32Host | (hasAlpha ? kCGImageAlphaPremultipliedFirst : kCGImageAlphaNoneSkipFirst);
+    CGImageRef imageRef = CGImageCreate(output.width, output.height, 8, 32, output.rowBytes, [MWImageCoderHelper colorSpaceGetDeviceRGB], bitmapInfo, provider, NULL, NO, kCGRenderingIntentDefault);
+    CGDataProviderRelease(provider);
+    if (!imageRef) {
+        return nil;
+    }
+    CGFloat scale = 1;
+    NSNumber *scaleFactor = options[MWImageCoderDecodeScaleFactor];
+    if (scaleFactor != nil) {
+        scale = MAX([scaleFactor doubleValue], 1);
+    }
+#if MW_UIKIT || MW_WATCH
+    UIImage *image = [[UIImage alloc] initWithCGImage:imageRef scale:scale orientation:UIImageOrientationUp];
+#else
+    UIImage *image = [[UIImage alloc] initWithCGImage:imageRef scale:scale orientation:kCGImagePropertyOrientationUp];
+#endif
+    CGImageRelease(imageRef);
+    // The same bitmap as `CGImageCreateDecoded`
+    image.MW_iMWecoded = YES;
+    return image;
+}
+
+#endif
+
+#pragma mark - Encode
+
+- (BOOL)canEncodeToFormat:(MWImageFormat)format {
+    return NO;
+}
+
+- (NSData *)encodedDataWithImage:(UIImage *)image format:(MWImageFormat)format options:(nullable MWImageCoderOptions *)options {
+    return nil;
+}
+
+@end
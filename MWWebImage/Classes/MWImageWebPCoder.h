@@ -0,0 +1,31 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "MWImageCoder.h"
+
+// Whether libwebp is linked, with its decode, encode, demux and mux headers
+#if __has_include(<webp/decode.h>) && __has_include(<webp/encode.h>) && __has_include(<webp/demux.h>) && __has_include(<webp/mux.h>)
+#define MW_WEBP 1
+#elif __has_include(<libwebp/decode.h>) && __has_include(<libwebp/encode.h>) && __has_include(<libwebp/demux.h>) && __has_include(<libwebp/mux.h>)
+#define MW_WEBP 1
+#else
+#define MW_WEBP 0
+#endif
+
+/**
+ This coder is used for Google WebP and Animated WebP(AWebP) image format, with libwebp instead of Image/IO, so it works on any firmware version.
+ Compared to `MWImageAWebPCoder`, it decodes with multiple threads, decodes directly at the thumbnail pixel size (`MWImageCoderDecodeThumbnailPixelSize`) instead of scaling the full image, and supports WebP encoding.
+ The animated image frames are composited by the libwebp animation decoder, and decoded on demand with `MWAnimatedImageCoder`.
+ @note This coder is only functional when libwebp is linked (`MW_WEBP` is 1), it's then registered in `MWImageCodersManager` by default. Otherwise, it can't decode nor encode anything.
+ */
+@interface MWImageWebPCoder : NSObject <MWProgressiveImageCoder, MWAnimatedImageCoder>
+
+@property (nonatomic, class, readonly, nonnull) MWImageWebPCoder *sharedCoder;
+
+@end
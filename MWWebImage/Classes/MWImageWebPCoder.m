@@ -0,0 +1,705 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "MWImageWebPCoder.h"
+#import "NMWata+ImageContentType.h"
+#import "UIImage+Metadata.h"
+#import "UIImage+ForceDecode.h"
+#import "NSImage+Compatibility.h"
+#import "MWImageCoderHelper.h"
+#import "MWImageFrame.h"
+#import "MWInternalMacros.h"
+#import <Accelerate/Accelerate.h>
+
+#if MW_WEBP
+#if __has_include(<webp/decode.h>)
+#import <webp/decode.h>
+#import <webp/encode.h>
+#import <webp/demux.h>
+#import <webp/mux.h>
+#else
+#import <libwebp/decode.h>
+#import <libwebp/encode.h>
+#import <libwebp/demux.h>
+#import <libwebp/mux.h>
+#endif
+#endif
+
+#if MW_WEBP
+
+// The pixel size to decode at, the thumbnail pixel size limits the image pixel size like `MWImageIOAnimatedCoder`
+static CGSize MWWebPScaledPixelSize(CGSize pixelSize, CGSize thumbnailSize, BOOL preserveAspectRatio) {
+    if (thumbnailSize.width <= 0 || thumbnailSize.height <= 0 || (pixelSize.width <= thumbnailSize.width && pixelSize.height <= thumbnailSize.height)) {
+        return pixelSize;
+    }
+    if (!preserveAspectRatio) {
+        return thumbnailSize;
+    }
+    CGFloat ratio = MIN(thumbnailSize.width / pixelSize.width, thumbnailSize.height / pixelSize.height);
+    return CGSizeMake(MAX(round(pixelSize.width * ratio), 1), MAX(round(pixelSize.height * ratio), 1));
+}
+
+static void MWWebPReleaseBitmapData(void *info, const void *data, size_t size) {
+    free((void *)data);
+}
+
+// Wrap a premultiplied RGBA buffer, the image frees it
+static CGImageRef MWWebPCreateCGImage(uint8_t *rgba, size_t width, size_t height, size_t stride, BOOL hasAlpha) CF_RETURNS_RETAINED {
+    CGDataProviderRef provider = CGDataProviderCreateWithData(NULL, rgba, stride * height, MWWebPReleaseBitmapData);
+    if (!provider) {
+        free(rgba);
+        return NULL;
+    }
+    CGBitmapInfo bitmapInfo = kCGBitmapByteOrder32Big | (hasAlpha ? kCGImageAlphaPremultipliedLast : kCGImageAlphaNoneSkipLast);
+    CGImageRef imageRef = CGImageCreate(width, height, 8, 32, stride, [MWImageCoderHelper colorSpaceGetDeviceRGB], bitmapInfo, provider, NULL, NO, kCGRenderingIntentDefault);
+    CGDataProviderRelease(provider);
+    return imageRef;
+}
+
+// The RGBA buffers of libwebp are reused or owned by the decoder, copy the pixels out
+static CGImageRef MWWebPCreateCGImageCopyingBuffer(const uint8_t *rgba, size_t width, size_t height, size_t stride, BOOL hasAlpha) CF_RETURNS_RETAINED {
+    size_t bytesPerRow = width * 4;
+    uint8_t *buffer = malloc(bytesPerRow * height);
+    if (!buffer) {
+        return NULL;
+    }
+    for (size_t y = 0; y < height; y++) {
+        memcpy(buffer + y * bytesPerRow, rgba + y * stride, bytesPerRow);
+    }
+    return MWWebPCreateCGImage(buffer, width, height, bytesPerRow, hasAlpha);
+}
+
+static UIImage *MWWebPImageWithCGImage(CGImageRef imageRef, CGFloat scale) {
+#if MW_UIKIT || MW_WATCH
+    return [[UIImage alloc] initWithCGImage:imageRef scale:scale orientation:UIImageOrientationUp];
+#else
+    return [[UIImage alloc] initWithCGImage:imageRef scale:scale orientation:kCGImagePropertyOrientationUp];
+#endif
+}
+
+#endif
+
+@implementation MWImageWebPCoder {
+#if MW_WEBP
+    NSData *_imageData;
+    CGFloat _scale;
+    CGSize _thumbnailSize;
+    BOOL _preserveAspectRatio;
+    // Progressive decoding
+    WebPIDecoder *_idec;
+    WebPDecoderConfig _incrementalConfig;
+    BOOL _incrementalAnimated;
+    BOOL _finished;
+    // Animated decoding
+    WebPAnimDecoder *_animDecoder;
+    WebPAnimInfo _animInfo;
+    NSArray<NSNumber *> *_frameDurations;
+    NSUInteger _nextFrameIndex; // the frame `WebPAnimDecoderGetNext` returns next
+    BOOL _hasAlpha;
+    dispatch_semaphore_t _lock;
+#endif
+}
+
+- (void)dealloc {
+#if MW_WEBP
+    if (_idec) {
+        WebPIDelete(_idec);
+        _idec = NULL;
+        WebPFreeDecBuffer(&_incrementalConfig.output);
+    }
+    if (_animDecoder) {
+        WebPAnimDecoderDelete(_animDecoder);
+        _animDecoder = NULL;
+    }
+#endif
+}
+
++ (instancetype)sharedCoder {
+    static MWImageWebPCoder *coder;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        coder = [[MWImageWebPCoder alloc] init];
+    });
+    return coder;
+}
+
+#pragma mark - Decode
+
+- (BOOL)canDecodeFromData:(nullable NSData *)data {
+#if MW_WEBP
+    return [NSData MW_imageFormatForImageData:data] == MWImageFormatWebP;
+#else
+    return NO;
+#endif
+}
+
+- (UIImage *)decodedImageWithData:(NSData *)data options:(nullable MWImageCoderOptions *)options {
+#if MW_WEBP
+    if (!data) {
+        return nil;
+    }
+    CGFloat scale = 1;
+    NSNumber *scaleFactor = options[MWImageCoderDecodeScaleFactor];
+    if (scaleFactor != nil) {
+        scale = MAX([scaleFactor doubleValue], 1);
+    }
+    CGSize thumbnailSize = CGSizeZero;
+    NSValue *thumbnailSizeValue = options[MWImageCoderDecodeThumbnailPixelSize];
+    if (thumbnailSizeValue != nil) {
+#if MW_MAC
+        thumbnailSize = thumbnailSizeValue.sizeValue;
+#else
+        thumbnailSize = thumbnailSizeValue.CGSizeValue;
+#endif
+    }
+    BOOL preserveAspectRatio = YES;
+    NSNumber *preserveAspectRatioValue = options[MWImageCoderDecodePreserveAspectRatio];
+    if (preserveAspectRatioValue != nil) {
+        preserveAspectRatio = preserveAspectRatioValue.boolValue;
+    }
+
+    WebPBitstreamFeatures features;
+    if (WebPGetFeatures(data.bytes, data.length, &features) != VP8_STATUS_OK) {
+        return nil;
+    }
+    UIImage *image;
+    BOOL decodeFirstFrame = [options[MWImageCoderDecodeFirstFrameOnly] boolValue];
+    if (!features.has_animation) {
+        CGImageRef imageRef = [self.class createStaticImageWithData:data features:&features thumbnailSize:thumbnailSize preserveAspectRatio:preserveAspectRatio];
+        if (!imageRef) {
+            return nil;
+        }
+        image = MWWebPImageWithCGImage(imageRef, scale);
+        CGImageRelease(imageRef);
+    } else {
+        image = [self.class createAnimatedImageWithData:data firstFrameOnly:decodeFirstFrame scale:scale thumbnailSize:thumbnailSize preserveAspectRatio:preserveAspectRatio];
+    }
+    image.MW_imageFormat = MWImageFormatWebP;
+    return image;
+#else
+    return nil;
+#endif
+}
+
+#if MW_WEBP
+
+// Decode a still image at the scaled size directly, with the multithreaded decoder
++ (CGImageRef)createStaticImageWithData:(NSData *)data features:(const WebPBitstreamFeatures *)features thumbnailSize:(CGSize)thumbnailSize preserveAspectRatio:(BOOL)preserveAspectRatio CF_RETURNS_RETAINED {
+    WebPDecoderConfig config;
+    if (!WebPInitDecoderConfig(&config)) {
+        return NULL;
+    }
+    CGSize pixelSize = CGSizeMake(features->width, features->height);
+    CGSize scaledSize = MWWebPScaledPixelSize(pixelSize, thumbnailSize, preserveAspectRatio);
+    size_t width = scaledSize.width;
+    size_t height = scaledSize.height;
+    config.options.use_threads = 1;
+    if (!CGSizeEqualToSize(scaledSize, pixelSize)) {
+        config.options.use_scaling = 1;
+        config.options.scaled_width = (int)width;
+        config.options.scaled_height = (int)height;
+    }
+    BOOL hasAlpha = features->has_alpha;
+    size_t stride = width * 4;
+    uint8_t *rgba = malloc(stride * height);
+    if (!rgba) {
+        return NULL;
+    }
+    // Decode into our buffer, so that the image owns it without a copy
+    config.output.colorspace = hasAlpha ? MODE_rgbA : MODE_RGBA;
+    config.output.is_external_memory = 1;
+    config.output.u.RGBA.rgba = rgba;
+    config.output.u.RGBA.stride = (int)stride;
+    config.output.u.RGBA.size = stride * height;
+    if (WebPDecode(data.bytes, data.length, &config) != VP8_STATUS_OK) {
+        free(rgba);
+        return NULL;
+    }
+    return MWWebPCreateCGImage(rgba, width, height, stride, hasAlpha);
+}
+
+// The animation decoder composites the frames on the canvas, it does not scale, so the frames are scaled after
++ (UIImage *)createAnimatedImageWithData:(NSData *)data firstFrameOnly:(BOOL)firstFrameOnly scale:(CGFloat)scale thumbnailSize:(CGSize)thumbnailSize preserveAspectRatio:(BOOL)preserveAspectRatio {
+    WebPData webpData = {data.bytes, data.length};
+    WebPAnimDecoderOptions decoderOptions;
+    if (!WebPAnimDecoderOptionsInit(&decoderOptions)) {
+        return nil;
+    }
+    decoderOptions.color_mode = MODE_rgbA;
+    decoderOptions.use_threads = 1;
+    WebPAnimDecoder *decoder = WebPAnimDecoderNew(&webpData, &decoderOptions);
+    if (!decoder) {
+        return nil;
+    }
+    @onExit {
+        WebPAnimDecoderDelete(decoder);
+    };
+    WebPAnimInfo info;
+    if (!WebPAnimDecoderGetInfo(decoder, &info)) {
+        return nil;
+    }
+    CGSize scaledSize = MWWebPScaledPixelSize(CGSizeMake(info.canvas_width, info.canvas_height), thumbnailSize, preserveAspectRatio);
+    NSMutableArray<MWImageFrame *> *frames = [NSMutableArray array];
+    int previousTimestamp = 0;
+    while (WebPAnimDecoderHasMoreFrames(decoder)) {
+        uint8_t *canvas;
+        int timestamp;
+        if (!WebPAnimDecoderGetNext(decoder, &canvas, &timestamp)) {
+            break;
+        }
+        CGImageRef imageRef = MWWebPCreateCGImageCopyingBuffer(canvas, info.canvas_width, info.canvas_height, info.canvas_width * 4, YES);
+        if (!imageRef) {
+            break;
+        }
+        if (scaledSize.width != info.canvas_width || scaledSize.height != info.canvas_height) {
+            CGImageRef scaledImageRef = [MWImageCoderHelper CGImageCreateScaled:imageRef size:scaledSize];
+            CGImageRelease(imageRef);
+            imageRef = scaledImageRef;
+        }
+        UIImage *image = MWWebPImageWithCGImage(imageRef, scale);
+        CGImageRelease(imageRef);
+        if (firstFrameOnly) {
+            return image;
+        }
+        [frames addObject:[MWImageFrame frameWithImage:image duration:(timestamp - previousTimestamp) / 1000.0]];
+        previousTimestamp = timestamp;
+    }
+    UIImage *animatedImage = [MWImageCoderHelper animatedImageWithFrames:frames];
+    animatedImage.MW_imageLoopCount = info.loop_count;
+    return animatedImage;
+}
+
+#endif
+
+#pragma mark - Progressive Decode
+
+- (BOOL)canIncrementalDecodeFromData:(NSData *)data {
+    return [self canDecodeFromData:data];
+}
+
+- (instancetype)initIncrementalWithOptions:(nullable MWImageCoderOptions *)options {
+    self = [super init];
+#if MW_WEBP
+    if (self) {
+        CGFloat scale = 1;
+        NSNumber *scaleFactor = options[MWImageCoderDecodeScaleFactor];
+        if (scaleFactor != nil) {
+            scale = MAX([scaleFactor doubleValue], 1);
+        }
+        _scale = scale;
+        CGSize thumbnailSize = CGSizeZero;
+        NSValue *thumbnailSizeValue = options[MWImageCoderDecodeThumbnailPixelSize];
+        if (thumbnailSizeValue != nil) {
+#if MW_MAC
+            thumbnailSize = thumbnailSizeValue.sizeValue;
+#else
+            thumbnailSize = thumbnailSizeValue.CGSizeValue;
+#endif
+        }
+        _thumbnailSize = thumbnailSize;
+        BOOL preserveAspectRatio = YES;
+        NSNumber *preserveAspectRatioValue = options[MWImageCoderDecodePreserveAspectRatio];
+        if (preserveAspectRatioValue != nil) {
+            preserveAspectRatio = preserveAspectRatioValue.boolValue;
+        }
+        _preserveAspectRatio = preserveAspectRatio;
+    }
+#endif
+    return self;
+}
+
+- (void)updateIncrementalData:(NSData *)data finished:(BOOL)finished {
+#if MW_WEBP
+    if (_finished) {
+        return;
+    }
+    _imageData = data;
+    _finished = finished;
+    if (!_idec && !_incrementalAnimated) {
+        // The size is needed to set the scaled decoding up
+        WebPBitstreamFeatures features;
+        if (WebPGetFeatures(data.bytes, data.length, &features) != VP8_STATUS_OK) {
+            return;
+        }
+        if (features.has_animation) {
+            // The incremental decoder does not support animation, the first frame is decoded once finished
+            _incrementalAnimated = YES;
+            return;
+        }
+        if (!WebPInitDecoderConfig(&_incrementalConfig)) {
+            return;
+        }
+        CGSize pixelSize = CGSizeMake(features.width, features.height);
+        CGSize scaledSize = MWWebPScaledPixelSize(pixelSize, _thumbnailSize, _preserveAspectRatio);
+        _incrementalConfig.options.use_threads = 1;
+        if (!CGSizeEqualToSize(scaledSize, pixelSize)) {
+            _incrementalConfig.options.use_scaling = 1;
+            _incrementalConfig.options.scaled_width = scaledSize.width;
+            _incrementalConfig.options.scaled_height = scaledSize.height;
+        }
+        _hasAlpha = features.has_alpha;
+        _incrementalConfig.output.colorspace = MODE_rgbA;
+        _idec = WebPIDecode(NULL, 0, &_incrementalConfig);
+    }
+    if (_idec) {
+        // The data always starts from the first byte, the decoder continues from where it stopped
+        VP8StatusCode status = WebPIUpdate(_idec, data.bytes, data.length);
+        if (status != VP8_STATUS_OK && status != VP8_STATUS_SUSPENDED) {
+            WebPIDelete(_idec);
+            _idec = NULL;
+            WebPFreeDecBuffer(&_incrementalConfig.output);
+        }
+    }
+#endif
+}
+
+- (UIImage *)incrementalDecodedImageWithOptions:(MWImageCoderOptions *)options {
+#if MW_WEBP
+    CGFloat scale = _scale;
+    NSNumber *scaleFactor = options[MWImageCoderDecodeScaleFactor];
+    if (scaleFactor != nil) {
+        scale = MAX([scaleFactor doubleValue], 1);
+    }
+    if (_incrementalAnimated) {
+        if (!_finished) {
+            return nil;
+        }
+        UIImage *image = [self.class createAnimatedImageWithData:_imageData firstFrameOnly:YES scale:scale thumbnailSize:_thumbnailSize preserveAspectRatio:_preserveAspectRatio];
+        image.MW_imageFormat = MWImageFormatWebP;
+        return image;
+    }
+    if (!_idec) {
+        return nil;
+    }
+    int lastY = 0, width = 0, height = 0, stride = 0;
+    const uint8_t *rgba = WebPIDecGetRGB(_idec, &lastY, &width, &height, &stride);
+    if (!rgba || lastY <= 0 || width <= 0 || height <= 0) {
+        return nil;
+    }
+    // The rows not decoded yet stay transparent
+    size_t bytesPerRow = (size_t)width * 4;
+    uint8_t *buffer = calloc((size_t)height, bytesPerRow);
+    if (!buffer) {
+        return nil;
+    }
+    for (int y = 0; y < lastY; y++) {
+        memcpy(buffer + y * bytesPerRow, rgba + y * stride, bytesPerRow);
+    }
+    BOOL hasAlpha = _hasAlpha || lastY < height;
+    CGImageRef imageRef = MWWebPCreateCGImage(buffer, width, height, bytesPerRow, hasAlpha);
+    if (!imageRef) {
+        return nil;
+    }
+    UIImage *image = MWWebPImageWithCGImage(imageRef, scale);
+    CGImageRelease(imageRef);
+    image.MW_imageFormat = MWImageFormatWebP;
+    return image;
+#else
+    return nil;
+#endif
+}
+
+#pragma mark - Encode
+
+- (BOOL)canEncodeToFormat:(MWImageFormat)format {
+#if MW_WEBP
+    return format == MWImageFormatWebP;
+#else
+    return NO;
+#endif
+}
+
+- (NSData *)encodedDataWithImage:(UIImage *)image format:(MWImageFormat)format options:(nullable MWImageCoderOptions *)options {
+#if MW_WEBP
+    if (!image || format != MWImageFormatWebP) {
+        return nil;
+    }
+    CGImageRef imageRef = image.CGImage;
+    if (!imageRef) {
+        return nil;
+    }
+    double compressionQuality = 1;
+    if (options[MWImageCoderEncodeCompressionQuality]) {
+        compressionQuality = [options[MWImageCoderEncodeCompressionQuality] doubleValue];
+    }
+    WebPConfig config;
+    if (!WebPConfigPreset(&config, WEBP_PRESET_DEFAULT, MIN(MAX(compressionQuality, 0), 1) * 100)) {
+        return nil;
+    }
+    config.thread_level = 1;
+    NSUInteger maxFileSize = [options[MWImageCoderEncodeMaxFileSize] unsignedIntegerValue];
+    if (maxFileSize > 0) {
+        config.target_size = (int)MIN(maxFileSize, INT_MAX);
+    }
+    if (!WebPValidateConfig(&config)) {
+        return nil;
+    }
+    CGSize maxPixelSize = CGSizeZero;
+    NSValue *maxPixelSizeValue = options[MWImageCoderEncodeMaxPixelSize];
+    if (maxPixelSizeValue != nil) {
+#if MW_MAC
+        maxPixelSize = maxPixelSizeValue.sizeValue;
+#else
+        maxPixelSize = maxPixelSizeValue.CGSizeValue;
+#endif
+    }
+    CGSize pixelSize = CGSizeMake(CGImageGetWidth(imageRef), CGImageGetHeight(imageRef));
+    CGSize encodedSize = MWWebPScaledPixelSize(pixelSize, maxPixelSize, YES);
+
+    NSArray<MWImageFrame *> *frames = [MWImageCoderHelper framesFromAnimatedImage:image];
+    BOOL encodeFirstFrame = [options[MWImageCoderEncodeFirstFrameOnly] boolValue];
+    if (encodeFirstFrame || frames.count == 0) {
+        WebPPicture picture;
+        if (![self.class importImage:imageRef size:encodedSize intoPicture:&picture]) {
+            return nil;
+        }
+        WebPMemoryWriter writer;
+        WebPMemoryWriterInit(&writer);
+        picture.writer = WebPMemoryWrite;
+        picture.custom_ptr = &writer;
+        int result = WebPEncode(&config, &picture);
+        WebPPictureFree(&picture);
+        NSData *data = result ? [NSData dataWithBytes:writer.mem length:writer.size] : nil;
+        WebPMemoryWriterClear(&writer);
+        return data;
+    }
+
+    WebPAnimEncoderOptions encoderOptions;
+    if (!WebPAnimEncoderOptionsInit(&encoderOptions)) {
+        return nil;
+    }
+    encoderOptions.anim_params.loop_count = (int)image.MW_imageLoopCount;
+    WebPAnimEncoder *encoder = WebPAnimEncoderNew((int)encodedSize.width, (int)encodedSize.height, &encoderOptions);
+    if (!encoder) {
+        return nil;
+    }
+    @onExit {
+        WebPAnimEncoderDelete(encoder);
+    };
+    int timestamp = 0;
+    for (MWImageFrame *frame in frames) {
+        CGImageRef frameImageRef = frame.image.CGImage;
+        WebPPicture picture;
+        if (!frameImageRef || ![self.class importImage:frameImageRef size:encodedSize intoPicture:&picture]) {
+            return nil;
+        }
+        int result = WebPAnimEncoderAdd(encoder, &picture, timestamp, &config);
+        WebPPictureFree(&picture);
+        if (!result) {
+            return nil;
+        }
+        timestamp += (int)round(frame.duration * 1000);
+    }
+    // The last call gives the duration of the last frame
+    if (!WebPAnimEncoderAdd(encoder, NULL, timestamp, NULL)) {
+        return nil;
+    }
+    WebPData webpData;
+    WebPDataInit(&webpData);
+    if (!WebPAnimEncoderAssemble(encoder, &webpData)) {
+        return nil;
+    }
+    NSData *data = [NSData dataWithBytes:webpData.bytes length:webpData.size];
+    WebPDataClear(&webpData);
+    return data;
+#else
+    return nil;
+#endif
+}
+
+#if MW_WEBP
+
+// The picture takes straight (not premultiplied) RGBA, at the encoded size
++ (BOOL)importImage:(CGImageRef)imageRef size:(CGSize)size intoPicture:(WebPPicture *)picture {
+    if (!WebPPictureInit(picture)) {
+        return NO;
+    }
+    CGImageRef scaledImageRef = [MWImageCoderHelper CGImageCreateScaled:imageRef size:size];
+    if (!scaledImageRef) {
+        return NO;
+    }
+    vImage_CGImageFormat format = (vImage_CGImageFormat) {
+        .bitsPerComponent = 8,
+        .bitsPerPixel = 32,
+        .colorSpace = NULL,
+        .bitmapInfo = kCGBitmapByteOrder32Big | kCGImageAlphaLast,
+        .version = 0,
+        .decode = NULL,
+        .renderingIntent = kCGRenderingIntentDefault,
+    };
+    vImage_Buffer buffer = {};
+    vImage_Error error = vImageBuffer_InitWithCGImage(&buffer, &format, NULL, scaledImageRef, kvImageNoFlags);
+    CGImageRelease(scaledImageRef);
+    if (error != kvImageNoError) {
+        return NO;
+    }
+    picture->use_argb = 1;
+    picture->width = (int)buffer.width;
+    picture->height = (int)buffer.height;
+    int result = WebPPictureImportRGBA(picture, buffer.data, (int)buffer.rowBytes);
+    free(buffer.data);
+    if (!result) {
+        WebPPictureFree(picture);
+        return NO;
+    }
+    return YES;
+}
+
+#endif
+
+#pragma mark - MWAnimatedImageCoder
+
+- (nullable instancetype)initWithAnimatedImageData:(nullable NSData *)data options:(nullable MWImageCoderOptions *)options {
+#if MW_WEBP
+    if (!data) {
+        return nil;
+    }
+    self = [super init];
+    if (self) {
+        WebPData webpData = {data.bytes, data.length};
+        WebPDemuxer *demuxer = WebPDemux(&webpData);
+        if (!demuxer) {
+            return nil;
+        }
+        // The durations come from the frame headers, without decoding
+        uint32_t frameCount = WebPDemuxGetI(demuxer, WEBP_FF_FRAME_COUNT);
+        NSMutableArray<NSNumber *> *frameDurations = [NSMutableArray arrayWithCapacity:frameCount];
+        WebPIterator iterator;
+        if (WebPDemuxGetFrame(demuxer, 1, &iterator)) {
+            do {
+                [frameDurations addObject:@(iterator.duration / 1000.0)];
+            } while (WebPDemuxNextFrame(&iterator));
+            WebPDemuxReleaseIterator(&iterator);
+        }
+        WebPDemuxDelete(demuxer);
+        if (frameDurations.count == 0) {
+            return nil;
+        }
+        WebPAnimDecoderOptions decoderOptions;
+        if (!WebPAnimDecoderOptionsInit(&decoderOptions)) {
+            return nil;
+        }
+        decoderOptions.color_mode = MODE_rgbA;
+        decoderOptions.use_threads = 1;
+        // The decoder reads the data in place, `_imageData` keeps it alive
+        _animDecoder = WebPAnimDecoderNew(&webpData, &decoderOptions);
+        if (!_animDecoder || !WebPAnimDecoderGetInfo(_animDecoder, &_animInfo)) {
+            return nil;
+        }
+        _imageData = data;
+        _frameDurations = [frameDurations copy];
+        CGFloat scale = 1;
+        NSNumber *scaleFactor = options[MWImageCoderDecodeScaleFactor];
+        if (scaleFactor != nil) {
+            scale = MAX([scaleFactor doubleValue], 1);
+        }
+        _scale = scale;
+        CGSize thumbnailSize = CGSizeZero;
+        NSValue *thumbnailSizeValue = options[MWImageCoderDecodeThumbnailPixelSize];
+        if (thumbnailSizeValue != nil) {
+#if MW_MAC
+            thumbnailSize = thumbnailSizeValue.sizeValue;
+#else
+            thumbnailSize = thumbnailSizeValue.CGSizeValue;
+#endif
+        }
+        _thumbnailSize = thumbnailSize;
+        BOOL preserveAspectRatio = YES;
+        NSNumber *preserveAspectRatioValue = options[MWImageCoderDecodePreserveAspectRatio];
+        if (preserveAspectRatioValue != nil) {
+            preserveAspectRatio = preserveAspectRatioValue.boolValue;
+        }
+        _preserveAspectRatio = preserveAspectRatio;
+        _lock = dispatch_semaphore_create(1);
+    }
+    return self;
+#else
+    return nil;
+#endif
+}
+
+- (NSData *)animatedImageData {
+#if MW_WEBP
+    return _imageData;
+#else
+    return nil;
+#endif
+}
+
+- (NSUInteger)animatedImageLoopCount {
+#if MW_WEBP
+    return _animInfo.loop_count;
+#else
+    return 0;
+#endif
+}
+
+- (NSUInteger)animatedImageFrameCount {
+#if MW_WEBP
+    return _frameDurations.count;
+#else
+    return 0;
+#endif
+}
+
+- (NSTimeInterval)animatedImageDurationAtIndex:(NSUInteger)index {
+#if MW_WEBP
+    if (index >= _frameDurations.count) {
+        return 0;
+    }
+    return _frameDurations[index].doubleValue;
+#else
+    return 0;
+#endif
+}
+
+- (UIImage *)animatedImageFrameAtIndex:(NSUInteger)index {
+#if MW_WEBP
+    if (index >= _frameDurations.count) {
+        return nil;
+    }
+    MW_LOCK(_lock);
+    // A frame is composited over the previous ones, so the decoder only moves forward. The player asks in order, going back restarts from the first frame
+    if (index < _nextFrameIndex) {
+        WebPAnimDecoderReset(_animDecoder);
+        _nextFrameIndex = 0;
+    }
+    uint8_t *canvas = NULL;
+    while (_nextFrameIndex <= index) {
+        int timestamp;
+        if (!WebPAnimDecoderGetNext(_animDecoder, &canvas, &timestamp)) {
+            canvas = NULL;
+            break;
+        }
+        _nextFrameIndex++;
+    }
+    CGImageRef imageRef = canvas ? MWWebPCreateCGImageCopyingBuffer(canvas, _animInfo.canvas_width, _animInfo.canvas_height, _animInfo.canvas_width * 4, YES) : NULL;
+    MW_UNLOCK(_lock);
+    if (!imageRef) {
+        return nil;
+    }
+    CGSize scaledSize = MWWebPScaledPixelSize(CGSizeMake(_animInfo.canvas_width, _animInfo.canvas_height), _thumbnailSize, _preserveAspectRatio);
+    if (scaledSize.width != _animInfo.canvas_width || scaledSize.height != _animInfo.canvas_height) {
+        CGImageRef scaledImageRef = [MWImageCoderHelper CGImageCreateScaled:imageRef size:scaledSize];
+        CGImageRelease(imageRef);
+        imageRef = scaledImageRef;
+        if (!imageRef) {
+            return nil;
+        }
+    }
+    UIImage *image = MWWebPImageWithCGImage(imageRef, _scale);
+    CGImageRelease(imageRef);
+    image.MW_imageFormat = MWImageFormatWebP;
+    image.MW_iMWecoded = YES;
+    return image;
+#else
+    return nil;
+#endif
+}
+
+@end
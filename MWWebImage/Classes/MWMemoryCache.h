@@ -7,6 +7,7 @@
  */
 
 #import "MWWebImageCompat.h"
+#import "MWMemoryCacheStatistics.h"
 
 @class MWImageCacheConfig;
 /**
@@ -75,4 +76,30 @@
 
 @property (nonatomic, strong, nonnull, readonly) MWImageCacheConfig *config;
 
+/**
+ Returns an image which shares the bitmap of an identical image seen before, or the image itself if there is none.
+ The scale, orientation and metadata of the image are kept, only the bitmap is shared.
+ @note This hashes a few rows of the bitmap, and compares the whole bitmaps when they match an image seen before, call it off the main thread. Hand out and store the returned image instead of the original one, else both bitmaps stay alive.
+ @note This returns the image as is unless `MWImageCacheConfig.shouldDeduplicateImagesInMemory` is enabled.
+ */
+- (nonnull UIImage *)deduplicatedImageWithImage:(nonnull UIImage *)image;
+
+/**
+ The number of images which shared the bitmap of an identical image instead of holding their own copy.
+ @note This only counts when `MWImageCacheConfig.shouldDeduplicateImagesInMemory` is enabled.
+ */
+@property (nonatomic, assign, readonly) NSUInteger deduplicatedCount;
+
+/**
+ The total bytes saved by sharing identical bitmaps, summed over `deduplicatedCount`. The bytes of each shared image are the `MW_memoryCost` it would have held on its own, which is only freed once the original image is released.
+ @note This only counts when `MWImageCacheConfig.shouldDeduplicateImagesInMemory` is enabled.
+ */
+@property (nonatomic, assign, readonly) NSUInteger deduplicatedBytes;
+
+/**
+ A snapshot of the hit, miss and eviction count, and the estimated hit ratio at other budgets.
+ @note This is nil unless `MWImageCacheConfig.shouldRecordMemoryCacheStatistics` is enabled.
+ */
+@property (nonatomic, strong, readonly, nullable) MWMemoryCacheStatistics *statistics;
+
 @end
@@ -9,13 +9,123 @@
 #import "MWMemoryCache.h"
 #import "MWImageCacheConfig.h"
 #import "UIImage+MemoryCacheCost.h"
+#import "UIImage+Metadata.h"
+#import "UIImage+ForceDecode.h"
+#import "NSImage+Compatibility.h"
+#import "MWAnimatedImage.h"
+#import "MWAssociatedObject.h"
+#import "MWMemoryCacheStatisticsInternal.h"
+#import "MWImageCoderHelper.h"
 #import "MWInternalMacros.h"
+#import <CommonCrypto/CommonDigest.h>
 
 static void * MWMemoryCacheContext = &MWMemoryCacheContext;
 
-@interface MWMemoryCache <KeyType, ObjectType> ()
+// The rows of the bitmap in the fingerprint, spread from the top to the bottom
+static const size_t kMWMemoryCacheFingerprintRowCount = 16;
+// Pruning the dead digests once the shared bitmaps doubled since the last pruning, at least this many
+static const NSUInteger kMWMemoryCacheSharedBitmapsMinPruneCount = 64;
+
+// SHA-256 of the bitmap layout and a few rows drawn out of the bitmap, without copying the rest of it. Matching fingerprints are not proof, the whole bitmaps are compared then
+static NSData *MWMemoryCacheFingerprintImage(CGImageRef imageRef) {
+    size_t width = CGImageGetWidth(imageRef);
+    size_t height = CGImageGetHeight(imageRef);
+    if (width == 0 || height == 0) {
+        return nil;
+    }
+    size_t rowCount = MIN(height, kMWMemoryCacheFingerprintRowCount);
+    size_t bytesPerRow = width * 4;
+    void *rows = calloc(rowCount, bytesPerRow);
+    if (!rows) {
+        return nil;
+    }
+    CGContextRef context = CGBitmapContextCreate(rows, width, rowCount, 8, bytesPerRow, [MWImageCoderHelper colorSpaceGetDeviceRGB], kCGBitmapByteOrder32Host | kCGImageAlphaPremultipliedFirst);
+    if (!context) {
+        free(rows);
+        return nil;
+    }
+    CGContextSetBlendMode(context, kCGBlendModeCopy);
+    CGContextSetInterpolationQuality(context, kCGInterpolationNone);
+    for (size_t i = 0; i < rowCount; i++) {
+        size_t row = rowCount > 1 ? i * (height - 1) / (rowCount - 1) : 0;
+        CGImageRef rowImageRef = CGImageCreateWithImageInRect(imageRef, CGRectMake(0, row, width, 1));
+        if (rowImageRef) {
+            // The context origin is at the bottom left
+            CGContextDrawImage(context, CGRectMake(0, rowCount - 1 - i, width, 1), rowImageRef);
+            CGImageRelease(rowImageRef);
+        }
+    }
+    CGContextRelease(context);
+
+    size_t layout[5] = {width, height, CGImageGetBytesPerRow(imageRef), CGImageGetBitsPerPixel(imageRef), CGImageGetBitmapInfo(imageRef)};
+    CC_SHA256_CTX sha;
+    CC_SHA256_Init(&sha);
+    CC_SHA256_Update(&sha, layout, sizeof(layout));
+    // A few rows, far within the 32 bits of `CC_LONG`
+    CC_SHA256_Update(&sha, rows, (CC_LONG)(rowCount * bytesPerRow));
+    free(rows);
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256_Final(digest, &sha);
+    return [NSData dataWithBytes:digest length:CC_SHA256_DIGEST_LENGTH];
+}
+
+// Compares the whole bitmaps, only done when the fingerprints match
+static BOOL MWMemoryCacheBitmapsAreEqual(CGImageRef imageRef, CGImageRef otherImageRef) {
+    if (CGImageGetWidth(imageRef) != CGImageGetWidth(otherImageRef)
+        || CGImageGetHeight(imageRef) != CGImageGetHeight(otherImageRef)
+        || CGImageGetBytesPerRow(imageRef) != CGImageGetBytesPerRow(otherImageRef)
+        || CGImageGetBitsPerPixel(imageRef) != CGImageGetBitsPerPixel(otherImageRef)
+        || CGImageGetBitmapInfo(imageRef) != CGImageGetBitmapInfo(otherImageRef)
+        || !CFEqual(CGImageGetColorSpace(imageRef), CGImageGetColorSpace(otherImageRef))) {
+        return NO;
+    }
+    CFDataRef data = CGDataProviderCopyData(CGImageGetDataProvider(imageRef));
+    CFDataRef otherData = CGDataProviderCopyData(CGImageGetDataProvider(otherImageRef));
+    BOOL equal = data && otherData && CFDataGetLength(data) == CFDataGetLength(otherData) && memcmp(CFDataGetBytePtr(data), CFDataGetBytePtr(otherData), CFDataGetLength(data)) == 0;
+    if (data) {
+        CFRelease(data);
+    }
+    if (otherData) {
+        CFRelease(otherData);
+    }
+    return equal;
+}
+
+// An entry with no recorded rebuild cost still costs at least a disk read to bring back
+static const NSTimeInterval kMWMemoryCacheMinimumRebuildCost = 0.001;
+
+/// The GreedyDual-Size bookkeeping of one memory cache entry
+@interface MWMemoryCacheCostEntry : NSObject
+
+@property (nonatomic, strong, nonnull) id key;
+@property (nonatomic, assign) NSUInteger cost; // bytes
+@property (nonatomic, assign) NSTimeInterval rebuildCost; // seconds
+@property (nonatomic, assign) double priority; // the GreedyDual-Size `H`, lowest is evicted first
+@property (nonatomic, assign) NSUInteger heapIndex;
+@property (nonatomic, weak, nullable) id object; // the cached object, to find the entry when `NSCache` evicts it
+
+@end
+
+@implementation MWMemoryCacheCostEntry
+@end
+
+@interface MWMemoryCache <KeyType, ObjectType> () <NSCacheDelegate>
 
 @property (nonatomic, strong, nullable) MWImageCacheConfig *config;
+@property (nonatomic, strong, nonnull) NSMapTable<NSData *, UIImage *> *sharedBitmaps; // fingerprint -> weak image which owns the shared bitmap
+@property (nonatomic, assign) NSUInteger sharedBitmapsPrunedCount; // the count of `sharedBitmaps` after the last pruning of the dead images
+@property (nonatomic, strong, nonnull) dispatch_semaphore_t sharedBitmapsLock; // a lock to keep the access to `sharedBitmaps` and the dedup counters thread-safe
+@property (nonatomic, assign, readwrite) NSUInteger deduplicatedCount;
+@property (nonatomic, assign, readwrite) NSUInteger deduplicatedBytes;
+@property (nonatomic, assign) MWImageCacheConfigMemoryEvictionType evictionType; // captured at init, not dynamic
+@property (nonatomic, assign, readonly, getter=isCostAware) BOOL costAware;
+@property (nonatomic, strong, nonnull) NSMutableDictionary<KeyType, MWMemoryCacheCostEntry *> *costEntries;
+@property (nonatomic, strong, nonnull) NSMutableArray<MWMemoryCacheCostEntry *> *costHeap; // min-heap on priority
+@property (nonatomic, strong, nonnull) NSMapTable<id, MWMemoryCacheCostEntry *> *costEntriesByObject; // weak object -> entry, compared by pointer
+@property (nonatomic, assign) double costInflation; // the GreedyDual-Size `L`, raised to the priority of each evicted entry
+@property (nonatomic, assign) NSUInteger totalCost;
+@property (nonatomic, strong, nonnull) dispatch_semaphore_t costLock; // a lock to keep the access to the GreedyDual-Size bookkeeping thread-safe
+@property (nonatomic, strong, nullable) MWMemoryCacheStatisticsRecorder *statisticsRecorder; // nil if disabled, captured at init
 #if MW_UIKIT
 @property (nonatomic, strong, nonnull) NSMapTable<KeyType, ObjectType> *weakCache; // strong-weak cache
 @property (nonatomic, strong, nonnull) dispatch_semaphore_t weakCacheLock; // a lock to keep the access to `weakCache` thread-safe
@@ -53,11 +163,32 @@ static void * MWMemoryCacheContext = &MWMemoryCacheContext;
 
 - (void)commonInit {
     MWImageCacheConfig *config = self.config;
-    self.totalCostLimit = config.maxMemoryCost;
-    self.countLimit = config.maxMemoryCount;
+    self.evictionType = config.memoryCacheEvictionType;
+    if (self.evictionType == MWImageCacheConfigMemoryEvictionTypeGreedyDualSize) {
+        // We evict by ourselves, `NSCache` only purges under system memory pressure
+        self.totalCostLimit = 0;
+        self.countLimit = 0;
+    } else {
+        self.totalCostLimit = config.maxMemoryCost;
+        self.countLimit = config.maxMemoryCount;
+    }
+    self.costEntries = [NSMutableDictionary dictionary];
+    self.costHeap = [NSMutableArray array];
+    self.costEntriesByObject = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality valueOptions:NSPointerFunctionsStrongMemory capacity:0];
+    self.costLock = dispatch_semaphore_create(1);
+    if (self.isCostAware) {
+        // Told about the purges under system memory pressure, to keep the bookkeeping in sync
+        self.delegate = self;
+    }
+    if (config.shouldRecordMemoryCacheStatistics) {
+        self.statisticsRecorder = [[MWMemoryCacheStatisticsRecorder alloc] initWithConfig:config];
+    }
 
     [config addObserver:self forKeyPath:NSStringFromSelector(@selector(maxMemoryCost)) options:0 context:MWMemoryCacheContext];
     [config addObserver:self forKeyPath:NSStringFromSelector(@selector(maxMemoryCount)) options:0 context:MWMemoryCacheContext];
+    
+    self.sharedBitmaps = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsStrongMemory valueOptions:NSPointerFunctionsWeakMemory capacity:0];
+    self.sharedBitmapsLock = dispatch_semaphore_create(1);
 
 #if MW_UIKIT
     self.weakCache = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsStrongMemory valueOptions:NSPointerFunctionsWeakMemory capacity:0];
@@ -70,16 +201,269 @@ static void * MWMemoryCacheContext = &MWMemoryCacheContext;
 #endif
 }
 
-// Current this seems no use on macOS (macOS use virtual memory and do not clear cache when memory warning). So we only override on iOS/tvOS platform.
-#if MW_UIKIT
-- (void)didReceiveMemoryWarning:(NSNotification *)notification {
-    // Only remove cache, but keep weak cache
-    [super removeAllObjects];
+#pragma mark - Deduplication
+
+- (UIImage *)deduplicatedImageWithImage:(UIImage *)image {
+    if (!self.config.shouldDeduplicateImagesInMemory || ![image isKindOfClass:[UIImage class]]) {
+        return image;
+    }
+    // Only decoded static bitmaps, reading the pixels of a lazy image would trigger a full decode
+    if (!image.MW_iMWecoded || image.MW_isAnimated || [image.class conformsToProtocol:@protocol(MWAnimatedImage)]) {
+        return image;
+    }
+    CGImageRef imageRef = image.CGImage;
+    if (!imageRef) {
+        return image;
+    }
+    NSData *fingerprint = MWMemoryCacheFingerprintImage(imageRef);
+    if (!fingerprint) {
+        return image;
+    }
+    
+    // The lookup and the insert are done under one lock, so two identical images stored at once still end up sharing one bitmap
+    MW_LOCK(self.sharedBitmapsLock);
+    UIImage *sharedImage = [self.sharedBitmaps objectForKey:fingerprint];
+    if (!sharedImage) {
+        // First one with these pixels, it owns the bitmap from now on
+        [self.sharedBitmaps setObject:image forKey:fingerprint];
+        [self pruneSharedBitmapsIfNeeded];
+    }
+    MW_UNLOCK(self.sharedBitmapsLock);
+    if (!sharedImage || sharedImage.CGImage == imageRef) {
+        return image;
+    }
+    if (!MWMemoryCacheBitmapsAreEqual(sharedImage.CGImage, imageRef)) {
+        // Only the fingerprinted rows are the same, this one keeps its own bitmap
+        return image;
+    }
+    MW_LOCK(self.sharedBitmapsLock);
+    _deduplicatedCount += 1;
+    _deduplicatedBytes += image.MW_memoryCost;
+    MW_UNLOCK(self.sharedBitmapsLock);
+    
+    // Keep the scale, orientation and metadata of the image, only the bitmap is shared
+#if MW_MAC
+    UIImage *deduplicatedImage = [[NSImage alloc] initWithCGImage:sharedImage.CGImage scale:image.scale orientation:kCGImagePropertyOrientationUp];
+#else
+    UIImage *deduplicatedImage = [[UIImage alloc] initWithCGImage:sharedImage.CGImage scale:image.scale orientation:image.imageOrientation];
+#endif
+    MWImageCopyAssociatedObject(image, deduplicatedImage);
+    return deduplicatedImage;
+}
+
+// Must be called with `sharedBitmapsLock` held. The weak images are gone with their bitmap, but not their fingerprint
+- (void)pruneSharedBitmapsIfNeeded {
+    NSUInteger count = self.sharedBitmaps.count;
+    if (count < MAX(self.sharedBitmapsPrunedCount * 2, kMWMemoryCacheSharedBitmapsMinPruneCount)) {
+        return;
+    }
+    NSMutableArray<NSData *> *deadFingerprints = [NSMutableArray array];
+    for (NSData *fingerprint in self.sharedBitmaps.keyEnumerator) {
+        if (![self.sharedBitmaps objectForKey:fingerprint]) {
+            [deadFingerprints addObject:fingerprint];
+        }
+    }
+    for (NSData *fingerprint in deadFingerprints) {
+        [self.sharedBitmaps removeObjectForKey:fingerprint];
+    }
+    self.sharedBitmapsPrunedCount = self.sharedBitmaps.count;
+}
+
+- (NSUInteger)deduplicatedCount {
+    MW_LOCK(self.sharedBitmapsLock);
+    NSUInteger count = _deduplicatedCount;
+    MW_UNLOCK(self.sharedBitmapsLock);
+    return count;
+}
+
+- (NSUInteger)deduplicatedBytes {
+    MW_LOCK(self.sharedBitmapsLock);
+    NSUInteger bytes = _deduplicatedBytes;
+    MW_UNLOCK(self.sharedBitmapsLock);
+    return bytes;
+}
+
+#pragma mark - GreedyDual-Size
+
+- (BOOL)isCostAware {
+    return self.evictionType == MWImageCacheConfigMemoryEvictionTypeGreedyDualSize;
+}
+
+- (double)priorityForCostEntry:(MWMemoryCacheCostEntry *)entry {
+    // Seconds to rebuild per byte held, aged by the inflation so that recently used entries win over stale ones
+    NSTimeInterval rebuildCost = MAX(entry.rebuildCost, kMWMemoryCacheMinimumRebuildCost);
+    return self.costInflation + rebuildCost / MAX(entry.cost, 1);
+}
+
+- (void)swapCostHeapAtIndex:(NSUInteger)index withIndex:(NSUInteger)otherIndex {
+    [self.costHeap exchangeObjectAtIndex:index withObjectAtIndex:otherIndex];
+    self.costHeap[index].heapIndex = index;
+    self.costHeap[otherIndex].heapIndex = otherIndex;
+}
+
+- (void)fixCostHeapAtIndex:(NSUInteger)index {
+    NSMutableArray<MWMemoryCacheCostEntry *> *heap = self.costHeap;
+    // Sift up
+    while (index > 0) {
+        NSUInteger parent = (index - 1) / 2;
+        if (heap[parent].priority <= heap[index].priority) {
+            break;
+        }
+        [self swapCostHeapAtIndex:index withIndex:parent];
+        index = parent;
+    }
+    // Sift down
+    NSUInteger count = heap.count;
+    while (YES) {
+        NSUInteger smallest = index;
+        NSUInteger left = index * 2 + 1;
+        NSUInteger right = left + 1;
+        if (left < count && heap[left].priority < heap[smallest].priority) {
+            smallest = left;
+        }
+        if (right < count && heap[right].priority < heap[smallest].priority) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            break;
+        }
+        [self swapCostHeapAtIndex:index withIndex:smallest];
+        index = smallest;
+    }
+}
+
+// Must be called with `costLock` held
+- (void)removeCostEntry:(MWMemoryCacheCostEntry *)entry {
+    NSUInteger index = entry.heapIndex;
+    NSUInteger lastIndex = self.costHeap.count - 1;
+    if (index != lastIndex) {
+        [self swapCostHeapAtIndex:index withIndex:lastIndex];
+    }
+    [self.costHeap removeLastObject];
+    if (index < self.costHeap.count) {
+        [self fixCostHeapAtIndex:index];
+    }
+    [self.costEntries removeObjectForKey:entry.key];
+    id object = entry.object;
+    if (object && [self.costEntriesByObject objectForKey:object] == entry) {
+        [self.costEntriesByObject removeObjectForKey:object];
+    }
+    self.totalCost -= entry.cost;
 }
 
+// Must be called with `costLock` held, returns the keys to remove from `NSCache`
+- (NSArray *)popCostEntriesOverLimit {
+    NSUInteger costLimit = self.config.maxMemoryCost;
+    NSUInteger countLimit = self.config.maxMemoryCount;
+    NSMutableArray *evictedKeys = [NSMutableArray array];
+    while (self.costHeap.count > 0
+           && ((costLimit > 0 && self.totalCost > costLimit) || (countLimit > 0 && self.costHeap.count > countLimit))) {
+        MWMemoryCacheCostEntry *entry = self.costHeap.firstObject;
+        self.costInflation = entry.priority;
+        [self removeCostEntry:entry];
+        [evictedKeys addObject:entry.key];
+    }
+    return [evictedKeys copy];
+}
+
+- (void)insertCostEntryForKey:(id)key object:(id)object cost:(NSUInteger)cost rebuildCost:(NSTimeInterval)rebuildCost {
+    MW_LOCK(self.costLock);
+    MWMemoryCacheCostEntry *entry = self.costEntries[key];
+    if (entry) {
+        self.totalCost -= entry.cost;
+    } else {
+        entry = [MWMemoryCacheCostEntry new];
+        entry.key = key;
+        entry.heapIndex = self.costHeap.count;
+        [self.costHeap addObject:entry];
+        self.costEntries[key] = entry;
+    }
+    id previousObject = entry.object;
+    if (previousObject && previousObject != object && [self.costEntriesByObject objectForKey:previousObject] == entry) {
+        [self.costEntriesByObject removeObjectForKey:previousObject];
+    }
+    entry.object = object;
+    [self.costEntriesByObject setObject:entry forKey:object];
+    entry.cost = cost;
+    entry.rebuildCost = rebuildCost;
+    entry.priority = [self priorityForCostEntry:entry];
+    self.totalCost += cost;
+    [self fixCostHeapAtIndex:entry.heapIndex];
+    NSArray *evictedKeys = [self popCostEntriesOverLimit];
+    MW_UNLOCK(self.costLock);
+    
+    // Only evict from `NSCache`, like its own eviction the weak cache is kept
+    for (id evictedKey in evictedKeys) {
+        [super removeObjectForKey:evictedKey];
+        [self.statisticsRecorder recordEvictionForKey:evictedKey];
+    }
+}
+
+- (void)touchCostEntryForKey:(id)key {
+    MW_LOCK(self.costLock);
+    MWMemoryCacheCostEntry *entry = self.costEntries[key];
+    if (entry) {
+        entry.priority = [self priorityForCostEntry:entry];
+        [self fixCostHeapAtIndex:entry.heapIndex];
+    }
+    MW_UNLOCK(self.costLock);
+}
+
+- (void)removeCostEntryForKey:(id)key {
+    MW_LOCK(self.costLock);
+    MWMemoryCacheCostEntry *entry = self.costEntries[key];
+    if (entry) {
+        [self removeCostEntry:entry];
+    }
+    MW_UNLOCK(self.costLock);
+}
+
+- (void)removeAllCostEntries {
+    MW_LOCK(self.costLock);
+    [self.costEntries removeAllObjects];
+    [self.costHeap removeAllObjects];
+    [self.costEntriesByObject removeAllObjects];
+    self.totalCost = 0;
+    MW_UNLOCK(self.costLock);
+}
+
+- (void)trimCostEntriesToLimit {
+    MW_LOCK(self.costLock);
+    NSArray *evictedKeys = [self popCostEntriesOverLimit];
+    MW_UNLOCK(self.costLock);
+    for (id evictedKey in evictedKeys) {
+        [super removeObjectForKey:evictedKey];
+        [self.statisticsRecorder recordEvictionForKey:evictedKey];
+    }
+}
+
+#pragma mark - Statistics
+
+- (MWMemoryCacheStatistics *)statistics {
+    return [self.statisticsRecorder statistics];
+}
+
+#pragma mark - Cache
+
 // `setObject:forKey:` just call this with 0 cost. Override this is enough
+// The cost is kept as is even for shared bitmap, the bitmap stays alive as long as any entry holds it
 - (void)setObject:(id)obj forKey:(id)key cost:(NSUInteger)g {
+    if (self.isCostAware && key) {
+        // A replaced object is not an eviction, if `NSCache` tells its delegate about it
+        [self removeCostEntryForKey:key];
+    }
     [super setObject:obj forKey:key cost:g];
+    if (self.isCostAware && key && obj) {
+        NSTimeInterval rebuildCost = 0;
+        if ([obj isKindOfClass:[UIImage class]]) {
+            rebuildCost = [(UIImage *)obj MW_rebuildCost];
+        }
+        [self insertCostEntryForKey:key object:obj cost:g rebuildCost:rebuildCost];
+    }
+    if (key && obj) {
+        [self.statisticsRecorder recordStoreForKey:key cost:g];
+    }
+#if MW_UIKIT
     if (!self.config.shouldUseWeakMemoryCache) {
         return;
     }
@@ -89,11 +473,24 @@ static void * MWMemoryCacheContext = &MWMemoryCacheContext;
         [self.weakCache setObject:obj forKey:key];
         MW_UNLOCK(self.weakCacheLock);
     }
+#endif
 }
 
 - (id)objectForKey:(id)key {
     id obj = [super objectForKey:key];
+    if (self.isCostAware && key) {
+        if (obj) {
+            [self touchCostEntryForKey:key];
+        } else {
+            // Purged by `NSCache` itself, while the delegate did not tell which key, like an object stored under several keys
+            [self removeCostEntryForKey:key];
+        }
+    }
+#if MW_UIKIT
     if (!self.config.shouldUseWeakMemoryCache) {
+        if (key) {
+            [self.statisticsRecorder recordLookupForKey:key hit:obj != nil];
+        }
         return obj;
     }
     if (key && !obj) {
@@ -104,17 +501,34 @@ static void * MWMemoryCacheContext = &MWMemoryCacheContext;
         if (obj) {
             // Sync cache
             NSUInteger cost = 0;
+            NSTimeInterval rebuildCost = 0;
             if ([obj isKindOfClass:[UIImage class]]) {
                 cost = [(UIImage *)obj MW_memoryCost];
+                rebuildCost = [(UIImage *)obj MW_rebuildCost];
             }
             [super setObject:obj forKey:key cost:cost];
+            if (self.isCostAware) {
+                [self insertCostEntryForKey:key object:obj cost:cost rebuildCost:rebuildCost];
+            }
         }
     }
+#endif
+    if (key) {
+        [self.statisticsRecorder recordLookupForKey:key hit:obj != nil];
+    }
     return obj;
 }
 
 - (void)removeObjectForKey:(id)key {
+    // Before `NSCache`, so that its delegate call is not taken for an eviction
+    if (self.isCostAware && key) {
+        [self removeCostEntryForKey:key];
+    }
     [super removeObjectForKey:key];
+    if (key) {
+        [self.statisticsRecorder recordRemovalForKey:key];
+    }
+#if MW_UIKIT
     if (!self.config.shouldUseWeakMemoryCache) {
         return;
     }
@@ -124,10 +538,16 @@ static void * MWMemoryCacheContext = &MWMemoryCacheContext;
         [self.weakCache removeObjectForKey:key];
         MW_UNLOCK(self.weakCacheLock);
     }
+#endif
 }
 
 - (void)removeAllObjects {
+    if (self.isCostAware) {
+        [self removeAllCostEntries];
+    }
     [super removeAllObjects];
+    [self.statisticsRecorder recordRemovalOfAllObjects];
+#if MW_UIKIT
     if (!self.config.shouldUseWeakMemoryCache) {
         return;
     }
@@ -135,14 +555,45 @@ static void * MWMemoryCacheContext = &MWMemoryCacheContext;
     MW_LOCK(self.weakCacheLock);
     [self.weakCache removeAllObjects];
     MW_UNLOCK(self.weakCacheLock);
+#endif
+}
+
+// Current this seems no use on macOS (macOS use virtual memory and do not clear cache when memory warning). So we only override on iOS/tvOS platform.
+#if MW_UIKIT
+- (void)didReceiveMemoryWarning:(NSNotification *)notification {
+    // Only remove cache, but keep weak cache
+    if (self.isCostAware) {
+        [self removeAllCostEntries];
+    }
+    [super removeAllObjects];
+    [self.statisticsRecorder recordEvictionOfAllObjects];
 }
 #endif
 
+#pragma mark - NSCacheDelegate
+
+- (void)cache:(NSCache *)cache willEvictObject:(id)obj {
+    // The entries evicted or removed by the methods above are gone already, what is left was purged by `NSCache` itself
+    MW_LOCK(self.costLock);
+    MWMemoryCacheCostEntry *entry = [self.costEntriesByObject objectForKey:obj];
+    id key = entry.key;
+    if (entry) {
+        [self removeCostEntry:entry];
+    }
+    MW_UNLOCK(self.costLock);
+    if (key) {
+        [self.statisticsRecorder recordEvictionForKey:key];
+    }
+}
+
 #pragma mark - KVO
 
 - (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary<NSKeyValueChangeKey,id> *)change context:(void *)context {
     if (context == MWMemoryCacheContext) {
-        if ([keyPath isEqualToString:NSStringFromSelector(@selector(maxMemoryCost))]) {
+        if (self.isCostAware) {
+            // Both limits are enforced by the GreedyDual-Size bookkeeping
+            [self trimCostEntriesToLimit];
+        } else if ([keyPath isEqualToString:NSStringFromSelector(@selector(maxMemoryCost))]) {
             self.totalCostLimit = self.config.maxMemoryCost;
         } else if ([keyPath isEqualToString:NSStringFromSelector(@selector(maxMemoryCount))]) {
             self.countLimit = self.config.maxMemoryCount;
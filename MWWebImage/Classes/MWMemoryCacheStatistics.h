@@ -0,0 +1,70 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "MWWebImageCompat.h"
+
+/**
+ A snapshot of the memory cache activity, used to size `maxMemoryCost` and `maxMemoryCount` from real usage.
+ Besides the resident entries, the memory cache keeps the key and cost of recently evicted entries (ghost entries), up to 4x its budget. Each lookup computes how many bytes were accessed since the last access of the same key, which tells whether a cache of 0.5x, 2x or 4x the budget would have hit.
+ @note The estimation replays the lookups with a LRU policy, so it's an approximation if `MWImageCacheConfigMemoryEvictionTypeGreedyDualSize` is used.
+ */
+@interface MWMemoryCacheStatistics : NSObject
+
+/**
+ The number of lookups which return an image from the memory cache (including the weak cache).
+ */
+@property (nonatomic, assign, readonly) NSUInteger hitCount;
+
+/**
+ The number of lookups which return nothing.
+ */
+@property (nonatomic, assign, readonly) NSUInteger missCount;
+
+/**
+ The number of misses on a ghost entry. Those are the lookups a larger cache may have served.
+ */
+@property (nonatomic, assign, readonly) NSUInteger ghostHitCount;
+
+/**
+ The number of entries evicted by the cache itself. Explicit removal is not an eviction.
+ @note Entries evicted by `NSCache` internally are only noticed on their next lookup. Entries evicted by memory warning are counted immediately, and so are all evictions with `MWImageCacheConfigMemoryEvictionTypeGreedyDualSize`, which is told by the `NSCache` delegate.
+ */
+@property (nonatomic, assign, readonly) NSUInteger evictionCount;
+
+/**
+ The budget used for the estimation, in bytes when `maxMemoryCost` is set, otherwise in images when `maxMemoryCount` is set. 0 means the cache is unbounded, then all the estimated ratios are the same.
+ */
+@property (nonatomic, assign, readonly) NSUInteger budget;
+
+/**
+ The observed hit ratio, `hitCount / (hitCount + missCount)`. 0 if there is no lookup yet.
+ */
+@property (nonatomic, assign, readonly) double hitRatio;
+
+/**
+ The estimated hit ratio with the current budget. Compare it with `hitRatio` to see how close the estimation is.
+ */
+@property (nonatomic, assign, readonly) double estimatedHitRatio;
+
+/**
+ The estimated hit ratio with half the current budget.
+ */
+@property (nonatomic, assign, readonly) double estimatedHitRatioAtHalfBudget;
+
+/**
+ The estimated hit ratio with twice the current budget.
+ */
+@property (nonatomic, assign, readonly) double estimatedHitRatioAtDoubleBudget;
+
+/**
+ The estimated hit ratio with 4 times the current budget.
+ */
+@property (nonatomic, assign, readonly) double estimatedHitRatioAtQuadrupleBudget;
+
+@end
@@ -0,0 +1,307 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "MWMemoryCacheStatistics.h"
+#import "MWMemoryCacheStatisticsInternal.h"
+#import "MWImageCacheConfig.h"
+#import "MWInternalMacros.h"
+
+enum {
+    // The access stamps wrap into a Fenwick tree, which is compacted when full. It grows with the resident entries
+    kMWMemoryCacheStatisticsMinStampCapacity = 8192,
+    // The ghost entries are kept up to this multiple of the budget, the largest estimated scale
+    kMWMemoryCacheStatisticsGhostScale = 4,
+    // The estimated scales: 0.5x, 1x, 2x, 4x
+    kMWMemoryCacheStatisticsScaleCount = 4,
+};
+
+@interface MWMemoryCacheStatistics ()
+
+@property (nonatomic, assign, readwrite) NSUInteger hitCount;
+@property (nonatomic, assign, readwrite) NSUInteger missCount;
+@property (nonatomic, assign, readwrite) NSUInteger ghostHitCount;
+@property (nonatomic, assign, readwrite) NSUInteger evictionCount;
+@property (nonatomic, assign, readwrite) NSUInteger budget;
+@property (nonatomic, assign, readwrite) double hitRatio;
+@property (nonatomic, assign, readwrite) double estimatedHitRatio;
+@property (nonatomic, assign, readwrite) double estimatedHitRatioAtHalfBudget;
+@property (nonatomic, assign, readwrite) double estimatedHitRatioAtDoubleBudget;
+@property (nonatomic, assign, readwrite) double estimatedHitRatioAtQuadrupleBudget;
+
+@end
+
+@implementation MWMemoryCacheStatistics
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p hits = %lu, misses = %lu, ghost hits = %lu, evictions = %lu, budget = %lu, hit ratio = %.3f, estimated = {0.5x: %.3f, 1x: %.3f, 2x: %.3f, 4x: %.3f}>", NSStringFromClass(self.class), self, (unsigned long)self.hitCount, (unsigned long)self.missCount, (unsigned long)self.ghostHitCount, (unsigned long)self.evictionCount, (unsigned long)self.budget, self.hitRatio, self.estimatedHitRatioAtHalfBudget, self.estimatedHitRatio, self.estimatedHitRatioAtDoubleBudget, self.estimatedHitRatioAtQuadrupleBudget];
+}
+
+@end
+
+@interface MWMemoryCacheStatisticsEntry : NSObject
+
+@property (nonatomic, strong, nonnull) id key;
+@property (nonatomic, assign) NSUInteger cost; // in budget unit, bytes or 1
+@property (nonatomic, assign) NSUInteger stamp;
+@property (nonatomic, assign) BOOL resident; // NO for ghost entry
+
+@end
+
+@implementation MWMemoryCacheStatisticsEntry
+@end
+
+@interface MWMemoryCacheStatisticsRecorder () {
+    uint64_t *_tree; // Fenwick tree of cost, indexed by access stamp, `_stampCapacity + 1` values
+    NSUInteger _stampCapacity;
+    NSUInteger _estimatedHitCounts[kMWMemoryCacheStatisticsScaleCount];
+}
+
+@property (nonatomic, strong, nonnull) MWImageCacheConfig *config;
+@property (nonatomic, assign) BOOL countsImages; // budget is `maxMemoryCount` instead of `maxMemoryCost`, captured at init
+@property (nonatomic, strong, nonnull) NSMutableDictionary<id, MWMemoryCacheStatisticsEntry *> *entries; // resident and ghost entries
+@property (nonatomic, assign) NSUInteger nextStamp;
+@property (nonatomic, assign) NSUInteger hitCount;
+@property (nonatomic, assign) NSUInteger missCount;
+@property (nonatomic, assign) NSUInteger ghostHitCount;
+@property (nonatomic, assign) NSUInteger evictionCount;
+@property (nonatomic, strong, nonnull) dispatch_semaphore_t lock;
+
+@end
+
+@implementation MWMemoryCacheStatisticsRecorder
+
+- (instancetype)initWithConfig:(MWImageCacheConfig *)config {
+    self = [super init];
+    if (self) {
+        _config = config;
+        _countsImages = config.maxMemoryCost == 0 && config.maxMemoryCount > 0;
+        _entries = [NSMutableDictionary dictionary];
+        _nextStamp = 1;
+        _stampCapacity = kMWMemoryCacheStatisticsMinStampCapacity;
+        _tree = calloc(_stampCapacity + 1, sizeof(uint64_t));
+        _lock = dispatch_semaphore_create(1);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_tree);
+}
+
+#pragma mark - Fenwick tree
+
+- (void)addValue:(int64_t)value atStamp:(NSUInteger)stamp {
+    for (NSUInteger i = stamp; i <= _stampCapacity; i += i & (~i + 1)) {
+        _tree[i] += value;
+    }
+}
+
+- (uint64_t)sumToStamp:(NSUInteger)stamp {
+    uint64_t sum = 0;
+    for (NSUInteger i = stamp; i > 0; i -= i & (~i + 1)) {
+        sum += _tree[i];
+    }
+    return sum;
+}
+
+#pragma mark - Stack
+
+- (NSUInteger)currentBudget {
+    return self.countsImages ? self.config.maxMemoryCount : self.config.maxMemoryCost;
+}
+
+// Drop the ghost entries too far away to hit even at the largest scale, then renumber the stamps from 1
+// The resident entries are always kept, the stamps are sized for them and half of the stamps stay free
+- (void)compact {
+    NSArray<MWMemoryCacheStatisticsEntry *> *sortedEntries = [self.entries.allValues sortedArrayUsingComparator:^NSComparisonResult(MWMemoryCacheStatisticsEntry *entry1, MWMemoryCacheStatisticsEntry *entry2) {
+        return entry1.stamp > entry2.stamp ? NSOrderedAscending : NSOrderedDescending;
+    }];
+    NSUInteger residentCount = 0;
+    for (MWMemoryCacheStatisticsEntry *entry in sortedEntries) {
+        if (entry.resident) {
+            residentCount++;
+        }
+    }
+    NSUInteger stampCapacity = MAX(_stampCapacity, MAX(residentCount, self.config.maxMemoryCount) * 2);
+    if (stampCapacity > _stampCapacity) {
+        free(_tree);
+        _tree = calloc(stampCapacity + 1, sizeof(uint64_t));
+        _stampCapacity = stampCapacity;
+    }
+    NSUInteger budget = [self currentBudget];
+    uint64_t window = (uint64_t)budget * kMWMemoryCacheStatisticsGhostScale;
+    NSUInteger maxGhostCount = _stampCapacity / 2 - residentCount;
+    NSUInteger ghostCount = 0;
+    NSMutableArray<MWMemoryCacheStatisticsEntry *> *keptEntries = [NSMutableArray arrayWithCapacity:sortedEntries.count];
+    uint64_t distance = 0;
+    for (MWMemoryCacheStatisticsEntry *entry in sortedEntries) {
+        distance += entry.cost;
+        if (!entry.resident) {
+            BOOL outOfWindow = budget > 0 && distance > window;
+            if (outOfWindow || ghostCount >= maxGhostCount) {
+                entry.stamp = 0;
+                [self.entries removeObjectForKey:entry.key];
+                continue;
+            }
+            ghostCount++;
+        }
+        [keptEntries addObject:entry];
+    }
+
+    memset(_tree, 0, (_stampCapacity + 1) * sizeof(uint64_t));
+    NSUInteger stamp = keptEntries.count;
+    for (MWMemoryCacheStatisticsEntry *entry in keptEntries) {
+        entry.stamp = stamp;
+        [self addValue:entry.cost atStamp:stamp];
+        stamp--;
+    }
+    self.nextStamp = keptEntries.count + 1;
+}
+
+// Move the entry to the top of the stack
+- (void)touchEntry:(MWMemoryCacheStatisticsEntry *)entry {
+    if (self.nextStamp > _stampCapacity) {
+        [self compact];
+        // The entry being touched is the most recent one, keep it even if compacted out
+        self.entries[entry.key] = entry;
+    }
+    if (entry.stamp > 0) {
+        [self addValue:-(int64_t)entry.cost atStamp:entry.stamp];
+    }
+    entry.stamp = self.nextStamp++;
+    [self addValue:entry.cost atStamp:entry.stamp];
+}
+
+#pragma mark - Record
+
+- (void)recordLookupForKey:(id)key hit:(BOOL)hit {
+    if (!key) {
+        return;
+    }
+    MW_LOCK(self.lock);
+    if (hit) {
+        self.hitCount++;
+    } else {
+        self.missCount++;
+    }
+    MWMemoryCacheStatisticsEntry *entry = self.entries[key];
+    if (entry) {
+        if (!hit) {
+            if (entry.resident) {
+                // Evicted by `NSCache` without telling us
+                self.evictionCount++;
+                entry.resident = NO;
+            }
+            self.ghostHitCount++;
+        }
+        // The bytes accessed since the last access of this key, including itself
+        uint64_t distance = [self sumToStamp:self.nextStamp - 1] - [self sumToStamp:entry.stamp - 1];
+        NSUInteger budget = [self currentBudget];
+        static const double scales[kMWMemoryCacheStatisticsScaleCount] = {0.5, 1, 2, 4};
+        for (NSUInteger i = 0; i < kMWMemoryCacheStatisticsScaleCount; i++) {
+            if (budget == 0 || distance <= budget * scales[i]) {
+                _estimatedHitCounts[i]++;
+            }
+        }
+        [self touchEntry:entry];
+    }
+    // A lookup on an unknown key is a cold miss at any scale, its cost is known only when stored
+    MW_UNLOCK(self.lock);
+}
+
+- (void)recordStoreForKey:(id)key cost:(NSUInteger)cost {
+    if (!key) {
+        return;
+    }
+    NSUInteger unitCost = self.countsImages ? 1 : cost;
+    MW_LOCK(self.lock);
+    MWMemoryCacheStatisticsEntry *entry = self.entries[key];
+    if (entry) {
+        // Stored right after the missing lookup, update the cost in place
+        if (entry.stamp > 0) {
+            [self addValue:(int64_t)unitCost - (int64_t)entry.cost atStamp:entry.stamp];
+        }
+        entry.cost = unitCost;
+    } else {
+        entry = [MWMemoryCacheStatisticsEntry new];
+        entry.key = key;
+        entry.cost = unitCost;
+        self.entries[key] = entry;
+        [self touchEntry:entry];
+    }
+    entry.resident = YES;
+    MW_UNLOCK(self.lock);
+}
+
+- (void)recordEvictionForKey:(id)key {
+    if (!key) {
+        return;
+    }
+    MW_LOCK(self.lock);
+    MWMemoryCacheStatisticsEntry *entry = self.entries[key];
+    if (entry.resident) {
+        entry.resident = NO;
+        self.evictionCount++;
+    }
+    MW_UNLOCK(self.lock);
+}
+
+- (void)recordRemovalForKey:(id)key {
+    if (!key) {
+        return;
+    }
+    MW_LOCK(self.lock);
+    MWMemoryCacheStatisticsEntry *entry = self.entries[key];
+    if (entry) {
+        // Removed on purpose, it's not a capacity miss any more
+        [self addValue:-(int64_t)entry.cost atStamp:entry.stamp];
+        [self.entries removeObjectForKey:key];
+    }
+    MW_UNLOCK(self.lock);
+}
+
+- (void)recordEvictionOfAllObjects {
+    MW_LOCK(self.lock);
+    for (MWMemoryCacheStatisticsEntry *entry in self.entries.allValues) {
+        if (entry.resident) {
+            entry.resident = NO;
+            self.evictionCount++;
+        }
+    }
+    MW_UNLOCK(self.lock);
+}
+
+- (void)recordRemovalOfAllObjects {
+    MW_LOCK(self.lock);
+    [self.entries removeAllObjects];
+    memset(_tree, 0, (_stampCapacity + 1) * sizeof(uint64_t));
+    self.nextStamp = 1;
+    MW_UNLOCK(self.lock);
+}
+
+- (MWMemoryCacheStatistics *)statistics {
+    MWMemoryCacheStatistics *statistics = [MWMemoryCacheStatistics new];
+    MW_LOCK(self.lock);
+    NSUInteger lookupCount = self.hitCount + self.missCount;
+    statistics.hitCount = self.hitCount;
+    statistics.missCount = self.missCount;
+    statistics.ghostHitCount = self.ghostHitCount;
+    statistics.evictionCount = self.evictionCount;
+    statistics.budget = [self currentBudget];
+    if (lookupCount > 0) {
+        statistics.hitRatio = (double)self.hitCount / lookupCount;
+        statistics.estimatedHitRatioAtHalfBudget = (double)_estimatedHitCounts[0] / lookupCount;
+        statistics.estimatedHitRatio = (double)_estimatedHitCounts[1] / lookupCount;
+        statistics.estimatedHitRatioAtDoubleBudget = (double)_estimatedHitCounts[2] / lookupCount;
+        statistics.estimatedHitRatioAtQuadrupleBudget = (double)_estimatedHitCounts[3] / lookupCount;
+    }
+    MW_UNLOCK(self.lock);
+    return statistics;
+}
+
+@end
@@ -0,0 +1,28 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "MWMemoryCacheStatistics.h"
+
+@class MWImageCacheConfig;
+
+/// Records the memory cache lookups and keeps the ghost entries. All methods are thread-safe.
+@interface MWMemoryCacheStatisticsRecorder : NSObject
+
+- (nonnull instancetype)initWithConfig:(nonnull MWImageCacheConfig *)config;
+
+- (void)recordLookupForKey:(nonnull id)key hit:(BOOL)hit;
+- (void)recordStoreForKey:(nonnull id)key cost:(NSUInteger)cost;
+- (void)recordEvictionForKey:(nonnull id)key;
+- (void)recordRemovalForKey:(nonnull id)key;
+- (void)recordEvictionOfAllObjects;
+- (void)recordRemovalOfAllObjects;
+
+- (nonnull MWMemoryCacheStatistics *)statistics;
+
+@end
@@ -18,11 +18,14 @@ FOUNDATION_EXPORT const unsigned char MWWebImageVersionString[];
 // In this header, you should import all the public headers of your framework using statements like #import <MWWebImage/PublicHeader.h>
 
 #import <MWWebImage/MWWebImageManager.h>
+#import <MWWebImage/MWWebImageRetryPolicy.h>
 #import <MWWebImage/MWWebImageCacheKeyFilter.h>
 #import <MWWebImage/MWWebImageCacheSerializer.h>
 #import <MWWebImage/MWImageCacheConfig.h>
 #import <MWWebImage/MWImageCache.h>
+#import <MWWebImage/MWImageCacheValidators.h>
 #import <MWWebImage/MWMemoryCache.h>
+#import <MWWebImage/MWMemoryCacheStatistics.h>
 #import <MWWebImage/MWDiskCache.h>
 #import <MWWebImage/MWImageCacheDefine.h>
 #import <MWWebImage/MWImageCachesManager.h>
@@ -30,8 +33,14 @@ FOUNDATION_EXPORT const unsigned char MWWebImageVersionString[];
 #import <MWWebImage/UIImageView+WebCache.h>
 #import <MWWebImage/UIImageView+HighlightedWebCache.h>
 #import <MWWebImage/MWWebImageDownloaderConfig.h>
+#import <MWWebImage/MWWebImageDownloaderConcurrencyController.h>
+#import <MWWebImage/MWWebImageDownloaderHostScheduler.h>
+#import <MWWebImage/MWWebImageDownloaderBandwidthEstimator.h>
+#import <MWWebImage/MWWebImageDownloaderMetrics.h>
+#import <MWWebImage/MWWebImageDownloaderBufferBudget.h>
 #import <MWWebImage/MWWebImageDownloaderOperation.h>
 #import <MWWebImage/MWWebImageDownloaderRequestModifier.h>
+#import <MWWebImage/MWWebImageDownloaderVariantRequestModifier.h>
 #import <MWWebImage/MWWebImageDownloaderResponseModifier.h>
 #import <MWWebImage/MWWebImageDownloaderDecryptor.h>
 #import <MWWebImage/MWImageLoader.h>
@@ -60,6 +69,8 @@ FOUNDATION_EXPORT const unsigned char MWWebImageVersionString[];
 #import <MWWebImage/MWImageIOCoder.h>
 #import <MWWebImage/MWImageFrame.h>
 #import <MWWebImage/MWImageCoderHelper.h>
+#import <MWWebImage/MWImageDecodeExecutor.h>
+#import <MWWebImage/MWImageHeaderParser.h>
 #import <MWWebImage/MWImageGraphics.h>
 #import <MWWebImage/MWGraphicsImageRenderer.h>
 #import <MWWebImage/UIImage+GIF.h>
@@ -71,6 +82,10 @@ FOUNDATION_EXPORT const unsigned char MWWebImageVersionString[];
 #import <MWWebImage/MWImageIOAnimatedCoder.h>
 #import <MWWebImage/MWImageHEICCoder.h>
 #import <MWWebImage/MWImageAWebPCoder.h>
+#import <MWWebImage/MWImageWebPCoder.h>
+#import <MWWebImage/MWImageAVIFCoder.h>
+#import <MWWebImage/MWImageJPEGCoder.h>
+#import <MWWebImage/MWImagePNGCoder.h>
 
 // Mac
 #if __has_include(<MWWebImage/NSImage+Compatibility.h>)
@@ -70,7 +70,7 @@ typedef NS_OPTIONS(NSUInteger, MWWebImageOptions) {
     
     /**
      * Even if the image is cached, respect the HTTP response cache control, and refresh the image from remote location if needed.
-     * The disk caching will be handled by NSURLCache instead of MWWebImage leading to slight performance degradation.
+     * When the image cache stores the HTTP validators of the image (see `MWImageCacheValidators`), the refresh is a conditional request and a `304 Not Modified` response keeps the cached image. Otherwise the disk caching will be handled by NSURLCache instead of MWWebImage leading to slight performance degradation.
      * This option helps deal with images changing behind the same request URL, e.g. Facebook graph api profile pics.
      * If a cached image is refreshed, the completion block is called once with the cached image and again with the final image.
      *
@@ -201,7 +201,21 @@ typedef NS_OPTIONS(NSUInteger, MWWebImageOptions) {
      * We usually don't apply transform on vector images, because vector images supports dynamically changing to any size, rasterize to a fixed size will loss details. To modify vector images, you can process the vector data at runtime (such as modifying PDF tag / SVG element).
      * Use this flag to transform them anyway.
      */
-    MWWebImageTransformVectorImage = 1 << 23
+    MWWebImageTransformVectorImage = 1 << 23,
+    
+    /**
+     * Like `MWWebImageRefreshCached`, the cached image is shown immediately and refreshed in the background, but only when it's stale: an image still fresh (younger than the `Cache-Control: max-age` of its response) does not hit the network at all.
+     * The refresh is a conditional request with the `ETag` / `Last-Modified` stored in the disk cache, a `304 Not Modified` response keeps the cached image and costs no body. If the image changed, the completion block is called again with the new image.
+     * Unlike `MWWebImageRefreshCached`, this does not use `NSURLCache`, so the image is not cached twice.
+     */
+    MWWebImageStaleWhileRevalidate = 1 << 24,
+    
+    /**
+     * By default, the downloaded data is kept in memory until the download completes, then written to the disk cache.
+     * This flag streams the received bytes into a file beside the disk cache file instead, which is moved in place atomically on the cache IO queue once the image decoded. The data is read back from the file once for the decoder, so the memory does not hold the growing body while downloading, which helps large images and prefetching.
+     * It applies only when the original data is stored into the disk cache of a `MWImageCache`: not with a transformer or a cache serializer. Progressive loading and resuming a download from its partial data are disabled.
+     */
+    MWWebImageDownloadToFile = 1 << 25
 };
 
 
@@ -260,6 +274,17 @@ FOUNDATION_EXPORT MWWebImageContextOption _Nonnull const MWWebImageContextImageP
  */
 FOUNDATION_EXPORT MWWebImageContextOption _Nonnull const MWWebImageContextImageThumbnailPixelSize;
 
+/**
+ A CGSize raw value of the pixel size the image is displayed at. The view categories provide it from the view bounds and screen scale. It's only a hint for the image loader, for example `MWWebImageDownloaderVariantRequestModifier` uses it to request a variant of the right width. Unlike `.imageThumbnailPixelSize`, it does not change the decoding, and only changes the cache key through `.imageVariant`. (NSValue)
+ */
+FOUNDATION_EXPORT MWWebImageContextOption _Nonnull const MWWebImageContextImageTargetPixelSize;
+
+/**
+ A string naming the variant of the image requested for the URL, like the rule and pixel size chosen by `MWWebImageDownloaderVariantRequestModifier`. It's appended to the cache key, so each variant is cached on its own instead of overwriting the others under the key of the URL.
+ The manager fills it before the cache query from the request modifier's `variantForURL:context:`. (NSString)
+ */
+FOUNDATION_EXPORT MWWebImageContextOption _Nonnull const MWWebImageContextImageVariant;
+
 /**
  A MWImageCacheType raw value which specify the source of cache to query. Specify `MWImageCacheTypeDisk` to query from disk cache only; `MWImageCacheTypeMemory` to query from memory only. And `MWImageCacheTypeAll` to query from both memory cache and disk cache. Specify `MWImageCacheTypeNone` is invalid and totally ignore the cache query.
  If not provide or the value is invalid, we will use `MWImageCacheTypeAll`. (NSNumber)
@@ -127,6 +127,8 @@ MWWebImageContextOption const MWWebImageContextImageTransformer = @"imageTransfo
 MWWebImageContextOption const MWWebImageContextImageScaleFactor = @"imageScaleFactor";
 MWWebImageContextOption const MWWebImageContextImagePreserveAspectRatio = @"imagePreserveAspectRatio";
 MWWebImageContextOption const MWWebImageContextImageThumbnailPixelSize = @"imageThumbnailPixelSize";
+MWWebImageContextOption const MWWebImageContextImageTargetPixelSize = @"imageTargetPixelSize";
+MWWebImageContextOption const MWWebImageContextImageVariant = @"imageVariant";
 MWWebImageContextOption const MWWebImageContextQueryCacheType = @"queryCacheType";
 MWWebImageContextOption const MWWebImageContextStoreCacheType = @"storeCacheType";
 MWWebImageContextOption const MWWebImageContextOriginalQueryCacheType = @"originalQueryCacheType";
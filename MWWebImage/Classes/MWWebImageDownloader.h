@@ -14,6 +14,11 @@
 #import "MWWebImageDownloaderRequestModifier.h"
 #import "MWWebImageDownloaderResponseModifier.h"
 #import "MWWebImageDownloaderDecryptor.h"
+#import "MWWebImageDownloaderConcurrencyController.h"
+#import "MWWebImageDownloaderHostScheduler.h"
+#import "MWWebImageDownloaderBandwidthEstimator.h"
+#import "MWWebImageDownloaderMetrics.h"
+#import "MWWebImageDownloaderBufferBudget.h"
 #import "MWImageLoader.h"
 
 /// Downloader options
@@ -99,6 +104,16 @@ FOUNDATION_EXPORT NSNotificationName _Nonnull const MWWebImageDownloadStartNotif
 FOUNDATION_EXPORT NSNotificationName _Nonnull const MWWebImageDownloadReceiveResponseNotification;
 FOUNDATION_EXPORT NSNotificationName _Nonnull const MWWebImageDownloadStopNotification;
 FOUNDATION_EXPORT NSNotificationName _Nonnull const MWWebImageDownloadFinishNotification;
+/// Posted on the main queue when the image format and pixel size are read from the first received bytes, the object is the download operation. See `MWWebImageDownloaderOperation.imagePixelSize`
+FOUNDATION_EXPORT NSNotificationName _Nonnull const MWWebImageDownloadReceiveImageHeaderNotification;
+/// Posted on the main queue when the downloaded data is moved to the file of `MWWebImageContextLoaderDownloadFileURL`, before the completion blocks are called. The object is the download operation. See `MWWebImageDownloaderOperation.downloadedFileURL`
+FOUNDATION_EXPORT NSNotificationName _Nonnull const MWWebImageDownloadWriteFileNotification;
+/// Posted on the main queue when the adaptive concurrency changes the download limit, the object is the downloader. See `MWWebImageDownloaderConfig.shouldAdaptConcurrentDownloads`
+FOUNDATION_EXPORT NSNotificationName _Nonnull const MWWebImageDownloaderConcurrencyDidChangeNotification;
+/// The `MWWebImageDownloaderConcurrencyDecision` in the notification user info
+FOUNDATION_EXPORT NSString * _Nonnull const MWWebImageDownloaderConcurrencyDecisionKey;
+/// Posted on the main queue when the buffered bytes go over `MWWebImageDownloaderConfig.maxBufferedBytes` or drain back, the object is the downloader. See `MWWebImageDownloader.bufferBudget`
+FOUNDATION_EXPORT NSNotificationName _Nonnull const MWWebImageDownloaderBufferPressureDidChangeNotification;
 
 typedef MWImageLoaderProgressBlock MWWebImageDownloaderProgressBlock;
 typedef MWImageLoaderCompletedBlock MWWebImageDownloaderCompletedBlock;
@@ -133,6 +148,17 @@ typedef MWImageLoaderCompletedBlock MWWebImageDownloaderCompletedBlock;
  */
 @property (nonatomic, strong, nullable, readonly) NSURLSessionTaskMetrics *metrics API_AVAILABLE(macosx(10.12), ios(10.0), watchos(3.0), tvos(10.0));
 
+/**
+ The file the downloaded data was moved to, see `MWWebImageContextLoaderDownloadFileURL`. This will be nil if the data was kept in memory.
+ */
+@property (nonatomic, strong, nullable, readonly) NSURL *downloadedFileURL;
+
+/**
+ The priority requested by this download's caller. The download operation shared by several callers runs at the highest requested priority, even if it is already running, so a low priority prefetch joined by a visible view is raised.
+ Defaults to the priority options. Custom download operations which do not implement `priority` ignore this.
+ */
+@property (nonatomic, assign) MWWebImageOperationPriority priority;
+
 @end
 
 
@@ -180,6 +206,7 @@ typedef MWImageLoaderCompletedBlock MWWebImageDownloaderCompletedBlock;
 
 /**
  * Gets/Sets the download queue suspension state.
+ * @note While `bufferBudget` is over budget, only the downloads below the default priority wait, see `MWWebImageDownloaderConfig.maxBufferedBytes`.
  */
 @property (nonatomic, assign, getter=isSuspended) BOOL suspended;
 
@@ -188,6 +215,34 @@ typedef MWImageLoaderCompletedBlock MWWebImageDownloaderCompletedBlock;
  */
 @property (nonatomic, assign, readonly) NSUInteger currentDownloadCount;
 
+/**
+ * The current limit of concurrent downloads. This is `config.maxConcurrentDownloads` unless `config.shouldAdaptConcurrentDownloads` is enabled.
+ */
+@property (nonatomic, assign, readonly) NSUInteger currentConcurrentDownloadsLimit;
+
+/**
+ * A snapshot of the queue depth and latency of each host, keyed by host.
+ * @note This is empty unless the per-host scheduling is enabled, see `MWWebImageDownloaderConfig.maxConcurrentDownloadsPerHost`.
+ */
+@property (nonatomic, copy, readonly, nonnull) NSDictionary<NSString *, MWWebImageDownloaderHostStatistics *> *hostStatistics;
+
+/**
+ * The running estimate of the download throughput, fed with each successful download of this downloader.
+ * @note It can drive the variant selection of `MWWebImageDownloaderVariantRequestModifier`.
+ */
+@property (nonatomic, strong, readonly, nonnull) MWWebImageDownloaderBandwidthEstimator *bandwidthEstimator;
+
+/**
+ * A snapshot of the histograms of DNS, connect, TLS, time to first byte, transfer time and size of the recent successful downloads, per host and priority. Export it with `dictionaryRepresentation` to watch the CDN latency.
+ * @note This is nil if `config.metricsWindowInterval` is 0. The timings need `NSURLSessionTaskMetrics`, so iOS 10/macOS 10.12 and later.
+ */
+@property (nonatomic, strong, readonly, nullable) MWWebImageDownloaderMetricsSnapshot *metricsSnapshot;
+
+/**
+ * The bytes held in memory by the downloads of this downloader, with their high water mark. The limit is `config.maxBufferedBytes`.
+ */
+@property (nonatomic, strong, readonly, nonnull) MWWebImageDownloaderBufferBudget *bufferBudget;
+
 /**
  *  Returns the global shared downloader instance. Which use the `MWWebImageDownloaderConfig.defaultDownloaderConfig` config.
  */
@@ -11,23 +11,46 @@
 #import "MWWebImageDownloaderOperation.h"
 #import "MWWebImageError.h"
 #import "MWInternalMacros.h"
+#import "MWDiskCache.h"
+#import "MWImageCacheConfig.h"
+#import "MWImageCacheValidators.h"
 
 NSNotificationName const MWWebImageDownloadStartNotification = @"MWWebImageDownloadStartNotification";
 NSNotificationName const MWWebImageDownloadReceiveResponseNotification = @"MWWebImageDownloadReceiveResponseNotification";
+NSNotificationName const MWWebImageDownloadReceiveImageHeaderNotification = @"MWWebImageDownloadReceiveImageHeaderNotification";
+NSNotificationName const MWWebImageDownloadWriteFileNotification = @"MWWebImageDownloadWriteFileNotification";
 NSNotificationName const MWWebImageDownloadStopNotification = @"MWWebImageDownloadStopNotification";
 NSNotificationName const MWWebImageDownloadFinishNotification = @"MWWebImageDownloadFinishNotification";
+NSNotificationName const MWWebImageDownloaderConcurrencyDidChangeNotification = @"MWWebImageDownloaderConcurrencyDidChangeNotification";
+NSString * const MWWebImageDownloaderConcurrencyDecisionKey = @"MWWebImageDownloaderConcurrencyDecisionKey";
+NSNotificationName const MWWebImageDownloaderBufferPressureDidChangeNotification = @"MWWebImageDownloaderBufferPressureDidChangeNotification";
 
 static void * MWWebImageDownloaderContext = &MWWebImageDownloaderContext;
 
+static BOOL MWIsConditionalRequest(NSURLRequest * _Nullable request) {
+    return [request valueForHTTPHeaderField:@"If-None-Match"] || [request valueForHTTPHeaderField:@"If-Modified-Since"];
+}
+
+// The key of the operation downloading a URL. Each variant is a different image, cached under its own key, so it is not shared with the other variants
+static id<NSCopying> MWOperationKeyForURL(NSURL * _Nonnull url, MWWebImageContext * _Nullable context) {
+    NSString *variant = context[MWWebImageContextImageVariant];
+    if ([variant isKindOfClass:NSString.class] && variant.length > 0) {
+        return @[url, variant];
+    }
+    return url;
+}
+
 @interface MWWebImageDownloadToken ()
 
 @property (nonatomic, strong, nullable, readwrite) NSURL *url;
 @property (nonatomic, strong, nullable, readwrite) NSURLRequest *request;
 @property (nonatomic, strong, nullable, readwrite) NSURLResponse *response;
 @property (nonatomic, strong, nullable, readwrite) NSURLSessionTaskMetrics *metrics API_AVAILABLE(macosx(10.12), ios(10.0), watchos(3.0), tvos(10.0));
+@property (nonatomic, strong, nullable, readwrite) NSURL *downloadedFileURL;
 @property (nonatomic, weak, nullable, readwrite) id downloadOperationCancelToken;
 @property (nonatomic, weak, nullable) NSOperation<MWWebImageDownloaderOperation> *downloadOperation;
 @property (nonatomic, assign, getter=isCancelled) BOOL cancelled;
+@property (nonatomic, assign) MWWebImageOperationPriority requestedPriority;
 
 - (nonnull instancetype)init NS_UNAVAILABLE;
 + (nonnull instancetype)new  NS_UNAVAILABLE;
@@ -38,10 +61,18 @@ static void * MWWebImageDownloaderContext = &MWWebImageDownloaderContext;
 @interface MWWebImageDownloader () <NSURLSessionTaskDelegate, NSURLSessionDataDelegate>
 
 @property (strong, nonatomic, nonnull) NSOperationQueue *downloadQueue;
-@property (strong, nonatomic, nonnull) NSMutableDictionary<NSURL *, NSOperation<MWWebImageDownloaderOperation> *> *URLOperations;
+@property (strong, nonatomic, nonnull) NSMutableDictionary<id<NSCopying>, NSOperation<MWWebImageDownloaderOperation> *> *URLOperations; // keyed by `MWOperationKeyForURL`
 @property (strong, nonatomic, nullable) NSMutableDictionary<NSString *, NSString *> *HTTPHeaders;
 @property (strong, nonatomic, nonnull) dispatch_semaphore_t HTTPHeadersLock; // A lock to keep the access to `HTTPHeaders` thread-safe
 @property (strong, nonatomic, nonnull) dispatch_semaphore_t operationsLock; // A lock to keep the access to `URLOperations` thread-safe
+@property (strong, nonatomic, nullable) MWWebImageDownloaderConcurrencyController *concurrencyController; // nil unless adaptive concurrency is enabled
+@property (strong, nonatomic, nullable) MWWebImageDownloaderHostScheduler *hostScheduler; // nil unless per-host scheduling is enabled
+@property (strong, nonatomic, nullable) MWWebImageDownloaderMetricsCollector *metricsCollector; // nil if the metrics collection is disabled
+@property (strong, nonatomic, nullable) id<MWDiskCache> resumeDataCache; // nil unless resumable downloads are enabled
+@property (strong, nonatomic, readwrite, nonnull) MWWebImageDownloaderBufferBudget *bufferBudget;
+@property (strong, nonatomic, nonnull) NSMutableArray<NSOperation<MWWebImageDownloaderOperation> *> *bufferPausedOperations;
+@property (strong, nonatomic, nonnull) dispatch_semaphore_t bufferPauseLock; // A lock to keep the access to `bufferPausedOperations` thread-safe
+@property (assign, atomic) BOOL userSuspended; // the `suspended` state set by the user
 
 // The session in which data tasks will run
 @property (strong, nonatomic) NSURLSession *session;
@@ -94,9 +125,40 @@ static void * MWWebImageDownloaderContext = &MWWebImageDownloaderContext;
         }
         _config = [config copy];
         [_config addObserver:self forKeyPath:NSStringFromSelector(@selector(maxConcurrentDownloads)) options:0 context:MWWebImageDownloaderContext];
+        [_config addObserver:self forKeyPath:NSStringFromSelector(@selector(minConcurrentDownloads)) options:0 context:MWWebImageDownloaderContext];
+        [_config addObserver:self forKeyPath:NSStringFromSelector(@selector(maxConcurrentDownloadsPerHost)) options:0 context:MWWebImageDownloaderContext];
+        [_config addObserver:self forKeyPath:NSStringFromSelector(@selector(maxBufferedBytes)) options:0 context:MWWebImageDownloaderContext];
         _downloadQueue = [NSOperationQueue new];
-        _downloadQueue.maxConcurrentOperationCount = _config.maxConcurrentDownloads;
+        if (_config.shouldAdaptConcurrentDownloads) {
+            _concurrencyController = [[MWWebImageDownloaderConcurrencyController alloc] initWithMinimumLimit:MAX(_config.minConcurrentDownloads, 1) maximumLimit:MAX(_config.maxConcurrentDownloads, 1)];
+            _downloadQueue.maxConcurrentOperationCount = _concurrencyController.limit;
+        } else {
+            _downloadQueue.maxConcurrentOperationCount = _config.maxConcurrentDownloads;
+        }
         _downloadQueue.name = @"com.hackemist.MWWebImageDownloader";
+        if (_config.maxConcurrentDownloadsPerHost > 0 || _config.downloadWeightsPerHost.count > 0) {
+            _hostScheduler = [[MWWebImageDownloaderHostScheduler alloc] initWithConfig:_config];
+            // Cancelled downloads finish right after start, let them go
+            NSOperationQueue *downloadQueue = _downloadQueue;
+            _hostScheduler.cancelledBlock = ^(NSOperation * _Nonnull operation) {
+                [downloadQueue addOperation:operation];
+            };
+        }
+        if (_config.shouldResumeDownloads) {
+            _resumeDataCache = [self.class createResumeDataCache];
+        }
+        _bandwidthEstimator = [MWWebImageDownloaderBandwidthEstimator new];
+        if (_config.metricsWindowInterval > 0) {
+            _metricsCollector = [[MWWebImageDownloaderMetricsCollector alloc] initWithWindowInterval:_config.metricsWindowInterval];
+        }
+        _bufferBudget = [[MWWebImageDownloaderBufferBudget alloc] initWithLimit:_config.maxBufferedBytes];
+        _bufferPausedOperations = [NSMutableArray array];
+        _bufferPauseLock = dispatch_semaphore_create(1);
+        @weakify(self);
+        _bufferBudget.pressureChangedBlock = ^(BOOL overBudget) {
+            @strongify(self);
+            [self applyBufferPressure:overBudget];
+        };
         _URLOperations = [NSMutableDictionary new];
         NSMutableDictionary<NSString *, NSString *> *headerDictionary = [NSMutableDictionary dictionary];
         NSString *userAgent = nil;
@@ -144,6 +206,9 @@ static void * MWWebImageDownloaderContext = &MWWebImageDownloaderContext;
     
     [self.downloadQueue cancelAllOperations];
     [self.config removeObserver:self forKeyPath:NSStringFromSelector(@selector(maxConcurrentDownloads)) context:MWWebImageDownloaderContext];
+    [self.config removeObserver:self forKeyPath:NSStringFromSelector(@selector(minConcurrentDownloads)) context:MWWebImageDownloaderContext];
+    [self.config removeObserver:self forKeyPath:NSStringFromSelector(@selector(maxConcurrentDownloadsPerHost)) context:MWWebImageDownloaderContext];
+    [self.config removeObserver:self forKeyPath:NSStringFromSelector(@selector(maxBufferedBytes)) context:MWWebImageDownloaderContext];
 }
 
 - (void)invalidateSessionAndCancel:(BOOL)cancelPendingOperations {
@@ -204,9 +269,13 @@ static void * MWWebImageDownloaderContext = &MWWebImageDownloaderContext;
     
     MW_LOCK(self.operationsLock);
     id downloadOperationCancelToken;
-    NSOperation<MWWebImageDownloaderOperation> *operation = [self.URLOperations objectForKey:url];
+    id<NSCopying> operationKey = MWOperationKeyForURL(url, context);
+    NSOperation<MWWebImageDownloaderOperation> *operation = [self.URLOperations objectForKey:operationKey];
+    // A conditional request may finish with `304 Not Modified` and no image, only the callers which have the cached image can share it
+    BOOL conditional = [context[MWWebImageContextLoaderCachedValidators] isKindOfClass:MWImageCacheValidators.class];
+    BOOL shareable = conditional || !MWIsConditionalRequest(operation.request);
     // There is a case that the operation may be marked as finished or cancelled, but not been removed from `self.URLOperations`.
-    if (!operation || operation.isFinished || operation.isCancelled) {
+    if (!operation || operation.isFinished || operation.isCancelled || !shareable) {
         operation = [self createDownloaderOperationWithUrl:url options:options context:context];
         if (!operation) {
             MW_UNLOCK(self.operationsLock);
@@ -217,28 +286,45 @@ static void * MWWebImageDownloaderContext = &MWWebImageDownloaderContext;
             return nil;
         }
         @weakify(self);
+        __weak typeof(operation) weakOperation = operation;
         operation.completionBlock = ^{
             @strongify(self);
             if (!self) {
                 return;
             }
+            NSOperation<MWWebImageDownloaderOperation> *finishedOperation = weakOperation;
             MW_LOCK(self.operationsLock);
-            [self.URLOperations removeObjectForKey:url];
+            // The URL may have been taken over by a new operation which could not share this one
+            if ([self.URLOperations objectForKey:operationKey] == finishedOperation) {
+                [self.URLOperations removeObjectForKey:operationKey];
+            }
             MW_UNLOCK(self.operationsLock);
+            if (self.hostScheduler && finishedOperation) {
+                [self.hostScheduler finishOperation:finishedOperation];
+                [self scheduleHostOperations];
+            }
+            [self resumeBufferPausedOperationIfIdle];
         };
-        self.URLOperations[url] = operation;
+        self.URLOperations[operationKey] = operation;
         // Add the handlers before submitting to operation queue, avoid the race condition that operation finished before setting handlers.
         downloadOperationCancelToken = [operation addHandlersForProgress:progressBlock completed:completedBlock];
         // Add operation to operation queue only after all configuration done according to Apple's doc.
         // `addOperation:` does not synchronously execute the `operation.completionBlock` so this will not cause deadlock.
-        [self.downloadQueue addOperation:operation];
+        if (self.hostScheduler) {
+            // Wait for a slot of its host
+            [self.hostScheduler enqueueOperation:operation forHost:url.host ?: @""];
+            [self scheduleHostOperations];
+        } else {
+            [self.downloadQueue addOperation:operation];
+        }
     } else {
         // When we reuse the download operation to attach more callbacks, there may be thread safe issue because the getter of callbacks may in another queue (decoding queue or delegate queue)
         // So we lock the operation here, and in `MWWebImageDownloaderOperation`, we use `@synchonzied (self)`, to ensure the thread safe between these two classes.
         @synchronized (operation) {
             downloadOperationCancelToken = [operation addHandlersForProgress:progressBlock completed:completedBlock];
         }
-        if (!operation.isExecuting) {
+        // The operations supporting `setPriority:forToken:` are raised by the token below, even if already running
+        if (![operation respondsToSelector:@selector(setPriority:forToken:)] && !operation.isExecuting) {
             if (options & MWWebImageDownloaderHighPriority) {
                 operation.queuePriority = NSOperationQueuePriorityHigh;
             } else if (options & MWWebImageDownloaderLowPriority) {
@@ -254,6 +340,13 @@ static void * MWWebImageDownloaderContext = &MWWebImageDownloaderContext;
     token.url = url;
     token.request = operation.request;
     token.downloadOperationCancelToken = downloadOperationCancelToken;
+    if (options & MWWebImageDownloaderHighPriority) {
+        token.priority = MWWebImageOperationPriorityHigh;
+    } else if (options & MWWebImageDownloaderLowPriority) {
+        token.priority = MWWebImageOperationPriorityLow;
+    } else {
+        token.priority = MWWebImageOperationPriorityDefault;
+    }
     
     return token;
 }
@@ -274,6 +367,11 @@ static void * MWWebImageDownloaderContext = &MWWebImageDownloaderContext;
     MW_LOCK(self.HTTPHeadersLock);
     mutableRequest.allHTTPHeaderFields = self.HTTPHeaders;
     MW_UNLOCK(self.HTTPHeadersLock);
+    // Revalidate the cached image with a conditional request
+    MWImageCacheValidators *cachedValidators = context[MWWebImageContextLoaderCachedValidators];
+    if ([cachedValidators isKindOfClass:MWImageCacheValidators.class]) {
+        [cachedValidators applyToRequest:mutableRequest];
+    }
     
     // Context Option
     MWWebImageMutableContext *mutableContext;
@@ -293,7 +391,12 @@ static void * MWWebImageDownloaderContext = &MWWebImageDownloaderContext;
     
     NSURLRequest *request;
     if (requestModifier) {
-        NSURLRequest *modifiedRequest = [requestModifier modifiedRequestWithRequest:[mutableRequest copy]];
+        NSURLRequest *modifiedRequest;
+        if ([requestModifier respondsToSelector:@selector(modifiedRequestWithRequest:context:)]) {
+            modifiedRequest = [requestModifier modifiedRequestWithRequest:[mutableRequest copy] context:context];
+        } else {
+            modifiedRequest = [requestModifier modifiedRequestWithRequest:[mutableRequest copy]];
+        }
         // If modified request is nil, early return
         if (!modifiedRequest) {
             return nil;
@@ -347,13 +450,27 @@ static void * MWWebImageDownloaderContext = &MWWebImageDownloaderContext;
         operation.minimumProgressInterval = MIN(MAX(self.config.minimumProgressInterval, 0), 1);
     }
     
+    if (self.resumeDataCache && [operation respondsToSelector:@selector(setResumeDataCache:)]) {
+        operation.resumeDataCache = self.resumeDataCache;
+        operation.minResumableDataSize = self.config.minResumableDataSize;
+    }
+    
+    if ([operation respondsToSelector:@selector(setMaxImagePixelCount:)]) {
+        operation.maxImagePixelCount = self.config.maxImagePixelCount;
+    }
+    
+    if ([operation respondsToSelector:@selector(setBufferBudget:)]) {
+        operation.bufferBudget = self.bufferBudget;
+    }
+    
     if (options & MWWebImageDownloaderHighPriority) {
         operation.queuePriority = NSOperationQueuePriorityHigh;
     } else if (options & MWWebImageDownloaderLowPriority) {
         operation.queuePriority = NSOperationQueuePriorityLow;
     }
     
-    if (self.config.executionOrder == MWWebImageDownloaderLIFOExecutionOrder) {
+    // The per-host scheduler applies the execution order by itself
+    if (!self.hostScheduler && self.config.executionOrder == MWWebImageDownloaderLIFOExecutionOrder) {
         // Emulate LIFO execution order by systematically, each previous adding operation can dependency the new operation
         // This can gurantee the new operation to be execulated firstly, even if when some operations finished, meanwhile you appending new operations
         // Just make last added operation dependents new operation can not solve this problem. See test case #test15DownloaderLIFOExecutionOrder
@@ -367,20 +484,65 @@ static void * MWWebImageDownloaderContext = &MWWebImageDownloaderContext;
 
 - (void)cancelAllDownloads {
     [self.downloadQueue cancelAllOperations];
+    if (self.hostScheduler) {
+        // Cancelled ones are admitted to finish by the scheduler
+        [[self.hostScheduler pendingOperations] makeObjectsPerformSelector:@selector(cancel)];
+    }
+}
+
+#pragma mark - Resume data
+
++ (id<MWDiskCache>)createResumeDataCache {
+    NSString *directory = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject;
+    if (!directory) {
+        return nil;
+    }
+    NSString *cachePath = [[directory stringByAppendingPathComponent:@"com.hackemist.MWWebImageDownloader"] stringByAppendingPathComponent:@"ResumeData"];
+    // The partial data is only worth for a short while, the image is likely requested again soon or never
+    MWImageCacheConfig *cacheConfig = [MWImageCacheConfig new];
+    cacheConfig.maxDiskAge = 60 * 60 * 24;
+    cacheConfig.maxDiskSize = 50 * 1024 * 1024;
+    MWDiskCache *resumeDataCache = [[MWDiskCache alloc] initWithCachePath:cachePath config:cacheConfig];
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_BACKGROUND, 0), ^{
+        [resumeDataCache removeExpiredData];
+    });
+    return resumeDataCache;
+}
+
+#pragma mark - Host scheduling
+
+- (void)scheduleHostOperations {
+    NSArray<NSOperation *> *operations = [self.hostScheduler dequeueOperationsWithLimit:self.downloadQueue.maxConcurrentOperationCount];
+    for (NSOperation *operation in operations) {
+        [self.downloadQueue addOperation:operation];
+    }
 }
 
 #pragma mark - Properties
 
 - (BOOL)isSuspended {
-    return self.downloadQueue.isSuspended;
+    return self.userSuspended;
 }
 
 - (void)setSuspended:(BOOL)suspended {
+    self.userSuspended = suspended;
     self.downloadQueue.suspended = suspended;
 }
 
 - (NSUInteger)currentDownloadCount {
-    return self.downloadQueue.operationCount;
+    return self.downloadQueue.operationCount + self.hostScheduler.pendingCount;
+}
+
+- (MWWebImageDownloaderMetricsSnapshot *)metricsSnapshot {
+    return [self.metricsCollector snapshot];
+}
+
+- (NSDictionary<NSString *,MWWebImageDownloaderHostStatistics *> *)hostStatistics {
+    return self.hostScheduler ? [self.hostScheduler statistics] : @{};
+}
+
+- (NSUInteger)currentConcurrentDownloadsLimit {
+    return self.downloadQueue.maxConcurrentOperationCount;
 }
 
 - (NSURLSessionConfiguration *)sessionConfiguration {
@@ -391,14 +553,166 @@ static void * MWWebImageDownloaderContext = &MWWebImageDownloaderContext;
 
 - (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary<NSKeyValueChangeKey,id> *)change context:(void *)context {
     if (context == MWWebImageDownloaderContext) {
-        if ([keyPath isEqualToString:NSStringFromSelector(@selector(maxConcurrentDownloads))]) {
+        if ([keyPath isEqualToString:NSStringFromSelector(@selector(maxBufferedBytes))]) {
+            self.bufferBudget.limit = self.config.maxBufferedBytes;
+            return;
+        }
+        if (self.concurrencyController) {
+            // The config values are the floor and ceiling of the adaptive limit
+            self.concurrencyController.minimumLimit = MAX(self.config.minConcurrentDownloads, 1);
+            self.concurrencyController.maximumLimit = MAX(self.config.maxConcurrentDownloads, 1);
+            self.downloadQueue.maxConcurrentOperationCount = self.concurrencyController.limit;
+        } else if ([keyPath isEqualToString:NSStringFromSelector(@selector(maxConcurrentDownloads))]) {
             self.downloadQueue.maxConcurrentOperationCount = self.config.maxConcurrentDownloads;
         }
+        if (self.hostScheduler) {
+            // More slots may be available
+            [self scheduleHostOperations];
+        }
     } else {
         [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
     }
 }
 
+#pragma mark Buffer budget
+
+// Over budget, the downloads below the default priority wait in the queue and the running ones pause, so that the visible images complete and release their buffers first
+// The others still start, and one download always keeps running, else the paused buffers would never drain
+- (void)applyBufferPressure:(BOOL)overBudget {
+    NSArray<NSOperation<MWWebImageDownloaderOperation> *> *operations = self.downloadQueue.operations;
+    for (NSOperation<MWWebImageDownloaderOperation> *operation in operations) {
+        if (!operation.isExecuting && [operation respondsToSelector:@selector(bufferPressureDidChange)]) {
+            [operation bufferPressureDidChange];
+        }
+    }
+    MW_LOCK(self.bufferPauseLock);
+    if (overBudget) {
+        NSMutableArray<NSOperation<MWWebImageDownloaderOperation> *> *pausableOperations = [NSMutableArray array];
+        BOOL keepsRunning = NO;
+        for (NSOperation<MWWebImageDownloaderOperation> *operation in operations) {
+            if (!operation.isExecuting) {
+                continue;
+            }
+            if (![operation respondsToSelector:@selector(pauseForBufferPressure)] || ![operation respondsToSelector:@selector(priority)] || operation.priority >= MWWebImageOperationPriorityDefault) {
+                keepsRunning = YES;
+                continue;
+            }
+            [pausableOperations addObject:operation];
+        }
+        if (!keepsRunning && pausableOperations.count > 0) {
+            [pausableOperations removeObject:[self highestPriorityOperationInOperations:pausableOperations]];
+        }
+        for (NSOperation<MWWebImageDownloaderOperation> *operation in pausableOperations) {
+            if ([operation pauseForBufferPressure]) {
+                [self.bufferPausedOperations addObject:operation];
+            }
+        }
+    } else {
+        for (NSOperation<MWWebImageDownloaderOperation> *operation in self.bufferPausedOperations) {
+            [operation resumeFromBufferPressure];
+        }
+        [self.bufferPausedOperations removeAllObjects];
+    }
+    MW_UNLOCK(self.bufferPauseLock);
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [[NSNotificationCenter defaultCenter] postNotificationName:MWWebImageDownloaderBufferPressureDidChangeNotification object:self];
+    });
+}
+
+// Still over budget when the last running download finished, resume the paused one at the highest priority
+- (void)resumeBufferPausedOperationIfIdle {
+    if (!self.bufferBudget.isOverBudget) {
+        return;
+    }
+    MW_LOCK(self.bufferPauseLock);
+    [self.bufferPausedOperations filterUsingPredicate:[NSPredicate predicateWithBlock:^BOOL(NSOperation<MWWebImageDownloaderOperation> *operation, NSDictionary<NSString *, id> *bindings) {
+        return !operation.isFinished && operation.isBufferPaused;
+    }]];
+    BOOL running = NO;
+    for (NSOperation<MWWebImageDownloaderOperation> *operation in self.downloadQueue.operations) {
+        if (operation.isExecuting && ![self.bufferPausedOperations containsObject:operation]) {
+            running = YES;
+            break;
+        }
+    }
+    if (!running && self.bufferPausedOperations.count > 0) {
+        NSOperation<MWWebImageDownloaderOperation> *operation = [self highestPriorityOperationInOperations:self.bufferPausedOperations];
+        [operation resumeFromBufferPressure];
+        [self.bufferPausedOperations removeObject:operation];
+    }
+    MW_UNLOCK(self.bufferPauseLock);
+}
+
+- (NSOperation<MWWebImageDownloaderOperation> *)highestPriorityOperationInOperations:(NSArray<NSOperation<MWWebImageDownloaderOperation> *> *)operations {
+    NSOperation<MWWebImageDownloaderOperation> *highestOperation;
+    for (NSOperation<MWWebImageDownloaderOperation> *operation in operations) {
+        if (!highestOperation || operation.priority > highestOperation.priority) {
+            highestOperation = operation;
+        }
+    }
+    return highestOperation;
+}
+
+#pragma mark Adaptive concurrency
+
+- (void)adaptConcurrencyWithTask:(NSURLSessionTask *)task operation:(NSOperation<MWWebImageDownloaderOperation> *)operation error:(NSError *)error {
+    NSTimeInterval timeToFirstByte = -1;
+    if ([operation respondsToSelector:@selector(metrics)]) {
+        if (@available(iOS 10.0, tvOS 10.0, macOS 10.12, watchOS 3.0, *)) {
+            NSURLSessionTaskTransactionMetrics *transactionMetrics = operation.metrics.transactionMetrics.lastObject;
+            if (transactionMetrics.requestStartDate && transactionMetrics.responseStartDate) {
+                timeToFirstByte = [transactionMetrics.responseStartDate timeIntervalSinceDate:transactionMetrics.requestStartDate];
+            }
+        }
+    }
+    NSUInteger limit = self.concurrencyController.limit;
+    // The finishing operation is still in the queue
+    BOOL hasPendingDownloads = self.currentDownloadCount > limit;
+    MWWebImageDownloaderConcurrencyDecision *decision = [self.concurrencyController decisionForDownloadWithHost:task.originalRequest.URL.host timeToFirstByte:timeToFirstByte bytes:task.countOfBytesReceived error:error hasPendingDownloads:hasPendingDownloads];
+    if (!decision) {
+        return;
+    }
+    self.downloadQueue.maxConcurrentOperationCount = decision.limit;
+    if (self.hostScheduler) {
+        [self scheduleHostOperations];
+    }
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [[NSNotificationCenter defaultCenter] postNotificationName:MWWebImageDownloaderConcurrencyDidChangeNotification object:self userInfo:@{MWWebImageDownloaderConcurrencyDecisionKey : decision}];
+    });
+}
+
+#pragma mark Transfer metrics
+
+- (void)recordTransferWithTask:(NSURLSessionTask *)task operation:(NSOperation<MWWebImageDownloaderOperation> *)operation {
+    int64_t bytes = task.countOfBytesReceived;
+    if ([operation respondsToSelector:@selector(metrics)]) {
+        if (@available(iOS 10.0, tvOS 10.0, macOS 10.12, watchOS 3.0, *)) {
+            NSURLSessionTaskMetrics *metrics = operation.metrics;
+            // The body transfer only, the time to first byte is latency not bandwidth
+            NSURLSessionTaskTransactionMetrics *transactionMetrics = metrics.transactionMetrics.lastObject;
+            if (transactionMetrics.resourceFetchType == NSURLSessionTaskMetricsResourceFetchTypeNetworkLoad && transactionMetrics.responseStartDate && transactionMetrics.responseEndDate) {
+                NSTimeInterval duration = [transactionMetrics.responseEndDate timeIntervalSinceDate:transactionMetrics.responseStartDate];
+                [self.bandwidthEstimator recordTransferWithBytes:bytes duration:duration];
+            }
+            if (metrics && self.metricsCollector) {
+                MWWebImageOperationPriority priority = [operation respondsToSelector:@selector(priority)] ? operation.priority : MWWebImageOperationPriorityDefault;
+                [self.metricsCollector recordMetrics:metrics host:task.originalRequest.URL.host ?: @"" priority:priority receivedBytes:bytes];
+            }
+        }
+    }
+    // Report the bytes to the request modifier which chose this request
+    id<MWWebImageDownloaderRequestModifier> requestModifier;
+    MWWebImageContext *context = [operation respondsToSelector:@selector(context)] ? [(id)operation context] : nil;
+    if ([context valueForKey:MWWebImageContextDownloadRequestModifier]) {
+        requestModifier = [context valueForKey:MWWebImageContextDownloadRequestModifier];
+    } else {
+        requestModifier = self.requestModifier;
+    }
+    if ([requestModifier respondsToSelector:@selector(didFinishRequest:receivedBytes:)] && task.originalRequest) {
+        [requestModifier didFinishRequest:task.originalRequest receivedBytes:bytes];
+    }
+}
+
 #pragma mark Helper methods
 
 - (NSOperation<MWWebImageDownloaderOperation> *)operationWithTask:(NSURLSessionTask *)task {
@@ -468,6 +782,12 @@ didReceiveResponse:(NSURLResponse *)response
     
     // Identify the operation that runs this task and pass it the delegate method
     NSOperation<MWWebImageDownloaderOperation> *dataOperation = [self operationWithTask:task];
+    if (self.concurrencyController) {
+        [self adaptConcurrencyWithTask:task operation:dataOperation error:error];
+    }
+    if (!error) {
+        [self recordTransferWithTask:task operation:dataOperation];
+    }
     if ([dataOperation respondsToSelector:@selector(URLSession:task:didCompleteWithError:)]) {
         [dataOperation URLSession:session task:task didCompleteWithError:error];
     }
@@ -515,6 +835,7 @@ didReceiveResponse:(NSURLResponse *)response
 - (void)dealloc {
     [[NSNotificationCenter defaultCenter] removeObserver:self name:MWWebImageDownloadReceiveResponseNotification object:nil];
     [[NSNotificationCenter defaultCenter] removeObserver:self name:MWWebImageDownloadStopNotification object:nil];
+    [[NSNotificationCenter defaultCenter] removeObserver:self name:MWWebImageDownloadWriteFileNotification object:nil];
 }
 
 - (instancetype)initWithDownloadOperation:(NSOperation<MWWebImageDownloaderOperation> *)downloadOperation {
@@ -523,6 +844,7 @@ didReceiveResponse:(NSURLResponse *)response
         _downloadOperation = downloadOperation;
         [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(downloadDidReceiveResponse:) name:MWWebImageDownloadReceiveResponseNotification object:downloadOperation];
         [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(downloadDidStop:) name:MWWebImageDownloadStopNotification object:downloadOperation];
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(downloadDidWriteFile:) name:MWWebImageDownloadWriteFileNotification object:downloadOperation];
     }
     return self;
 }
@@ -545,6 +867,15 @@ didReceiveResponse:(NSURLResponse *)response
     }
 }
 
+- (void)downloadDidWriteFile:(NSNotification *)notification {
+    NSOperation<MWWebImageDownloaderOperation> *downloadOperation = notification.object;
+    if (downloadOperation && downloadOperation == self.downloadOperation) {
+        if ([downloadOperation respondsToSelector:@selector(downloadedFileURL)]) {
+            self.downloadedFileURL = downloadOperation.downloadedFileURL;
+        }
+    }
+}
+
 - (void)cancel {
     @synchronized (self) {
         if (self.isCancelled) {
@@ -556,6 +887,28 @@ didReceiveResponse:(NSURLResponse *)response
     }
 }
 
+- (MWWebImageOperationPriority)priority {
+    @synchronized (self) {
+        return self.requestedPriority;
+    }
+}
+
+- (void)setPriority:(MWWebImageOperationPriority)priority {
+    @synchronized (self) {
+        if (self.isCancelled) {
+            return;
+        }
+        self.requestedPriority = priority;
+        NSOperation<MWWebImageDownloaderOperation> *downloadOperation = self.downloadOperation;
+        if ([downloadOperation respondsToSelector:@selector(setPriority:forToken:)]) {
+            // Only this caller's request, the operation runs at the highest one
+            [downloadOperation setPriority:priority forToken:self.downloadOperationCancelToken];
+        } else if ([downloadOperation respondsToSelector:@selector(setPriority:)]) {
+            downloadOperation.priority = priority;
+        }
+    }
+}
+
 @end
 
 @implementation MWWebImageDownloader (MWImageLoader)
@@ -570,11 +923,14 @@ didReceiveResponse:(NSURLResponse *)response
 
 - (id<MWWebImageOperation>)requestImageWithURL:(NSURL *)url options:(MWWebImageOptions)options context:(MWWebImageContext *)context progress:(MWImageLoaderProgressBlock)progressBlock completed:(MWImageLoaderCompletedBlock)completedBlock {
     UIImage *cachedImage = context[MWWebImageContextLoaderCachedImage];
+    MWImageCacheValidators *cachedValidators = context[MWWebImageContextLoaderCachedValidators];
+    BOOL conditional = cachedImage && [cachedValidators isKindOfClass:MWImageCacheValidators.class];
     
     MWWebImageDownloaderOptions downloaderOptions = 0;
     if (options & MWWebImageLowPriority) downloaderOptions |= MWWebImageDownloaderLowPriority;
     if (options & MWWebImageProgressiveLoad) downloaderOptions |= MWWebImageDownloaderProgressiveLoad;
-    if (options & MWWebImageRefreshCached) downloaderOptions |= MWWebImageDownloaderUseNSURLCache;
+    // The conditional request does not need NSURLCache, neither does the stale-while-revalidate mode which stores the validators
+    if (options & MWWebImageRefreshCached && !conditional && !(options & MWWebImageStaleWhileRevalidate)) downloaderOptions |= MWWebImageDownloaderUseNSURLCache;
     if (options & MWWebImageContinueInBackground) downloaderOptions |= MWWebImageDownloaderContinueInBackground;
     if (options & MWWebImageHandleCookies) downloaderOptions |= MWWebImageDownloaderHandleCookies;
     if (options & MWWebImageAllowInvalidSSLCertificates) downloaderOptions |= MWWebImageDownloaderAllowInvalidSSLCertificates;
@@ -585,11 +941,13 @@ didReceiveResponse:(NSURLResponse *)response
     if (options & MWWebImagePreloadAllFrames) downloaderOptions |= MWWebImageDownloaderPreloadAllFrames;
     if (options & MWWebImageMatchAnimatedImageClass) downloaderOptions |= MWWebImageDownloaderMatchAnimatedImageClass;
     
-    if (cachedImage && options & MWWebImageRefreshCached) {
+    if (cachedImage && options & (MWWebImageRefreshCached | MWWebImageStaleWhileRevalidate)) {
         // force progressive off if image already cached but forced refreshing
         downloaderOptions &= ~MWWebImageDownloaderProgressiveLoad;
-        // ignore image read from NSURLCache if image if cached but force refreshing
-        downloaderOptions |= MWWebImageDownloaderIgnoreCachedResponse;
+        // ignore image read from NSURLCache if image if cached but force refreshing, a conditional request gets `304 Not Modified` instead
+        if (downloaderOptions & MWWebImageDownloaderUseNSURLCache) {
+            downloaderOptions |= MWWebImageDownloaderIgnoreCachedResponse;
+        }
     }
     
     return [self downloadImageWithURL:url options:downloaderOptions context:context progress:progressBlock completed:completedBlock];
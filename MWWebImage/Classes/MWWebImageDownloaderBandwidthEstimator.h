@@ -0,0 +1,37 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "MWWebImageCompat.h"
+
+/**
+ A running estimate of the download throughput, fed by `MWWebImageDownloader` with the body transfer time of each finished download (from `NSURLSessionTaskMetrics`, so iOS 10/macOS 10.12 and later).
+ Small downloads are dominated by latency and slow start, they are weighted less than large ones. See `MWWebImageDownloaderVariantRequestModifier`.
+ @note All methods are thread-safe.
+ */
+@interface MWWebImageDownloaderBandwidthEstimator : NSObject
+
+/// The estimated throughput in bytes per second, 0 if there is no sample yet
+@property (nonatomic, assign, readonly) double estimatedBandwidth;
+/// The number of samples recorded so far
+@property (nonatomic, assign, readonly) NSUInteger sampleCount;
+
+/**
+ Record a finished transfer. Transfers without bytes or duration are ignored.
+
+ @param bytes The response body bytes received
+ @param duration The time from the first to the last response byte, in seconds
+ */
+- (void)recordTransferWithBytes:(int64_t)bytes duration:(NSTimeInterval)duration;
+
+/**
+ Forget all the samples, for example when the network interface changes.
+ */
+- (void)reset;
+
+@end
@@ -0,0 +1,77 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "MWWebImageDownloaderBandwidthEstimator.h"
+#import "MWInternalMacros.h"
+
+// The smoothing factor of a sample of `kMWBandwidthReferenceBytes`, smaller samples move the estimate less
+static const double kMWBandwidthAverageFactor = 0.3;
+static const double kMWBandwidthReferenceBytes = 64 * 1024;
+// Below this duration the clock resolution makes the sample meaningless
+static const NSTimeInterval kMWBandwidthMinimumDuration = 0.001;
+
+@interface MWWebImageDownloaderBandwidthEstimator ()
+
+@property (nonatomic, assign, readwrite) double estimatedBandwidth;
+@property (nonatomic, assign, readwrite) NSUInteger sampleCount;
+@property (nonatomic, strong, nonnull) dispatch_semaphore_t lock;
+
+@end
+
+@implementation MWWebImageDownloaderBandwidthEstimator
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _lock = dispatch_semaphore_create(1);
+    }
+    return self;
+}
+
+- (double)estimatedBandwidth {
+    MW_LOCK(self.lock);
+    double estimatedBandwidth = _estimatedBandwidth;
+    MW_UNLOCK(self.lock);
+    return estimatedBandwidth;
+}
+
+- (NSUInteger)sampleCount {
+    MW_LOCK(self.lock);
+    NSUInteger sampleCount = _sampleCount;
+    MW_UNLOCK(self.lock);
+    return sampleCount;
+}
+
+- (void)recordTransferWithBytes:(int64_t)bytes duration:(NSTimeInterval)duration {
+    if (bytes <= 0 || duration <= 0) {
+        return;
+    }
+    double bandwidth = bytes / MAX(duration, kMWBandwidthMinimumDuration);
+    double factor = kMWBandwidthAverageFactor * MIN(bytes / kMWBandwidthReferenceBytes, 1);
+    MW_LOCK(self.lock);
+    if (_sampleCount == 0) {
+        _estimatedBandwidth = bandwidth;
+    } else {
+        _estimatedBandwidth += (bandwidth - _estimatedBandwidth) * factor;
+    }
+    _sampleCount++;
+    MW_UNLOCK(self.lock);
+}
+
+- (void)reset {
+    MW_LOCK(self.lock);
+    _estimatedBandwidth = 0;
+    _sampleCount = 0;
+    MW_UNLOCK(self.lock);
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p bandwidth = %.0fB/s, samples = %lu>", NSStringFromClass(self.class), self, self.estimatedBandwidth, (unsigned long)self.sampleCount];
+}
+
+@end
@@ -0,0 +1,50 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "MWWebImageCompat.h"
+
+/**
+ The accounting of the bytes received by the downloads of a `MWWebImageDownloader` and held in memory until their image is decoded. See `MWWebImageDownloaderConfig.maxBufferedBytes`.
+ The budget goes over when the buffered bytes exceed the limit, and back under when they drain to 3/4 of it, so that the downloader does not pause and resume the downloads at each chunk.
+ @note All methods are thread-safe.
+ */
+@interface MWWebImageDownloaderBufferBudget : NSObject
+
+/// The maximum buffered bytes. 0 means no limit, the bytes are still counted
+@property (assign, atomic) NSUInteger limit;
+/// The bytes buffered now
+@property (assign, atomic, readonly) NSUInteger bufferedBytes;
+/// The most bytes buffered at the same time, since the creation or the last `resetHighWaterMark`
+@property (assign, atomic, readonly) NSUInteger highWaterMark;
+/// Whether the buffered bytes went over the limit and did not drain yet
+@property (assign, atomic, readonly, getter=isOverBudget) BOOL overBudget;
+
+/**
+ Called on a serial queue of the budget when `overBudget` changes, with its value at the time of the call.
+ */
+@property (copy, atomic, nullable) void (^pressureChangedBlock)(BOOL overBudget);
+
+- (nonnull instancetype)initWithLimit:(NSUInteger)limit NS_DESIGNATED_INITIALIZER;
+
+/**
+ Count bytes appended to a download buffer.
+ */
+- (void)chargeBytes:(NSUInteger)bytes;
+
+/**
+ Stop counting bytes released by a download buffer.
+ */
+- (void)releaseBytes:(NSUInteger)bytes;
+
+/**
+ Start the high water mark again from the bytes buffered now.
+ */
+- (void)resetHighWaterMark;
+
+@end
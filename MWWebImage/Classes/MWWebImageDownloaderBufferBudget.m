@@ -0,0 +1,103 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "MWWebImageDownloaderBufferBudget.h"
+#import "MWInternalMacros.h"
+
+@interface MWWebImageDownloaderBufferBudget ()
+
+@property (assign, atomic, readwrite) NSUInteger bufferedBytes;
+@property (assign, atomic, readwrite) NSUInteger highWaterMark;
+@property (assign, atomic, readwrite, getter=isOverBudget) BOOL overBudget;
+@property (nonatomic, strong, nonnull) dispatch_semaphore_t lock;
+@property (nonatomic, strong, nonnull) dispatch_queue_t pressureQueue;
+
+@end
+
+@implementation MWWebImageDownloaderBufferBudget
+
+- (instancetype)init {
+    return [self initWithLimit:0];
+}
+
+- (instancetype)initWithLimit:(NSUInteger)limit {
+    self = [super init];
+    if (self) {
+        _limit = limit;
+        _lock = dispatch_semaphore_create(1);
+        _pressureQueue = dispatch_queue_create("com.hackemist.MWWebImageDownloaderBufferBudget.pressureQueue", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+- (void)chargeBytes:(NSUInteger)bytes {
+    if (bytes == 0) {
+        return;
+    }
+    MW_LOCK(self.lock);
+    self.bufferedBytes += bytes;
+    self.highWaterMark = MAX(self.highWaterMark, self.bufferedBytes);
+    BOOL changed = [self updatePressure];
+    MW_UNLOCK(self.lock);
+    if (changed) {
+        [self notifyPressure];
+    }
+}
+
+- (void)releaseBytes:(NSUInteger)bytes {
+    if (bytes == 0) {
+        return;
+    }
+    MW_LOCK(self.lock);
+    self.bufferedBytes -= MIN(bytes, self.bufferedBytes);
+    BOOL changed = [self updatePressure];
+    MW_UNLOCK(self.lock);
+    if (changed) {
+        [self notifyPressure];
+    }
+}
+
+- (void)resetHighWaterMark {
+    MW_LOCK(self.lock);
+    self.highWaterMark = self.bufferedBytes;
+    MW_UNLOCK(self.lock);
+}
+
+// Must be called inside the lock. Returns YES if `overBudget` changed
+- (BOOL)updatePressure {
+    NSUInteger limit = self.limit;
+    BOOL overBudget = self.overBudget;
+    if (limit == 0) {
+        overBudget = NO;
+    } else if (!overBudget && self.bufferedBytes > limit) {
+        overBudget = YES;
+    } else if (overBudget && self.bufferedBytes <= limit / 4 * 3) {
+        overBudget = NO;
+    }
+    if (overBudget == self.overBudget) {
+        return NO;
+    }
+    self.overBudget = overBudget;
+    return YES;
+}
+
+- (void)notifyPressure {
+    // Read the state again on the queue, the changes racing to get there are delivered with the latest state
+    dispatch_async(self.pressureQueue, ^{
+        void (^pressureChangedBlock)(BOOL) = self.pressureChangedBlock;
+        if (pressureChangedBlock) {
+            pressureChangedBlock(self.isOverBudget);
+        }
+    });
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p bufferedBytes = %lu, highWaterMark = %lu, limit = %lu, overBudget = %d>", NSStringFromClass(self.class), self, (unsigned long)self.bufferedBytes, (unsigned long)self.highWaterMark, (unsigned long)self.limit, self.isOverBudget];
+}
+
+@end
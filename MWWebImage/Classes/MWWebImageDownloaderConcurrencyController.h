@@ -0,0 +1,93 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "MWWebImageCompat.h"
+
+/// The reason of a concurrency limit change
+typedef NS_ENUM(NSUInteger, MWWebImageDownloaderConcurrencyChangeReason) {
+    /**
+     * A full round of downloads finished without congestion while more downloads were waiting. The limit is raised by one.
+     */
+    MWWebImageDownloaderConcurrencyChangeReasonAdditiveIncrease,
+    /**
+     * The time to first byte grew well above the recent minimum of the same host, the link is queueing. The limit is halved.
+     */
+    MWWebImageDownloaderConcurrencyChangeReasonSlowFirstByte,
+    /**
+     * The goodput of the last round dropped compared to the previous round. The limit is halved.
+     */
+    MWWebImageDownloaderConcurrencyChangeReasonGoodputDrop,
+    /**
+     * A download timed out or lost its connection. The limit is halved.
+     */
+    MWWebImageDownloaderConcurrencyChangeReasonNetworkError,
+};
+
+/**
+ A decision of the adaptive download concurrency controller. Posted with `MWWebImageDownloaderConcurrencyDidChangeNotification`.
+ */
+@interface MWWebImageDownloaderConcurrencyDecision : NSObject
+
+/// The limit before the decision
+@property (nonatomic, assign, readonly) NSUInteger previousLimit;
+/// The limit after the decision, already applied to the download queue
+@property (nonatomic, assign, readonly) NSUInteger limit;
+/// Why the limit changed
+@property (nonatomic, assign, readonly) MWWebImageDownloaderConcurrencyChangeReason reason;
+/// The time to first byte of the download which triggered the decision, in seconds
+@property (nonatomic, assign, readonly) NSTimeInterval timeToFirstByte;
+/// The recent minimum time to first byte of the host of the download, in seconds
+@property (nonatomic, assign, readonly) NSTimeInterval baselineTimeToFirstByte;
+/// The goodput of the last round, in bytes per second. 0 if the round is not finished yet
+@property (nonatomic, assign, readonly) double goodput;
+
+@end
+
+/**
+ The additive increase, multiplicative decrease controller used by `MWWebImageDownloader` when `MWWebImageDownloaderConfig.shouldAdaptConcurrentDownloads` is enabled.
+ Each finished download reports its time to first byte and bytes, the goodput is measured over each round. After a round of `limit` downloads without congestion, if there are still downloads waiting, the limit is raised by one. On congestion (slow first byte, goodput drop or network timeout), the limit is halved, then the next round is observed before deciding again.
+ @note All methods are thread-safe.
+ */
+@interface MWWebImageDownloaderConcurrencyController : NSObject
+
+/// The current concurrency limit, between `minimumLimit` and `maximumLimit`
+@property (nonatomic, assign, readonly) NSUInteger limit;
+/// The floor of the limit
+@property (nonatomic, assign) NSUInteger minimumLimit;
+/// The ceiling of the limit
+@property (nonatomic, assign) NSUInteger maximumLimit;
+
+- (nonnull instancetype)init NS_UNAVAILABLE;
++ (nonnull instancetype)new NS_UNAVAILABLE;
+
+/**
+ Create a controller, the limit starts at the floor.
+
+ @param minimumLimit The floor of the limit, at least 1
+ @param maximumLimit The ceiling of the limit, at least `minimumLimit`
+ */
+- (nonnull instancetype)initWithMinimumLimit:(NSUInteger)minimumLimit maximumLimit:(NSUInteger)maximumLimit NS_DESIGNATED_INITIALIZER;
+
+/**
+ Report a finished download.
+
+ @param host The host of the download, the time to first byte is only compared with the samples of the same host, since a slow CDN is not a congested link. Pass nil if unknown
+ @param timeToFirstByte The time from sending the request to receiving the first response byte, in seconds. Pass a negative value if unknown
+ @param bytes The response body bytes received
+ @param error The download error, nil on success. Cancellation is ignored
+ @param hasPendingDownloads Whether there are downloads waiting for a slot
+ @return The decision if the limit changed, nil otherwise
+ */
+- (nullable MWWebImageDownloaderConcurrencyDecision *)decisionForDownloadWithHost:(nullable NSString *)host
+                                                                  timeToFirstByte:(NSTimeInterval)timeToFirstByte
+                                                                            bytes:(int64_t)bytes
+                                                                            error:(nullable NSError *)error
+                                                              hasPendingDownloads:(BOOL)hasPendingDownloads;
+
+@end
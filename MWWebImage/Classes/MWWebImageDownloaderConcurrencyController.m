@@ -0,0 +1,222 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "MWWebImageDownloaderConcurrencyController.h"
+#import "MWInternalMacros.h"
+
+// The number of recent time to first byte samples of one host used to compute its baseline
+static const NSUInteger kMWConcurrencyBaselineSampleCount = 32;
+// The number of hosts whose samples are kept, the least recently used one is dropped first
+static const NSUInteger kMWConcurrencyBaselineHostCount = 16;
+// The time to first byte is congested above `baseline * factor + slack`
+static const double kMWConcurrencySlowFirstByteFactor = 2;
+static const NSTimeInterval kMWConcurrencySlowFirstByteSlack = 0.05;
+// The goodput is dropping below `previous goodput * ratio`
+static const double kMWConcurrencyGoodputDropRatio = 0.8;
+static const double kMWConcurrencyDecreaseFactor = 0.5;
+
+@interface MWWebImageDownloaderConcurrencyDecision ()
+
+@property (nonatomic, assign, readwrite) NSUInteger previousLimit;
+@property (nonatomic, assign, readwrite) NSUInteger limit;
+@property (nonatomic, assign, readwrite) MWWebImageDownloaderConcurrencyChangeReason reason;
+@property (nonatomic, assign, readwrite) NSTimeInterval timeToFirstByte;
+@property (nonatomic, assign, readwrite) NSTimeInterval baselineTimeToFirstByte;
+@property (nonatomic, assign, readwrite) double goodput;
+
+@end
+
+@implementation MWWebImageDownloaderConcurrencyDecision
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p %lu -> %lu, reason = %lu, ttfb = %.3fs, baseline = %.3fs, goodput = %.0fB/s>", NSStringFromClass(self.class), self, (unsigned long)self.previousLimit, (unsigned long)self.limit, (unsigned long)self.reason, self.timeToFirstByte, self.baselineTimeToFirstByte, self.goodput];
+}
+
+@end
+
+@interface MWWebImageDownloaderConcurrencyController ()
+
+@property (nonatomic, assign, readwrite) NSUInteger limit;
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSString *, NSMutableArray<NSNumber *> *> *timeToFirstByteSamples; // host -> samples
+@property (nonatomic, strong, nonnull) NSMutableOrderedSet<NSString *> *sampledHosts; // least recently used first
+@property (nonatomic, assign) NSUInteger roundCount; // finished downloads in current round
+@property (nonatomic, assign) int64_t roundBytes;
+@property (nonatomic, assign) CFAbsoluteTime roundStartTime;
+@property (nonatomic, assign) BOOL roundSaturated; // whether downloads were waiting during the whole round
+@property (nonatomic, assign) double previousGoodput;
+@property (nonatomic, assign) NSUInteger ignoredCount; // downloads started before the last decrease, their congestion signals are stale
+@property (nonatomic, strong, nonnull) dispatch_semaphore_t lock;
+
+@end
+
+@implementation MWWebImageDownloaderConcurrencyController
+
+- (instancetype)initWithMinimumLimit:(NSUInteger)minimumLimit maximumLimit:(NSUInteger)maximumLimit {
+    self = [super init];
+    if (self) {
+        _minimumLimit = MAX(minimumLimit, 1);
+        _maximumLimit = MAX(maximumLimit, _minimumLimit);
+        _limit = _minimumLimit;
+        _timeToFirstByteSamples = [NSMutableDictionary dictionary];
+        _sampledHosts = [NSMutableOrderedSet orderedSet];
+        _lock = dispatch_semaphore_create(1);
+        [self resetRound];
+    }
+    return self;
+}
+
+- (NSUInteger)limit {
+    MW_LOCK(self.lock);
+    NSUInteger limit = _limit;
+    MW_UNLOCK(self.lock);
+    return limit;
+}
+
+- (void)setMinimumLimit:(NSUInteger)minimumLimit {
+    MW_LOCK(self.lock);
+    _minimumLimit = MAX(minimumLimit, 1);
+    _maximumLimit = MAX(_maximumLimit, _minimumLimit);
+    _limit = MIN(MAX(_limit, _minimumLimit), _maximumLimit);
+    MW_UNLOCK(self.lock);
+}
+
+- (void)setMaximumLimit:(NSUInteger)maximumLimit {
+    MW_LOCK(self.lock);
+    _maximumLimit = MAX(maximumLimit, _minimumLimit);
+    _limit = MIN(MAX(_limit, _minimumLimit), _maximumLimit);
+    MW_UNLOCK(self.lock);
+}
+
+#pragma mark - Decision
+
+- (void)resetRound {
+    _roundCount = 0;
+    _roundBytes = 0;
+    _roundStartTime = CFAbsoluteTimeGetCurrent();
+    _roundSaturated = YES;
+}
+
+- (NSTimeInterval)baselineTimeToFirstByteForHost:(NSString *)host {
+    NSTimeInterval baseline = 0;
+    for (NSNumber *sample in _timeToFirstByteSamples[host]) {
+        if (baseline == 0 || sample.doubleValue < baseline) {
+            baseline = sample.doubleValue;
+        }
+    }
+    return baseline;
+}
+
+- (void)addTimeToFirstByteSample:(NSTimeInterval)timeToFirstByte forHost:(NSString *)host {
+    NSMutableArray<NSNumber *> *samples = _timeToFirstByteSamples[host];
+    if (!samples) {
+        samples = [NSMutableArray arrayWithCapacity:kMWConcurrencyBaselineSampleCount];
+        _timeToFirstByteSamples[host] = samples;
+    }
+    if (samples.count == kMWConcurrencyBaselineSampleCount) {
+        [samples removeObjectAtIndex:0];
+    }
+    [samples addObject:@(timeToFirstByte)];
+    [_sampledHosts removeObject:host];
+    [_sampledHosts addObject:host];
+    if (_sampledHosts.count > kMWConcurrencyBaselineHostCount) {
+        [_timeToFirstByteSamples removeObjectForKey:_sampledHosts.firstObject];
+        [_sampledHosts removeObjectAtIndex:0];
+    }
+}
+
+- (BOOL)isCongestionError:(NSError *)error {
+    if (![error.domain isEqualToString:NSURLErrorDomain]) {
+        return NO;
+    }
+    return error.code == NSURLErrorTimedOut
+        || error.code == NSURLErrorNetworkConnectionLost
+        || error.code == NSURLErrorCannotConnectToHost;
+}
+
+- (MWWebImageDownloaderConcurrencyDecision *)decisionWithReason:(MWWebImageDownloaderConcurrencyChangeReason)reason newLimit:(NSUInteger)newLimit timeToFirstByte:(NSTimeInterval)timeToFirstByte baseline:(NSTimeInterval)baseline goodput:(double)goodput {
+    if (newLimit == _limit) {
+        return nil;
+    }
+    MWWebImageDownloaderConcurrencyDecision *decision = [MWWebImageDownloaderConcurrencyDecision new];
+    decision.previousLimit = _limit;
+    decision.limit = newLimit;
+    decision.reason = reason;
+    decision.timeToFirstByte = timeToFirstByte;
+    decision.baselineTimeToFirstByte = baseline;
+    decision.goodput = goodput;
+    if (newLimit < _limit) {
+        // The downloads in flight were started with the old limit, do not punish twice for the same congestion
+        _ignoredCount = _limit;
+        _previousGoodput = 0;
+    }
+    _limit = newLimit;
+    [self resetRound];
+    return decision;
+}
+
+- (MWWebImageDownloaderConcurrencyDecision *)decisionForDownloadWithHost:(NSString *)host timeToFirstByte:(NSTimeInterval)timeToFirstByte bytes:(int64_t)bytes error:(NSError *)error hasPendingDownloads:(BOOL)hasPendingDownloads {
+    if ([error.domain isEqualToString:NSURLErrorDomain] && error.code == NSURLErrorCancelled) {
+        return nil;
+    }
+    MWWebImageDownloaderConcurrencyDecision *decision;
+    MW_LOCK(self.lock);
+    NSUInteger decreasedLimit = MAX((NSUInteger)(_limit * kMWConcurrencyDecreaseFactor), _minimumLimit);
+    // Hosts have their own latency, a download is only compared with the same host
+    host = host.lowercaseString ?: @"";
+    NSTimeInterval baseline = [self baselineTimeToFirstByteForHost:host];
+    if (timeToFirstByte >= 0) {
+        [self addTimeToFirstByteSample:timeToFirstByte forHost:host];
+    }
+    BOOL stale = _ignoredCount > 0;
+    if (stale) {
+        _ignoredCount--;
+    }
+
+    if (error) {
+        if ([self isCongestionError:error] && !stale) {
+            decision = [self decisionWithReason:MWWebImageDownloaderConcurrencyChangeReasonNetworkError newLimit:decreasedLimit timeToFirstByte:timeToFirstByte baseline:baseline goodput:0];
+        }
+        MW_UNLOCK(self.lock);
+        return decision;
+    }
+
+    if (!stale && baseline > 0 && timeToFirstByte > baseline * kMWConcurrencySlowFirstByteFactor + kMWConcurrencySlowFirstByteSlack) {
+        decision = [self decisionWithReason:MWWebImageDownloaderConcurrencyChangeReasonSlowFirstByte newLimit:decreasedLimit timeToFirstByte:timeToFirstByte baseline:baseline goodput:0];
+        MW_UNLOCK(self.lock);
+        return decision;
+    }
+
+    _roundCount++;
+    _roundBytes += MAX(bytes, 0);
+    _roundSaturated = _roundSaturated && hasPendingDownloads;
+    if (_roundCount >= _limit) {
+        // Round finished
+        NSTimeInterval elapsed = MAX(CFAbsoluteTimeGetCurrent() - _roundStartTime, 0.001);
+        double goodput = _roundBytes / elapsed;
+        // Only compare saturated rounds, an idle queue has a low goodput for no network reason
+        BOOL saturated = _roundSaturated;
+        if (saturated && _previousGoodput > 0 && goodput < _previousGoodput * kMWConcurrencyGoodputDropRatio) {
+            decision = [self decisionWithReason:MWWebImageDownloaderConcurrencyChangeReasonGoodputDrop newLimit:decreasedLimit timeToFirstByte:timeToFirstByte baseline:baseline goodput:goodput];
+        } else {
+            if (saturated) {
+                _previousGoodput = goodput;
+            }
+            if (hasPendingDownloads && _limit < _maximumLimit) {
+                decision = [self decisionWithReason:MWWebImageDownloaderConcurrencyChangeReasonAdditiveIncrease newLimit:_limit + 1 timeToFirstByte:timeToFirstByte baseline:baseline goodput:goodput];
+            }
+        }
+        if (!decision) {
+            [self resetRound];
+        }
+    }
+    MW_UNLOCK(self.lock);
+
+    return decision;
+}
+
+@end
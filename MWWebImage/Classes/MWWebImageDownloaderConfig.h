@@ -40,12 +40,79 @@ typedef NS_ENUM(NSInteger, MWWebImageDownloaderExecutionOrder) {
  */
 @property (nonatomic, assign) NSInteger maxConcurrentDownloads;
 
+/**
+ * Whether or not to adapt the number of concurrent downloads to the network, instead of using the fixed `maxConcurrentDownloads`.
+ * When enabled, the limit starts at `minConcurrentDownloads`. It is raised by one after each round of downloads finishing without congestion while more downloads are waiting, and halved when the time to first byte or the goodput shows congestion, or a download times out. `maxConcurrentDownloads` becomes the ceiling.
+ * Observe `MWWebImageDownloaderConcurrencyDidChangeNotification` to get each decision.
+ * @note The time to first byte comes from `NSURLSessionTaskMetrics`, so before iOS 10/macOS 10.12 only timeouts and goodput are used.
+ * @note This property does not support dynamic changes, means it's immutable after the downloader instance initialized.
+ * Defaults to NO.
+ */
+@property (nonatomic, assign) BOOL shouldAdaptConcurrentDownloads;
+
+/**
+ * The floor of the number of concurrent downloads when `shouldAdaptConcurrentDownloads` is enabled.
+ * Defaults to 2.
+ */
+@property (nonatomic, assign) NSInteger minConcurrentDownloads;
+
+/**
+ * The maximum number of concurrent downloads for each host. When set, the downloads wait in a per-host scheduler and the hosts share the `maxConcurrentDownloads` slots by weighted round-robin, so one slow host can not starve the others. See `MWWebImageDownloader.hostStatistics` for the per-host queue depth and latency.
+ * @note The per-host scheduling is enabled at downloader initialization when this value or `downloadWeightsPerHost` is set. Later the value can be changed dynamically.
+ * Defaults to 0, which means no per-host limit, the downloads are scheduled by `NSOperationQueue` in `executionOrder`.
+ */
+@property (nonatomic, assign) NSInteger maxConcurrentDownloadsPerHost;
+
+/**
+ * The round-robin weight of hosts, a host with weight 2 gets twice as many free slots as a host with weight 1. Only used by the per-host scheduling, see `maxConcurrentDownloadsPerHost`.
+ * Defaults to nil, which means every host has weight 1.
+ */
+@property (nonatomic, copy, nullable) NSDictionary<NSString *, NSNumber *> *downloadWeightsPerHost;
+
 /**
  * The timeout value (in seconds) for each download operation.
  * Defaults to 15.0.
  */
 @property (nonatomic, assign) NSTimeInterval downloadTimeout;
 
+/**
+ * Whether or not to keep the partially received data of the cancelled or failed downloads, to resume them later.
+ * When enabled, the received bytes are saved with the response validator (strong `ETag` or `Last-Modified`) into a disk cache of the downloader, if the server accepts byte ranges. The next download of the same URL sends a `Range` / `If-Range` request, and only receives the missing bytes if the image did not change. Otherwise the server sends the full image.
+ * See `MWWebImageDownloaderOperation.resumedSize` for the bytes saved.
+ * @note This property does not support dynamic changes, means it's immutable after the downloader instance initialized.
+ * Defaults to NO.
+ */
+@property (nonatomic, assign) BOOL shouldResumeDownloads;
+
+/**
+ * The minimum partial data size worth keeping for `shouldResumeDownloads`, in bytes.
+ * Defaults to 16KB.
+ */
+@property (nonatomic, assign) NSUInteger minResumableDataSize;
+
+/**
+ * The window of the download metrics histograms, in seconds. The downloader aggregates the `NSURLSessionTaskMetrics` of the successful downloads, per host and priority, see `MWWebImageDownloader.metricsSnapshot`. A snapshot covers between one and two windows.
+ * Pass 0 to disable the collection.
+ * @note This property does not support dynamic changes, means it's immutable after the downloader instance initialized.
+ * Defaults to 300 (5 minutes).
+ */
+@property (nonatomic, assign) NSTimeInterval metricsWindowInterval;
+
+/**
+ * The decode budget of a downloaded image, in pixels. The image header is parsed from the first received bytes (see `MWImageHeaderParser`), and the download is cancelled with `MWWebImageErrorImageTooLarge` as soon as the width × height exceeds this, instead of receiving the whole body.
+ * For a thumbnail load (`MWWebImageContextImageThumbnailPixelSize`), the thumbnail pixel count is compared instead, as only the thumbnail is decoded.
+ * Images whose header can't be parsed early are not limited.
+ * Defaults to 0, which means there is no limit.
+ */
+@property (nonatomic, assign) NSUInteger maxImagePixelCount;
+
+/**
+ * The maximum bytes held in memory by all the downloads together, from the first received byte until their image is decoded. See `MWWebImageDownloader.bufferBudget`.
+ * Over it, the downloads below the default priority do not start and the running ones pause, until the buffers drain to 3/4 of it or their priority is raised. The downloads at or above the default priority still start, and one download always keeps running so that the buffers drain. The downloads with `MWWebImageDownloadToFile` write to a file and are not counted.
+ * Defaults to 0, which means there is no limit.
+ */
+@property (nonatomic, assign) NSUInteger maxBufferedBytes;
+
 /**
  * The minimum interval about progress percent during network downloading. Which means the next progress callback and current progress callback's progress percent difference should be larger or equal to this value. However, the final finish download progress callback does not get effected.
  * The value should be 0.0-1.0.
@@ -24,7 +24,12 @@ static MWWebImageDownloaderConfig * _defaultDownloaderConfig;
     self = [super init];
     if (self) {
         _maxConcurrentDownloads = 6;
+        _shouldAdaptConcurrentDownloads = NO;
+        _minConcurrentDownloads = 2;
         _downloadTimeout = 15.0;
+        _shouldResumeDownloads = NO;
+        _minResumableDataSize = 16 * 1024;
+        _metricsWindowInterval = 300;
         _executionOrder = MWWebImageDownloaderFIFOExecutionOrder;
     }
     return self;
@@ -33,7 +38,16 @@ static MWWebImageDownloaderConfig * _defaultDownloaderConfig;
 - (id)copyWithZone:(NSZone *)zone {
     MWWebImageDownloaderConfig *config = [[[self class] allocWithZone:zone] init];
     config.maxConcurrentDownloads = self.maxConcurrentDownloads;
+    config.shouldAdaptConcurrentDownloads = self.shouldAdaptConcurrentDownloads;
+    config.minConcurrentDownloads = self.minConcurrentDownloads;
+    config.maxConcurrentDownloadsPerHost = self.maxConcurrentDownloadsPerHost;
+    config.downloadWeightsPerHost = self.downloadWeightsPerHost;
     config.downloadTimeout = self.downloadTimeout;
+    config.shouldResumeDownloads = self.shouldResumeDownloads;
+    config.minResumableDataSize = self.minResumableDataSize;
+    config.metricsWindowInterval = self.metricsWindowInterval;
+    config.maxImagePixelCount = self.maxImagePixelCount;
+    config.maxBufferedBytes = self.maxBufferedBytes;
     config.minimumProgressInterval = self.minimumProgressInterval;
     config.sessionConfiguration = [self.sessionConfiguration copyWithZone:zone];
     config.operationClass = self.operationClass;
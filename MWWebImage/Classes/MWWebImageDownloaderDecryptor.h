@@ -12,7 +12,7 @@
 typedef NSData * _Nullable (^MWWebImageDownloaderDecryptorBlock)(NSData * _Nonnull data, NSURLResponse * _Nullable response);
 
 /**
-This is the protocol for downloader decryptor. Which decrypt the original encrypted data before decoding. Note progressive decoding is not compatible for decryptor.
+This is the protocol for downloader decryptor. Which decrypt the original encrypted data before decoding. Note progressive decoding is not compatible for decryptor, unless it also conforms to `MWWebImageDownloaderStreamingDecryptor`.
 We can use a block to specify the downloader decryptor. But Using protocol can make this extensible, and allow Swift user to use it easily instead of using `@convention(block)` to store a block into context options.
 */
 @protocol MWWebImageDownloaderDecryptor <NSObject>
@@ -25,6 +25,36 @@ We can use a block to specify the downloader decryptor. But Using protocol can m
 
 @end
 
+/**
+This is the protocol for the decryption state of one download, created by `MWWebImageDownloaderStreamingDecryptor`. The chunks are decrypted in order on the session delegate queue.
+*/
+@protocol MWWebImageDownloaderDecryptorStream <NSObject>
+
+/// Decrypt the next chunk of the download. The stream can keep the bytes it can't decrypt yet, such as an incomplete cipher block, until the next chunk.
+/// @param data The next received chunk
+/// @note If nil is returned, the image download will be cancelled and marked as failed with error `MWWebImageErrorBadImageData`. Return an empty data if there is nothing to output yet
+- (nullable NSData *)decryptedDataWithData:(nonnull NSData *)data;
+
+/// Finish the decryption after the last chunk, and return the remaining decrypted bytes.
+/// @note If nil is returned, the image download will be marked as failed with error `MWWebImageErrorBadImageData`
+- (nullable NSData *)finishDecrypting;
+
+@end
+
+/**
+This is the protocol for downloader decryptor which can decrypt the data while it's downloaded. The encrypted data is not kept, which halves the peak memory of a download, and progressive decoding keeps working.
+`MWWebImageDownloaderOperation` uses the stream when the decryptor conforms to this protocol. The `decryptedDataWithData:response:` method is still used to decrypt a whole data, such as when the stream can't be created.
+@note The resume of interrupted downloads is disabled with a streaming decryptor, since the decrypted bytes offsets do not match the encrypted content.
+*/
+@protocol MWWebImageDownloaderStreamingDecryptor <MWWebImageDownloaderDecryptor>
+
+/// Create the decryption state of a download, when its response is received.
+/// @param response The URL response for data. If you modify the original URL response via response modifier, the modified version will be here. This arg is nullable.
+/// @return The stream, or nil to decrypt the whole data after the download instead
+- (nullable id<MWWebImageDownloaderDecryptorStream>)decryptorStreamWithResponse:(nullable NSURLResponse *)response;
+
+@end
+
 /**
 A downloader response modifier class with block.
 */
@@ -43,7 +73,7 @@ A downloader response modifier class with block.
 /// Convenience way to create decryptor for common data encryption.
 @interface MWWebImageDownloaderDecryptor (Conveniences)
 
-/// Base64 Encoded image data decryptor
+/// Base64 Encoded image data decryptor. It conforms to `MWWebImageDownloaderStreamingDecryptor`, so it decodes the data while it's downloaded
 @property (class, readonly, nonnull) MWWebImageDownloaderDecryptor *base64Decryptor;
 
 @end
@@ -25,7 +25,7 @@
 }
 
 + (instancetype)decryptorWithBlock:(MWWebImageDownloaderDecryptorBlock)block {
-    MWWebImageDownloaderDecryptor *decryptor = [[MWWebImageDownloaderDecryptor alloc] initWithBlock:block];
+    MWWebImageDownloaderDecryptor *decryptor = [[self alloc] initWithBlock:block];
     return decryptor;
 }
 
@@ -38,13 +38,87 @@
 
 @end
 
+static inline BOOL MWIsBase64Character(uint8_t c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '+' || c == '/' || c == '=';
+}
+
+/// Decode the base64 characters by groups of 4, the incomplete group waits for the next chunk
+@interface MWWebImageDownloaderBase64DecryptorStream : NSObject <MWWebImageDownloaderDecryptorStream>
+
+@property (nonatomic, strong, nonnull) NSMutableData *pendingData; // less than 4 characters
+
+@end
+
+@implementation MWWebImageDownloaderBase64DecryptorStream
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _pendingData = [NSMutableData dataWithCapacity:4];
+    }
+    return self;
+}
+
+- (NSData *)decryptedDataWithData:(NSData *)data {
+    NSMutableData *encodedData = [NSMutableData dataWithCapacity:self.pendingData.length + data.length];
+    [encodedData appendData:self.pendingData];
+    // Skip the unknown characters, like `NSDataBase64DecodingIgnoreUnknownCharacters`
+    [data enumerateByteRangesUsingBlock:^(const void * _Nonnull bytes, NSRange byteRange, BOOL * _Nonnull stop) {
+        const uint8_t *characters = bytes;
+        NSUInteger start = 0;
+        for (NSUInteger i = 0; i < byteRange.length; i++) {
+            if (!MWIsBase64Character(characters[i])) {
+                [encodedData appendBytes:characters + start length:i - start];
+                start = i + 1;
+            }
+        }
+        [encodedData appendBytes:characters + start length:byteRange.length - start];
+    }];
+    NSUInteger length = encodedData.length / 4 * 4;
+    [self.pendingData setData:[encodedData subdataWithRange:NSMakeRange(length, encodedData.length - length)]];
+    if (length == 0) {
+        return [NSData data];
+    }
+    encodedData.length = length;
+    return [[NSData alloc] initWithBase64EncodedData:encodedData options:0];
+}
+
+- (NSData *)finishDecrypting {
+    NSUInteger length = self.pendingData.length;
+    if (length == 0) {
+        return [NSData data];
+    }
+    if (length == 1) {
+        return nil;
+    }
+    // Tolerate the missing padding of the last group
+    NSMutableData *encodedData = [self.pendingData mutableCopy];
+    [encodedData appendBytes:"==" length:4 - length];
+    self.pendingData.length = 0;
+    return [[NSData alloc] initWithBase64EncodedData:encodedData options:0];
+}
+
+@end
+
+/// The base64 decryptor, which also decodes while downloading
+@interface MWWebImageDownloaderBase64Decryptor : MWWebImageDownloaderDecryptor <MWWebImageDownloaderStreamingDecryptor>
+@end
+
+@implementation MWWebImageDownloaderBase64Decryptor
+
+- (id<MWWebImageDownloaderDecryptorStream>)decryptorStreamWithResponse:(NSURLResponse *)response {
+    return [MWWebImageDownloaderBase64DecryptorStream new];
+}
+
+@end
+
 @implementation MWWebImageDownloaderDecryptor (Conveniences)
 
 + (MWWebImageDownloaderDecryptor *)base64Decryptor {
     static MWWebImageDownloaderDecryptor *decryptor;
     static dispatch_once_t onceToken;
     dispatch_once(&onceToken, ^{
-        decryptor = [MWWebImageDownloaderDecryptor decryptorWithBlock:^NSData * _Nullable(NSData * _Nonnull data, NSURLResponse * _Nullable response) {
+        decryptor = [MWWebImageDownloaderBase64Decryptor decryptorWithBlock:^NSData * _Nullable(NSData * _Nonnull data, NSURLResponse * _Nullable response) {
             NSData *modifiedData = [[NSData alloc] initWithBase64EncodedData:data options:NSDataBase64DecodingIgnoreUnknownCharacters];
             return modifiedData;
         }];
@@ -0,0 +1,86 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "MWWebImageCompat.h"
+
+@class MWWebImageDownloaderConfig;
+
+/**
+ A snapshot of the download activity of one host. See `MWWebImageDownloader.hostStatistics`.
+ */
+@interface MWWebImageDownloaderHostStatistics : NSObject
+
+/// The host name, empty string for URLs without host
+@property (nonatomic, copy, readonly, nonnull) NSString *host;
+/// The downloads waiting for a slot (queue depth)
+@property (nonatomic, assign, readonly) NSUInteger pendingCount;
+/// The downloads admitted to the download queue and not finished yet
+@property (nonatomic, assign, readonly) NSUInteger runningCount;
+/// The downloads finished, including failed and cancelled ones
+@property (nonatomic, assign, readonly) NSUInteger finishedCount;
+/// The moving average of the time spent waiting for a slot, in seconds
+@property (nonatomic, assign, readonly) NSTimeInterval averageQueueingTime;
+/// The moving average of the time from admission to finish, in seconds
+@property (nonatomic, assign, readonly) NSTimeInterval averageLatency;
+
+@end
+
+typedef void(^MWWebImageDownloaderHostSchedulerCancelledBlock)(NSOperation * _Nonnull operation);
+
+/**
+ The per-host scheduler used by `MWWebImageDownloader` when `MWWebImageDownloaderConfig.maxConcurrentDownloadsPerHost` is set.
+ Downloads wait here until both the global limit and their host limit allow them to run. Hosts are served by smooth weighted round-robin, with the weights from `MWWebImageDownloaderConfig.downloadWeightsPerHost`. Inside a host, the higher queue priority goes first, then the configured execution order.
+ The idle hosts are kept for the statistics, up to 32 hosts in total. Past it, the least recently active idle hosts are dropped.
+ @note All methods are thread-safe.
+ */
+@interface MWWebImageDownloaderHostScheduler : NSObject
+
+/// The downloads waiting for a slot, across all hosts
+@property (nonatomic, assign, readonly) NSUInteger pendingCount;
+
+/// Called when a waiting download is cancelled, on the thread which cancelled it. The download no longer waits for a slot and should be started right away so it can finish.
+@property (nonatomic, copy, nullable) MWWebImageDownloaderHostSchedulerCancelledBlock cancelledBlock;
+
+- (nonnull instancetype)init NS_UNAVAILABLE;
++ (nonnull instancetype)new NS_UNAVAILABLE;
+
+/**
+ Create a scheduler. The per-host limit, weights and execution order are read from the config at each scheduling, so they can be changed dynamically.
+ */
+- (nonnull instancetype)initWithConfig:(nonnull MWWebImageDownloaderConfig *)config NS_DESIGNATED_INITIALIZER;
+
+/**
+ Add a download waiting for a slot.
+ */
+- (void)enqueueOperation:(nonnull NSOperation *)operation forHost:(nonnull NSString *)host;
+
+/**
+ Admit the downloads which can run now. Cancelled downloads do not wait here, see `cancelledBlock`.
+
+ @param limit The global limit of running downloads
+ @return The downloads to add to the download queue, in order
+ */
+- (nonnull NSArray<NSOperation *> *)dequeueOperationsWithLimit:(NSUInteger)limit;
+
+/**
+ Mark an admitted download as finished, which frees its slot.
+ */
+- (void)finishOperation:(nonnull NSOperation *)operation;
+
+/**
+ All the downloads waiting for a slot.
+ */
+- (nonnull NSArray<NSOperation *> *)pendingOperations;
+
+/**
+ A snapshot of each host seen so far.
+ */
+- (nonnull NSDictionary<NSString *, MWWebImageDownloaderHostStatistics *> *)statistics;
+
+@end
@@ -0,0 +1,295 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "MWWebImageDownloaderHostScheduler.h"
+#import "MWWebImageDownloaderConfig.h"
+#import "MWInternalMacros.h"
+
+// The smoothing factor of the moving averages
+static const double kMWHostSchedulerAverageFactor = 0.2;
+// The number of hosts kept in the statistics once idle, the least recently active idle host is dropped first
+static const NSUInteger kMWHostSchedulerIdleHostCount = 32;
+
+static void * MWWebImageDownloaderHostSchedulerContext = &MWWebImageDownloaderHostSchedulerContext;
+
+@interface MWWebImageDownloaderHostStatistics ()
+
+@property (nonatomic, copy, readwrite, nonnull) NSString *host;
+@property (nonatomic, assign, readwrite) NSUInteger pendingCount;
+@property (nonatomic, assign, readwrite) NSUInteger runningCount;
+@property (nonatomic, assign, readwrite) NSUInteger finishedCount;
+@property (nonatomic, assign, readwrite) NSTimeInterval averageQueueingTime;
+@property (nonatomic, assign, readwrite) NSTimeInterval averageLatency;
+
+@end
+
+@implementation MWWebImageDownloaderHostStatistics
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p host = %@, pending = %lu, running = %lu, finished = %lu, queueing = %.3fs, latency = %.3fs>", NSStringFromClass(self.class), self, self.host, (unsigned long)self.pendingCount, (unsigned long)self.runningCount, (unsigned long)self.finishedCount, self.averageQueueingTime, self.averageLatency];
+}
+
+@end
+
+/// The scheduling state of one host
+@interface MWWebImageDownloaderHostState : NSObject
+
+@property (nonatomic, copy, nonnull) NSString *host;
+@property (nonatomic, strong, nonnull) NSMutableArray<NSOperation *> *pendingOperations; // in enqueue order
+@property (nonatomic, assign) NSUInteger runningCount;
+@property (nonatomic, assign) NSUInteger finishedCount;
+@property (nonatomic, assign) NSInteger currentWeight; // smooth weighted round-robin
+@property (nonatomic, assign) NSTimeInterval averageQueueingTime;
+@property (nonatomic, assign) NSTimeInterval averageLatency;
+@property (nonatomic, assign) CFAbsoluteTime lastActiveTime; // the last enqueue or finish
+
+@end
+
+@implementation MWWebImageDownloaderHostState
+@end
+
+/// The timestamps of one download
+@interface MWWebImageDownloaderHostEntry : NSObject
+
+@property (nonatomic, weak, nullable) MWWebImageDownloaderHostState *hostState;
+@property (nonatomic, assign) CFAbsoluteTime enqueueTime;
+@property (nonatomic, assign) CFAbsoluteTime admitTime;
+
+@end
+
+@implementation MWWebImageDownloaderHostEntry
+@end
+
+@interface MWWebImageDownloaderHostScheduler ()
+
+@property (nonatomic, strong, nonnull) MWWebImageDownloaderConfig *config;
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSString *, MWWebImageDownloaderHostState *> *hostStates;
+@property (nonatomic, strong, nonnull) NSMapTable<NSOperation *, MWWebImageDownloaderHostEntry *> *entries;
+@property (nonatomic, assign) NSUInteger runningCount;
+@property (nonatomic, strong, nonnull) dispatch_semaphore_t lock;
+
+@end
+
+@implementation MWWebImageDownloaderHostScheduler
+
+- (instancetype)initWithConfig:(MWWebImageDownloaderConfig *)config {
+    self = [super init];
+    if (self) {
+        _config = config;
+        _hostStates = [NSMutableDictionary dictionary];
+        _entries = [NSMapTable strongToStrongObjectsMapTable];
+        _lock = dispatch_semaphore_create(1);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    for (MWWebImageDownloaderHostState *hostState in _hostStates.allValues) {
+        for (NSOperation *operation in hostState.pendingOperations) {
+            [operation removeObserver:self forKeyPath:NSStringFromSelector(@selector(isCancelled)) context:MWWebImageDownloaderHostSchedulerContext];
+        }
+    }
+}
+
+- (NSUInteger)pendingCount {
+    NSUInteger count = 0;
+    MW_LOCK(self.lock);
+    for (MWWebImageDownloaderHostState *hostState in self.hostStates.allValues) {
+        count += hostState.pendingOperations.count;
+    }
+    MW_UNLOCK(self.lock);
+    return count;
+}
+
+- (void)enqueueOperation:(NSOperation *)operation forHost:(NSString *)host {
+    MW_LOCK(self.lock);
+    MWWebImageDownloaderHostState *hostState = self.hostStates[host];
+    if (!hostState) {
+        hostState = [MWWebImageDownloaderHostState new];
+        hostState.host = host;
+        hostState.pendingOperations = [NSMutableArray array];
+        self.hostStates[host] = hostState;
+    }
+    [hostState.pendingOperations addObject:operation];
+    MWWebImageDownloaderHostEntry *entry = [MWWebImageDownloaderHostEntry new];
+    entry.hostState = hostState;
+    entry.enqueueTime = CFAbsoluteTimeGetCurrent();
+    hostState.lastActiveTime = entry.enqueueTime;
+    [self.entries setObject:entry forKey:operation];
+    // Removed when admitted
+    [operation addObserver:self forKeyPath:NSStringFromSelector(@selector(isCancelled)) options:0 context:MWWebImageDownloaderHostSchedulerContext];
+    MW_UNLOCK(self.lock);
+    
+    if (operation.isCancelled) {
+        // Cancelled before the observation started
+        [self admitCancelledOperation:operation];
+    }
+}
+
+#pragma mark - Cancellation
+
+- (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary<NSKeyValueChangeKey,id> *)change context:(void *)context {
+    if (context == MWWebImageDownloaderHostSchedulerContext) {
+        NSOperation *operation = object;
+        if (operation.isCancelled) {
+            [self admitCancelledOperation:operation];
+        }
+    } else {
+        [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
+    }
+}
+
+// A cancelled download does not wait for a slot, it is handed out right away to finish immediately
+- (void)admitCancelledOperation:(NSOperation *)operation {
+    NSMutableArray<NSOperation *> *admittedOperations = [NSMutableArray array];
+    MW_LOCK(self.lock);
+    MWWebImageDownloaderHostEntry *entry = [self.entries objectForKey:operation];
+    MWWebImageDownloaderHostState *hostState = entry.hostState;
+    NSUInteger index = hostState ? [hostState.pendingOperations indexOfObjectIdenticalTo:operation] : NSNotFound;
+    if (index != NSNotFound) {
+        [self admitOperationAtIndex:index hostState:hostState toArray:admittedOperations];
+    }
+    MW_UNLOCK(self.lock);
+    
+    MWWebImageDownloaderHostSchedulerCancelledBlock cancelledBlock = self.cancelledBlock;
+    if (admittedOperations.count > 0 && cancelledBlock) {
+        cancelledBlock(operation);
+    }
+}
+
+#pragma mark - Idle hosts
+
+// Must be called with `lock` held
+- (void)pruneIdleHosts {
+    if (self.hostStates.count <= kMWHostSchedulerIdleHostCount) {
+        return;
+    }
+    NSMutableArray<MWWebImageDownloaderHostState *> *idleHostStates = [NSMutableArray array];
+    for (MWWebImageDownloaderHostState *hostState in self.hostStates.allValues) {
+        if (hostState.pendingOperations.count == 0 && hostState.runningCount == 0) {
+            [idleHostStates addObject:hostState];
+        }
+    }
+    [idleHostStates sortUsingComparator:^NSComparisonResult(MWWebImageDownloaderHostState *hostState1, MWWebImageDownloaderHostState *hostState2) {
+        return hostState1.lastActiveTime < hostState2.lastActiveTime ? NSOrderedAscending : (hostState1.lastActiveTime > hostState2.lastActiveTime ? NSOrderedDescending : NSOrderedSame);
+    }];
+    NSUInteger removeCount = MIN(self.hostStates.count - kMWHostSchedulerIdleHostCount, idleHostStates.count);
+    for (NSUInteger i = 0; i < removeCount; i++) {
+        [self.hostStates removeObjectForKey:idleHostStates[i].host];
+    }
+}
+
+#pragma mark - Scheduling
+
+- (NSInteger)weightForHost:(NSString *)host {
+    NSNumber *weight = self.config.downloadWeightsPerHost[host];
+    return weight ? MAX(weight.integerValue, 1) : 1;
+}
+
+// The next operation of the host, higher queue priority first, then execution order
+- (NSUInteger)nextOperationIndexForHostState:(MWWebImageDownloaderHostState *)hostState {
+    NSArray<NSOperation *> *pendingOperations = hostState.pendingOperations;
+    BOOL LIFO = self.config.executionOrder == MWWebImageDownloaderLIFOExecutionOrder;
+    NSUInteger bestIndex = NSNotFound;
+    for (NSUInteger i = 0; i < pendingOperations.count; i++) {
+        NSUInteger index = LIFO ? pendingOperations.count - 1 - i : i;
+        if (bestIndex == NSNotFound || pendingOperations[index].queuePriority > pendingOperations[bestIndex].queuePriority) {
+            bestIndex = index;
+        }
+    }
+    return bestIndex;
+}
+
+- (void)admitOperationAtIndex:(NSUInteger)index hostState:(MWWebImageDownloaderHostState *)hostState toArray:(NSMutableArray<NSOperation *> *)admittedOperations {
+    NSOperation *operation = hostState.pendingOperations[index];
+    [hostState.pendingOperations removeObjectAtIndex:index];
+    [operation removeObserver:self forKeyPath:NSStringFromSelector(@selector(isCancelled)) context:MWWebImageDownloaderHostSchedulerContext];
+    hostState.runningCount++;
+    self.runningCount++;
+    MWWebImageDownloaderHostEntry *entry = [self.entries objectForKey:operation];
+    entry.admitTime = CFAbsoluteTimeGetCurrent();
+    NSTimeInterval queueingTime = entry.admitTime - entry.enqueueTime;
+    hostState.averageQueueingTime += (queueingTime - hostState.averageQueueingTime) * kMWHostSchedulerAverageFactor;
+    [admittedOperations addObject:operation];
+}
+
+- (NSArray<NSOperation *> *)dequeueOperationsWithLimit:(NSUInteger)limit {
+    NSMutableArray<NSOperation *> *admittedOperations = [NSMutableArray array];
+    MW_LOCK(self.lock);
+    NSUInteger hostLimit = self.config.maxConcurrentDownloadsPerHost > 0 ? self.config.maxConcurrentDownloadsPerHost : NSUIntegerMax;
+    while (self.runningCount < limit) {
+        // Smooth weighted round-robin between the hosts which can run one more download
+        MWWebImageDownloaderHostState *selectedHostState;
+        NSInteger totalWeight = 0;
+        for (MWWebImageDownloaderHostState *hostState in self.hostStates.allValues) {
+            if (hostState.pendingOperations.count == 0 || hostState.runningCount >= hostLimit) {
+                continue;
+            }
+            NSInteger weight = [self weightForHost:hostState.host];
+            hostState.currentWeight += weight;
+            totalWeight += weight;
+            if (!selectedHostState || hostState.currentWeight > selectedHostState.currentWeight) {
+                selectedHostState = hostState;
+            }
+        }
+        if (!selectedHostState) {
+            break;
+        }
+        selectedHostState.currentWeight -= totalWeight;
+        NSUInteger index = [self nextOperationIndexForHostState:selectedHostState];
+        [self admitOperationAtIndex:index hostState:selectedHostState toArray:admittedOperations];
+    }
+    MW_UNLOCK(self.lock);
+    return [admittedOperations copy];
+}
+
+- (void)finishOperation:(NSOperation *)operation {
+    MW_LOCK(self.lock);
+    MWWebImageDownloaderHostEntry *entry = [self.entries objectForKey:operation];
+    MWWebImageDownloaderHostState *hostState = entry.hostState;
+    if (entry && hostState && entry.admitTime > 0) {
+        hostState.runningCount--;
+        hostState.finishedCount++;
+        self.runningCount--;
+        hostState.lastActiveTime = CFAbsoluteTimeGetCurrent();
+        NSTimeInterval latency = hostState.lastActiveTime - entry.admitTime;
+        hostState.averageLatency += (latency - hostState.averageLatency) * kMWHostSchedulerAverageFactor;
+    }
+    [self.entries removeObjectForKey:operation];
+    [self pruneIdleHosts];
+    MW_UNLOCK(self.lock);
+}
+
+- (NSArray<NSOperation *> *)pendingOperations {
+    NSMutableArray<NSOperation *> *pendingOperations = [NSMutableArray array];
+    MW_LOCK(self.lock);
+    for (MWWebImageDownloaderHostState *hostState in self.hostStates.allValues) {
+        [pendingOperations addObjectsFromArray:hostState.pendingOperations];
+    }
+    MW_UNLOCK(self.lock);
+    return [pendingOperations copy];
+}
+
+- (NSDictionary<NSString *, MWWebImageDownloaderHostStatistics *> *)statistics {
+    NSMutableDictionary<NSString *, MWWebImageDownloaderHostStatistics *> *statistics = [NSMutableDictionary dictionary];
+    MW_LOCK(self.lock);
+    for (MWWebImageDownloaderHostState *hostState in self.hostStates.allValues) {
+        MWWebImageDownloaderHostStatistics *hostStatistics = [MWWebImageDownloaderHostStatistics new];
+        hostStatistics.host = hostState.host;
+        hostStatistics.pendingCount = hostState.pendingOperations.count;
+        hostStatistics.runningCount = hostState.runningCount;
+        hostStatistics.finishedCount = hostState.finishedCount;
+        hostStatistics.averageQueueingTime = hostState.averageQueueingTime;
+        hostStatistics.averageLatency = hostState.averageLatency;
+        statistics[hostState.host] = hostStatistics;
+    }
+    MW_UNLOCK(self.lock);
+    return [statistics copy];
+}
+
+@end
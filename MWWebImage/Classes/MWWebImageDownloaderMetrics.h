@@ -0,0 +1,143 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "MWWebImageCompat.h"
+#import "MWWebImageOperation.h"
+
+/// A download metric aggregated by `MWWebImageDownloaderMetricsCollector`
+typedef NSString * MWWebImageDownloaderMetric NS_STRING_ENUM;
+
+/// The DNS lookup duration, in microseconds. Not recorded for reused connections
+FOUNDATION_EXPORT MWWebImageDownloaderMetric _Nonnull const MWWebImageDownloaderMetricDomainLookup;
+/// The TCP connection duration, without the TLS handshake, in microseconds. Not recorded for reused connections
+FOUNDATION_EXPORT MWWebImageDownloaderMetric _Nonnull const MWWebImageDownloaderMetricConnect;
+/// The TLS handshake duration, in microseconds. Not recorded for reused or insecure connections
+FOUNDATION_EXPORT MWWebImageDownloaderMetric _Nonnull const MWWebImageDownloaderMetricSecureConnection;
+/// The time from sending the request to receiving the first response byte, in microseconds
+FOUNDATION_EXPORT MWWebImageDownloaderMetric _Nonnull const MWWebImageDownloaderMetricTimeToFirstByte;
+/// The time from the first to the last response byte, in microseconds
+FOUNDATION_EXPORT MWWebImageDownloaderMetric _Nonnull const MWWebImageDownloaderMetricTransfer;
+/// The response body size, in bytes
+FOUNDATION_EXPORT MWWebImageDownloaderMetric _Nonnull const MWWebImageDownloaderMetricReceivedBytes;
+
+/// The host of the downloads beyond `MWWebImageDownloaderMetricsCollector.maxHostCount`
+FOUNDATION_EXPORT NSString * _Nonnull const MWWebImageDownloaderMetricsOtherHost;
+
+/// The priority class of a download, from its `MWWebImageOperationPriority`
+typedef NS_ENUM(NSInteger, MWWebImageDownloaderMetricsPriority) {
+    /// All the priorities, only used to query a snapshot
+    MWWebImageDownloaderMetricsPriorityAny = -1,
+    /// Priority up to 0.375
+    MWWebImageDownloaderMetricsPriorityLow = 0,
+    /// Priority between 0.375 and 0.625
+    MWWebImageDownloaderMetricsPriorityDefault,
+    /// Priority from 0.625
+    MWWebImageDownloaderMetricsPriorityHigh,
+};
+
+/**
+ A histogram of non-negative integer values with a bounded relative error, like HdrHistogram: each power of two is split into 16 linear buckets, so a value is known within 1/16 (6.25%) whatever its magnitude. Values are capped to 2^40.
+ */
+@interface MWWebImageDownloaderHistogram : NSObject <NSCopying>
+
+/// The number of recorded values
+@property (nonatomic, assign, readonly) uint64_t count;
+/// The smallest recorded value, 0 if empty
+@property (nonatomic, assign, readonly) uint64_t minValue;
+/// The largest recorded value, 0 if empty
+@property (nonatomic, assign, readonly) uint64_t maxValue;
+/// The mean of the recorded values, 0 if empty
+@property (nonatomic, assign, readonly) double mean;
+
+/**
+ The value at a percentile, within the bucket precision.
+
+ @param percentile The percentile, between 0 and 100
+ @return The value, 0 if empty
+ */
+- (uint64_t)valueAtPercentile:(double)percentile;
+
+/**
+ A property list of the histogram: count, min, max, mean, p50, p90, p99 and the non-empty buckets as `[lowest value, count]` pairs.
+ */
+- (nonnull NSDictionary<NSString *, id> *)dictionaryRepresentation;
+
+@end
+
+/**
+ The aggregated download metrics of a time range. See `MWWebImageDownloader.metricsSnapshot`.
+ */
+@interface MWWebImageDownloaderMetricsSnapshot : NSObject
+
+/// The start of the aggregated range
+@property (nonatomic, strong, readonly, nonnull) NSDate *startDate;
+/// The end of the aggregated range, when the snapshot was taken
+@property (nonatomic, strong, readonly, nonnull) NSDate *endDate;
+/// The hosts with recorded downloads
+@property (nonatomic, copy, readonly, nonnull) NSArray<NSString *> *hosts;
+
+/**
+ The histogram of a metric.
+
+ @param metric The metric
+ @param host The host, nil for all hosts
+ @param priority The priority class, `MWWebImageDownloaderMetricsPriorityAny` for all priorities
+ @return The histogram, empty if there are no downloads matching
+ */
+- (nonnull MWWebImageDownloaderHistogram *)histogramForMetric:(nonnull MWWebImageDownloaderMetric)metric host:(nullable NSString *)host priority:(MWWebImageDownloaderMetricsPriority)priority;
+
+/**
+ A property list of the snapshot, which can be serialized with `NSJSONSerialization` to be exported. It contains the dates and, for each host and priority with downloads, the `dictionaryRepresentation` of each metric histogram.
+ */
+- (nonnull NSDictionary<NSString *, id> *)dictionaryRepresentation;
+
+@end
+
+/**
+ The collector of download metrics used by `MWWebImageDownloader`. It keeps rolling histograms of each `MWWebImageDownloaderMetric` per host and priority class: the downloads of the current window and the previous one.
+ @note All methods are thread-safe.
+ */
+@interface MWWebImageDownloaderMetricsCollector : NSObject
+
+/// The window duration, in seconds
+@property (nonatomic, assign, readonly) NSTimeInterval windowInterval;
+/// The maximum number of hosts with their own histograms, the others are recorded under `MWWebImageDownloaderMetricsOtherHost`. Defaults to 32
+@property (nonatomic, assign) NSUInteger maxHostCount;
+
+- (nonnull instancetype)init NS_UNAVAILABLE;
++ (nonnull instancetype)new NS_UNAVAILABLE;
+
+/**
+ Create a collector.
+
+ @param windowInterval The window duration, in seconds
+ */
+- (nonnull instancetype)initWithWindowInterval:(NSTimeInterval)windowInterval NS_DESIGNATED_INITIALIZER;
+
+/**
+ Record a finished download. The timings come from the last transaction loaded from network.
+
+ @param metrics The task metrics
+ @param host The host of the download
+ @param priority The priority of the download
+ @param receivedBytes The response body bytes received
+ */
+- (void)recordMetrics:(nonnull NSURLSessionTaskMetrics *)metrics host:(nonnull NSString *)host priority:(MWWebImageOperationPriority)priority receivedBytes:(int64_t)receivedBytes API_AVAILABLE(macosx(10.12), ios(10.0), watchos(3.0), tvos(10.0));
+
+/**
+ The metrics of the current and previous windows.
+ */
+- (nonnull MWWebImageDownloaderMetricsSnapshot *)snapshot;
+
+/**
+ Forget all the recorded downloads.
+ */
+- (void)reset;
+
+@end
@@ -0,0 +1,414 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "MWWebImageDownloaderMetrics.h"
+#import "MWInternalMacros.h"
+
+MWWebImageDownloaderMetric const MWWebImageDownloaderMetricDomainLookup = @"domainLookup";
+MWWebImageDownloaderMetric const MWWebImageDownloaderMetricConnect = @"connect";
+MWWebImageDownloaderMetric const MWWebImageDownloaderMetricSecureConnection = @"secureConnection";
+MWWebImageDownloaderMetric const MWWebImageDownloaderMetricTimeToFirstByte = @"timeToFirstByte";
+MWWebImageDownloaderMetric const MWWebImageDownloaderMetricTransfer = @"transfer";
+MWWebImageDownloaderMetric const MWWebImageDownloaderMetricReceivedBytes = @"receivedBytes";
+
+NSString * const MWWebImageDownloaderMetricsOtherHost = @"*";
+
+enum {
+    // 16 linear buckets per power of two, the first 16 values are exact
+    kMWHistogramSubBucketBits = 4,
+    kMWHistogramSubBucketCount = 1 << kMWHistogramSubBucketBits,
+    kMWHistogramSubBucketHalfCount = kMWHistogramSubBucketCount / 2,
+    kMWHistogramMaxValueBits = 40,
+    kMWHistogramBucketCount = kMWHistogramSubBucketCount + (kMWHistogramMaxValueBits - kMWHistogramSubBucketBits) * kMWHistogramSubBucketHalfCount,
+};
+
+static NSUInteger MWHistogramBucketIndex(uint64_t value) {
+    value = MIN(value, ((uint64_t)1 << kMWHistogramMaxValueBits) - 1);
+    if (value < kMWHistogramSubBucketCount) {
+        return (NSUInteger)value;
+    }
+    NSUInteger exponent = 63 - __builtin_clzll(value);
+    uint64_t subBucket = value >> (exponent - (kMWHistogramSubBucketBits - 1));
+    return kMWHistogramSubBucketCount + (exponent - kMWHistogramSubBucketBits) * kMWHistogramSubBucketHalfCount + (NSUInteger)(subBucket - kMWHistogramSubBucketHalfCount);
+}
+
+static uint64_t MWHistogramBucketLowestValue(NSUInteger index) {
+    if (index < kMWHistogramSubBucketCount) {
+        return index;
+    }
+    NSUInteger offset = index - kMWHistogramSubBucketCount;
+    NSUInteger exponent = offset / kMWHistogramSubBucketHalfCount + kMWHistogramSubBucketBits;
+    uint64_t subBucket = offset % kMWHistogramSubBucketHalfCount + kMWHistogramSubBucketHalfCount;
+    return subBucket << (exponent - (kMWHistogramSubBucketBits - 1));
+}
+
+static NSString *MWWebImageDownloaderMetricsPriorityName(MWWebImageDownloaderMetricsPriority priority) {
+    switch (priority) {
+        case MWWebImageDownloaderMetricsPriorityLow:
+            return @"low";
+        case MWWebImageDownloaderMetricsPriorityHigh:
+            return @"high";
+        default:
+            return @"default";
+    }
+}
+
+#pragma mark - Histogram
+
+@interface MWWebImageDownloaderHistogram () {
+    uint32_t _counts[kMWHistogramBucketCount];
+    double _sum;
+}
+
+@property (nonatomic, assign, readwrite) uint64_t count;
+@property (nonatomic, assign, readwrite) uint64_t minValue;
+@property (nonatomic, assign, readwrite) uint64_t maxValue;
+
+- (void)recordValue:(uint64_t)value;
+- (void)addHistogram:(nonnull MWWebImageDownloaderHistogram *)histogram;
+
+@end
+
+@implementation MWWebImageDownloaderHistogram
+
+- (void)recordValue:(uint64_t)value {
+    NSUInteger index = MWHistogramBucketIndex(value);
+    if (_counts[index] == UINT32_MAX) {
+        return;
+    }
+    _counts[index]++;
+    _minValue = _count == 0 ? value : MIN(_minValue, value);
+    _maxValue = MAX(_maxValue, value);
+    _sum += value;
+    _count++;
+}
+
+- (void)addHistogram:(MWWebImageDownloaderHistogram *)histogram {
+    if (histogram.count == 0) {
+        return;
+    }
+    for (NSUInteger i = 0; i < kMWHistogramBucketCount; i++) {
+        _counts[i] = (uint32_t)MIN((uint64_t)_counts[i] + histogram->_counts[i], UINT32_MAX);
+    }
+    _minValue = _count == 0 ? histogram.minValue : MIN(_minValue, histogram.minValue);
+    _maxValue = MAX(_maxValue, histogram.maxValue);
+    _sum += histogram->_sum;
+    _count += histogram.count;
+}
+
+- (double)mean {
+    return _count > 0 ? _sum / _count : 0;
+}
+
+- (uint64_t)valueAtPercentile:(double)percentile {
+    if (_count == 0) {
+        return 0;
+    }
+    percentile = MIN(MAX(percentile, 0), 100);
+    uint64_t rank = MAX((uint64_t)ceil(percentile / 100 * _count), 1);
+    uint64_t cumulativeCount = 0;
+    for (NSUInteger i = 0; i < kMWHistogramBucketCount; i++) {
+        cumulativeCount += _counts[i];
+        if (cumulativeCount >= rank) {
+            // The middle of the bucket, within the recorded range
+            uint64_t lowestValue = MWHistogramBucketLowestValue(i);
+            uint64_t highestValue = i + 1 < kMWHistogramBucketCount ? MWHistogramBucketLowestValue(i + 1) - 1 : lowestValue;
+            uint64_t value = lowestValue + (highestValue - lowestValue) / 2;
+            return MIN(MAX(value, _minValue), _maxValue);
+        }
+    }
+    return _maxValue;
+}
+
+- (NSDictionary<NSString *,id> *)dictionaryRepresentation {
+    NSMutableArray<NSArray<NSNumber *> *> *buckets = [NSMutableArray array];
+    for (NSUInteger i = 0; i < kMWHistogramBucketCount; i++) {
+        if (_counts[i] > 0) {
+            [buckets addObject:@[@(MWHistogramBucketLowestValue(i)), @(_counts[i])]];
+        }
+    }
+    return @{@"count" : @(self.count),
+             @"min" : @(self.minValue),
+             @"max" : @(self.maxValue),
+             @"mean" : @(self.mean),
+             @"p50" : @([self valueAtPercentile:50]),
+             @"p90" : @([self valueAtPercentile:90]),
+             @"p99" : @([self valueAtPercentile:99]),
+             @"buckets" : [buckets copy]};
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    MWWebImageDownloaderHistogram *histogram = [[[self class] allocWithZone:zone] init];
+    [histogram addHistogram:self];
+    return histogram;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p count = %llu, min = %llu, p50 = %llu, p90 = %llu, p99 = %llu, max = %llu>", NSStringFromClass(self.class), self, self.count, self.minValue, [self valueAtPercentile:50], [self valueAtPercentile:90], [self valueAtPercentile:99], self.maxValue];
+}
+
+@end
+
+#pragma mark - Series
+
+/// The histograms of one host and priority class
+@interface MWWebImageDownloaderMetricsSeries : NSObject
+
+@property (nonatomic, copy, nonnull) NSString *host;
+@property (nonatomic, assign) MWWebImageDownloaderMetricsPriority priority;
+@property (nonatomic, strong, nonnull) NSMutableDictionary<MWWebImageDownloaderMetric, MWWebImageDownloaderHistogram *> *histograms;
+
+@end
+
+@implementation MWWebImageDownloaderMetricsSeries
+
+- (instancetype)initWithHost:(NSString *)host priority:(MWWebImageDownloaderMetricsPriority)priority {
+    self = [super init];
+    if (self) {
+        _host = [host copy];
+        _priority = priority;
+        _histograms = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (MWWebImageDownloaderHistogram *)histogramForMetric:(MWWebImageDownloaderMetric)metric {
+    MWWebImageDownloaderHistogram *histogram = self.histograms[metric];
+    if (!histogram) {
+        histogram = [MWWebImageDownloaderHistogram new];
+        self.histograms[metric] = histogram;
+    }
+    return histogram;
+}
+
+- (void)addSeries:(MWWebImageDownloaderMetricsSeries *)series {
+    [series.histograms enumerateKeysAndObjectsUsingBlock:^(MWWebImageDownloaderMetric metric, MWWebImageDownloaderHistogram *histogram, BOOL *stop) {
+        [[self histogramForMetric:metric] addHistogram:histogram];
+    }];
+}
+
+@end
+
+static NSString *MWWebImageDownloaderMetricsSeriesKey(NSString *host, MWWebImageDownloaderMetricsPriority priority) {
+    return [NSString stringWithFormat:@"%@\t%ld", host, (long)priority];
+}
+
+#pragma mark - Snapshot
+
+@interface MWWebImageDownloaderMetricsSnapshot ()
+
+@property (nonatomic, strong, readwrite, nonnull) NSDate *startDate;
+@property (nonatomic, strong, readwrite, nonnull) NSDate *endDate;
+@property (nonatomic, copy, nonnull) NSArray<MWWebImageDownloaderMetricsSeries *> *series;
+
+@end
+
+@implementation MWWebImageDownloaderMetricsSnapshot
+
+- (NSArray<NSString *> *)hosts {
+    NSMutableOrderedSet<NSString *> *hosts = [NSMutableOrderedSet orderedSet];
+    for (MWWebImageDownloaderMetricsSeries *series in self.series) {
+        [hosts addObject:series.host];
+    }
+    return hosts.array;
+}
+
+- (MWWebImageDownloaderHistogram *)histogramForMetric:(MWWebImageDownloaderMetric)metric host:(NSString *)host priority:(MWWebImageDownloaderMetricsPriority)priority {
+    MWWebImageDownloaderHistogram *histogram = [MWWebImageDownloaderHistogram new];
+    for (MWWebImageDownloaderMetricsSeries *series in self.series) {
+        if (host && ![series.host isEqualToString:host]) {
+            continue;
+        }
+        if (priority != MWWebImageDownloaderMetricsPriorityAny && series.priority != priority) {
+            continue;
+        }
+        MWWebImageDownloaderHistogram *seriesHistogram = series.histograms[metric];
+        if (seriesHistogram) {
+            [histogram addHistogram:seriesHistogram];
+        }
+    }
+    return histogram;
+}
+
+- (NSDictionary<NSString *,id> *)dictionaryRepresentation {
+    NSMutableArray<NSDictionary<NSString *, id> *> *seriesRepresentations = [NSMutableArray arrayWithCapacity:self.series.count];
+    for (MWWebImageDownloaderMetricsSeries *series in self.series) {
+        NSMutableDictionary<NSString *, id> *metrics = [NSMutableDictionary dictionary];
+        [series.histograms enumerateKeysAndObjectsUsingBlock:^(MWWebImageDownloaderMetric metric, MWWebImageDownloaderHistogram *histogram, BOOL *stop) {
+            metrics[metric] = [histogram dictionaryRepresentation];
+        }];
+        [seriesRepresentations addObject:@{@"host" : series.host,
+                                           @"priority" : MWWebImageDownloaderMetricsPriorityName(series.priority),
+                                           @"metrics" : [metrics copy]}];
+    }
+    return @{@"startDate" : @(self.startDate.timeIntervalSince1970),
+             @"endDate" : @(self.endDate.timeIntervalSince1970),
+             @"series" : [seriesRepresentations copy]};
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p %@ - %@, hosts = %@>", NSStringFromClass(self.class), self, self.startDate, self.endDate, self.hosts];
+}
+
+@end
+
+#pragma mark - Collector
+
+@interface MWWebImageDownloaderMetricsCollector ()
+
+@property (nonatomic, assign, readwrite) NSTimeInterval windowInterval;
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSString *, MWWebImageDownloaderMetricsSeries *> *currentSeries;
+@property (nonatomic, strong, nullable) NSDictionary<NSString *, MWWebImageDownloaderMetricsSeries *> *previousSeries;
+@property (nonatomic, assign) CFAbsoluteTime currentStartTime;
+@property (nonatomic, assign) CFAbsoluteTime previousStartTime;
+@property (nonatomic, strong, nonnull) NSMutableSet<NSString *> *hosts;
+@property (nonatomic, strong, nonnull) dispatch_semaphore_t lock;
+
+@end
+
+@implementation MWWebImageDownloaderMetricsCollector
+
+- (instancetype)initWithWindowInterval:(NSTimeInterval)windowInterval {
+    self = [super init];
+    if (self) {
+        _windowInterval = MAX(windowInterval, 1);
+        _maxHostCount = 32;
+        _currentSeries = [NSMutableDictionary dictionary];
+        _currentStartTime = CFAbsoluteTimeGetCurrent();
+        _previousStartTime = _currentStartTime;
+        _hosts = [NSMutableSet set];
+        _lock = dispatch_semaphore_create(1);
+    }
+    return self;
+}
+
+// Must be called with the lock
+- (void)rotateWindowsIfNeeded {
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    NSTimeInterval elapsed = now - self.currentStartTime;
+    if (elapsed < self.windowInterval) {
+        return;
+    }
+    NSUInteger windowCount = (NSUInteger)(elapsed / self.windowInterval);
+    CFAbsoluteTime newStartTime = self.currentStartTime + windowCount * self.windowInterval;
+    if (windowCount == 1) {
+        self.previousSeries = [self.currentSeries copy];
+        self.previousStartTime = self.currentStartTime;
+    } else {
+        // Idle for more than a window, the current window is too old to be kept
+        self.previousSeries = nil;
+        self.previousStartTime = newStartTime;
+    }
+    self.currentSeries = [NSMutableDictionary dictionary];
+    self.currentStartTime = newStartTime;
+    [self.hosts removeAllObjects];
+    for (MWWebImageDownloaderMetricsSeries *series in self.previousSeries.allValues) {
+        [self.hosts addObject:series.host];
+    }
+}
+
+- (void)recordMetrics:(NSURLSessionTaskMetrics *)metrics host:(NSString *)host priority:(MWWebImageOperationPriority)priority receivedBytes:(int64_t)receivedBytes {
+    NSURLSessionTaskTransactionMetrics *transactionMetrics;
+    for (NSURLSessionTaskTransactionMetrics *transaction in metrics.transactionMetrics.reverseObjectEnumerator) {
+        if (transaction.resourceFetchType == NSURLSessionTaskMetricsResourceFetchTypeNetworkLoad) {
+            transactionMetrics = transaction;
+            break;
+        }
+    }
+    if (!transactionMetrics) {
+        return;
+    }
+    MWWebImageDownloaderMetricsPriority priorityClass;
+    if (priority >= 0.625) {
+        priorityClass = MWWebImageDownloaderMetricsPriorityHigh;
+    } else if (priority > 0.375) {
+        priorityClass = MWWebImageDownloaderMetricsPriorityDefault;
+    } else {
+        priorityClass = MWWebImageDownloaderMetricsPriorityLow;
+    }
+
+    NSMutableDictionary<MWWebImageDownloaderMetric, NSNumber *> *values = [NSMutableDictionary dictionary];
+    void (^recordInterval)(MWWebImageDownloaderMetric, NSDate *, NSDate *) = ^(MWWebImageDownloaderMetric metric, NSDate *startDate, NSDate *endDate) {
+        if (startDate && endDate) {
+            NSTimeInterval interval = [endDate timeIntervalSinceDate:startDate];
+            values[metric] = @((uint64_t)(MAX(interval, 0) * USEC_PER_SEC));
+        }
+    };
+    recordInterval(MWWebImageDownloaderMetricDomainLookup, transactionMetrics.domainLookupStartDate, transactionMetrics.domainLookupEndDate);
+    recordInterval(MWWebImageDownloaderMetricConnect, transactionMetrics.connectStartDate, transactionMetrics.secureConnectionStartDate ?: transactionMetrics.connectEndDate);
+    recordInterval(MWWebImageDownloaderMetricSecureConnection, transactionMetrics.secureConnectionStartDate, transactionMetrics.secureConnectionEndDate);
+    recordInterval(MWWebImageDownloaderMetricTimeToFirstByte, transactionMetrics.requestStartDate, transactionMetrics.responseStartDate);
+    recordInterval(MWWebImageDownloaderMetricTransfer, transactionMetrics.responseStartDate, transactionMetrics.responseEndDate);
+    values[MWWebImageDownloaderMetricReceivedBytes] = @((uint64_t)MAX(receivedBytes, 0));
+
+    MW_LOCK(self.lock);
+    [self rotateWindowsIfNeeded];
+    if (![self.hosts containsObject:host]) {
+        if (self.hosts.count < self.maxHostCount) {
+            [self.hosts addObject:host];
+        } else {
+            host = MWWebImageDownloaderMetricsOtherHost;
+        }
+    }
+    NSString *key = MWWebImageDownloaderMetricsSeriesKey(host, priorityClass);
+    MWWebImageDownloaderMetricsSeries *series = self.currentSeries[key];
+    if (!series) {
+        series = [[MWWebImageDownloaderMetricsSeries alloc] initWithHost:host priority:priorityClass];
+        self.currentSeries[key] = series;
+    }
+    [values enumerateKeysAndObjectsUsingBlock:^(MWWebImageDownloaderMetric metric, NSNumber *value, BOOL *stop) {
+        [[series histogramForMetric:metric] recordValue:value.unsignedLongLongValue];
+    }];
+    MW_UNLOCK(self.lock);
+}
+
+- (MWWebImageDownloaderMetricsSnapshot *)snapshot {
+    NSMutableDictionary<NSString *, MWWebImageDownloaderMetricsSeries *> *mergedSeries = [NSMutableDictionary dictionary];
+    MW_LOCK(self.lock);
+    [self rotateWindowsIfNeeded];
+    CFAbsoluteTime startTime = self.previousSeries ? self.previousStartTime : self.currentStartTime;
+    NSMutableArray<NSDictionary<NSString *, MWWebImageDownloaderMetricsSeries *> *> *windows = [NSMutableArray arrayWithObject:self.currentSeries];
+    if (self.previousSeries) {
+        [windows addObject:self.previousSeries];
+    }
+    for (NSDictionary<NSString *, MWWebImageDownloaderMetricsSeries *> *window in windows) {
+        [window enumerateKeysAndObjectsUsingBlock:^(NSString *key, MWWebImageDownloaderMetricsSeries *series, BOOL *stop) {
+            MWWebImageDownloaderMetricsSeries *merged = mergedSeries[key];
+            if (!merged) {
+                merged = [[MWWebImageDownloaderMetricsSeries alloc] initWithHost:series.host priority:series.priority];
+                mergedSeries[key] = merged;
+            }
+            [merged addSeries:series];
+        }];
+    }
+    MW_UNLOCK(self.lock);
+
+    MWWebImageDownloaderMetricsSnapshot *snapshot = [MWWebImageDownloaderMetricsSnapshot new];
+    snapshot.startDate = [NSDate dateWithTimeIntervalSinceReferenceDate:startTime];
+    snapshot.endDate = [NSDate date];
+    snapshot.series = [mergedSeries.allValues sortedArrayUsingComparator:^NSComparisonResult(MWWebImageDownloaderMetricsSeries *series1, MWWebImageDownloaderMetricsSeries *series2) {
+        NSComparisonResult result = [series1.host compare:series2.host];
+        if (result != NSOrderedSame) {
+            return result;
+        }
+        return [@(series1.priority) compare:@(series2.priority)];
+    }];
+    return snapshot;
+}
+
+- (void)reset {
+    MW_LOCK(self.lock);
+    [self.currentSeries removeAllObjects];
+    self.previousSeries = nil;
+    self.currentStartTime = CFAbsoluteTimeGetCurrent();
+    self.previousStartTime = self.currentStartTime;
+    [self.hosts removeAllObjects];
+    MW_UNLOCK(self.lock);
+}
+
+@end
@@ -9,6 +9,8 @@
 #import <Foundation/Foundation.h>
 #import "MWWebImageDownloader.h"
 #import "MWWebImageOperation.h"
+#import "MWDiskCache.h"
+#import "NMWata+ImageContentType.h"
 
 /**
  Describes a downloader operation. If one wants to use a custom downloader op, it needs to inherit from `NSOperation` and conform to this protocol
@@ -39,6 +41,17 @@
 @property (strong, nonatomic, readonly, nullable) NSURLSessionTaskMetrics *metrics API_AVAILABLE(macosx(10.12), ios(10.0), watchos(3.0), tvos(10.0));
 @property (strong, nonatomic, nullable) NSURLCredential *credential;
 @property (assign, nonatomic) double minimumProgressInterval;
+@property (assign, nonatomic) MWWebImageOperationPriority priority;
+- (void)setPriority:(MWWebImageOperationPriority)priority forToken:(nullable id)token;
+@property (strong, nonatomic, nullable) id<MWDiskCache> resumeDataCache;
+@property (assign, nonatomic) NSUInteger minResumableDataSize;
+@property (assign, nonatomic) NSUInteger maxImagePixelCount;
+@property (strong, nonatomic, nullable) MWWebImageDownloaderBufferBudget *bufferBudget;
+@property (strong, nonatomic, readonly, nullable) NSURL *downloadedFileURL;
+@property (assign, nonatomic, readonly, getter=isBufferPaused) BOOL bufferPaused;
+- (BOOL)pauseForBufferPressure;
+- (void)resumeFromBufferPressure;
+- (void)bufferPressureDidChange;
 
 @end
 
@@ -85,6 +98,74 @@
  */
 @property (assign, nonatomic) double minimumProgressInterval;
 
+/**
+ * The disk cache keeping the partially received data, to resume the download with a `Range` request. Set by the downloader when `MWWebImageDownloaderConfig.shouldResumeDownloads` is enabled.
+ * Defaults to nil, which means the download always starts from the first byte.
+ */
+@property (strong, nonatomic, nullable) id<MWDiskCache> resumeDataCache;
+
+/**
+ * The minimum partial data size saved into `resumeDataCache`, in bytes.
+ * Defaults to 0.
+ */
+@property (assign, nonatomic) NSUInteger minResumableDataSize;
+
+/**
+ * The bytes which were not downloaded again because the download resumed from a previous partial data. 0 if the download did not resume.
+ */
+@property (assign, nonatomic, readonly) NSUInteger resumedSize;
+
+/**
+ * The decode budget of the image, in pixels. The download is cancelled with `MWWebImageErrorImageTooLarge` once the image header shows a larger width × height, or a larger thumbnail for a thumbnail load. Set by the downloader from `MWWebImageDownloaderConfig.maxImagePixelCount`.
+ * Defaults to 0, which means there is no limit.
+ */
+@property (assign, nonatomic) NSUInteger maxImagePixelCount;
+
+/**
+ * The downloader-wide accounting of the bytes held in memory. The received bytes are counted from their arrival until the image is decoded, or the download stops. Set by the downloader, see `MWWebImageDownloaderConfig.maxBufferedBytes`.
+ * Defaults to nil, which means the bytes are not counted.
+ */
+@property (strong, nonatomic, nullable) MWWebImageDownloaderBufferBudget *bufferBudget;
+
+/**
+ * Whether the data task is paused by `pauseForBufferPressure`.
+ */
+@property (assign, nonatomic, readonly, getter=isBufferPaused) BOOL bufferPaused;
+
+/**
+ * Suspend the running data task until `resumeFromBufferPressure`, while `bufferBudget` is over budget. The downloader pauses the downloads below the default priority.
+ * Raising the priority to the default one or above resumes the task.
+ *
+ * @return Whether the task was paused
+ */
+- (BOOL)pauseForBufferPressure;
+
+/**
+ * Resume the data task paused by `pauseForBufferPressure`.
+ */
+- (void)resumeFromBufferPressure;
+
+/**
+ * Called by the downloader when `bufferBudget` goes over or back under. While over budget, an operation below the default priority is not ready, so the queue starts the others first.
+ */
+- (void)bufferPressureDidChange;
+
+/**
+ * The image format read from the first received bytes, `MWImageFormatUndefined` until then or if the header can't be parsed.
+ */
+@property (assign, nonatomic, readonly) MWImageFormat imageFormat;
+
+/**
+ * The image pixel size read from the first received bytes, before the EXIF orientation. `CGSizeZero` until then or if the header can't be parsed. `MWWebImageDownloadReceiveImageHeaderNotification` is posted when it's known.
+ */
+@property (assign, nonatomic, readonly) CGSize imagePixelSize;
+
+/**
+ * The file the downloaded data was moved to once the image decoded, the `MWWebImageContextLoaderDownloadFileURL` of the context. The data is written into a temporary file beside it while downloading, instead of being kept in memory, and moved on the IO queue of the `MWWebImageContextImageCache` of the context when it's a `MWImageCache`.
+ * nil until then, or if the context has no file URL.
+ */
+@property (strong, nonatomic, readonly, nullable) NSURL *downloadedFileURL;
+
 /**
  * The options for the receiver.
  */
@@ -95,6 +176,13 @@
  */
 @property (copy, nonatomic, readonly, nullable) MWWebImageContext *context;
 
+/**
+ * The effective priority of the download, the highest priority requested by its callbacks. It starts from the priority options.
+ * Changes update the `queuePriority` if the operation is not started yet, the `dataTask.priority` if it is running, and the quality of service of the waiting and following decoding.
+ * Setting it overrides the priority requested by every callback.
+ */
+@property (assign, nonatomic) MWWebImageOperationPriority priority;
+
 /**
  *  Initializes a `MWWebImageDownloaderOperation` object
  *
@@ -150,4 +238,12 @@
  */
 - (BOOL)cancel:(nullable id)token;
 
+/**
+ *  Sets the priority requested by a set of callbacks. The operation runs at the highest priority requested by its remaining callbacks, so a low priority download joined by an urgent caller is raised, even if already running, and lowered back when that caller cancels.
+ *
+ *  @param priority the priority requested by these callbacks
+ *  @param token    the token returned by `addHandlersForProgress:completed:`
+ */
+- (void)setPriority:(MWWebImageOperationPriority)priority forToken:(nullable id)token;
+
 @end
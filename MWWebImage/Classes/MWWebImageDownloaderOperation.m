@@ -11,6 +11,14 @@
 #import "MWInternalMacros.h"
 #import "MWWebImageDownloaderResponseModifier.h"
 #import "MWWebImageDownloaderDecryptor.h"
+#import "MWImageDecodeExecutor.h"
+#import "MWImageHeaderParser.h"
+#import "MWImageCache.h"
+#import "MWDiskCache.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 // iOS 8 Foundation.framework extern these symbol but the define is in CFNetwork.framework. We just fix this without import CFNetwork.framework
 #if ((__IPHONE_OS_VERSION_MIN_REQUIRED && __IPHONE_OS_VERSION_MIN_REQUIRED < __IPHONE_9_0) || (__MAC_OS_X_VERSION_MIN_REQUIRED && __MAC_OS_X_VERSION_MIN_REQUIRED < __MAC_10_11))
@@ -21,28 +29,133 @@ const float NSURLSessionTaskPriorityLow = 0.25;
 
 static NSString *const kProgressCallbackKey = @"progress";
 static NSString *const kCompletedCallbackKey = @"completed";
+static NSString *const kPriorityCallbackKey = @"priority";
+static NSString *const kResumeValidatorKey = @"validator";
+
+// The expected content length comes from the server. A receive buffer larger than this, or than the decoded bitmap of the decode budget, is not allocated upfront, the body past it goes to the rope
+static const NSUInteger kMWReceiveBufferMaxCapacity = 64 * 1024 * 1024;
 
 typedef NSMutableDictionary<NSString *, id> MWCallbackMWictionary;
 
+// Wrap the bytes of the received data without copy, the regions keep the data alive until the rope is released
+static dispatch_data_t MWDispatchDataCreateWithData(NSData *data) {
+    __block dispatch_data_t result = dispatch_data_empty;
+    [data enumerateByteRangesUsingBlock:^(const void * _Nonnull bytes, NSRange byteRange, BOOL * _Nonnull stop) {
+        dispatch_data_t region = dispatch_data_create(bytes, byteRange.length, NULL, ^{
+            [data self];
+        });
+        result = dispatch_data_create_concat(result, region);
+    }];
+    return result;
+}
+
+/// A buffer sized from the expected content length up to a cap, which the received chunks are copied into as they arrive.
+/// The bytes below `length` are never written again, so each snapshot wraps them without copy, and the completed data is one contiguous region which maps without copy.
+@interface MWWebImageDownloaderBuffer : NSObject
+
+@property (assign, nonatomic, readonly) size_t capacity;
+@property (assign, nonatomic, readonly) size_t length;
+
+- (nullable instancetype)initWithCapacity:(size_t)capacity;
+- (BOOL)appendBytes:(nonnull const void *)bytes length:(size_t)length; // NO if over the capacity
+- (nonnull dispatch_data_t)dispatchData; // the bytes appended so far, keeps the buffer alive
+
+@end
+
+@implementation MWWebImageDownloaderBuffer {
+    uint8_t *_bytes;
+}
+
+- (instancetype)initWithCapacity:(size_t)capacity {
+    self = [super init];
+    if (self) {
+        _bytes = capacity > 0 ? malloc(capacity) : NULL;
+        if (!_bytes) {
+            return nil;
+        }
+        _capacity = capacity;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_bytes);
+}
+
+- (BOOL)appendBytes:(const void *)bytes length:(size_t)length {
+    if (length > _capacity - _length) {
+        return NO;
+    }
+    memcpy(_bytes + _length, bytes, length);
+    _length += length;
+    return YES;
+}
+
+- (dispatch_data_t)dispatchData {
+    if (_length == 0) {
+        return dispatch_data_empty;
+    }
+    return dispatch_data_create(_bytes, _length, NULL, ^{
+        [self self];
+    });
+}
+
+@end
+
+// The serial queue for the resume data disk access, the operations of one downloader share its disk cache
+static dispatch_queue_t MWResumeDataQueue(void) {
+    static dispatch_queue_t queue;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        queue = dispatch_queue_create("com.hackemist.MWWebImageDownloaderOperation.resumeData", DISPATCH_QUEUE_SERIAL);
+    });
+    return queue;
+}
+
+// `allHeaderFields` keys are not canonicalized the same way on all OS versions
+static NSString *MWHTTPHeaderValue(NSHTTPURLResponse *response, NSString *field) {
+    for (NSString *key in response.allHeaderFields) {
+        if ([key caseInsensitiveCompare:field] == NSOrderedSame) {
+            return response.allHeaderFields[key];
+        }
+    }
+    return nil;
+}
+
 @interface MWWebImageDownloaderOperation ()
 
 @property (strong, nonatomic, nonnull) NSMutableArray<MWCallbackMWictionary *> *callbackBlocks;
 
+@property (strong, nonatomic, readwrite, nullable) NSURLRequest *request;
 @property (assign, nonatomic, readwrite) MWWebImageDownloaderOptions options;
 @property (copy, nonatomic, readwrite, nullable) MWWebImageContext *context;
 
 @property (assign, nonatomic, getter = isExecuting) BOOL executing;
 @property (assign, nonatomic, getter = isFinished) BOOL finished;
-@property (strong, nonatomic, nullable) NSMutableData *imageData;
+@property (assign, nonatomic, readwrite, getter=isBufferPaused) BOOL bufferPaused;
+@property (strong, nonatomic, nullable) dispatch_data_t imageData; // the received chunks as a rope, only flattened when a consumer needs contiguous bytes
+@property (strong, nonatomic, nullable) MWWebImageDownloaderBuffer *receiveBuffer; // backs `imageData` while the body fits it, nil once it falls back to the rope
 @property (copy, nonatomic, nullable) NSData *cachedData; // for `MWWebImageDownloaderIgnoreCachedResponse`
 @property (assign, nonatomic) NSUInteger expectedSize; // may be 0
 @property (assign, nonatomic) NSUInteger receivedSize;
 @property (strong, nonatomic, nullable, readwrite) NSURLResponse *response;
 @property (strong, nonatomic, nullable) NSError *responseError;
 @property (assign, nonatomic) double previousProgress; // previous progress percent
+@property (copy, nonatomic, nullable) NSData *resumeData; // the partial data sent with the `Range` request, until the response accepts it
+@property (assign, nonatomic, readwrite) NSUInteger resumedSize;
+@property (assign, nonatomic, readwrite) MWImageFormat imageFormat;
+@property (assign, nonatomic, readwrite) CGSize imagePixelSize;
+@property (assign, nonatomic) MWImageHeaderParseStatus headerParseStatus;
+@property (strong, nonatomic, nullable) NSURL *downloadFileURL; // the `MWWebImageContextLoaderDownloadFileURL` of the context
+@property (strong, nonatomic, nullable) NSURL *temporaryFileURL; // the received data is written here instead of `imageData`, nil if it's kept in memory
+@property (assign, nonatomic) int temporaryFileDescriptor; // -1 once closed
+@property (assign, nonatomic) NSUInteger bufferedSize; // the bytes counted in `bufferBudget`
+@property (strong, nonatomic, readwrite, nullable) NSURL *downloadedFileURL;
+@property (assign, nonatomic) MWWebImageOperationPriority basePriority; // used when no callback requested a priority
 
 @property (strong, nonatomic, nullable) id<MWWebImageDownloaderResponseModifier> responseModifier; // modify original URLResponse
 @property (strong, nonatomic, nullable) id<MWWebImageDownloaderDecryptor> decryptor; // decrypt image data
+@property (strong, nonatomic, nullable) id<MWWebImageDownloaderDecryptorStream> decryptorStream; // decrypt image data while downloading, `imageData` is then the decrypted data
 
 // This is weak because it is injected by whoever manages this session. If this gets nil-ed out, we won't be able to run
 // the task associated with this operation
@@ -54,7 +167,8 @@ typedef NSMutableDictionary<NSString *, id> MWCallbackMWictionary;
 
 @property (strong, nonatomic, readwrite, nullable) NSURLSessionTaskMetrics *metrics API_AVAILABLE(macosx(10.12), ios(10.0), watchos(3.0), tvos(10.0));
 
-@property (strong, nonatomic, nonnull) NSOperationQueue *coderQueue; // the serial operation queue to do image decoding
+@property (strong, atomic, nullable) MWImageDecodeTask *decodeTask; // the last decode submitted to the shared executor, the next one waits for it
+@property (strong, atomic, nullable) MWImageDecodeTask *finalDecodeTask; // the decode of the completed data, which finishes the operation
 #if MW_UIKIT
 @property (assign, nonatomic) UIBackgroundTaskIdentifier backgroundTaskId;
 #endif
@@ -85,12 +199,26 @@ typedef NSMutableDictionary<NSString *, id> MWCallbackMWictionary;
         _callbackBlocks = [NSMutableArray new];
         _responseModifier = context[MWWebImageContextDownloadResponseModifier];
         _decryptor = context[MWWebImageContextDownloadDecryptor];
+        // The decryptor which needs the whole data can't decrypt a file, the streaming one decrypts before writing
+        BOOL canDecryptFile = !_decryptor || [_decryptor conformsToProtocol:@protocol(MWWebImageDownloaderStreamingDecryptor)];
+        NSURL *downloadFileURL = context[MWWebImageContextLoaderDownloadFileURL];
+        if (canDecryptFile && [downloadFileURL isKindOfClass:NSURL.class] && downloadFileURL.isFileURL) {
+            _downloadFileURL = downloadFileURL;
+        }
+        _temporaryFileDescriptor = -1;
         _executing = NO;
         _finished = NO;
         _expectedSize = 0;
+        _imageFormat = MWImageFormatUndefined;
         _unownedSession = session;
-        _coderQueue = [NSOperationQueue new];
-        _coderQueue.maxConcurrentOperationCount = 1;
+        if (options & MWWebImageDownloaderHighPriority) {
+            _priority = MWWebImageOperationPriorityHigh;
+        } else if (options & MWWebImageDownloaderLowPriority) {
+            _priority = MWWebImageOperationPriorityLow;
+        } else {
+            _priority = MWWebImageOperationPriorityDefault;
+        }
+        _basePriority = _priority;
 #if MW_UIKIT
         _backgroundTaskId = UIBackgroundTaskInvalid;
 #endif
@@ -137,6 +265,8 @@ typedef NSMutableDictionary<NSString *, id> MWCallbackMWictionary;
         // Only callback this token's completion block
         @synchronized (self) {
             [self.callbackBlocks removeObjectIdenticalTo:token];
+            // The cancelled waiter no longer lifts the priority
+            [self updatePriority];
         }
         MWWebImageDownloaderCompletedBlock completedBlock = [token valueForKey:kCompletedCallbackKey];
         dispatch_main_async_safe(^{
@@ -185,6 +315,8 @@ typedef NSMutableDictionary<NSString *, id> MWCallbackMWictionary;
             self.ownedSession = session;
         }
         
+        [self prepareResumeRequest];
+        
         if (self.options & MWWebImageDownloaderIgnoreCachedResponse) {
             // Grab the cached data for later check
             NSURLCache *URLCache = session.configuration.URLCache;
@@ -206,15 +338,8 @@ typedef NSMutableDictionary<NSString *, id> MWCallbackMWictionary;
     }
 
     if (self.dataTask) {
-        if (self.options & MWWebImageDownloaderHighPriority) {
-            self.dataTask.priority = NSURLSessionTaskPriorityHigh;
-            self.coderQueue.qualityOfService = NSQualityOfServiceUserInteractive;
-        } else if (self.options & MWWebImageDownloaderLowPriority) {
-            self.dataTask.priority = NSURLSessionTaskPriorityLow;
-            self.coderQueue.qualityOfService = NSQualityOfServiceBackground;
-        } else {
-            self.dataTask.priority = NSURLSessionTaskPriorityDefault;
-            self.coderQueue.qualityOfService = NSQualityOfServiceDefault;
+        @synchronized (self) {
+            [self applyPriority];
         }
         [self.dataTask resume];
         for (MWWebImageDownloaderProgressBlock progressBlock in [self callbacksForKey:kProgressCallbackKey]) {
@@ -236,11 +361,157 @@ typedef NSMutableDictionary<NSString *, id> MWCallbackMWictionary;
     }
 }
 
+#pragma mark - Priority
+
+- (MWWebImageOperationPriority)priority {
+    @synchronized (self) {
+        return _priority;
+    }
+}
+
+- (void)setPriority:(MWWebImageOperationPriority)priority {
+    priority = MIN(MAX(priority, 0), 1);
+    @synchronized (self) {
+        // Overrides the priority requested by every callback
+        self.basePriority = priority;
+        for (MWCallbackMWictionary *callbacks in self.callbackBlocks) {
+            callbacks[kPriorityCallbackKey] = @(priority);
+        }
+        [self updatePriority];
+    }
+    [self bufferPressureDidChange];
+}
+
+- (void)setPriority:(MWWebImageOperationPriority)priority forToken:(id)token {
+    if (!token) return;
+    priority = MIN(MAX(priority, 0), 1);
+    @synchronized (self) {
+        if ([self.callbackBlocks indexOfObjectIdenticalTo:token] == NSNotFound) {
+            return;
+        }
+        ((MWCallbackMWictionary *)token)[kPriorityCallbackKey] = @(priority);
+        [self updatePriority];
+    }
+    [self bufferPressureDidChange];
+}
+
+// The operation runs at the highest priority of its waiters, so a prefetch joined by a visible view speeds up. Must be called inside `@synchronized (self)`
+- (void)updatePriority {
+    MWWebImageOperationPriority priority = -1;
+    for (MWCallbackMWictionary *callbacks in self.callbackBlocks) {
+        NSNumber *callbackPriority = callbacks[kPriorityCallbackKey];
+        if (callbackPriority) {
+            priority = MAX(priority, callbackPriority.floatValue);
+        }
+    }
+    if (priority < 0) {
+        priority = self.basePriority;
+    }
+    if (_priority == priority) {
+        return;
+    }
+    _priority = priority;
+    [self applyPriority];
+}
+
+// Push the priority to the download queue, the running task and the waiting decode. Must be called inside `@synchronized (self)`
+- (void)applyPriority {
+    if (self.isFinished) {
+        return;
+    }
+    if (!self.isExecuting) {
+        // The queue only reorders the operations not started yet
+        self.queuePriority = MWWebImageOperationQueuePriorityForPriority(_priority);
+    }
+    if (self.dataTask) {
+        self.dataTask.priority = _priority;
+    }
+    // A visible image does not wait for the buffers of the others to drain
+    if (self.bufferPaused && _priority >= MWWebImageOperationPriorityDefault) {
+        [self resumeFromBufferPressure];
+    }
+    // Moves the decode to another lane of the executor if it's still waiting
+    self.decodeTask.priority = _priority;
+}
+
+#pragma mark - Buffer pressure
+
+- (BOOL)pauseForBufferPressure {
+    @synchronized (self) {
+        if (!self.isExecuting || self.isCancelled || self.bufferPaused || self.dataTask.state != NSURLSessionTaskStateRunning) {
+            return NO;
+        }
+        [self.dataTask suspend];
+        self.bufferPaused = YES;
+        return YES;
+    }
+}
+
+- (void)resumeFromBufferPressure {
+    @synchronized (self) {
+        if (!self.bufferPaused) {
+            return;
+        }
+        self.bufferPaused = NO;
+        // The task may have been cancelled meanwhile
+        if (self.dataTask.state == NSURLSessionTaskStateSuspended) {
+            [self.dataTask resume];
+        }
+    }
+}
+
+- (void)bufferPressureDidChange {
+    if (self.isExecuting || self.isFinished) {
+        return;
+    }
+    // Outside `@synchronized (self)`, the queue reads `isReady` under its own lock
+    [self willChangeValueForKey:@"isReady"];
+    [self didChangeValueForKey:@"isReady"];
+}
+
+- (BOOL)isReady {
+    // Read without the lock, see `bufferPressureDidChange`
+    if (self.bufferBudget.isOverBudget && _priority < MWWebImageOperationPriorityDefault && !self.isCancelled) {
+        return NO;
+    }
+    return [super isReady];
+}
+
+// The estimated memory of decoding the data, for the admission of the decode executor
+- (NSUInteger)decodeCostForData:(NSData *)data {
+    CGSize imagePixelSize = self.imagePixelSize;
+    CGSize thumbnailSize = [self thumbnailPixelSize];
+    if (imagePixelSize.width > 0 && imagePixelSize.height > 0) {
+        return MWImageDecodeEstimatedCostForPixelSize(imagePixelSize, thumbnailSize);
+    }
+    return MWImageDecodeEstimatedCost(data, thumbnailSize);
+}
+
+// The thumbnail size the image is decoded to, zero for a full decode
+- (CGSize)thumbnailPixelSize {
+    CGSize thumbnailSize = CGSizeZero;
+    NSValue *thumbnailSizeValue = self.context[MWWebImageContextImageThumbnailPixelSize];
+    if (thumbnailSizeValue != nil) {
+#if MW_MAC
+        thumbnailSize = thumbnailSizeValue.sizeValue;
+#else
+        thumbnailSize = thumbnailSizeValue.CGSizeValue;
+#endif
+    }
+    return thumbnailSize;
+}
+
 - (void)cancelInternal {
     if (self.isFinished) return;
     [super cancel];
+    // A pending decode of a cancelled download is not needed anymore
+    [self.decodeTask cancel];
+    // Once the data task completed, the final decode is what finishes the operation. If it was cancelled before it started, it never will
+    MWImageDecodeTask *finalDecodeTask = self.finalDecodeTask;
+    BOOL finalDecodeCancelled = finalDecodeTask && finalDecodeTask.isCancelled;
 
     if (self.dataTask) {
+        [self saveResumeDataOnDelegateQueue];
         [self.dataTask cancel];
         __block typeof(self) strongSelf = self;
         dispatch_async(dispatch_get_main_queue(), ^{
@@ -252,13 +523,291 @@ typedef NSMutableDictionary<NSString *, id> MWCallbackMWictionary;
         if (self.isExecuting) self.executing = NO;
         if (!self.isFinished) self.finished = YES;
     } else {
-        // Operation cancelled by user during sending the request
+        // Operation cancelled by user during sending the request, or while waiting to decode
         [self callCompletionBlocksWithError:[NSError errorWithDomain:MWWebImageErrorDomain code:MWWebImageErrorCancelled userInfo:@{NSLocalizedDescriptionKey : @"Operation cancelled by user during sending the request"}]];
+        if (finalDecodeCancelled) {
+            if (self.isExecuting) self.executing = NO;
+            if (!self.isFinished) self.finished = YES;
+        }
     }
 
     [self reset];
 }
 
+#pragma mark - Resume data
+
+// Ask for the missing bytes only, if there is partial data from a previous download. Must be called inside `@synchronized (self)`
+- (void)prepareResumeRequest {
+    id<MWDiskCache> resumeDataCache = self.resumeDataCache;
+    NSString *key = self.request.URL.absoluteString;
+    if (!resumeDataCache || key.length == 0 || [self.request valueForHTTPHeaderField:@"Range"]) {
+        return;
+    }
+    // The streaming decryptor can't restart in the middle of the encrypted content
+    if ([self.decryptor conformsToProtocol:@protocol(MWWebImageDownloaderStreamingDecryptor)]) {
+        return;
+    }
+    // The partial data is not kept in memory to be saved
+    if (self.downloadFileURL) {
+        return;
+    }
+    NSString *method = self.request.HTTPMethod;
+    if (method && ![method isEqualToString:@"GET"]) {
+        return;
+    }
+    __block NSData *data;
+    __block NSData *extendedData;
+    dispatch_sync(MWResumeDataQueue(), ^{
+        data = [resumeDataCache dataForKey:key];
+        extendedData = [resumeDataCache extendedDataForKey:key];
+    });
+    NSDictionary *info = extendedData ? [NSJSONSerialization JSONObjectWithData:extendedData options:0 error:nil] : nil;
+    NSString *validator = [info isKindOfClass:NSDictionary.class] ? info[kResumeValidatorKey] : nil;
+    if (data.length == 0 || ![validator isKindOfClass:NSString.class]) {
+        return;
+    }
+    NSMutableURLRequest *mutableRequest = [self.request mutableCopy];
+    [mutableRequest setValue:[NSString stringWithFormat:@"bytes=%lu-", (unsigned long)data.length] forHTTPHeaderField:@"Range"];
+    // The server sends the full image instead if it changed since the partial data
+    [mutableRequest setValue:validator forHTTPHeaderField:@"If-Range"];
+    self.request = [mutableRequest copy];
+    self.resumeData = data;
+}
+
+// Whether the partial response continues the resume data, `Content-Range: bytes <offset>-<last>/<total>`
+- (BOOL)isResponse:(NSHTTPURLResponse *)response continuingAtOffset:(NSUInteger)offset {
+    NSString *contentRange = MWHTTPHeaderValue(response, @"Content-Range");
+    NSString *prefix = [NSString stringWithFormat:@"bytes %lu-", (unsigned long)offset];
+    return [contentRange hasPrefix:prefix];
+}
+
+- (void)saveResumeDataIfNeeded {
+    id<MWDiskCache> resumeDataCache = self.resumeDataCache;
+    NSString *key = self.request.URL.absoluteString;
+    dispatch_data_t imageData = self.imageData;
+    if (!resumeDataCache || key.length == 0 || !imageData || self.decryptorStream || self.temporaryFileURL || ![self.response isKindOfClass:NSHTTPURLResponse.class]) {
+        return;
+    }
+    NSHTTPURLResponse *response = (NSHTTPURLResponse *)self.response;
+    if (response.statusCode != 200 && response.statusCode != 206) {
+        return;
+    }
+    // `If-Range` only accepts a strong validator
+    NSString *validator = MWHTTPHeaderValue(response, @"ETag");
+    if (validator.length == 0 || [validator hasPrefix:@"W/"]) {
+        validator = MWHTTPHeaderValue(response, @"Last-Modified");
+    }
+    BOOL acceptsRanges = response.statusCode == 206 || [MWHTTPHeaderValue(response, @"Accept-Ranges") caseInsensitiveCompare:@"bytes"] == NSOrderedSame;
+    // The received bytes are decoded, their offsets do not match the encoded content
+    NSString *contentEncoding = MWHTTPHeaderValue(response, @"Content-Encoding");
+    BOOL encoded = contentEncoding.length > 0 && [contentEncoding caseInsensitiveCompare:@"identity"] != NSOrderedSame;
+    NSUInteger size = dispatch_data_get_size(imageData);
+    BOOL complete = self.expectedSize > 0 && size >= self.expectedSize;
+    if (validator.length == 0 || !acceptsRanges || encoded || complete || size < MAX(self.minResumableDataSize, 1)) {
+        return;
+    }
+    NSData *data = (NSData *)dispatch_data_create_map(imageData, NULL, NULL);
+    NSData *extendedData = [NSJSONSerialization dataWithJSONObject:@{kResumeValidatorKey : validator} options:0 error:nil];
+    dispatch_async(MWResumeDataQueue(), ^{
+        [resumeDataCache setData:data forKey:key];
+        [resumeDataCache setExtendedData:extendedData forKey:key];
+    });
+}
+
+// The received data is only consistent on the session delegate queue, where it's appended
+- (void)saveResumeDataOnDelegateQueue {
+    if (!self.resumeDataCache) {
+        return;
+    }
+    NSOperationQueue *delegateQueue = (self.ownedSession ?: self.unownedSession).delegateQueue;
+    __block typeof(self) strongSelf = self;
+    if (delegateQueue) {
+        [delegateQueue addOperationWithBlock:^{
+            [strongSelf saveResumeDataIfNeeded];
+        }];
+    }
+}
+
+- (void)removeResumeData {
+    id<MWDiskCache> resumeDataCache = self.resumeDataCache;
+    NSString *key = self.request.URL.absoluteString;
+    if (!resumeDataCache || key.length == 0) {
+        return;
+    }
+    dispatch_async(MWResumeDataQueue(), ^{
+        [resumeDataCache removeDataForKey:key];
+    });
+}
+
+#pragma mark - Buffer budget
+
+- (void)chargeBufferedSize:(NSUInteger)size {
+    if (!self.bufferBudget || size == 0) {
+        return;
+    }
+    @synchronized (self) {
+        self.bufferedSize += size;
+    }
+    [self.bufferBudget chargeBytes:size];
+}
+
+- (void)releaseBufferedSize {
+    NSUInteger size;
+    @synchronized (self) {
+        size = self.bufferedSize;
+        self.bufferedSize = 0;
+    }
+    [self.bufferBudget releaseBytes:size];
+}
+
+#pragma mark - Download to file
+
+// Create the temporary file beside the destination, so that committing it is a rename on the same volume. The received data is kept in memory if it fails
+- (void)openTemporaryFile {
+    NSURL *directoryURL = self.downloadFileURL.URLByDeletingLastPathComponent;
+    [[NSFileManager defaultManager] createDirectoryAtURL:directoryURL withIntermediateDirectories:YES attributes:nil error:nil];
+    // Not hidden, so that the disk cache cleanup removes the file left by a crash like an expired cache file
+    NSString *fileName = [NSString stringWithFormat:@"%@.%@.download", self.downloadFileURL.lastPathComponent, [NSUUID UUID].UUIDString];
+    NSURL *fileURL = [directoryURL URLByAppendingPathComponent:fileName];
+    // Readable too, the data is read back from the descriptor even if the cleanup removed the file meanwhile
+    int fileDescriptor = open(fileURL.fileSystemRepresentation, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fileDescriptor < 0) {
+        return;
+    }
+    @synchronized (self) {
+        self.temporaryFileURL = fileURL;
+        self.temporaryFileDescriptor = fileDescriptor;
+    }
+}
+
+// Returns NO if the write failed or the file was closed by a cancel
+- (BOOL)writeDataToTemporaryFile:(NSData *)data {
+    __block BOOL success = YES;
+    @synchronized (self) {
+        int fileDescriptor = self.temporaryFileDescriptor;
+        if (fileDescriptor < 0) {
+            return NO;
+        }
+        [data enumerateByteRangesUsingBlock:^(const void * _Nonnull bytes, NSRange byteRange, BOOL * _Nonnull stop) {
+            const uint8_t *buffer = bytes;
+            size_t remaining = byteRange.length;
+            while (remaining > 0) {
+                ssize_t written = write(fileDescriptor, buffer, remaining);
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    success = NO;
+                    *stop = YES;
+                    return;
+                }
+                buffer += written;
+                remaining -= written;
+            }
+        }];
+    }
+    return success;
+}
+
+// The data outlives the download, a mapped file must not be rewritten in place later. The built-in disk cache replaces its files with a rename, unless configured otherwise
+- (BOOL)canMapTemporaryFile {
+    id imageCache = self.context[MWWebImageContextImageCache];
+    if (![imageCache isKindOfClass:MWImageCache.class] || ![((MWImageCache *)imageCache).diskCache isKindOfClass:MWDiskCache.class]) {
+        return NO;
+    }
+    NSDataWritingOptions writingOptions = ((MWImageCache *)imageCache).config.diskCacheWritingOptions;
+    return (writingOptions & (NSDataWritingAtomic | NSDataWritingWithoutOverwriting)) != 0;
+}
+
+// Map the whole file from its descriptor, the pages are read on demand and stay valid once the file is moved or removed. Read into memory if it may be rewritten in place
+- (NSData *)readTemporaryFile {
+    @synchronized (self) {
+        int fileDescriptor = self.temporaryFileDescriptor;
+        if (fileDescriptor < 0) {
+            return nil;
+        }
+        struct stat fileStat;
+        if (fstat(fileDescriptor, &fileStat) != 0 || fileStat.st_size <= 0) {
+            return nil;
+        }
+        size_t size = (size_t)fileStat.st_size;
+        if ([self canMapTemporaryFile]) {
+            void *mappedBytes = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+            if (mappedBytes != MAP_FAILED) {
+                return [[NSData alloc] initWithBytesNoCopy:mappedBytes length:size deallocator:^(void * _Nonnull bytes, NSUInteger length) {
+                    munmap(bytes, length);
+                }];
+            }
+        }
+        void *bytes = malloc(size);
+        if (!bytes) {
+            return nil;
+        }
+        size_t offset = 0;
+        while (offset < size) {
+            ssize_t count = pread(fileDescriptor, (uint8_t *)bytes + offset, size - offset, offset);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                free(bytes);
+                return nil;
+            }
+            offset += count;
+        }
+        return [NSData dataWithBytesNoCopy:bytes length:size freeWhenDone:YES];
+    }
+}
+
+- (void)closeTemporaryFile {
+    @synchronized (self) {
+        if (self.temporaryFileDescriptor >= 0) {
+            close(self.temporaryFileDescriptor);
+            self.temporaryFileDescriptor = -1;
+        }
+    }
+}
+
+// Move the temporary file in place once the image decoded, on the IO queue of the image cache the file URL comes from
+- (BOOL)commitTemporaryFile {
+    NSURL *fileURL;
+    @synchronized (self) {
+        fileURL = self.temporaryFileURL;
+        self.temporaryFileURL = nil;
+    }
+    if (!fileURL) {
+        return NO;
+    }
+    BOOL moved;
+    id imageCache = self.context[MWWebImageContextImageCache];
+    if ([imageCache isKindOfClass:MWImageCache.class]) {
+        moved = [(MWImageCache *)imageCache moveFileAtURL:fileURL toCacheFileURL:self.downloadFileURL];
+    } else {
+        // `rename` replaces the previous cache file atomically, a reader sees either the old data or the new one
+        moved = rename(fileURL.fileSystemRepresentation, self.downloadFileURL.fileSystemRepresentation) == 0;
+        if (!moved) {
+            unlink(fileURL.fileSystemRepresentation);
+        }
+    }
+    if (!moved) {
+        return NO;
+    }
+    self.downloadedFileURL = self.downloadFileURL;
+    return YES;
+}
+
+- (void)removeTemporaryFile {
+    [self closeTemporaryFile];
+    NSURL *fileURL;
+    @synchronized (self) {
+        fileURL = self.temporaryFileURL;
+        self.temporaryFileURL = nil;
+    }
+    if (fileURL) {
+        unlink(fileURL.fileSystemRepresentation);
+    }
+}
+
 - (void)done {
     self.finished = YES;
     self.executing = NO;
@@ -283,6 +832,10 @@ typedef NSMutableDictionary<NSString *, id> MWCallbackMWictionary;
             self.backgroundTaskId = UIBackgroundTaskInvalid;
         }
 #endif
+        // Not committed, the download failed or was cancelled
+        [self removeTemporaryFile];
+        // The decoded image does not need the received data anymore
+        [self releaseBufferedSize];
     }
 }
 
@@ -326,6 +879,26 @@ didReceiveResponse:(NSURLResponse *)response
     self.response = response;
     
     NSInteger statusCode = [response respondsToSelector:@selector(statusCode)] ? ((NSHTTPURLResponse *)response).statusCode : 200;
+    NSData *resumeData = self.resumeData;
+    if (resumeData) {
+        self.resumeData = nil;
+        if (statusCode == 206 && [self isResponse:(NSHTTPURLResponse *)response continuingAtOffset:resumeData.length]) {
+            // Resumed, the response only contains the missing bytes
+            self.imageData = MWDispatchDataCreateWithData(resumeData);
+            [self chargeBufferedSize:resumeData.length];
+            self.receivedSize = resumeData.length;
+            self.resumedSize = resumeData.length;
+            expected = expected > 0 ? expected + resumeData.length : 0;
+            self.expectedSize = expected;
+        } else {
+            // The image changed or the server ignored the range, the partial data is useless
+            [self removeResumeData];
+            if (statusCode == 206) {
+                valid = NO;
+                self.responseError = [NSError errorWithDomain:MWWebImageErrorDomain code:MWWebImageErrorInvalidDownloadResponse userInfo:@{NSLocalizedDescriptionKey : @"Download marked as failed because the resumed response range does not match"}];
+            }
+        }
+    }
     // Status code should between [200,400)
     BOOL statusCodeValid = statusCode >= 200 && statusCode < 400;
     if (!statusCodeValid) {
@@ -340,8 +913,18 @@ didReceiveResponse:(NSURLResponse *)response
     }
     
     if (valid) {
+        if ([self.decryptor conformsToProtocol:@protocol(MWWebImageDownloaderStreamingDecryptor)]) {
+            self.decryptorStream = [(id<MWWebImageDownloaderStreamingDecryptor>)self.decryptor decryptorStreamWithResponse:response];
+        }
+        if (self.downloadFileURL && !self.temporaryFileURL) {
+            [self openTemporaryFile];
+        }
+        if (!self.temporaryFileURL && !self.decryptorStream && expected > 0) {
+            // The decrypted size is unknown, and the data written to a file is not kept
+            [self prepareReceiveBufferWithCapacity:MIN((NSUInteger)expected, [self maxReceiveBufferCapacity])];
+        }
         for (MWWebImageDownloaderProgressBlock progressBlock in [self callbacksForKey:kProgressCallbackKey]) {
-            progressBlock(0, expected, self.request.URL);
+            progressBlock(self.receivedSize, expected, self.request.URL);
         }
     } else {
         // Status code invalid and marked as cancelled. Do not call `[self.dataTask cancel]` which may mass up URLSession life cycle
@@ -359,11 +942,41 @@ didReceiveResponse:(NSURLResponse *)response
 
 - (void)URLSession:(NSURLSession *)session dataTask:(NSURLSessionDataTask *)dataTask didReceiveData:(NSData *)data {
     if (!self.imageData) {
-        self.imageData = [[NSMutableData alloc] initWithCapacity:self.expectedSize];
+        self.imageData = dispatch_data_empty;
+    }
+    NSData *receivedData = data;
+    if (self.decryptorStream) {
+        // Only the decrypted data is kept, the progress is still in encrypted bytes like the expected size
+        receivedData = [self.decryptorStream decryptedDataWithData:data];
+        if (!receivedData) {
+            self.responseError = [NSError errorWithDomain:MWWebImageErrorDomain code:MWWebImageErrorBadImageData userInfo:@{NSLocalizedDescriptionKey : @"Image data decryption failed"}];
+            [dataTask cancel];
+            return;
+        }
+    }
+    if (self.temporaryFileURL) {
+        if (![self writeDataToTemporaryFile:receivedData]) {
+            self.responseError = [NSError errorWithDomain:MWWebImageErrorDomain code:MWWebImageErrorBadImageData userInfo:@{NSLocalizedDescriptionKey : @"Image data could not be written to the download file"}];
+            [dataTask cancel];
+            return;
+        }
+        // Only the first bytes are kept in memory, for the image header
+        if (self.headerParseStatus == MWImageHeaderParseStatusNeedMoreData && receivedData.length > 0) {
+            self.imageData = dispatch_data_create_concat(self.imageData, MWDispatchDataCreateWithData(receivedData));
+            [self chargeBufferedSize:receivedData.length];
+        }
+    } else if (receivedData.length > 0) {
+        [self appendReceivedData:receivedData];
+        [self chargeBufferedSize:receivedData.length];
+    }
+    self.receivedSize += data.length;
+    if (self.headerParseStatus == MWImageHeaderParseStatusNeedMoreData && ![self parseImageHeaderForDataTask:dataTask]) {
+        return;
+    }
+    if (self.temporaryFileURL && self.headerParseStatus != MWImageHeaderParseStatusNeedMoreData && dispatch_data_get_size(self.imageData) > 0) {
+        self.imageData = dispatch_data_empty;
+        [self releaseBufferedSize];
     }
-    [self.imageData appendData:data];
-    
-    self.receivedSize = self.imageData.length;
     if (self.expectedSize == 0) {
         // Unknown expectedSize, immediately call progressBlock and return
         for (MWWebImageDownloaderProgressBlock progressBlock in [self callbacksForKey:kProgressCallbackKey]) {
@@ -384,23 +997,28 @@ didReceiveResponse:(NSURLResponse *)response
     }
     self.previousProgress = currentProgress;
     
-    // Using data decryptor will disable the progressive decoding, since there are no support for progressive decrypt
-    BOOL supportProgressive = (self.options & MWWebImageDownloaderProgressiveLoad) && !self.decryptor;
+    // Using data decryptor will disable the progressive decoding, unless it can decrypt while downloading
+    BOOL supportProgressive = (self.options & MWWebImageDownloaderProgressiveLoad) && (!self.decryptor || self.decryptorStream);
+    // The data written to a file is not in memory to decode
+    supportProgressive = supportProgressive && !self.temporaryFileURL;
     if (supportProgressive) {
-        // Get the image data
-        NSData *imageData = [self.imageData copy];
+        // Get the image data, `dispatch_data_t` is immutable and is a `NSData`, so the snapshot shares the chunks
+        NSData *imageData = (NSData *)self.imageData;
+        // The decryptor stream may still hold the last bytes until the download completes
+        BOOL decodeFinished = finished && !self.decryptorStream;
         
         // keep maximum one progressive decode process during download
-        if (self.coderQueue.operationCount == 0) {
-            // NSOperation have autoreleasepool, don't need to create extra one
-            [self.coderQueue addOperationWithBlock:^{
-                UIImage *image = MWImageLoaderDecodeProgressiveImageData(imageData, self.request.URL, finished, self, [[self class] imageOptionsFromDownloaderOptions:self.options], self.context);
+        MWImageDecodeTask *decodeTask = self.decodeTask;
+        if (!decodeTask || decodeTask.isFinished || decodeTask.isCancelled) {
+            // The executor tasks have autoreleasepool, don't need to create extra one
+            self.decodeTask = [[MWImageDecodeExecutor sharedExecutor] addDecodeBlock:^{
+                UIImage *image = MWImageLoaderDecodeProgressiveImageData(imageData, self.request.URL, decodeFinished, self, [[self class] imageOptionsFromDownloaderOptions:self.options], self.context);
                 if (image) {
                     // We do not keep the progressive decoding image even when `finished`=YES. Because they are for view rendering but not take full function from downloader options. And some coders implementation may not keep consistent between progressive decoding and normal decoding.
                     
                     [self callCompletionBlocksWithImage:image imageData:nil error:nil finished:NO];
                 }
-            }];
+            } priority:self.priority cost:[self decodeCostForData:imageData] dependency:nil];
         }
     }
     
@@ -409,6 +1027,85 @@ didReceiveResponse:(NSURLResponse *)response
     }
 }
 
+- (NSUInteger)maxReceiveBufferCapacity {
+    NSUInteger capacity = kMWReceiveBufferMaxCapacity;
+    if (self.maxImagePixelCount > 0 && self.maxImagePixelCount < capacity / 4) {
+        // An encoded image larger than its 4 bytes per pixel bitmap is rare, and over the budget anyway
+        capacity = self.maxImagePixelCount * 4;
+    }
+    return capacity;
+}
+
+- (void)prepareReceiveBufferWithCapacity:(NSUInteger)capacity {
+    MWWebImageDownloaderBuffer *buffer = [[MWWebImageDownloaderBuffer alloc] initWithCapacity:capacity];
+    if (!buffer) {
+        return;
+    }
+    // The resumed bytes are moved in, the resume data is released with the old rope
+    dispatch_data_t imageData = self.imageData;
+    if (imageData) {
+        __block BOOL fits = YES;
+        dispatch_data_apply(imageData, ^bool(dispatch_data_t region, size_t offset, const void *bytes, size_t size) {
+            fits = [buffer appendBytes:bytes length:size];
+            return fits;
+        });
+        if (!fits) {
+            return;
+        }
+    }
+    self.receiveBuffer = buffer;
+    self.imageData = [buffer dispatchData];
+}
+
+// Copy into the receive buffer while the body fits it, the chunk is then released by the session. Past it, fall back to wrap the chunks in the rope
+- (void)appendReceivedData:(NSData *)data {
+    MWWebImageDownloaderBuffer *buffer = self.receiveBuffer;
+    if (buffer) {
+        __block BOOL fits = YES;
+        [data enumerateByteRangesUsingBlock:^(const void * _Nonnull bytes, NSRange byteRange, BOOL * _Nonnull stop) {
+            fits = [buffer appendBytes:bytes length:byteRange.length];
+            *stop = !fits;
+        }];
+        if (fits) {
+            self.imageData = [buffer dispatchData];
+            return;
+        }
+        // The buffer was capped, or the server sent more than the expected size. The bytes appended before the failed range are in the snapshot below
+        self.receiveBuffer = nil;
+        NSUInteger appendedLength = buffer.length - dispatch_data_get_size(self.imageData);
+        self.imageData = [buffer dispatchData];
+        data = [data subdataWithRange:NSMakeRange(appendedLength, data.length - appendedLength)];
+    }
+    self.imageData = dispatch_data_create_concat(self.imageData ?: dispatch_data_empty, MWDispatchDataCreateWithData(data));
+}
+
+// Read the image format and size from the first bytes, and cancel the download over the decode budget. Returns NO if cancelled
+- (BOOL)parseImageHeaderForDataTask:(NSURLSessionDataTask *)dataTask {
+    size_t size = dispatch_data_get_size(self.imageData);
+    dispatch_data_t headerData = dispatch_data_create_subrange(self.imageData, 0, MIN(size, MWImageHeaderParserMaxHeaderLength));
+    MWImageFormat format = MWImageFormatUndefined;
+    CGSize pixelSize = CGSizeZero;
+    self.headerParseStatus = [MWImageHeaderParser parseHeaderWithData:(NSData *)headerData format:&format pixelSize:&pixelSize];
+    if (self.headerParseStatus != MWImageHeaderParseStatusSuccess) {
+        return YES;
+    }
+    self.imageFormat = format;
+    self.imagePixelSize = pixelSize;
+    __block typeof(self) strongSelf = self;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [[NSNotificationCenter defaultCenter] postNotificationName:MWWebImageDownloadReceiveImageHeaderNotification object:strongSelf];
+    });
+    // A thumbnail decode only allocates the thumbnail pixels, whatever the image size
+    double pixelCount = MWImageDecodeEstimatedCostForPixelSize(pixelSize, [self thumbnailPixelSize]) / 4;
+    if (self.maxImagePixelCount > 0 && pixelCount > self.maxImagePixelCount) {
+        NSString *description = [NSString stringWithFormat:@"Download marked as failed because the image size %.0fx%.0f exceeds the decode budget of %lu pixels", pixelSize.width, pixelSize.height, (unsigned long)self.maxImagePixelCount];
+        self.responseError = [NSError errorWithDomain:MWWebImageErrorDomain code:MWWebImageErrorImageTooLarge userInfo:@{NSLocalizedDescriptionKey : description}];
+        [dataTask cancel];
+        return NO;
+    }
+    return YES;
+}
+
 - (void)URLSession:(NSURLSession *)session
           dataTask:(NSURLSessionDataTask *)dataTask
  willCacheResponse:(NSCachedURLResponse *)proposedResponse
@@ -447,15 +1144,49 @@ didReceiveResponse:(NSURLResponse *)response
         // custom error instead of URLSession error
         if (self.responseError) {
             error = self.responseError;
+        } else {
+            // Timeout or lost connection, the next download can resume
+            [self saveResumeDataIfNeeded];
         }
         [self callCompletionBlocksWithError:error];
         [self done];
     } else {
+        if (self.resumeDataCache) {
+            [self removeResumeData];
+        }
         if ([self callbacksForKey:kCompletedCallbackKey].count > 0) {
-            NSData *imageData = [self.imageData copy];
+            BOOL decrypted = YES;
+            NSURL *temporaryFileURL = self.temporaryFileURL;
+            if (self.decryptorStream) {
+                NSData *decryptedData = [self.decryptorStream finishDecrypting];
+                if (decryptedData.length > 0) {
+                    if (temporaryFileURL) {
+                        decryptedData = [self writeDataToTemporaryFile:decryptedData] ? decryptedData : nil;
+                    } else {
+                        self.imageData = dispatch_data_create_concat(self.imageData ?: dispatch_data_empty, MWDispatchDataCreateWithData(decryptedData));
+                        [self chargeBufferedSize:decryptedData.length];
+                    }
+                }
+                decrypted = decryptedData != nil;
+            }
+            NSData *imageData;
+            if (temporaryFileURL) {
+                // The body was not buffered while downloading, it's read once for the decoder
+                imageData = decrypted ? [self readTemporaryFile] : nil;
+                [self closeTemporaryFile];
+            } else {
+                // Flatten once for the decoder. No copy when the body fit the receive buffer, which is one contiguous region, so the peak stays at the data size
+                // Else the chunks are released right after, once the old rope is dropped
+                dispatch_data_t receivedData = self.imageData;
+                self.imageData = nil;
+                self.receiveBuffer = nil;
+                imageData = receivedData && decrypted ? (NSData *)dispatch_data_create_map(receivedData, NULL, NULL) : nil;
+                receivedData = nil;
+            }
             self.imageData = nil;
-            // data decryptor
-            if (imageData && self.decryptor) {
+            self.receiveBuffer = nil;
+            // data decryptor, if not already decrypted while downloading
+            if (imageData && self.decryptor && !self.decryptorStream) {
                 imageData = [self.decryptor decryptedDataWithData:imageData response:self.response];
             }
             if (imageData) {
@@ -468,19 +1199,32 @@ didReceiveResponse:(NSURLResponse *)response
                     [self callCompletionBlocksWithError:self.responseError];
                     [self done];
                 } else {
-                    // decode the image in coder queue, cancel all previous decoding process
-                    [self.coderQueue cancelAllOperations];
-                    [self.coderQueue addOperationWithBlock:^{
+                    // decode the image in the shared executor, cancel the waiting progressive decoding and run after the running one
+                    MWImageDecodeTask *progressiveDecodeTask = self.decodeTask;
+                    [progressiveDecodeTask cancel];
+                    MWImageDecodeTask *finalDecodeTask = [[MWImageDecodeExecutor sharedExecutor] addDecodeBlock:^{
                         UIImage *image = MWImageLoaderDecodeImageData(imageData, self.request.URL, [[self class] imageOptionsFromDownloaderOptions:self.options], self.context);
                         CGSize imageSize = image.size;
                         if (imageSize.width == 0 || imageSize.height == 0) {
                             NSString *description = image == nil ? @"Downloaded image decode failed" : @"Downloaded image has 0 pixels";
                             [self callCompletionBlocksWithError:[NSError errorWithDomain:MWWebImageErrorDomain code:MWWebImageErrorBadImageData userInfo:@{NSLocalizedDescriptionKey : description}]];
                         } else {
+                            if ([self commitTemporaryFile]) {
+                                // Before the completion blocks, so that the download tokens know the file
+                                __block typeof(self) strongSelf = self;
+                                dispatch_async(dispatch_get_main_queue(), ^{
+                                    [[NSNotificationCenter defaultCenter] postNotificationName:MWWebImageDownloadWriteFileNotification object:strongSelf];
+                                });
+                            }
                             [self callCompletionBlocksWithImage:image imageData:imageData error:nil finished:YES];
                         }
                         [self done];
-                    }];
+                    } priority:self.priority cost:[self decodeCostForData:imageData] dependency:progressiveDecodeTask];
+                    // Seen together by `cancelInternal`, which runs inside `@synchronized (self)`
+                    @synchronized (self) {
+                        self.decodeTask = finalDecodeTask;
+                        self.finalDecodeTask = finalDecodeTask;
+                    }
                 }
             } else {
                 [self callCompletionBlocksWithError:[NSError errorWithDomain:MWWebImageErrorDomain code:MWWebImageErrorBadImageData userInfo:@{NSLocalizedDescriptionKey : @"Image data is nil"}]];
@@ -8,6 +8,7 @@
 
 #import <Foundation/Foundation.h>
 #import "MWWebImageCompat.h"
+#import "MWWebImageDefine.h"
 
 typedef NSURLRequest * _Nullable (^MWWebImageDownloaderRequestModifierBlock)(NSURLRequest * _Nonnull request);
 
@@ -22,6 +23,26 @@ typedef NSURLRequest * _Nullable (^MWWebImageDownloaderRequestModifierBlock)(NSU
 /// @note If return nil, the URL request will be cancelled.
 - (nullable NSURLRequest *)modifiedRequestWithRequest:(nonnull NSURLRequest *)request;
 
+@optional
+
+/// Modify the original URL request with the context of the image load, like the target pixel size (`MWWebImageContextImageTargetPixelSize`). When implemented, it's called instead of `modifiedRequestWithRequest:`.
+/// @param request The original URL request for image loading
+/// @param context The context of the image load
+/// @note If return nil, the URL request will be cancelled.
+- (nullable NSURLRequest *)modifiedRequestWithRequest:(nonnull NSURLRequest *)request context:(nullable MWWebImageContext *)context;
+
+/// The variant of the image this modifier will request for the URL, such as the chosen size or quality. The image manager asks for it before the cache query and stores it as `MWWebImageContextImageVariant`, which is appended to the cache key, so each variant is cached on its own.
+/// The modifier must then request the variant from `MWWebImageContextImageVariant` when the context has it, even if it would choose another one now.
+/// @param url The original URL of the image
+/// @param context The context of the image load
+/// @return The variant name, nil if the request of this URL is not modified into a variant
+- (nullable NSString *)variantForURL:(nonnull NSURL *)url context:(nullable MWWebImageContext *)context;
+
+/// Called when the download of a modified request finished successfully, to measure the effect of the modification.
+/// @param request The modified URL request
+/// @param receivedBytes The response body bytes received
+- (void)didFinishRequest:(nonnull NSURLRequest *)request receivedBytes:(int64_t)receivedBytes;
+
 @end
 
 /**
@@ -0,0 +1,112 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "MWWebImageCompat.h"
+#import "MWWebImageDownloaderRequestModifier.h"
+
+@class MWWebImageDownloaderBandwidthEstimator;
+
+/**
+ A rule of `MWWebImageDownloaderVariantRequestModifier`: which variant of the image to request above a bandwidth.
+ */
+@interface MWWebImageDownloaderVariantRule : NSObject <NSCopying>
+
+/// The rule name, used in the decisions and statistics
+@property (nonatomic, copy, readonly, nonnull) NSString *name;
+/// The rule applies when the estimated bandwidth is at least this value, in bytes per second
+@property (nonatomic, assign, readonly) double minimumBandwidth;
+/// The query items set on the URL, like quality or format parameters. They replace the items of the same name
+@property (nonatomic, copy, readonly, nullable) NSDictionary<NSString *, NSString *> *queryItems;
+/// The factor applied to the target pixel size before setting the width and height query items. Defaults to 1, use less than 1 to request smaller variants on slow links
+@property (nonatomic, assign) CGFloat pixelSizeScale;
+
+- (nonnull instancetype)init NS_UNAVAILABLE;
++ (nonnull instancetype)new NS_UNAVAILABLE;
+
+/**
+ Create a rule.
+
+ @param name The rule name
+ @param minimumBandwidth The minimum estimated bandwidth in bytes per second, 0 for the fallback rule
+ @param queryItems The query items set on the URL
+ */
++ (nonnull instancetype)ruleWithName:(nonnull NSString *)name minimumBandwidth:(double)minimumBandwidth queryItems:(nullable NSDictionary<NSString *, NSString *> *)queryItems;
+
+@end
+
+/**
+ A decision of `MWWebImageDownloaderVariantRequestModifier`.
+ */
+@interface MWWebImageDownloaderVariantDecision : NSObject
+
+/// The original URL
+@property (nonatomic, copy, readonly, nonnull) NSURL *originalURL;
+/// The URL of the requested variant
+@property (nonatomic, copy, readonly, nonnull) NSURL *variantURL;
+/// The name of the applied rule
+@property (nonatomic, copy, readonly, nonnull) NSString *ruleName;
+/// The estimated bandwidth the decision was based on, in bytes per second
+@property (nonatomic, assign, readonly) double bandwidth;
+/// The target pixel size of the image, zero if unknown
+@property (nonatomic, assign, readonly) CGSize targetPixelSize;
+/// The response body bytes received, -1 until the download finished successfully
+@property (nonatomic, assign, readonly) int64_t receivedBytes;
+
+@end
+
+/**
+ A request modifier choosing the URL variant of the image from the estimated bandwidth and the target pixel size, for image servers or CDNs which resize and re-encode with query parameters. On slow links, smaller or lower quality variants can divide the transferred bytes several times.
+ The rules are checked from the highest `minimumBandwidth`, the first one below the estimate applies. The width and height query items are set from the target pixel size (`MWWebImageContextImageTargetPixelSize`, or `MWWebImageContextImageThumbnailPixelSize`) scaled by the rule.
+ @note The variant (the rule name and the requested width and height) is appended to the cache key by `variantForURL:context:`, so a low quality variant downloaded on a slow link is not returned for the same URL later on a fast one. A cached variant is only found again while the same rule applies.
+ @note Set it as the downloader `requestModifier`, or with `MWWebImageContextDownloadRequestModifier`. Its methods are thread-safe.
+ */
+@interface MWWebImageDownloaderVariantRequestModifier : NSObject <MWWebImageDownloaderRequestModifier>
+
+/// The bandwidth estimator, usually `MWWebImageDownloader.bandwidthEstimator`
+@property (nonatomic, strong, readonly, nonnull) MWWebImageDownloaderBandwidthEstimator *bandwidthEstimator;
+/// The rules, sorted from the highest `minimumBandwidth`
+@property (nonatomic, copy, readonly, nonnull) NSArray<MWWebImageDownloaderVariantRule *> *rules;
+/// The hosts the rules apply to, nil means all hosts. Defaults to nil
+@property (nonatomic, copy, nullable) NSSet<NSString *> *hosts;
+/// The query item name of the width in pixels, nil to not set it. Defaults to nil
+@property (nonatomic, copy, nullable) NSString *widthQueryName;
+/// The query item name of the height in pixels, nil to not set it. Defaults to nil
+@property (nonatomic, copy, nullable) NSString *heightQueryName;
+/// The bandwidth used before the first estimate, in bytes per second. Defaults to 1MB/s
+@property (nonatomic, assign) double assumedBandwidth;
+/// The number of recent decisions kept. Defaults to 100
+@property (nonatomic, assign) NSUInteger maxDecisionCount;
+
+- (nonnull instancetype)init NS_UNAVAILABLE;
++ (nonnull instancetype)new NS_UNAVAILABLE;
+
+/**
+ Create a variant request modifier.
+
+ @param bandwidthEstimator The bandwidth estimator, usually `MWWebImageDownloader.bandwidthEstimator`
+ @param rules The rules, in any order. If no rule applies, the request is not modified
+ */
+- (nonnull instancetype)initWithBandwidthEstimator:(nonnull MWWebImageDownloaderBandwidthEstimator *)bandwidthEstimator rules:(nonnull NSArray<MWWebImageDownloaderVariantRule *> *)rules NS_DESIGNATED_INITIALIZER;
+
+/**
+ The recent decisions, oldest first.
+ */
+- (nonnull NSArray<MWWebImageDownloaderVariantDecision *> *)recentDecisions;
+
+/**
+ The number of requests modified by each rule, by rule name.
+ */
+- (nonnull NSDictionary<NSString *, NSNumber *> *)requestCountsPerRule;
+
+/**
+ The response body bytes received for the requests modified by each rule, by rule name.
+ */
+- (nonnull NSDictionary<NSString *, NSNumber *> *)receivedBytesPerRule;
+
+@end
@@ -0,0 +1,287 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "MWWebImageDownloaderVariantRequestModifier.h"
+#import "MWWebImageDownloaderBandwidthEstimator.h"
+#import "MWInternalMacros.h"
+
+@interface MWWebImageDownloaderVariantRule ()
+
+@property (nonatomic, copy, readwrite, nonnull) NSString *name;
+@property (nonatomic, assign, readwrite) double minimumBandwidth;
+@property (nonatomic, copy, readwrite, nullable) NSDictionary<NSString *, NSString *> *queryItems;
+
+@end
+
+@implementation MWWebImageDownloaderVariantRule
+
++ (instancetype)ruleWithName:(NSString *)name minimumBandwidth:(double)minimumBandwidth queryItems:(NSDictionary<NSString *,NSString *> *)queryItems {
+    MWWebImageDownloaderVariantRule *rule = [[self alloc] initWithName:name minimumBandwidth:minimumBandwidth queryItems:queryItems];
+    return rule;
+}
+
+- (instancetype)initWithName:(NSString *)name minimumBandwidth:(double)minimumBandwidth queryItems:(NSDictionary<NSString *,NSString *> *)queryItems {
+    self = [super init];
+    if (self) {
+        _name = [name copy];
+        _minimumBandwidth = MAX(minimumBandwidth, 0);
+        _queryItems = [queryItems copy];
+        _pixelSizeScale = 1;
+    }
+    return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    MWWebImageDownloaderVariantRule *rule = [[[self class] allocWithZone:zone] initWithName:self.name minimumBandwidth:self.minimumBandwidth queryItems:self.queryItems];
+    rule.pixelSizeScale = self.pixelSizeScale;
+    return rule;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p name = %@, minimum bandwidth = %.0fB/s, scale = %.2f, query = %@>", NSStringFromClass(self.class), self, self.name, self.minimumBandwidth, self.pixelSizeScale, self.queryItems];
+}
+
+@end
+
+@interface MWWebImageDownloaderVariantDecision ()
+
+@property (nonatomic, copy, readwrite, nonnull) NSURL *originalURL;
+@property (nonatomic, copy, readwrite, nonnull) NSURL *variantURL;
+@property (nonatomic, copy, readwrite, nonnull) NSString *ruleName;
+@property (nonatomic, assign, readwrite) double bandwidth;
+@property (nonatomic, assign, readwrite) CGSize targetPixelSize;
+@property (nonatomic, assign, readwrite) int64_t receivedBytes;
+
+@end
+
+@implementation MWWebImageDownloaderVariantDecision
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p rule = %@, bandwidth = %.0fB/s, target = %.0fx%.0f, received = %lld, url = %@>", NSStringFromClass(self.class), self, self.ruleName, self.bandwidth, self.targetPixelSize.width, self.targetPixelSize.height, self.receivedBytes, self.variantURL];
+}
+
+@end
+
+@interface MWWebImageDownloaderVariantRequestModifier ()
+
+@property (nonatomic, strong, readwrite, nonnull) MWWebImageDownloaderBandwidthEstimator *bandwidthEstimator;
+@property (nonatomic, copy, readwrite, nonnull) NSArray<MWWebImageDownloaderVariantRule *> *rules;
+@property (nonatomic, strong, nonnull) NSMutableArray<MWWebImageDownloaderVariantDecision *> *decisions; // oldest first
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSString *, NSNumber *> *requestCounts;
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSString *, NSNumber *> *receivedBytes;
+@property (nonatomic, strong, nonnull) dispatch_semaphore_t lock;
+
+@end
+
+@implementation MWWebImageDownloaderVariantRequestModifier
+
+- (instancetype)initWithBandwidthEstimator:(MWWebImageDownloaderBandwidthEstimator *)bandwidthEstimator rules:(NSArray<MWWebImageDownloaderVariantRule *> *)rules {
+    self = [super init];
+    if (self) {
+        _bandwidthEstimator = bandwidthEstimator;
+        NSMutableArray<MWWebImageDownloaderVariantRule *> *copiedRules = [NSMutableArray arrayWithCapacity:rules.count];
+        for (MWWebImageDownloaderVariantRule *rule in rules) {
+            [copiedRules addObject:[rule copy]];
+        }
+        _rules = [copiedRules sortedArrayUsingComparator:^NSComparisonResult(MWWebImageDownloaderVariantRule *rule1, MWWebImageDownloaderVariantRule *rule2) {
+            if (rule1.minimumBandwidth == rule2.minimumBandwidth) {
+                return NSOrderedSame;
+            }
+            return rule1.minimumBandwidth > rule2.minimumBandwidth ? NSOrderedAscending : NSOrderedDescending;
+        }];
+        _assumedBandwidth = 1024 * 1024;
+        _maxDecisionCount = 100;
+        _decisions = [NSMutableArray array];
+        _requestCounts = [NSMutableDictionary dictionary];
+        _receivedBytes = [NSMutableDictionary dictionary];
+        _lock = dispatch_semaphore_create(1);
+    }
+    return self;
+}
+
+#pragma mark - MWWebImageDownloaderRequestModifier
+
+- (NSURLRequest *)modifiedRequestWithRequest:(NSURLRequest *)request {
+    return [self modifiedRequestWithRequest:request context:nil];
+}
+
+- (NSURLRequest *)modifiedRequestWithRequest:(NSURLRequest *)request context:(MWWebImageContext *)context {
+    NSURL *URL = request.URL;
+    if (![self appliesToURL:URL]) {
+        return request;
+    }
+    double bandwidth = self.bandwidthEstimator.sampleCount > 0 ? self.bandwidthEstimator.estimatedBandwidth : self.assumedBandwidth;
+    CGSize targetPixelSize = [self targetPixelSizeWithContext:context];
+    // The variant the cache key was built with, the bandwidth may have changed since the cache query
+    MWWebImageDownloaderVariantRule *selectedRule;
+    NSString *variant = context[MWWebImageContextImageVariant];
+    if ([variant isKindOfClass:NSString.class]) {
+        for (MWWebImageDownloaderVariantRule *rule in self.rules) {
+            if ([[self variantWithRule:rule targetPixelSize:targetPixelSize] isEqualToString:variant]) {
+                selectedRule = rule;
+                break;
+            }
+        }
+    }
+    if (!selectedRule) {
+        selectedRule = [self ruleForBandwidth:bandwidth];
+    }
+    if (!selectedRule) {
+        return request;
+    }
+    NSURL *variantURL = [self variantURLWithURL:URL rule:selectedRule targetPixelSize:targetPixelSize];
+    if (!variantURL) {
+        return request;
+    }
+    
+    MWWebImageDownloaderVariantDecision *decision = [MWWebImageDownloaderVariantDecision new];
+    decision.originalURL = URL;
+    decision.variantURL = variantURL;
+    decision.ruleName = selectedRule.name;
+    decision.bandwidth = bandwidth;
+    decision.targetPixelSize = targetPixelSize;
+    decision.receivedBytes = -1;
+    MW_LOCK(self.lock);
+    [self.decisions addObject:decision];
+    NSUInteger maxDecisionCount = MAX(self.maxDecisionCount, 1);
+    if (self.decisions.count > maxDecisionCount) {
+        [self.decisions removeObjectsInRange:NSMakeRange(0, self.decisions.count - maxDecisionCount)];
+    }
+    self.requestCounts[selectedRule.name] = @(self.requestCounts[selectedRule.name].unsignedIntegerValue + 1);
+    MW_UNLOCK(self.lock);
+    
+    NSMutableURLRequest *mutableRequest = [request mutableCopy];
+    mutableRequest.URL = variantURL;
+    return [mutableRequest copy];
+}
+
+- (NSString *)variantForURL:(NSURL *)url context:(MWWebImageContext *)context {
+    if (![self appliesToURL:url]) {
+        return nil;
+    }
+    double bandwidth = self.bandwidthEstimator.sampleCount > 0 ? self.bandwidthEstimator.estimatedBandwidth : self.assumedBandwidth;
+    MWWebImageDownloaderVariantRule *rule = [self ruleForBandwidth:bandwidth];
+    if (!rule) {
+        return nil;
+    }
+    CGSize targetPixelSize = [self targetPixelSizeWithContext:context];
+    if (![self variantURLWithURL:url rule:rule targetPixelSize:targetPixelSize]) {
+        // The request is not modified
+        return nil;
+    }
+    return [self variantWithRule:rule targetPixelSize:targetPixelSize];
+}
+
+- (void)didFinishRequest:(NSURLRequest *)request receivedBytes:(int64_t)receivedBytes {
+    NSURL *URL = request.URL;
+    if (!URL) {
+        return;
+    }
+    MW_LOCK(self.lock);
+    for (MWWebImageDownloaderVariantDecision *decision in self.decisions) {
+        if (decision.receivedBytes < 0 && [decision.variantURL isEqual:URL]) {
+            decision.receivedBytes = receivedBytes;
+            self.receivedBytes[decision.ruleName] = @(self.receivedBytes[decision.ruleName].longLongValue + receivedBytes);
+            break;
+        }
+    }
+    MW_UNLOCK(self.lock);
+}
+
+#pragma mark - Variant
+
+- (BOOL)appliesToURL:(NSURL *)URL {
+    NSSet<NSString *> *hosts = self.hosts;
+    return URL && (!hosts || (URL.host && [hosts containsObject:URL.host]));
+}
+
+- (MWWebImageDownloaderVariantRule *)ruleForBandwidth:(double)bandwidth {
+    for (MWWebImageDownloaderVariantRule *rule in self.rules) {
+        if (bandwidth >= rule.minimumBandwidth) {
+            return rule;
+        }
+    }
+    return nil;
+}
+
+// The rule name and the requested pixel size, what makes the downloaded variant differ
+- (NSString *)variantWithRule:(MWWebImageDownloaderVariantRule *)rule targetPixelSize:(CGSize)targetPixelSize {
+    CGFloat scale = rule.pixelSizeScale > 0 ? rule.pixelSizeScale : 1;
+    CGFloat width = self.widthQueryName && targetPixelSize.width > 0 ? ceil(targetPixelSize.width * scale) : 0;
+    CGFloat height = self.heightQueryName && targetPixelSize.height > 0 ? ceil(targetPixelSize.height * scale) : 0;
+    return [NSString stringWithFormat:@"%@-%.0fx%.0f", rule.name, width, height];
+}
+
+- (CGSize)targetPixelSizeWithContext:(MWWebImageContext *)context {
+    NSValue *sizeValue = context[MWWebImageContextImageTargetPixelSize] ?: context[MWWebImageContextImageThumbnailPixelSize];
+    if (![sizeValue isKindOfClass:NSValue.class]) {
+        return CGSizeZero;
+    }
+#if MW_MAC
+    return sizeValue.sizeValue;
+#else
+    return sizeValue.CGSizeValue;
+#endif
+}
+
+- (NSURL *)variantURLWithURL:(NSURL *)URL rule:(MWWebImageDownloaderVariantRule *)rule targetPixelSize:(CGSize)targetPixelSize {
+    NSURLComponents *components = [NSURLComponents componentsWithURL:URL resolvingAgainstBaseURL:NO];
+    if (!components) {
+        return nil;
+    }
+    NSMutableDictionary<NSString *, NSString *> *values = [NSMutableDictionary dictionary];
+    [values addEntriesFromDictionary:rule.queryItems];
+    CGFloat scale = rule.pixelSizeScale > 0 ? rule.pixelSizeScale : 1;
+    if (self.widthQueryName && targetPixelSize.width > 0) {
+        values[self.widthQueryName] = [NSString stringWithFormat:@"%.0f", ceil(targetPixelSize.width * scale)];
+    }
+    if (self.heightQueryName && targetPixelSize.height > 0) {
+        values[self.heightQueryName] = [NSString stringWithFormat:@"%.0f", ceil(targetPixelSize.height * scale)];
+    }
+    if (values.count == 0) {
+        return nil;
+    }
+    // Replace the existing items of the same name, keep the others in order
+    NSMutableArray<NSURLQueryItem *> *queryItems = [NSMutableArray array];
+    for (NSURLQueryItem *queryItem in components.queryItems) {
+        if (!values[queryItem.name]) {
+            [queryItems addObject:queryItem];
+        }
+    }
+    NSArray<NSString *> *names = [values.allKeys sortedArrayUsingSelector:@selector(compare:)];
+    for (NSString *name in names) {
+        [queryItems addObject:[NSURLQueryItem queryItemWithName:name value:values[name]]];
+    }
+    components.queryItems = queryItems;
+    return components.URL;
+}
+
+#pragma mark - Statistics
+
+- (NSArray<MWWebImageDownloaderVariantDecision *> *)recentDecisions {
+    MW_LOCK(self.lock);
+    NSArray<MWWebImageDownloaderVariantDecision *> *decisions = [self.decisions copy];
+    MW_UNLOCK(self.lock);
+    return decisions;
+}
+
+- (NSDictionary<NSString *,NSNumber *> *)requestCountsPerRule {
+    MW_LOCK(self.lock);
+    NSDictionary<NSString *, NSNumber *> *requestCounts = [self.requestCounts copy];
+    MW_UNLOCK(self.lock);
+    return requestCounts;
+}
+
+- (NSDictionary<NSString *,NSNumber *> *)receivedBytesPerRule {
+    MW_LOCK(self.lock);
+    NSDictionary<NSString *, NSNumber *> *receivedBytes = [self.receivedBytes copy];
+    MW_UNLOCK(self.lock);
+    return receivedBytes;
+}
+
+@end
@@ -24,4 +24,5 @@ typedef NS_ERROR_ENUM(MWWebImageErrorDomain, MWWebImageError) {
     MWWebImageErrorInvalidDownloadStatusCode = 2001, // The image download response a invalid status code. You can check the status code in error's userInfo under `MWWebImageErrorDownloadStatusCodeKey`
     MWWebImageErrorCancelled = 2002, // The image loading operation is cancelled before finished, during either async disk cache query, or waiting before actual network request. For actual network request error, check `NSURLErrorDomain` error domain and code.
     MWWebImageErrorInvalidDownloadResponse = 2003, // When using response modifier, the modified download response is nil and marked as failed.
+    MWWebImageErrorImageTooLarge = 2004, // The image pixel count, read from the image header during the download, exceeds `MWWebImageDownloaderConfig.maxImagePixelCount`. The download is cancelled, but the URL is not blocked, as a load with a smaller thumbnail size may fit
 };
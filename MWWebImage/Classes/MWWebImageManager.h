@@ -14,6 +14,7 @@
 #import "MWWebImageCacheKeyFilter.h"
 #import "MWWebImageCacheSerializer.h"
 #import "MWWebImageOptionsProcessor.h"
+#import "MWWebImageRetryPolicy.h"
 
 typedef void(^MWExternalCompletionBlock)(UIImage * _Nullable image, NSError * _Nullable error, MWImageCacheType cacheType, NSURL * _Nullable imageURL);
 
@@ -39,6 +40,12 @@ typedef void(^MWInternalCompletionBlock)(UIImage * _Nullable image, NSData * _Nu
  */
 @property (strong, nonatomic, nullable, readonly) id<MWWebImageOperation> loaderOperation;
 
+/**
+ The priority of the whole load. It starts from `MWWebImageHighPriority` / `MWWebImageLowPriority` options, and can be changed at any time, for example when the view scrolls on or off screen.
+ The change is forwarded to the loader operation (queue priority, task priority and decoding quality of service), and used by the following serializing and transforming work.
+ */
+@property (assign, nonatomic) MWWebImageOperationPriority priority;
+
 @end
 
 
@@ -180,6 +187,25 @@ MWWebImageManager *manager = [MWWebImageManager sharedManager];
  */
 @property (nonatomic, strong, nullable) id<MWWebImageOptionsProcessor> optionsProcessor;
 
+/**
+ The retry policy for the transient load failures, such as a timeout or a 503 response. The load is retried with exponential backoff and jitter, within a retry budget, before its completion block is called with the error. See `MWWebImageRetryPolicy`.
+ The errors which should be blocked (see `imageManager:shouldBlockFailedURL:withError:` and `-[MWImageLoader shouldBlockFailedURLWithURL:error:]`) are never retried, neither are the refreshes of a cached image (`MWWebImageRefreshCached`).
+ Defaults to nil, which means no retry.
+ */
+@property (nonatomic, copy, nullable) MWWebImageRetryPolicy *retryPolicy;
+
+/**
+ The time a failed URL stays in the black list, in seconds. After it, the URL is loaded again even without `MWWebImageRetryFailed`.
+ Defaults to 3600 (1 hour). 0 means the failed URLs stay blocked until removed by `removeFailedURL:`.
+ */
+@property (nonatomic, assign) NSTimeInterval failedURLExpirationInterval;
+
+/**
+ The maximum number of URLs in the failed black list. When full, the oldest failed URL is removed.
+ Defaults to 1000. 0 means no limit.
+ */
+@property (nonatomic, assign) NSUInteger maxFailedURLCount;
+
 /**
  * Check one or more operations running
  */
@@ -10,6 +10,7 @@
 #import "MWImageCache.h"
 #import "MWWebImageDownloader.h"
 #import "UIImage+Metadata.h"
+#import "UIImage+MemoryCacheCost.h"
 #import "MWAssociatedObject.h"
 #import "MWWebImageError.h"
 #import "MWInternalMacros.h"
@@ -17,12 +18,74 @@
 static id<MWImageCache> _defaultImageCache;
 static id<MWImageLoader> _defaultImageLoader;
 
+// The HTTP validators of the downloaded image, passed from the download process to the store cache process (MWImageCacheValidators)
+static MWWebImageContextOption const MWWebImageContextDownloadedValidators = @"downloadedValidators";
+// The disk cache file the downloaded data was already written to with `MWWebImageDownloadToFile`, passed from the download process to the store cache process (NSURL)
+static MWWebImageContextOption const MWWebImageContextDownloadedFileURL = @"downloadedFileURL";
+// Whether the cached image was already delivered before querying the validators, so the download process does not deliver it again (NSNumber)
+static MWWebImageContextOption const MWWebImageContextCachedImageDelivered = @"cachedImageDelivered";
+
+// The global queue for the serializing and transforming work of a load, which follows the load priority
+static dispatch_queue_t MWWebImageWorkQueueForPriority(MWWebImageOperationPriority priority) {
+    qos_class_t qos;
+    if (priority >= 0.625) {
+        qos = QOS_CLASS_USER_INTERACTIVE;
+    } else if (priority > 0.375) {
+        qos = QOS_CLASS_USER_INITIATED;
+    } else {
+        qos = QOS_CLASS_UTILITY;
+    }
+    return dispatch_get_global_queue(qos, 0);
+}
+
+// The `Retry-After` of the response in seconds from now, either delay-seconds or an HTTP-date. Negative if absent or invalid
+static NSTimeInterval MWRetryAfterIntervalForResponse(NSURLResponse *response) {
+    if (![response isKindOfClass:NSHTTPURLResponse.class]) {
+        return -1;
+    }
+    NSString *retryAfter;
+    NSDictionary *headerFields = ((NSHTTPURLResponse *)response).allHeaderFields;
+    for (NSString *key in headerFields) {
+        if ([key caseInsensitiveCompare:@"Retry-After"] == NSOrderedSame) {
+            retryAfter = headerFields[key];
+            break;
+        }
+    }
+    retryAfter = [retryAfter stringByTrimmingCharactersInSet:NSCharacterSet.whitespaceCharacterSet];
+    if (retryAfter.length == 0) {
+        return -1;
+    }
+    NSScanner *scanner = [NSScanner scannerWithString:retryAfter];
+    double seconds = 0;
+    if ([scanner scanDouble:&seconds] && scanner.isAtEnd) {
+        return seconds >= 0 ? seconds : -1;
+    }
+    // An HTTP-date, in the IMF-fixdate format of RFC 7231, such as `Sun, 06 Nov 1994 08:49:37 GMT`
+    static NSDateFormatter *dateFormatter;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        dateFormatter = [NSDateFormatter new];
+        dateFormatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+        dateFormatter.timeZone = [NSTimeZone timeZoneForSecondsFromGMT:0];
+        dateFormatter.dateFormat = @"EEE',' dd MMM yyyy HH':'mm':'ss 'GMT'";
+    });
+    NSDate *date = [dateFormatter dateFromString:retryAfter];
+    if (!date) {
+        return -1;
+    }
+    // A date in the past means retry now
+    return MAX(date.timeIntervalSinceNow, 0);
+}
+
 @interface MWWebImageCombinedOperation ()
 
 @property (assign, nonatomic, getter = isCancelled) BOOL cancelled;
 @property (strong, nonatomic, readwrite, nullable) id<MWWebImageOperation> loaderOperation;
 @property (strong, nonatomic, readwrite, nullable) id<MWWebImageOperation> cacheOperation;
 @property (weak, nonatomic, nullable) MWWebImageManager *manager;
+@property (assign, nonatomic) NSUInteger retryCount;
+
+- (void)applyPriorityToLoaderOperation;
 
 @end
 
@@ -30,8 +93,10 @@ static id<MWImageLoader> _defaultImageLoader;
 
 @property (strong, nonatomic, readwrite, nonnull) MWImageCache *imageCache;
 @property (strong, nonatomic, readwrite, nonnull) id<MWImageLoader> imageLoader;
-@property (strong, nonatomic, nonnull) NSMutableSet<NSURL *> *failedURLs;
+@property (strong, nonatomic, nonnull) NSMutableDictionary<NSURL *, NSNumber *> *failedURLs; // failed URL to the absolute time it failed
 @property (strong, nonatomic, nonnull) dispatch_semaphore_t failedURLsLock; // a lock to keep the access to `failedURLs` thread-safe
+@property (assign, nonatomic) double retryBudget;
+@property (strong, nonatomic, nonnull) dispatch_semaphore_t retryBudgetLock;
 @property (strong, nonatomic, nonnull) NSMutableSet<MWWebImageCombinedOperation *> *runningOperations;
 @property (strong, nonatomic, nonnull) dispatch_semaphore_t runningOperationsLock; // a lock to keep the access to `runningOperations` thread-safe
 
@@ -86,8 +151,12 @@ static id<MWImageLoader> _defaultImageLoader;
     if ((self = [super init])) {
         _imageCache = cache;
         _imageLoader = loader;
-        _failedURLs = [NSMutableSet new];
+        _failedURLs = [NSMutableDictionary new];
         _failedURLsLock = dispatch_semaphore_create(1);
+        _failedURLExpirationInterval = 3600;
+        _maxFailedURLCount = 1000;
+        _retryBudget = -1; // filled on first use, from the retry policy
+        _retryBudgetLock = dispatch_semaphore_create(1);
         _runningOperations = [NSMutableSet new];
         _runningOperationsLock = dispatch_semaphore_create(1);
     }
@@ -157,6 +226,12 @@ static id<MWImageLoader> _defaultImageLoader;
         key = MWTransformedKeyForKey(key, transformer.transformerKey);
     }
     
+    // Variant Key Appending
+    NSString *variant = context[MWWebImageContextImageVariant];
+    if ([variant isKindOfClass:NSString.class] && variant.length > 0) {
+        key = MWTransformedKeyForKey(key, [NSString stringWithFormat:@"Variant(%@)", variant]);
+    }
+    
     return key;
 }
 
@@ -185,12 +260,15 @@ static id<MWImageLoader> _defaultImageLoader;
 
     MWWebImageCombinedOperation *operation = [MWWebImageCombinedOperation new];
     operation.manager = self;
+    if (options & MWWebImageHighPriority) {
+        operation.priority = MWWebImageOperationPriorityHigh;
+    } else if (options & MWWebImageLowPriority) {
+        operation.priority = MWWebImageOperationPriorityLow;
+    }
 
     BOOL isFailedUrl = NO;
     if (url) {
-        MW_LOCK(self.failedURLsLock);
-        isFailedUrl = [self.failedURLs containsObject:url];
-        MW_UNLOCK(self.failedURLsLock);
+        isFailedUrl = [self isFailedURL:url];
     }
 
     if (url.absoluteString.length == 0 || (!(options & MWWebImageRetryFailed) && isFailedUrl)) {
@@ -233,7 +311,7 @@ static id<MWImageLoader> _defaultImageLoader;
         return;
     }
     MW_LOCK(self.failedURLsLock);
-    [self.failedURLs removeObject:url];
+    [self.failedURLs removeObjectForKey:url];
     MW_UNLOCK(self.failedURLsLock);
 }
 
@@ -243,6 +321,91 @@ static id<MWImageLoader> _defaultImageLoader;
     MW_UNLOCK(self.failedURLsLock);
 }
 
+#pragma mark - Failed URLs
+
+- (BOOL)isFailedURL:(nonnull NSURL *)url {
+    MW_LOCK(self.failedURLsLock);
+    NSNumber *failedTime = self.failedURLs[url];
+    NSTimeInterval expirationInterval = self.failedURLExpirationInterval;
+    if (failedTime && expirationInterval > 0 && CFAbsoluteTimeGetCurrent() - failedTime.doubleValue > expirationInterval) {
+        // Expired, give the URL a new chance
+        [self.failedURLs removeObjectForKey:url];
+        failedTime = nil;
+    }
+    MW_UNLOCK(self.failedURLsLock);
+    return failedTime != nil;
+}
+
+- (void)addFailedURL:(nonnull NSURL *)url {
+    CFAbsoluteTime currentTime = CFAbsoluteTimeGetCurrent();
+    MW_LOCK(self.failedURLsLock);
+    self.failedURLs[url] = @(currentTime);
+    NSUInteger maxCount = self.maxFailedURLCount;
+    if (maxCount > 0 && self.failedURLs.count > maxCount) {
+        // Drop the expired ones first, then the oldest ones
+        NSTimeInterval expirationInterval = self.failedURLExpirationInterval;
+        NSArray<NSURL *> *sortedURLs = [self.failedURLs keysSortedByValueUsingSelector:@selector(compare:)];
+        for (NSURL *failedURL in sortedURLs) {
+            BOOL expired = expirationInterval > 0 && currentTime - self.failedURLs[failedURL].doubleValue > expirationInterval;
+            if (!expired && self.failedURLs.count <= maxCount) {
+                break;
+            }
+            [self.failedURLs removeObjectForKey:failedURL];
+        }
+    }
+    MW_UNLOCK(self.failedURLsLock);
+}
+
+#pragma mark - Retry
+
+- (void)depositRetryBudgetWithPolicy:(nonnull MWWebImageRetryPolicy *)retryPolicy {
+    MW_LOCK(self.retryBudgetLock);
+    if (self.retryBudget < 0) {
+        self.retryBudget = retryPolicy.maxRetryBudget;
+    }
+    self.retryBudget = MIN(self.retryBudget + retryPolicy.retryBudgetRatio, retryPolicy.maxRetryBudget);
+    MW_UNLOCK(self.retryBudgetLock);
+}
+
+- (BOOL)withdrawRetryBudgetWithPolicy:(nonnull MWWebImageRetryPolicy *)retryPolicy {
+    BOOL withdrawn = NO;
+    MW_LOCK(self.retryBudgetLock);
+    if (self.retryBudget < 0) {
+        self.retryBudget = retryPolicy.maxRetryBudget;
+    }
+    if (self.retryBudget >= 1) {
+        self.retryBudget -= 1;
+        withdrawn = YES;
+    }
+    MW_UNLOCK(self.retryBudgetLock);
+    return withdrawn;
+}
+
+// The delay before retrying the failed load, or a negative value if it should not be retried
+- (NSTimeInterval)retryDelayForOperation:(nonnull MWWebImageCombinedOperation *)operation
+                                     url:(nonnull NSURL *)url
+                                   error:(nonnull NSError *)error
+                                 options:(MWWebImageOptions)options
+                                 context:(nullable MWWebImageContext *)context {
+    MWWebImageRetryPolicy *retryPolicy = self.retryPolicy;
+    if (!retryPolicy || operation.retryCount >= retryPolicy.maxRetryCount) {
+        return -1;
+    }
+    if (![retryPolicy isRetryableError:error] || [self shouldBlockFailedURLWithURL:url error:error options:options context:context]) {
+        return -1;
+    }
+    // Respect the server's `Retry-After`, usually sent with 429 and 503. Retrying earlier than it asks is pointless, so a longer one fails the load
+    NSTimeInterval retryAfter = MWRetryAfterIntervalForResponse([self responseForLoaderOperation:operation.loaderOperation]);
+    if (retryAfter > retryPolicy.maxDelay) {
+        return -1;
+    }
+    if (![self withdrawRetryBudgetWithPolicy:retryPolicy]) {
+        return -1;
+    }
+    NSTimeInterval delay = MIN([retryPolicy delayForRetryCount:operation.retryCount], retryPolicy.maxDelay);
+    return MAX(delay, retryAfter);
+}
+
 #pragma mark - Private
 
 // Query normal cache process
@@ -366,6 +529,47 @@ static id<MWImageLoader> _defaultImageLoader;
                               cacheType:(MWImageCacheType)cacheType
                                progress:(nullable MWImageLoaderProgressBlock)progressBlock
                               completed:(nullable MWInternalCompletionBlock)completedBlock {
+    BOOL shouldRefreshCachedImage = cachedImage && (options & (MWWebImageRefreshCached | MWWebImageStaleWhileRevalidate));
+    if (shouldRefreshCachedImage && !context[MWWebImageContextLoaderCachedValidators]) {
+        // Query the validators stored with the cached image first, to send a conditional request
+        id<MWImageCache> imageCache;
+        if ([context[MWWebImageContextImageCache] conformsToProtocol:@protocol(MWImageCache)]) {
+            imageCache = context[MWWebImageContextImageCache];
+        } else {
+            imageCache = self.imageCache;
+        }
+        if ([imageCache respondsToSelector:@selector(queryValidatorsForKey:completion:)]) {
+            // Deliver the cached image first, a memory hit stays synchronous. The validators only decide how to revalidate it
+            [self callCompletionBlockForOperation:operation completion:completedBlock image:cachedImage data:cachedData error:nil cacheType:cacheType finished:YES url:url];
+            NSString *key = [self cacheKeyForURL:url context:context];
+            @weakify(operation);
+            [imageCache queryValidatorsForKey:key completion:^(MWImageCacheValidators * _Nullable validators) {
+                @strongify(operation);
+                if (!operation || operation.isCancelled) {
+                    // The cached image was delivered as finished, the completion is not called again
+                    [self safelyRemoveOperationFromRunning:operation];
+                    return;
+                }
+                MWWebImageMutableContext *mutableContext;
+                if (context) {
+                    mutableContext = [context mutableCopy];
+                } else {
+                    mutableContext = [NSMutableDictionary dictionary];
+                }
+                // NSNull when there are no validators, so we do not query again
+                mutableContext[MWWebImageContextLoaderCachedValidators] = validators ?: [NSNull null];
+                mutableContext[MWWebImageContextCachedImageDelivered] = @(YES);
+                [self callDownloadProcessForOperation:operation url:url options:options context:[mutableContext copy] cachedImage:cachedImage cachedData:cachedData cacheType:cacheType progress:progressBlock completed:completedBlock];
+            }];
+            return;
+        }
+    }
+    MWImageCacheValidators *cachedValidators = context[MWWebImageContextLoaderCachedValidators];
+    if (![cachedValidators isKindOfClass:MWImageCacheValidators.class]) {
+        cachedValidators = nil;
+    }
+    BOOL cachedImageDelivered = [context[MWWebImageContextCachedImageDelivered] boolValue];
+    
     // Grab the image loader to use
     id<MWImageLoader> imageLoader;
     if ([context[MWWebImageContextImageLoader] conformsToProtocol:@protocol(MWImageLoader)]) {
@@ -376,14 +580,16 @@ static id<MWImageLoader> _defaultImageLoader;
     
     // Check whether we should download image from network
     BOOL shouldDownload = !MW_OPTIONS_CONTAINS(options, MWWebImageFromCacheOnly);
-    shouldDownload &= (!cachedImage || options & MWWebImageRefreshCached);
+    shouldDownload &= (!cachedImage || options & MWWebImageRefreshCached || (options & MWWebImageStaleWhileRevalidate && !cachedValidators.isFresh));
     shouldDownload &= (![self.delegate respondsToSelector:@selector(imageManager:shouldDownloadImageForURL:)] || [self.delegate imageManager:self shouldDownloadImageForURL:url]);
     shouldDownload &= [imageLoader canRequestImageForURL:url];
     if (shouldDownload) {
-        if (cachedImage && options & MWWebImageRefreshCached) {
+        if (shouldRefreshCachedImage) {
             // If image was found in the cache but MWWebImageRefreshCached is provided, notify about the cached image
-            // AND try to re-download it in order to let a chance to NSURLCache to refresh it from server.
-            [self callCompletionBlockForOperation:operation completion:completedBlock image:cachedImage data:cachedData error:nil cacheType:cacheType finished:YES url:url];
+            // AND try to re-download it with a conditional request, or in order to let a chance to NSURLCache to refresh it from server.
+            if (!cachedImageDelivered) {
+                [self callCompletionBlockForOperation:operation completion:completedBlock image:cachedImage data:cachedData error:nil cacheType:cacheType finished:YES url:url];
+            }
             // Pass the cached image to the image loader. The image loader should check whether the remote image is equal to the cached image.
             MWWebImageMutableContext *mutableContext;
             if (context) {
@@ -392,45 +598,113 @@ static id<MWImageLoader> _defaultImageLoader;
                 mutableContext = [NSMutableDictionary dictionary];
             }
             mutableContext[MWWebImageContextLoaderCachedImage] = cachedImage;
+            if (!cachedValidators) {
+                [mutableContext removeObjectForKey:MWWebImageContextLoaderCachedValidators];
+            }
+            context = [mutableContext copy];
+        }
+        NSURL *downloadFileURL = [self downloadFileURLForURL:url options:options context:context];
+        if (downloadFileURL) {
+            MWWebImageMutableContext *mutableContext = context ? [context mutableCopy] : [NSMutableDictionary dictionary];
+            mutableContext[MWWebImageContextLoaderDownloadFileURL] = downloadFileURL;
+            // The cache the file URL comes from, which moves the downloaded file in place on its IO queue
+            if (!mutableContext[MWWebImageContextImageCache]) {
+                mutableContext[MWWebImageContextImageCache] = self.imageCache;
+            }
             context = [mutableContext copy];
         }
         
+        MWWebImageRetryPolicy *retryPolicy = self.retryPolicy;
+        if (retryPolicy && operation.retryCount == 0) {
+            [self depositRetryBudgetWithPolicy:retryPolicy];
+        }
+        
         @weakify(operation);
         operation.loaderOperation = [imageLoader requestImageWithURL:url options:options context:context progress:progressBlock completed:^(UIImage *downloadedImage, NSData *downloadedData, NSError *error, BOOL finished) {
             @strongify(operation);
             if (!operation || operation.isCancelled) {
-                // Image combined operation cancelled by user
-                [self callCompletionBlockForOperation:operation completion:completedBlock error:[NSError errorWithDomain:MWWebImageErrorDomain code:MWWebImageErrorCancelled userInfo:@{NSLocalizedDescriptionKey : @"Operation cancelled by user during sending the request"}] url:url];
-            } else if (cachedImage && options & MWWebImageRefreshCached && [error.domain isEqualToString:MWWebImageErrorDomain] && error.code == MWWebImageErrorCacheNotModified) {
-                // Image refresh hit the NSURLCache cache, do not call the completion block
+                // Image combined operation cancelled by user. Not told again if the cached image was delivered as finished before the validators query
+                if (!cachedImageDelivered) {
+                    [self callCompletionBlockForOperation:operation completion:completedBlock error:[NSError errorWithDomain:MWWebImageErrorDomain code:MWWebImageErrorCancelled userInfo:@{NSLocalizedDescriptionKey : @"Operation cancelled by user during sending the request"}] url:url];
+                }
+            } else if (shouldRefreshCachedImage && [error.domain isEqualToString:MWWebImageErrorDomain] && error.code == MWWebImageErrorCacheNotModified) {
+                // Image refresh hit the NSURLCache cache or the server validated the cached image, do not call the completion block
+                if (cachedValidators) {
+                    // The cached image is fresh again
+                    MWImageCacheValidators *validators = [cachedValidators validatorsByRevalidatingWithResponse:[self responseForLoaderOperation:operation.loaderOperation]];
+                    [self storeValidators:validators forKey:[self cacheKeyForURL:url context:context] context:context];
+                }
             } else if ([error.domain isEqualToString:MWWebImageErrorDomain] && error.code == MWWebImageErrorCancelled) {
                 // Download operation cancelled by user before sending the request, don't block failed URL
-                [self callCompletionBlockForOperation:operation completion:completedBlock error:error url:url];
+                if (!cachedImageDelivered) {
+                    [self callCompletionBlockForOperation:operation completion:completedBlock error:error url:url];
+                }
             } else if (error) {
+                // The cached image was already delivered for a refresh, do not retry it
+                NSTimeInterval retryDelay = cachedImage ? -1 : [self retryDelayForOperation:operation url:url error:error options:options context:context];
+                if (retryDelay >= 0) {
+                    // Transient failure, retry later without calling the completion block
+                    operation.retryCount++;
+                    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(retryDelay * NSEC_PER_SEC)), MWWebImageWorkQueueForPriority(operation.priority), ^{
+                        if (operation.isCancelled) {
+                            [self callCompletionBlockForOperation:operation completion:completedBlock error:[NSError errorWithDomain:MWWebImageErrorDomain code:MWWebImageErrorCancelled userInfo:@{NSLocalizedDescriptionKey : @"Operation cancelled by user while waiting to retry the request"}] url:url];
+                            [self safelyRemoveOperationFromRunning:operation];
+                            return;
+                        }
+                        [self callDownloadProcessForOperation:operation url:url options:options context:context cachedImage:cachedImage cachedData:cachedData cacheType:cacheType progress:progressBlock completed:completedBlock];
+                    });
+                    return;
+                }
                 [self callCompletionBlockForOperation:operation completion:completedBlock error:error url:url];
                 BOOL shouldBlockFailedURL = [self shouldBlockFailedURLWithURL:url error:error options:options context:context];
                 
                 if (shouldBlockFailedURL) {
-                    MW_LOCK(self.failedURLsLock);
-                    [self.failedURLs addObject:url];
-                    MW_UNLOCK(self.failedURLsLock);
+                    [self addFailedURL:url];
                 }
             } else {
                 if ((options & MWWebImageRetryFailed)) {
                     MW_LOCK(self.failedURLsLock);
-                    [self.failedURLs removeObject:url];
+                    [self.failedURLs removeObjectForKey:url];
                     MW_UNLOCK(self.failedURLsLock);
                 }
-                // Continue store cache process
-                [self callStoreCacheProcessForOperation:operation url:url options:options context:context downloadedImage:downloadedImage downloadedData:downloadedData finished:finished progress:progressBlock completed:completedBlock];
+                // Continue store cache process, with the validators to store beside the image
+                MWWebImageContext *storeContext = context;
+                MWImageCacheValidators *validators = finished ? [MWImageCacheValidators validatorsWithResponse:[self responseForLoaderOperation:operation.loaderOperation]] : nil;
+                // The download shared with another load may have kept the data in memory, or written it for another key
+                NSURL *downloadedFileURL = finished ? [self downloadedFileURLForLoaderOperation:operation.loaderOperation] : nil;
+                BOOL downloadedToFile = downloadedFileURL && [downloadedFileURL isEqual:downloadFileURL];
+                if (validators || downloadedToFile) {
+                    MWWebImageMutableContext *mutableContext = context ? [context mutableCopy] : [NSMutableDictionary dictionary];
+                    mutableContext[MWWebImageContextDownloadedValidators] = validators;
+                    if (downloadedToFile) {
+                        mutableContext[MWWebImageContextDownloadedFileURL] = downloadedFileURL;
+                    }
+                    storeContext = [mutableContext copy];
+                }
+                MWImageCache *deduplicatingCache = finished && downloadedImage ? [self deduplicatingImageCacheWithContext:context] : nil;
+                if (deduplicatingCache) {
+                    // Hash the bitmap off the main thread, the shared image is both stored and delivered
+                    dispatch_async(MWWebImageWorkQueueForPriority(operation.priority), ^{
+                        @autoreleasepool {
+                            UIImage *deduplicatedImage = [deduplicatingCache deduplicatedImageWithImage:downloadedImage];
+                            [self callStoreCacheProcessForOperation:operation url:url options:options context:storeContext downloadedImage:deduplicatedImage downloadedData:downloadedData finished:finished progress:progressBlock completed:completedBlock];
+                        }
+                    });
+                } else {
+                    [self callStoreCacheProcessForOperation:operation url:url options:options context:storeContext downloadedImage:downloadedImage downloadedData:downloadedData finished:finished progress:progressBlock completed:completedBlock];
+                }
             }
             
             if (finished) {
                 [self safelyRemoveOperationFromRunning:operation];
             }
         }];
+        // The priority may have changed during the cache query
+        [operation applyPriorityToLoaderOperation];
     } else if (cachedImage) {
-        [self callCompletionBlockForOperation:operation completion:completedBlock image:cachedImage data:cachedData error:nil cacheType:cacheType finished:YES url:url];
+        if (!cachedImageDelivered) {
+            [self callCompletionBlockForOperation:operation completion:completedBlock image:cachedImage data:cachedData error:nil cacheType:cacheType finished:YES url:url];
+        }
         [self safelyRemoveOperationFromRunning:operation];
     } else {
         // Image not in cache and download disallowed by delegate
@@ -480,7 +754,7 @@ static id<MWImageLoader> _defaultImageLoader;
         // normally use the store cache type, but if target image is transformed, use original store cache type instead
         MWImageCacheType targetStoreCacheType = shouldTransformImage ? originalStoreCacheType : storeCacheType;
         if (cacheSerializer && (targetStoreCacheType == MWImageCacheTypeDisk || targetStoreCacheType == MWImageCacheTypeAll)) {
-            dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), ^{
+            dispatch_async(MWWebImageWorkQueueForPriority(operation.priority), ^{
                 @autoreleasepool {
                     NSData *cacheData = [cacheSerializer cacheDataWithImage:downloadedImage originalData:downloadedData imageURL:url];
                     [self storeImage:downloadedImage imageData:cacheData forKey:key cacheType:targetStoreCacheType options:options context:context completion:^{
@@ -529,9 +803,14 @@ static id<MWImageLoader> _defaultImageLoader;
     shouldTransformImage = shouldTransformImage && (!originalImage.MW_isVector || (options & MWWebImageTransformVectorImage));
     // if available, store transformed image to cache
     if (shouldTransformImage) {
-        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), ^{
+        dispatch_async(MWWebImageWorkQueueForPriority(operation.priority), ^{
             @autoreleasepool {
+                CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
                 UIImage *transformedImage = [transformer transformedImageWithImage:originalImage forKey:key];
+                if (transformedImage && ![transformedImage isEqual:originalImage]) {
+                    // Rebuilding the transformed image means decoding the original again, then transforming it
+                    transformedImage.MW_rebuildCost = originalImage.MW_rebuildCost + (CFAbsoluteTimeGetCurrent() - startTime);
+                }
                 if (transformedImage && finished) {
                     BOOL imageWasTransformed = ![transformedImage isEqual:originalImage];
                     NSData *cacheData;
@@ -579,14 +858,28 @@ static id<MWImageLoader> _defaultImageLoader;
         imageCache = self.imageCache;
     }
     BOOL waitStoreCache = MW_OPTIONS_CONTAINS(options, MWWebImageWaitStoreCache);
+    MWImageCacheType imageCacheType = cacheType;
+    NSURL *downloadedFileURL = context[MWWebImageContextDownloadedFileURL];
+    if (downloadedFileURL && (cacheType == MWImageCacheTypeDisk || cacheType == MWImageCacheTypeAll)) {
+        // The downloader already moved the data into the disk cache, do not write it again
+        imageCacheType = cacheType == MWImageCacheTypeAll ? MWImageCacheTypeMemory : MWImageCacheTypeNone;
+        if ([imageCache isKindOfClass:MWImageCache.class] && ((MWImageCache *)imageCache).config.shouldDisableiCloud) {
+            [downloadedFileURL setResourceValue:@YES forKey:NSURLIsExcludedFromBackupKey error:nil];
+        }
+    }
     // Check whether we should wait the store cache finished. If not, callback immediately
-    [imageCache storeImage:image imageData:data forKey:key cacheType:cacheType completion:^{
+    [imageCache storeImage:image imageData:data forKey:key cacheType:imageCacheType completion:^{
         if (waitStoreCache) {
             if (completion) {
                 completion();
             }
         }
     }];
+    // The validators are kept with the disk data, stored after it
+    MWImageCacheValidators *validators = context[MWWebImageContextDownloadedValidators];
+    if (validators && (cacheType == MWImageCacheTypeDisk || cacheType == MWImageCacheTypeAll)) {
+        [self storeValidators:validators forKey:key context:context];
+    }
     if (!waitStoreCache) {
         if (completion) {
             completion();
@@ -594,6 +887,79 @@ static id<MWImageLoader> _defaultImageLoader;
     }
 }
 
+- (nullable MWImageCache *)deduplicatingImageCacheWithContext:(nullable MWWebImageContext *)context {
+    id<MWImageCache> imageCache;
+    if ([context[MWWebImageContextImageCache] conformsToProtocol:@protocol(MWImageCache)]) {
+        imageCache = context[MWWebImageContextImageCache];
+    } else {
+        imageCache = self.imageCache;
+    }
+    if (![imageCache isKindOfClass:[MWImageCache class]] || !((MWImageCache *)imageCache).config.shouldDeduplicateImagesInMemory) {
+        return nil;
+    }
+    return (MWImageCache *)imageCache;
+}
+
+- (void)storeValidators:(nonnull MWImageCacheValidators *)validators
+                 forKey:(nullable NSString *)key
+                context:(nullable MWWebImageContext *)context {
+    id<MWImageCache> imageCache;
+    if ([context[MWWebImageContextImageCache] conformsToProtocol:@protocol(MWImageCache)]) {
+        imageCache = context[MWWebImageContextImageCache];
+    } else {
+        imageCache = self.imageCache;
+    }
+    if ([imageCache respondsToSelector:@selector(storeValidators:forKey:)]) {
+        [imageCache storeValidators:validators forKey:key];
+    }
+}
+
+- (nullable NSURLResponse *)responseForLoaderOperation:(nullable id<MWWebImageOperation>)loaderOperation {
+    if ([loaderOperation respondsToSelector:@selector(response)]) {
+        return [(id)loaderOperation response];
+    }
+    return nil;
+}
+
+- (nullable NSURL *)downloadedFileURLForLoaderOperation:(nullable id<MWWebImageOperation>)loaderOperation {
+    if ([loaderOperation respondsToSelector:@selector(downloadedFileURL)]) {
+        return [(id)loaderOperation downloadedFileURL];
+    }
+    return nil;
+}
+
+// The disk cache file to download into with `MWWebImageDownloadToFile`, nil if the downloaded data is not stored as it is
+- (nullable NSURL *)downloadFileURLForURL:(nonnull NSURL *)url
+                                  options:(MWWebImageOptions)options
+                                  context:(nullable MWWebImageContext *)context {
+    if (!(options & MWWebImageDownloadToFile)) {
+        return nil;
+    }
+    MWImageCacheType storeCacheType = MWImageCacheTypeAll;
+    if (context[MWWebImageContextStoreCacheType]) {
+        storeCacheType = [context[MWWebImageContextStoreCacheType] integerValue];
+    }
+    if (storeCacheType != MWImageCacheTypeDisk && storeCacheType != MWImageCacheTypeAll) {
+        return nil;
+    }
+    // The transformed image is stored under another key, the serialized data is not the downloaded one
+    if ([context[MWWebImageContextImageTransformer] conformsToProtocol:@protocol(MWImageTransformer)] || [context[MWWebImageContextCacheSerializer] conformsToProtocol:@protocol(MWWebImageCacheSerializer)]) {
+        return nil;
+    }
+    id<MWImageCache> imageCache;
+    if ([context[MWWebImageContextImageCache] conformsToProtocol:@protocol(MWImageCache)]) {
+        imageCache = context[MWWebImageContextImageCache];
+    } else {
+        imageCache = self.imageCache;
+    }
+    // Only `MWImageCache` has a known file for a key
+    if (![imageCache isKindOfClass:MWImageCache.class]) {
+        return nil;
+    }
+    NSString *path = [(MWImageCache *)imageCache cachePathForKey:[self cacheKeyForURL:url context:context]];
+    return path ? [NSURL fileURLWithPath:path] : nil;
+}
+
 - (void)callCompletionBlockForOperation:(nullable MWWebImageCombinedOperation*)operation
                              completion:(nullable MWInternalCompletionBlock)completionBlock
                                   error:(nullable NSError *)error
@@ -673,14 +1039,81 @@ static id<MWImageLoader> _defaultImageLoader;
         result = [[MWWebImageOptionsResult alloc] initWithOptions:options context:context];
     }
     
+    // Variant from the request modifier, before the cache key is built
+    context = result.context;
+    if (url && !context[MWWebImageContextImageVariant]) {
+        NSString *variant = [self variantForURL:url context:context];
+        if (variant) {
+            MWWebImageMutableContext *variantContext = context ? [context mutableCopy] : [MWWebImageMutableContext dictionary];
+            variantContext[MWWebImageContextImageVariant] = variant;
+            result = [[MWWebImageOptionsResult alloc] initWithOptions:result.options context:[variantContext copy]];
+        }
+    }
+    
     return result;
 }
 
+- (nullable NSString *)variantForURL:(nonnull NSURL *)url context:(nullable MWWebImageContext *)context {
+    id<MWWebImageDownloaderRequestModifier> requestModifier = context[MWWebImageContextDownloadRequestModifier];
+    if (!requestModifier) {
+        id<MWImageLoader> imageLoader = self.imageLoader;
+        if ([context[MWWebImageContextImageLoader] conformsToProtocol:@protocol(MWImageLoader)]) {
+            imageLoader = context[MWWebImageContextImageLoader];
+        }
+        if ([imageLoader isKindOfClass:MWWebImageDownloader.class]) {
+            requestModifier = ((MWWebImageDownloader *)imageLoader).requestModifier;
+        }
+    }
+    if (![requestModifier respondsToSelector:@selector(variantForURL:context:)]) {
+        return nil;
+    }
+    NSString *variant = [requestModifier variantForURL:url context:context];
+    return variant.length > 0 ? variant : nil;
+}
+
 @end
 
 
 @implementation MWWebImageCombinedOperation
 
+@synthesize priority = _priority;
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _priority = MWWebImageOperationPriorityDefault;
+    }
+    return self;
+}
+
+- (MWWebImageOperationPriority)priority {
+    @synchronized(self) {
+        return _priority;
+    }
+}
+
+- (void)setPriority:(MWWebImageOperationPriority)priority {
+    @synchronized(self) {
+        _priority = MIN(MAX(priority, 0), 1);
+    }
+    [self applyPriorityToLoaderOperation];
+}
+
+- (void)applyPriorityToLoaderOperation {
+    id<MWWebImageOperation> loaderOperation;
+    MWWebImageOperationPriority priority;
+    @synchronized(self) {
+        if (self.isCancelled) {
+            return;
+        }
+        loaderOperation = self.loaderOperation;
+        priority = _priority;
+    }
+    if ([loaderOperation respondsToSelector:@selector(setPriority:)]) {
+        loaderOperation.priority = priority;
+    }
+}
+
 - (void)cancel {
     @synchronized(self) {
         if (self.isCancelled) {
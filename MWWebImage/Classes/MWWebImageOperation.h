@@ -8,11 +8,32 @@
 
 #import <Foundation/Foundation.h>
 
+/// The priority of an image load, from 0.0 (lowest) to 1.0 (highest). Same scale as `NSURLSessionTask.priority`.
+typedef float MWWebImageOperationPriority;
+
+/// The priority of `MWWebImageLowPriority` loads, such as prefetching (0.25)
+FOUNDATION_EXPORT const MWWebImageOperationPriority MWWebImageOperationPriorityLow;
+/// The priority of loads without priority options (0.5)
+FOUNDATION_EXPORT const MWWebImageOperationPriority MWWebImageOperationPriorityDefault;
+/// The priority of `MWWebImageHighPriority` loads, such as visible views (0.75)
+FOUNDATION_EXPORT const MWWebImageOperationPriority MWWebImageOperationPriorityHigh;
+
+/// The operation queue priority matching the load priority
+FOUNDATION_EXPORT NSOperationQueuePriority MWWebImageOperationQueuePriorityForPriority(MWWebImageOperationPriority priority);
+/// The quality of service matching the load priority, used for the decoding and transforming work
+FOUNDATION_EXPORT NSQualityOfService MWWebImageOperationQualityOfServiceForPriority(MWWebImageOperationPriority priority);
+
 /// A protocol represents cancelable operation.
 @protocol MWWebImageOperation <NSObject>
 
 - (void)cancel;
 
+@optional
+/**
+ The priority of the operation. It can be changed while the operation is queued or running, for example when its view scrolls on or off screen.
+ */
+@property (assign, nonatomic) MWWebImageOperationPriority priority;
+
 @end
 
 /// NSOperation conform to `MWWebImageOperation`.
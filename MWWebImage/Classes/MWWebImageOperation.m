@@ -8,6 +8,34 @@
 
 #import "MWWebImageOperation.h"
 
+const MWWebImageOperationPriority MWWebImageOperationPriorityLow = 0.25;
+const MWWebImageOperationPriority MWWebImageOperationPriorityDefault = 0.5;
+const MWWebImageOperationPriority MWWebImageOperationPriorityHigh = 0.75;
+
+NSOperationQueuePriority MWWebImageOperationQueuePriorityForPriority(MWWebImageOperationPriority priority) {
+    if (priority >= 0.875) {
+        return NSOperationQueuePriorityVeryHigh;
+    } else if (priority >= 0.625) {
+        return NSOperationQueuePriorityHigh;
+    } else if (priority > 0.375) {
+        return NSOperationQueuePriorityNormal;
+    } else if (priority > 0.125) {
+        return NSOperationQueuePriorityLow;
+    } else {
+        return NSOperationQueuePriorityVeryLow;
+    }
+}
+
+NSQualityOfService MWWebImageOperationQualityOfServiceForPriority(MWWebImageOperationPriority priority) {
+    if (priority >= 0.625) {
+        return NSQualityOfServiceUserInteractive;
+    } else if (priority > 0.375) {
+        return NSQualityOfServiceDefault;
+    } else {
+        return NSQualityOfServiceBackground;
+    }
+}
+
 /// NSOperation conform to `MWWebImageOperation`.
 @implementation NSOperation (MWWebImageOperation)
 
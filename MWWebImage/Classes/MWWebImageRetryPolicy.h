@@ -0,0 +1,78 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "MWWebImageCompat.h"
+
+/**
+ The retry policy of `MWWebImageManager` for the transient load failures, such as a timeout or a 503 response.
+ A failed load is retried after an exponential backoff with full jitter: the n-th retry waits a random delay between 0 and `MIN(maxDelay, baseDelay * 2^n)`, or as long as the server asks with a `Retry-After` header.
+ The retries are limited by a shared budget, so a failing server is not flooded: each load earns `retryBudgetRatio` retry, each retry spends one, and the budget can not exceed `maxRetryBudget`.
+ @note This class conform to NSCopying, make sure to add the property in `copyWithZone:` as well.
+ */
+@interface MWWebImageRetryPolicy : NSObject <NSCopying>
+
+/**
+ Gets the default retry policy. Assign it to `MWWebImageManager.retryPolicy` to enable the retries with the default values.
+ */
+@property (nonatomic, class, readonly, nonnull) MWWebImageRetryPolicy *defaultRetryPolicy;
+
+/**
+ * The maximum number of retries of one load.
+ * Defaults to 3.
+ */
+@property (nonatomic, assign) NSUInteger maxRetryCount;
+
+/**
+ * The backoff of the first retry, in seconds. It doubles for each following retry.
+ * Defaults to 0.5.
+ */
+@property (nonatomic, assign) NSTimeInterval baseDelay;
+
+/**
+ * The maximum backoff of one retry, in seconds. If the server asks for a longer wait with `Retry-After`, in delay-seconds or as an HTTP-date, the load fails without retrying.
+ * Defaults to 30.
+ */
+@property (nonatomic, assign) NSTimeInterval maxDelay;
+
+/**
+ * The retry budget earned by each load. For example 0.1 means at most one retry for ten loads in the long run.
+ * Defaults to 0.1.
+ */
+@property (nonatomic, assign) double retryBudgetRatio;
+
+/**
+ * The maximum retry budget, which is also the initial budget, allowing a burst of retries.
+ * Defaults to 10.
+ */
+@property (nonatomic, assign) double maxRetryBudget;
+
+/**
+ * The HTTP status codes which are transient.
+ * Defaults to 408, 429, 500, 502, 503 and 504.
+ */
+@property (nonatomic, copy, nonnull) NSIndexSet *retryableStatusCodes;
+
+/**
+ Whether the error is transient, and the load worth a retry. The default implementation accepts the timeouts, the lost connections and the `retryableStatusCodes`. Subclasses can override it.
+ @note The errors blocked by `-[MWImageLoader shouldBlockFailedURLWithURL:error:]` are never retried.
+
+ @param error The load error
+ @return YES to retry the load
+ */
+- (BOOL)isRetryableError:(nonnull NSError *)error;
+
+/**
+ The backoff before a retry, with jitter.
+
+ @param retryCount The number of retries already done for the load, 0 for the first retry
+ @return The delay in seconds
+ */
+- (NSTimeInterval)delayForRetryCount:(NSUInteger)retryCount;
+
+@end
@@ -0,0 +1,78 @@
+/*
+ * This file is part of the MWWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "MWWebImageRetryPolicy.h"
+#import "MWWebImageError.h"
+
+static MWWebImageRetryPolicy * _defaultRetryPolicy;
+
+@implementation MWWebImageRetryPolicy
+
++ (MWWebImageRetryPolicy *)defaultRetryPolicy {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        _defaultRetryPolicy = [MWWebImageRetryPolicy new];
+    });
+    return _defaultRetryPolicy;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _maxRetryCount = 3;
+        _baseDelay = 0.5;
+        _maxDelay = 30;
+        _retryBudgetRatio = 0.1;
+        _maxRetryBudget = 10;
+        NSMutableIndexSet *retryableStatusCodes = [NSMutableIndexSet indexSet];
+        [retryableStatusCodes addIndex:408];
+        [retryableStatusCodes addIndex:429];
+        [retryableStatusCodes addIndex:500];
+        [retryableStatusCodes addIndexesInRange:NSMakeRange(502, 3)];
+        _retryableStatusCodes = [retryableStatusCodes copy];
+    }
+    return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    MWWebImageRetryPolicy *policy = [[[self class] allocWithZone:zone] init];
+    policy.maxRetryCount = self.maxRetryCount;
+    policy.baseDelay = self.baseDelay;
+    policy.maxDelay = self.maxDelay;
+    policy.retryBudgetRatio = self.retryBudgetRatio;
+    policy.maxRetryBudget = self.maxRetryBudget;
+    policy.retryableStatusCodes = self.retryableStatusCodes;
+    
+    return policy;
+}
+
+- (BOOL)isRetryableError:(NSError *)error {
+    if ([error.domain isEqualToString:MWWebImageErrorDomain]) {
+        if (error.code == MWWebImageErrorInvalidDownloadStatusCode) {
+            NSInteger statusCode = [error.userInfo[MWWebImageErrorDownloadStatusCodeKey] integerValue];
+            return statusCode > 0 && [self.retryableStatusCodes containsIndex:statusCode];
+        }
+        return NO;
+    } else if ([error.domain isEqualToString:NSURLErrorDomain]) {
+        // Not `NSURLErrorNotConnectedToInternet`, retrying offline only drains the budget
+        return (   error.code == NSURLErrorTimedOut
+                || error.code == NSURLErrorNetworkConnectionLost
+                || error.code == NSURLErrorCannotConnectToHost
+                || error.code == NSURLErrorCannotFindHost
+                || error.code == NSURLErrorDNSLookupFailed);
+    }
+    return NO;
+}
+
+- (NSTimeInterval)delayForRetryCount:(NSUInteger)retryCount {
+    // Full jitter spreads the retries of the loads which failed together
+    NSTimeInterval backoff = MIN(self.maxDelay, self.baseDelay * pow(2, MIN(retryCount, 32)));
+    return backoff * arc4random_uniform(UINT32_MAX) / UINT32_MAX;
+}
+
+@end
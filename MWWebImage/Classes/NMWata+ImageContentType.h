@@ -25,6 +25,7 @@ static const MWImageFormat MWImageFormatHEIC      = 5;
 static const MWImageFormat MWImageFormatHEIF      = 6;
 static const MWImageFormat MWImageFormatPDF       = 7;
 static const MWImageFormat MWImageFormatSVG       = 8;
+static const MWImageFormat MWImageFormatAVIF      = 9;
 
 /**
  NSData category about the image content type and UTI.
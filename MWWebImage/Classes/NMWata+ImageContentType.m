@@ -61,6 +61,10 @@
                 if ([testString isEqualToString:@"ftypmif1"] || [testString isEqualToString:@"ftypmsf1"]) {
                     return MWImageFormatHEIF;
                 }
+                //....ftypavif ....ftypavis
+                if ([testString isEqualToString:@"ftypavif"] || [testString isEqualToString:@"ftypavis"]) {
+                    return MWImageFormatAVIF;
+                }
             }
             break;
         }
@@ -113,6 +117,9 @@
         case MWImageFormatSVG:
             UTType = kUTTypeScalableVectorGraphics;
             break;
+        case MWImageFormatAVIF:
+            UTType = kMWUTTypeAVIF;
+            break;
         default:
             // default is kUTTypeImage abstract type
             UTType = kUTTypeImage;
@@ -144,6 +151,8 @@
         imageFormat = MWImageFormatPDF;
     } else if (CFStringCompare(uttype, kUTTypeScalableVectorGraphics, 0) == kCFCompareEqualTo) {
         imageFormat = MWImageFormatSVG;
+    } else if (CFStringCompare(uttype, kMWUTTypeAVIF, 0) == kCFCompareEqualTo) {
+        imageFormat = MWImageFormatAVIF;
     } else {
         imageFormat = MWImageFormatUndefined;
     }
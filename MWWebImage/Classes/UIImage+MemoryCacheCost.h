@@ -24,4 +24,10 @@
  */
 @property (assign, nonatomic) NSUInteger MW_memoryCost;
 
+/**
+ The time in seconds it took to produce this image, including the decoding and the image transformer if any. It's recorded by the built-in decoding and transform process, and defaults to 0 when unknown.
+ The memory cache uses this value as the cost to rebuild the image when `MWImageCacheConfig.memoryCacheEvictionType` is `MWImageCacheConfigMemoryEvictionTypeGreedyDualSize`.
+ */
+@property (assign, nonatomic) NSTimeInterval MW_rebuildCost;
+
 @end
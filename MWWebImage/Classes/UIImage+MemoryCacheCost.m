@@ -43,4 +43,13 @@ FOUNDATION_STATIC_INLINE NSUInteger MWMemoryCacheCostForImage(UIImage *image) {
     objc_setAssociatedObject(self, @selector(MW_memoryCost), @(MW_memoryCost), OBJC_ASSOCIATION_RETAIN_NONATOMIC);
 }
 
+- (NSTimeInterval)MW_rebuildCost {
+    NSNumber *value = objc_getAssociatedObject(self, @selector(MW_rebuildCost));
+    return value.doubleValue;
+}
+
+- (void)setMW_rebuildCost:(NSTimeInterval)MW_rebuildCost {
+    objc_setAssociatedObject(self, @selector(MW_rebuildCost), @(MW_rebuildCost), OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+}
+
 @end
@@ -85,6 +85,15 @@ typedef void(^MWSetImageBlock)(UIImage * _Nullable image, NSData * _Nullable ima
  */
 - (void)MW_cancelCurrentImageLoad;
 
+/**
+ * Change the priority of the current image load, while it is queued or running. Does nothing if there is no current load.
+ * Typically raise it to `MWWebImageOperationPriorityHigh` when the view scrolls on screen, and lower it to `MWWebImageOperationPriorityLow` when it scrolls off screen, instead of cancelling the load.
+ * @note The priority is forwarded to the download queue, the `NSURLSessionTask.priority`, and the decoding and transforming work which has not started yet.
+ *
+ * @param priority The new priority, from 0.0 to 1.0
+ */
+- (void)MW_setImageLoadPriority:(MWWebImageOperationPriority)priority;
+
 #if MW_UIKIT || MW_MAC
 
 #pragma mark - Image Transition
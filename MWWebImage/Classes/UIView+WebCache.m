@@ -67,6 +67,17 @@ const int64_t MWWebImageProgressUnitCountUnknown = 1LL;
         mutableContext[MWWebImageContextSetImageOperationKey] = validOperationKey;
         context = [mutableContext copy];
     }
+#if MW_UIKIT || MW_MAC
+    if (!context[MWWebImageContextImageTargetPixelSize] && [NSThread isMainThread]) {
+        // pass through the displayed pixel size, which loaders can use to request a matching variant
+        CGSize targetPixelSize = [self MW_targetPixelSize];
+        if (targetPixelSize.width > 0 && targetPixelSize.height > 0) {
+            MWWebImageMutableContext *mutableContext = [context mutableCopy];
+            mutableContext[MWWebImageContextImageTargetPixelSize] = @(targetPixelSize);
+            context = [mutableContext copy];
+        }
+    }
+#endif
     self.MW_latestOperationKey = validOperationKey;
     [self MW_cancelImageLoadOperationWithKey:validOperationKey];
     self.MW_imageURL = url;
@@ -228,6 +239,25 @@ const int64_t MWWebImageProgressUnitCountUnknown = 1LL;
     self.MW_latestOperationKey = nil;
 }
 
+#if MW_UIKIT || MW_MAC
+- (CGSize)MW_targetPixelSize {
+    CGSize size = self.bounds.size;
+#if MW_UIKIT
+    CGFloat scale = self.window.screen.scale ?: [UIScreen mainScreen].scale;
+#else
+    CGFloat scale = self.window.backingScaleFactor ?: [NSScreen mainScreen].backingScaleFactor;
+#endif
+    return CGSizeMake(ceil(size.width * scale), ceil(size.height * scale));
+}
+#endif
+
+- (void)MW_setImageLoadPriority:(MWWebImageOperationPriority)priority {
+    id<MWWebImageOperation> operation = [self MW_imageLoadOperationForKey:self.MW_latestOperationKey];
+    if ([operation respondsToSelector:@selector(setPriority:)]) {
+        operation.priority = priority;
+    }
+}
+
 - (void)MW_setImage:(UIImage *)image imageData:(NSData *)imageData basedOnClassOrViaCustomSetImageBlock:(MWSetImageBlock)setImageBlock cacheType:(MWImageCacheType)cacheType imageURL:(NSURL *)imageURL {
 #if MW_UIKIT || MW_MAC
     [self MW_setImage:image imageData:imageData basedOnClassOrViaCustomSetImageBlock:setImageBlock transition:nil cacheType:cacheType imageURL:imageURL];